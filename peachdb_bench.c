@@ -0,0 +1,567 @@
+/*==================[ PEACHDB MICRO-BENCHMARK ]==================
+ * Drives the public Peach_* API over collections of configurable size
+ * and reports one result row per (rows, workload, threads) combination.
+ *
+ * Usage:
+ *   ./peachdb_bench [--rows 10000,100000,1000000,10000000]
+ *                   [--threads 1,2,4,8]
+ *                   [--ops 20]
+ *                   [--workloads seq_write,rand_read,mixed,...]
+ *                   [--format csv|json]
+ *                   [--out results.csv]
+ *                   [--dir peachbench]
+ *                   [--cache-mb 8]
+ *
+ * Workloads:
+ *   seq_write    Peach_write_record with ascending, unused keys
+ *   rand_write   Peach_write_record with random, unused keys
+ *   seq_read     Peach_read_all_records (full forward scan)
+ *   rand_read    Peach_read_all_records + lookup of a random key
+ *   rand_query   Peach_query for a random key (limit 1, projected)
+ *   last_page    Peach_read_last_n of the newest 50 records (backward scan)
+ *   highest_key  Peach_get_highest_key
+ *   rand_update  Peach_update_record on a random existing key
+ *   rand_delete  Peach_delete_record on distinct random existing keys
+ *   mixed        80% rand_read, 10% seq_write, 10% rand_update
+ *
+ * The benchmark runs inside its own working directory (--dir) because
+ * PeachDB always resolves 'peachdata/' relative to the current directory.
+ * Collections are bulk-loaded by appending lines directly to the .lpdb
+ * file; loading 10M rows through Peach_write_record would be quadratic.
+ * The record cache is invalidated after every load. --cache-mb sets the
+ * cache budget (0 measures the uncached, on-disk path).
+ ==========================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "src/server/services/peachdb/peachdb.h"
+
+#define BENCH_MAX_LIST 16
+#define BENCH_COLLECTIONS_PATH "peachdata/collections"
+
+typedef enum {
+    WL_SEQ_WRITE,
+    WL_RAND_WRITE,
+    WL_SEQ_READ,
+    WL_RAND_READ,
+    WL_RAND_QUERY,
+    WL_LAST_PAGE,
+    WL_HIGHEST_KEY,
+    WL_RAND_UPDATE,
+    WL_RAND_DELETE,
+    WL_MIXED,
+    WL_COUNT
+} Workload;
+
+static const char* WORKLOAD_NAMES[WL_COUNT] = {
+    "seq_write", "rand_write", "seq_read", "rand_read", "rand_query",
+    "last_page", "highest_key", "rand_update", "rand_delete", "mixed"
+};
+
+typedef struct {
+    long rows[BENCH_MAX_LIST];
+    int rows_count;
+    int threads[BENCH_MAX_LIST];
+    int threads_count;
+    bool workloads[WL_COUNT];
+    int ops;
+    bool json;
+    const char* out_path;
+    const char* dir;
+    long cache_mb;              // -1 keeps the engine default
+} BenchConfig;
+
+// State shared by all worker threads of a single run.
+typedef struct {
+    const char* collection;
+    Workload workload;
+    long rows;
+    int ops_per_thread;
+    long next_seq_key;          // Next unused ascending key (protected by key_mutex)
+    long next_delete_slot;      // Next slot in the delete permutation (protected by key_mutex)
+    pthread_mutex_t key_mutex;
+} BenchShared;
+
+typedef struct {
+    BenchShared* shared;
+    unsigned int seed;
+    double* latencies_us;
+    int completed;
+    int errors;
+} BenchWorker;
+
+typedef struct {
+    long rows;
+    Workload workload;
+    int threads;
+    int ops;
+    int errors;
+    double seconds;
+    double avg_us;
+    double p50_us;
+    double p95_us;
+    double p99_us;
+    double max_us;
+} BenchResult;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Small, thread-local xorshift PRNG so workers never contend on rand().
+static unsigned int next_random(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x ? x : 0x9e3779b9u;
+    return *state;
+}
+
+static long random_key(unsigned int* state, long rows) {
+    unsigned long r = ((unsigned long)next_random(state) << 32) | next_random(state);
+    return 1 + (long)(r % (unsigned long)rows);
+}
+
+static int parse_long_list(const char* arg, long* out, int max) {
+    int count = 0;
+    char* copy = strdup(arg);
+    char* saveptr = NULL;
+    for (char* tok = strtok_r(copy, ",", &saveptr); tok != NULL && count < max; tok = strtok_r(NULL, ",", &saveptr)) {
+        long value = atol(tok);
+        if (value > 0) out[count++] = value;
+    }
+    free(copy);
+    return count;
+}
+
+static int parse_workloads(const char* arg, bool* out) {
+    memset(out, 0, sizeof(bool) * WL_COUNT);
+    int count = 0;
+    char* copy = strdup(arg);
+    char* saveptr = NULL;
+    for (char* tok = strtok_r(copy, ",", &saveptr); tok != NULL; tok = strtok_r(NULL, ",", &saveptr)) {
+        if (strcmp(tok, "all") == 0) {
+            for (int i = 0; i < WL_COUNT; i++) out[i] = true;
+            count = WL_COUNT;
+            continue;
+        }
+        bool known = false;
+        for (int i = 0; i < WL_COUNT; i++) {
+            if (strcmp(tok, WORKLOAD_NAMES[i]) == 0) {
+                if (!out[i]) count++;
+                out[i] = true;
+                known = true;
+            }
+        }
+        if (!known) {
+            fprintf(stderr, "Unknown workload '%s'.\n", tok);
+        }
+    }
+    free(copy);
+    return count;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [--rows N,...] [--threads N,...] [--ops N] [--workloads a,b|all]\n"
+            "          [--format csv|json] [--out FILE] [--dir DIR] [--cache-mb N]\n", prog);
+}
+
+static int parse_args(int argc, char** argv, BenchConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->rows[0] = 10000;
+    config->rows[1] = 100000;
+    config->rows_count = 2;
+    config->threads[0] = 1;
+    config->threads[1] = 2;
+    config->threads[2] = 4;
+    config->threads_count = 3;
+    config->ops = 20;
+    config->dir = "peachbench";
+    config->cache_mb = -1;
+    for (int i = 0; i < WL_COUNT; i++) config->workloads[i] = true;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        if (strcmp(arg, "--rows") == 0) {
+            config->rows_count = parse_long_list(value, config->rows, BENCH_MAX_LIST);
+        } else if (strcmp(arg, "--threads") == 0) {
+            long threads[BENCH_MAX_LIST];
+            config->threads_count = parse_long_list(value, threads, BENCH_MAX_LIST);
+            for (int t = 0; t < config->threads_count; t++) config->threads[t] = (int)threads[t];
+        } else if (strcmp(arg, "--ops") == 0) {
+            config->ops = atoi(value);
+        } else if (strcmp(arg, "--workloads") == 0) {
+            if (parse_workloads(value, config->workloads) == 0) return -1;
+        } else if (strcmp(arg, "--format") == 0) {
+            config->json = (strcmp(value, "json") == 0);
+        } else if (strcmp(arg, "--out") == 0) {
+            config->out_path = value;
+        } else if (strcmp(arg, "--dir") == 0) {
+            config->dir = value;
+        } else if (strcmp(arg, "--cache-mb") == 0) {
+            config->cache_mb = atol(value);
+        } else {
+            print_usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+
+    if (config->rows_count == 0 || config->threads_count == 0 || config->ops <= 0) {
+        print_usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+// Creates '{name}' and bulk-loads 'rows' records with keys 1..rows.
+static int populate_collection(const char* name, long rows) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.lpdb", BENCH_COLLECTIONS_PATH, name);
+
+    if (access(path, F_OK) != 0) {
+        if (Peach_collection_create(name, "id^name^email^payload") != 0) {
+            return -1;
+        }
+    }
+
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Bench Error: Could not open '%s' for bulk load.\n", path);
+        return -1;
+    }
+    fprintf(file, "id^name^email^payload\n");
+    for (long key = 1; key <= rows; key++) {
+        fprintf(file, "%ld^user%ld^user%ld@example.com^lorem-ipsum-dolor-sit-amet-%08ld\n", key, key, key, key);
+    }
+    fclose(file);
+
+    // The file changed behind PeachDB's back
+    Peach_cache_invalidate(name);
+    return 0;
+}
+
+static bool is_mutating(Workload workload) {
+    return workload == WL_SEQ_WRITE || workload == WL_RAND_WRITE ||
+           workload == WL_RAND_UPDATE || workload == WL_RAND_DELETE || workload == WL_MIXED;
+}
+
+static int op_read(BenchShared* shared, unsigned int* seed, bool lookup) {
+    PeachRecordSet* set = Peach_read_all_records(shared->collection);
+    if (set == NULL) return -1;
+
+    int status = 0;
+    if (lookup) {
+        char key[32];
+        snprintf(key, sizeof(key), "%ld", random_key(seed, shared->rows));
+        status = -1;
+        for (PeachRecord* rec = set->head; rec != NULL; rec = rec->next) {
+            if (strcmp(rec->fields[0], key) == 0) {
+                status = 0;
+                break;
+            }
+        }
+    }
+    Peach_free_record_set(set);
+    return status;
+}
+
+static int op_query(BenchShared* shared, unsigned int* seed) {
+    static const int select[] = { 1, 2 }; // name^email
+    PeachPredicate by_key = { .field = 0, .op = PEACH_EQ, .number = random_key(seed, shared->rows) };
+    PeachQuery query = { .where = &by_key, .where_count = 1, .select = select, .select_count = 2, .limit = 1 };
+
+    PeachRecordSet* set = Peach_query(shared->collection, &query);
+    if (set == NULL) return -1;
+    int status = set->record_count == 1 ? 0 : -1;
+    Peach_free_record_set(set);
+    return status;
+}
+
+static int op_last_page(BenchShared* shared) {
+    const int page = 50;
+    PeachRecordSet* set = Peach_read_last_n(shared->collection, page);
+    if (set == NULL) return -1;
+    long expected = shared->rows < page ? shared->rows : page;
+    int status = set->record_count == expected ? 0 : -1;
+    Peach_free_record_set(set);
+    return status;
+}
+
+static int op_write(BenchShared* shared, long key) {
+    char record[256];
+    snprintf(record, sizeof(record), "%ld^user%ld^user%ld@example.com^lorem-ipsum-dolor-sit-amet-%08ld", key, key, key, key);
+    int status = Peach_write_record(shared->collection, record);
+    return status;
+}
+
+static int op_update(BenchShared* shared, long key) {
+    char key_str[32];
+    char record[256];
+    snprintf(key_str, sizeof(key_str), "%ld", key);
+    snprintf(record, sizeof(record), "%ld^updated%ld^updated%ld@example.com^lorem-ipsum-dolor-sit-amet-%08ld", key, key, key, key);
+    int status = Peach_update_record(shared->collection, key_str, record);
+    return status;
+}
+
+static int op_delete(BenchShared* shared, long key) {
+    char key_str[32];
+    snprintf(key_str, sizeof(key_str), "%ld", key);
+    int status = Peach_delete_record(shared->collection, key_str);
+    return status;
+}
+
+static long take_seq_key(BenchShared* shared) {
+    pthread_mutex_lock(&shared->key_mutex);
+    long key = shared->next_seq_key++;
+    pthread_mutex_unlock(&shared->key_mutex);
+    return key;
+}
+
+// Walks keys 1..rows in a fixed pseudo-random permutation so that every
+// delete targets a distinct, existing record.
+static long take_delete_key(BenchShared* shared) {
+    const long stride = 1000003; // Prime, so it is coprime with almost every row count
+    pthread_mutex_lock(&shared->key_mutex);
+    long slot = shared->next_delete_slot++;
+    pthread_mutex_unlock(&shared->key_mutex);
+    long step = (shared->rows % stride == 0) ? 1 : stride;
+    return 1 + (long)(((unsigned long)slot * (unsigned long)step) % (unsigned long)shared->rows);
+}
+
+static int run_one_op(BenchWorker* worker) {
+    BenchShared* shared = worker->shared;
+    switch (shared->workload) {
+        case WL_SEQ_WRITE:
+            return op_write(shared, take_seq_key(shared));
+        case WL_RAND_WRITE:
+            // Random keys well above the loaded range never collide with existing rows
+            return op_write(shared, shared->rows * 4 + random_key(&worker->seed, shared->rows * 1000));
+        case WL_SEQ_READ:
+            return op_read(shared, &worker->seed, false);
+        case WL_RAND_READ:
+            return op_read(shared, &worker->seed, true);
+        case WL_RAND_QUERY:
+            return op_query(shared, &worker->seed);
+        case WL_LAST_PAGE:
+            return op_last_page(shared);
+        case WL_HIGHEST_KEY: {
+            long key = Peach_get_highest_key(shared->collection);
+            return key < 0 ? -1 : 0;
+        }
+        case WL_RAND_UPDATE:
+            return op_update(shared, random_key(&worker->seed, shared->rows));
+        case WL_RAND_DELETE:
+            return op_delete(shared, take_delete_key(shared));
+        case WL_MIXED: {
+            unsigned int dice = next_random(&worker->seed) % 10;
+            if (dice == 0) return op_write(shared, take_seq_key(shared));
+            if (dice == 1) return op_update(shared, random_key(&worker->seed, shared->rows));
+            return op_read(shared, &worker->seed, true);
+        }
+        default:
+            return -1;
+    }
+}
+
+static void* worker_main(void* arg) {
+    BenchWorker* worker = (BenchWorker*)arg;
+    for (int i = 0; i < worker->shared->ops_per_thread; i++) {
+        double start = now_seconds();
+        int status = run_one_op(worker);
+        worker->latencies_us[worker->completed++] = (now_seconds() - start) * 1e6;
+        if (status != 0) worker->errors++;
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+static int run_benchmark(const char* collection, long rows, Workload workload, int threads, int ops, BenchResult* out) {
+    BenchShared shared = {
+        .collection = collection,
+        .workload = workload,
+        .rows = rows,
+        .ops_per_thread = (ops + threads - 1) / threads,
+        .next_seq_key = rows + 1,
+        .next_delete_slot = 0,
+    };
+    pthread_mutex_init(&shared.key_mutex, NULL);
+
+    BenchWorker* workers = calloc(threads, sizeof(BenchWorker));
+    pthread_t* handles = calloc(threads, sizeof(pthread_t));
+    if (workers == NULL || handles == NULL) {
+        free(workers);
+        free(handles);
+        return -1;
+    }
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].shared = &shared;
+        workers[t].seed = 0x12345u + (unsigned int)t * 7919u;
+        workers[t].latencies_us = calloc(shared.ops_per_thread, sizeof(double));
+    }
+
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&handles[t], NULL, worker_main, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(handles[t], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    // Merge per-thread latencies
+    int total = 0;
+    int errors = 0;
+    for (int t = 0; t < threads; t++) {
+        total += workers[t].completed;
+        errors += workers[t].errors;
+    }
+    double* merged = malloc(sizeof(double) * (total > 0 ? total : 1));
+    int cursor = 0;
+    double sum = 0.0;
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < workers[t].completed; i++) {
+            merged[cursor++] = workers[t].latencies_us[i];
+            sum += workers[t].latencies_us[i];
+        }
+        free(workers[t].latencies_us);
+    }
+    qsort(merged, total, sizeof(double), compare_doubles);
+
+    out->rows = rows;
+    out->workload = workload;
+    out->threads = threads;
+    out->ops = total;
+    out->errors = errors;
+    out->seconds = elapsed;
+    out->avg_us = total > 0 ? sum / total : 0.0;
+    out->p50_us = percentile(merged, total, 0.50);
+    out->p95_us = percentile(merged, total, 0.95);
+    out->p99_us = percentile(merged, total, 0.99);
+    out->max_us = total > 0 ? merged[total - 1] : 0.0;
+
+    free(merged);
+    free(workers);
+    free(handles);
+    pthread_mutex_destroy(&shared.key_mutex);
+    return 0;
+}
+
+static void write_result(FILE* out, const BenchResult* r, bool json, bool first) {
+    double ops_per_sec = r->seconds > 0 ? r->ops / r->seconds : 0.0;
+    if (json) {
+        fprintf(out, "%s  {\"engine\":\"peachdb\",\"rows\":%ld,\"workload\":\"%s\",\"threads\":%d,"
+                     "\"ops\":%d,\"errors\":%d,\"seconds\":%.6f,\"ops_per_sec\":%.2f,"
+                     "\"avg_us\":%.1f,\"p50_us\":%.1f,\"p95_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+                first ? "" : ",\n", r->rows, WORKLOAD_NAMES[r->workload], r->threads,
+                r->ops, r->errors, r->seconds, ops_per_sec,
+                r->avg_us, r->p50_us, r->p95_us, r->p99_us, r->max_us);
+    } else {
+        fprintf(out, "peachdb,%ld,%s,%d,%d,%d,%.6f,%.2f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                r->rows, WORKLOAD_NAMES[r->workload], r->threads,
+                r->ops, r->errors, r->seconds, ops_per_sec,
+                r->avg_us, r->p50_us, r->p95_us, r->p99_us, r->max_us);
+    }
+    fflush(out);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (parse_args(argc, argv, &config) != 0) {
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (config.out_path != NULL) {
+        out = fopen(config.out_path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Bench Error: Could not open output file '%s'.\n", config.out_path);
+            return 1;
+        }
+    }
+
+    // Run inside a dedicated directory with a fresh database
+    mkdir(config.dir, 0700);
+    if (chdir(config.dir) != 0) {
+        fprintf(stderr, "Bench Error: Could not enter working directory '%s'.\n", config.dir);
+        return 1;
+    }
+    system("rm -rf peachdata");
+    if (Peach_initPeachDb() != 0) {
+        fprintf(stderr, "Bench Error: PeachDB initialization failed.\n");
+        return 1;
+    }
+    if (config.cache_mb >= 0) {
+        Peach_set_cache_budget((size_t)config.cache_mb * 1024u * 1024u);
+    }
+
+    if (config.json) {
+        fprintf(out, "[\n");
+    } else {
+        fprintf(out, "engine,rows,workload,threads,ops,errors,seconds,ops_per_sec,avg_us,p50_us,p95_us,p99_us,max_us\n");
+    }
+
+    bool first = true;
+    for (int r = 0; r < config.rows_count; r++) {
+        long rows = config.rows[r];
+        char collection[64];
+        snprintf(collection, sizeof(collection), "bench_%ld", rows);
+
+        bool loaded = false;
+        for (int w = 0; w < WL_COUNT; w++) {
+            if (!config.workloads[w]) continue;
+            for (int t = 0; t < config.threads_count; t++) {
+                // Mutating runs start from a pristine collection
+                if (!loaded || is_mutating((Workload)w)) {
+                    fprintf(stderr, "Loading %ld rows into '%s'...\n", rows, collection);
+                    if (populate_collection(collection, rows) != 0) {
+                        return 1;
+                    }
+                    loaded = true;
+                }
+
+                fprintf(stderr, "Running %s (rows=%ld, threads=%d)...\n", WORKLOAD_NAMES[w], rows, config.threads[t]);
+                BenchResult result;
+                if (run_benchmark(collection, rows, (Workload)w, config.threads[t], config.ops, &result) == 0) {
+                    write_result(out, &result, config.json, first);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    if (config.json) {
+        fprintf(out, "\n]\n");
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -1,16 +1,52 @@
 #include "registerController.h"
+#include "../../services/taskService/taskService.h"
+#include <stdlib.h>
+#include <string.h>
 
-bool Register_onClickRegisterButton(const char *username,const char *password) {
-    bool status = AuthService_register(username, password);
+// A sign-up request runs on the task worker (see taskService.h)
+typedef struct {
+    char username[100];
+    char password[100];
+    bool status;
+} RegisterTask;
+
+static bool g_register_pending = false;
+
+static void run_register(void* context) {
+    RegisterTask* task = context;
+    task->status = AuthService_register(task->username, task->password);
+}
 
-    if (status) {
+static void finish_register(void* context) {
+    RegisterTask* task = context;
+    g_register_pending = false;
+    if (task->status) {
         changeScreenState(LOGIN);
         setDebugMessage("Signup Sucessfully");
-        return true;
     } else {
         setDebugMessage("Signup Failed");
+    }
+    free(task);
+}
+
+bool Register_onClickRegisterButton(const char *username,const char *password) {
+    if (g_register_pending) return false;
+
+    RegisterTask* task = calloc(1, sizeof(RegisterTask));
+    if (task == NULL) return false;
+    strncpy(task->username, username, sizeof(task->username) - 1);
+    strncpy(task->password, password, sizeof(task->password) - 1);
+
+    if (TaskService_post(run_register, finish_register, task) != 0) {
+        setDebugMessage("Signup Failed");
         return false;
     }
+    g_register_pending = true;
+    return true;
+}
+
+bool Register_is_pending() {
+    return g_register_pending;
 }
 
 void Register_onClickIhaveAccount() {
@@ -7,7 +7,17 @@
 #include <stdbool.h>
 
 
+/**
+ * @brief Sends a sign-up request in the background; the screen changes to
+ * LOGIN once the server accepts it.
+ * @return true if the request was sent, false if one is already pending or it cannot be queued.
+ */
 bool Register_onClickRegisterButton(const char *username,const char *password);
+
+/**
+ * @brief Returns true while a sign-up request waits for the server.
+ */
+bool Register_is_pending();
 void Register_onClickIhaveAccount();
 
 #endif
@@ -6,9 +6,13 @@
 #include "utils/constants/constants.h"
 #include "utils/fonts/fonts.h"
 #include "views/screenManager/screenManager.h"
+#include "utils/redraw/redraw.h"
 #include "services/networkService/networkService.h"
 #include "services/messageService/messageService.h"
 #include "services/groupService/groupService.h"     // Include group service
+#include "services/taskService/taskService.h"       // Runs network requests off the render thread
+#include "services/cacheService/cacheService.h"     // On-disk cache of the chat lists and histories
+#include "services/outboxService/outboxService.h"   // Sends the user's messages in the background
 #include "views/screens/chatScreen/chatScreen.h" // Include the screen that handles chat logic
 #include "utils/debugger/debugger.h"
 
@@ -24,6 +28,12 @@ int main()
     SetTargetFPS(WINDOW_FRAME);
     // toggleDebugMode();
 
+    // --- Task Worker Init ---
+    // Screens post their network requests to it and never block a frame
+    if (TaskService_start() < 0) {
+        setDebugMessage("Could not start the task worker.\n");
+    }
+
     // --- Network Init ---
     setDebugMessage("Attempting to connect to the server...\n");
     if (Network_connect("127.0.0.1", 8080) < 0) {
@@ -42,23 +52,31 @@ int main()
     while (!WindowShouldClose())
     {
         // --- Update logic ---
-        updateScreen(); // Update your UI/game state
+        // Apply finished requests and pushed messages; start a due send
+        if (TaskService_drain() > 0) markScreenDirty();
+        OutboxService_update();
 
        // --- Drawing ---
-        BeginDrawing();
-        // Your existing updateScreen probably handles drawing,
-        // but if not, drawing code goes here.
-        // For this example, we'll just clear the background.
-        // ClearBackground(RAYWHITE);
-        // updateScreen();
-        EndDrawing();
+        // Only frames where something changed are drawn (see redraw.h);
+        // otherwise the last frame stays up and input is polled
+        if (shouldDrawScreen()) {
+            BeginDrawing();
+            updateScreen(); // Handles input and draws the current screen
+            EndDrawing();   // Also polls input and waits for the frame rate
+        } else {
+            WaitTime(1.0 / WINDOW_IDLE_POLL);
+            PollInputEvents();
+        }
     }
 
     // --- De-Initialization ---
     printf("Shutting down...\n");
     CloseAudioDevice();     // Close the audio device
+    unloadFonts();          // Free the glyph atlases while the GL context is alive
     CloseWindow();          // Close the raylib window
     Network_disconnect();   // Disconnect from the server
+    TaskService_stop();     // Stop the task worker (its pending request fails fast now)
+    CacheService_close();   // Flush and close the local cache log
 
     return 0;
 }
@@ -8,6 +8,10 @@
 // Global state for logged-in user
 static long g_current_user_id = -1;
 
+// Credentials of the logged-in user, for AuthService_relogin
+static char g_username[256] = "";
+static char g_password[256] = "";
+
 // Helper function to send a command and wait for a specific response prefix
 static bool send_command_and_wait_for_response(const char* command, const char* success_prefix) {
     // 1. Clear any old response from the buffer
@@ -88,6 +92,10 @@ bool AuthService_login(const char* username, const char* password, long* out_use
                     long userId = atol(userId_str);
                     g_current_user_id = userId;
                     if (out_userId != NULL) *out_userId = userId;
+                    if (username != g_username) { // Not when logging in again
+                        strncpy(g_username, username, sizeof(g_username) - 1);
+                        strncpy(g_password, password, sizeof(g_password) - 1);
+                    }
                     printf("AuthService: Login successful, user ID: %ld\n", userId);
                 }
                 return true;
@@ -105,3 +113,8 @@ bool AuthService_login(const char* username, const char* password, long* out_use
 long AuthService_get_current_user_id(void) {
     return g_current_user_id;
 }
+
+bool AuthService_relogin(void) {
+    if (g_current_user_id == -1) return false;
+    return AuthService_login(g_username, g_password, NULL);
+}
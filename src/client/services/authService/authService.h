@@ -24,6 +24,13 @@ bool AuthService_register(const char* username, const char* password);
  */
 bool AuthService_login(const char* username, const char* password, long* out_userId);
 
+/**
+ * @brief Logs the current user in again, with the credentials of their
+ * last login (e.g., after Network_reconnect). This is a blocking call.
+ * @return true on success, false if nobody was logged in or the login failed.
+ */
+bool AuthService_relogin(void);
+
 /**
  * @brief Gets the currently logged-in user's ID.
  * @return The user ID if logged in, -1 otherwise.
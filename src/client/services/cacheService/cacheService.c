@@ -0,0 +1,351 @@
+#include "cacheService.h"
+#include "../usernameService/usernameService.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Records of the log, one per line ('^' separated, the text field last):
+//   C^<contactId>
+//   R^<roomId>^<name>
+//   U^<userId>^<username>
+//   M^<D|G>^<chatId>^<messageId>^<senderId>^<time>^<text>
+//   X^<D|G>^<chatId>                  (the chat's messages are forgotten)
+
+#define COMPACT_SLACK 256 // Superseded records tolerated before a rewrite
+
+typedef struct {
+    long id;
+    char name[256];
+} NamedEntry;
+
+typedef struct {
+    bool is_group;
+    long chat_id;
+    CachedMessage* messages; // CACHE_CHAT_MESSAGES slots, oldest first
+    int count;
+} CachedChat;
+
+// --- Module-level static variables ---
+static FILE* g_log = NULL;
+static char g_log_path[512] = "";
+static int g_record_count = 0; // Lines in the log, live or superseded
+
+static long* g_contacts = NULL;
+static int g_contact_count = 0;
+static int g_contact_capacity = 0;
+
+static NamedEntry* g_rooms = NULL;
+static int g_room_count = 0;
+static int g_room_capacity = 0;
+
+static NamedEntry* g_usernames = NULL;
+static int g_username_count = 0;
+static int g_username_capacity = 0;
+
+static CachedChat* g_chats = NULL;
+static int g_chat_count = 0;
+static int g_chat_capacity = 0;
+
+static int grow(void** items, int* capacity, int count, size_t item_size) {
+    if (count < *capacity) return 0;
+    int grown_capacity = *capacity == 0 ? 16 : *capacity * 2;
+    void* grown = realloc(*items, item_size * grown_capacity);
+    if (grown == NULL) return -1;
+    *items = grown;
+    *capacity = grown_capacity;
+    return 0;
+}
+
+// Copies a field into a buffer, cutting it at a newline (records are lines)
+static void copy_field(char* dest, size_t size, const char* src) {
+    size_t i = 0;
+    for (; src != NULL && src[i] != '\0' && src[i] != '\n' && i < size - 1; i++) dest[i] = src[i];
+    dest[i] = '\0';
+}
+
+// Appends one record to the log
+static void write_record(const char* format, ...) {
+    if (g_log == NULL) return;
+    va_list args;
+    va_start(args, format);
+    vfprintf(g_log, format, args);
+    va_end(args);
+    fputc('\n', g_log);
+    fflush(g_log);
+    g_record_count++;
+}
+
+// --- In-memory state (shared by the replay and the put functions) ---
+
+static bool apply_contact(long contactId) {
+    for (int i = 0; i < g_contact_count; i++) {
+        if (g_contacts[i] == contactId) return false;
+    }
+    if (grow((void**)&g_contacts, &g_contact_capacity, g_contact_count, sizeof(long)) != 0) return false;
+    g_contacts[g_contact_count++] = contactId;
+    return true;
+}
+
+// Sets the name of an entry, adding it if needed; returns true if anything changed
+static bool apply_name(NamedEntry** entries, int* count, int* capacity, long id, const char* name) {
+    char copy[256];
+    copy_field(copy, sizeof(copy), name);
+    for (int i = 0; i < *count; i++) {
+        if ((*entries)[i].id == id) {
+            if (strcmp((*entries)[i].name, copy) == 0) return false;
+            strcpy((*entries)[i].name, copy);
+            return true;
+        }
+    }
+    if (grow((void**)entries, capacity, *count, sizeof(NamedEntry)) != 0) return false;
+    (*entries)[*count].id = id;
+    strcpy((*entries)[*count].name, copy);
+    (*count)++;
+    return true;
+}
+
+static CachedChat* find_chat(bool isGroup, long chatId, bool create) {
+    for (int i = 0; i < g_chat_count; i++) {
+        if (g_chats[i].is_group == isGroup && g_chats[i].chat_id == chatId) return &g_chats[i];
+    }
+    if (!create) return NULL;
+    if (grow((void**)&g_chats, &g_chat_capacity, g_chat_count, sizeof(CachedChat)) != 0) return NULL;
+    CachedMessage* messages = calloc(CACHE_CHAT_MESSAGES, sizeof(CachedMessage));
+    if (messages == NULL) return NULL;
+    CachedChat* chat = &g_chats[g_chat_count++];
+    chat->is_group = isGroup;
+    chat->chat_id = chatId;
+    chat->messages = messages;
+    chat->count = 0;
+    return chat;
+}
+
+static void clear_chat(CachedChat* chat) {
+    for (int i = 0; i < chat->count; i++) free(chat->messages[i].text);
+    chat->count = 0;
+}
+
+static bool apply_message(bool isGroup, long chatId, long messageId, long senderId, const char* time, const char* text) {
+    if (messageId <= 0) return false;
+    CachedChat* chat = find_chat(isGroup, chatId, true);
+    if (chat == NULL) return false;
+    if (chat->count > 0 && chat->messages[chat->count - 1].id >= messageId) return false;
+
+    if (text == NULL) text = "";
+    size_t size = strlen(text) + 1;
+    char* copy = malloc(size);
+    if (copy == NULL) return false;
+    copy_field(copy, size, text);
+
+    // Full: the oldest message makes room
+    if (chat->count == CACHE_CHAT_MESSAGES) {
+        free(chat->messages[0].text);
+        memmove(chat->messages, chat->messages + 1, sizeof(CachedMessage) * (CACHE_CHAT_MESSAGES - 1));
+        chat->count--;
+    }
+    CachedMessage* message = &chat->messages[chat->count++];
+    message->id = messageId;
+    message->sender_id = senderId;
+    copy_field(message->time, sizeof(message->time), time);
+    message->text = copy;
+    return true;
+}
+
+// --- Log replay and compaction ---
+
+// Splits off the next '^' field; the last field keeps any '^' it contains
+static char* next_field(char** cursor, bool last) {
+    if (*cursor == NULL) return NULL;
+    char* field = *cursor;
+    char* separator = last ? NULL : strchr(field, '^');
+    if (separator != NULL) {
+        *separator = '\0';
+        *cursor = separator + 1;
+    } else {
+        *cursor = NULL;
+    }
+    return field;
+}
+
+static void replay_record(char* line) {
+    char* cursor = line;
+    char* kind = next_field(&cursor, false);
+    if (kind == NULL || kind[0] == '\0' || kind[1] != '\0') return;
+
+    if (kind[0] == 'C') {
+        char* id = next_field(&cursor, true);
+        if (id != NULL) apply_contact(atol(id));
+    } else if (kind[0] == 'R' || kind[0] == 'U') {
+        char* id = next_field(&cursor, false);
+        char* name = next_field(&cursor, true);
+        if (id == NULL || name == NULL) return;
+        if (kind[0] == 'R') apply_name(&g_rooms, &g_room_count, &g_room_capacity, atol(id), name);
+        else apply_name(&g_usernames, &g_username_count, &g_username_capacity, atol(id), name);
+    } else if (kind[0] == 'M') {
+        char* chat_kind = next_field(&cursor, false);
+        char* chat_id = next_field(&cursor, false);
+        char* message_id = next_field(&cursor, false);
+        char* sender_id = next_field(&cursor, false);
+        char* time = next_field(&cursor, false);
+        char* text = next_field(&cursor, true);
+        if (chat_kind == NULL || chat_id == NULL || message_id == NULL || sender_id == NULL || time == NULL || text == NULL) return;
+        apply_message(chat_kind[0] == 'G', atol(chat_id), atol(message_id), atol(sender_id), time, text);
+    } else if (kind[0] == 'X') {
+        char* chat_kind = next_field(&cursor, false);
+        char* chat_id = next_field(&cursor, true);
+        if (chat_kind == NULL || chat_id == NULL) return;
+        CachedChat* chat = find_chat(chat_kind[0] == 'G', atol(chat_id), false);
+        if (chat != NULL) clear_chat(chat);
+    }
+}
+
+static void replay_log(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return;
+    char* line = NULL;
+    size_t line_size = 0;
+    ssize_t length;
+    while ((length = getline(&line, &line_size, file)) != -1) {
+        if (length > 0 && line[length - 1] == '\n') line[length - 1] = '\0';
+        replay_record(line);
+        g_record_count++;
+    }
+    free(line);
+    fclose(file);
+}
+
+static int live_record_count() {
+    int count = g_contact_count + g_room_count + g_username_count;
+    for (int i = 0; i < g_chat_count; i++) count += g_chats[i].count;
+    return count;
+}
+
+// Writes the live records to a new log and swaps it in
+static void compact_log() {
+    char temp_path[sizeof(g_log_path) + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", g_log_path);
+    g_log = fopen(temp_path, "w");
+    if (g_log == NULL) return;
+    g_record_count = 0;
+
+    for (int i = 0; i < g_contact_count; i++) write_record("C^%ld", g_contacts[i]);
+    for (int i = 0; i < g_room_count; i++) write_record("R^%ld^%s", g_rooms[i].id, g_rooms[i].name);
+    for (int i = 0; i < g_username_count; i++) write_record("U^%ld^%s", g_usernames[i].id, g_usernames[i].name);
+    for (int i = 0; i < g_chat_count; i++) {
+        CachedChat* chat = &g_chats[i];
+        for (int j = 0; j < chat->count; j++) {
+            CachedMessage* message = &chat->messages[j];
+            write_record("M^%c^%ld^%ld^%ld^%s^%s", chat->is_group ? 'G' : 'D', chat->chat_id,
+                         message->id, message->sender_id, message->time, message->text);
+        }
+    }
+    fclose(g_log);
+    g_log = NULL;
+    if (rename(temp_path, g_log_path) != 0) remove(temp_path);
+}
+
+bool CacheService_open(long userId) {
+    CacheService_close();
+    mkdir(CACHE_DIRECTORY, 0755);
+    snprintf(g_log_path, sizeof(g_log_path), "%s/user_%ld.log", CACHE_DIRECTORY, userId);
+
+    replay_log(g_log_path);
+    if (g_record_count > live_record_count() * 2 + COMPACT_SLACK) {
+        compact_log();
+    }
+    for (int i = 0; i < g_username_count; i++) {
+        UsernameService_remember(g_usernames[i].id, g_usernames[i].name);
+    }
+
+    g_log = fopen(g_log_path, "a");
+    if (g_log == NULL) {
+        fprintf(stderr, "CacheService: Could not open %s; running without a cache.\n", g_log_path);
+        return false;
+    }
+    printf("CacheService: Loaded %d contacts, %d rooms and %d chats from the cache.\n",
+           g_contact_count, g_room_count, g_chat_count);
+    return true;
+}
+
+void CacheService_close(void) {
+    if (g_log != NULL) {
+        fclose(g_log);
+        g_log = NULL;
+    }
+    for (int i = 0; i < g_chat_count; i++) {
+        clear_chat(&g_chats[i]);
+        free(g_chats[i].messages);
+    }
+    free(g_chats);
+    free(g_contacts);
+    free(g_rooms);
+    free(g_usernames);
+    g_chats = NULL;
+    g_contacts = NULL;
+    g_rooms = NULL;
+    g_usernames = NULL;
+    g_chat_count = g_chat_capacity = 0;
+    g_contact_count = g_contact_capacity = 0;
+    g_room_count = g_room_capacity = 0;
+    g_username_count = g_username_capacity = 0;
+    g_record_count = 0;
+}
+
+int CacheService_get_contacts(long* out_ids, int max) {
+    int count = g_contact_count < max ? g_contact_count : max;
+    memcpy(out_ids, g_contacts, sizeof(long) * count);
+    return count;
+}
+
+int CacheService_get_rooms(long* out_ids, char out_names[][256], int max) {
+    int count = g_room_count < max ? g_room_count : max;
+    for (int i = 0; i < count; i++) {
+        out_ids[i] = g_rooms[i].id;
+        strcpy(out_names[i], g_rooms[i].name);
+    }
+    return count;
+}
+
+void CacheService_put_contact(long contactId) {
+    if (apply_contact(contactId)) write_record("C^%ld", contactId);
+}
+
+void CacheService_put_room(long roomId, const char* name) {
+    if (name == NULL) return;
+    if (apply_name(&g_rooms, &g_room_count, &g_room_capacity, roomId, name)) {
+        char copy[256];
+        copy_field(copy, sizeof(copy), name);
+        write_record("R^%ld^%s", roomId, copy);
+    }
+}
+
+void CacheService_put_username(long userId, const char* username) {
+    if (username == NULL) return;
+    if (apply_name(&g_usernames, &g_username_count, &g_username_capacity, userId, username)) {
+        char copy[256];
+        copy_field(copy, sizeof(copy), username);
+        write_record("U^%ld^%s", userId, copy);
+    }
+}
+
+int CacheService_get_messages(bool isGroup, long chatId, const CachedMessage** out_messages) {
+    CachedChat* chat = find_chat(isGroup, chatId, false);
+    *out_messages = chat != NULL ? chat->messages : NULL;
+    return chat != NULL ? chat->count : 0;
+}
+
+void CacheService_put_message(bool isGroup, long chatId, long messageId, long senderId, const char* time, const char* text) {
+    if (!apply_message(isGroup, chatId, messageId, senderId, time, text)) return;
+    CachedChat* chat = find_chat(isGroup, chatId, false);
+    CachedMessage* message = &chat->messages[chat->count - 1];
+    write_record("M^%c^%ld^%ld^%ld^%s^%s", isGroup ? 'G' : 'D', chatId, messageId, senderId, message->time, message->text);
+}
+
+void CacheService_reset_chat(bool isGroup, long chatId) {
+    CachedChat* chat = find_chat(isGroup, chatId, false);
+    if (chat == NULL || chat->count == 0) return;
+    clear_chat(chat);
+    write_record("X^%c^%ld", isGroup ? 'G' : 'D', chatId);
+}
@@ -0,0 +1,90 @@
+#ifndef CACHE_SERVICE_H
+#define CACHE_SERVICE_H
+#include <stdbool.h>
+
+/*
+ * On-disk cache of the logged-in user's conversations, so the chat screen
+ * can draw its lists and the last messages of a chat before the server
+ * answers, and then ask only for what changed.
+ *
+ * - Each user has an append-only log, CACHE_DIRECTORY/user_<id>.log, of
+ *   one record per line: contacts, rooms, usernames and messages.
+ * - Opening the cache replays the log into memory. Superseded records
+ *   (renames, messages past CACHE_CHAT_MESSAGES per chat, reset chats)
+ *   pile up in the log, so it is rewritten when they outnumber the live ones.
+ * - A chat keeps its newest CACHE_CHAT_MESSAGES messages, in ID order; the
+ *   last one tells where to resume (see MessageService_load_history_since).
+ *
+ * Call these functions from the UI thread only. Writing is best effort:
+ * without a cache the screen simply loads everything from the server.
+ */
+
+#define CACHE_DIRECTORY "cache"
+#define CACHE_CHAT_MESSAGES 200
+
+typedef struct {
+    long id;
+    long sender_id;
+    char time[32];
+    char* text;
+} CachedMessage;
+
+/**
+ * @brief Loads the cache of a user and opens their log for writing.
+ * Cached usernames are handed to the username service.
+ * @return true if the log could be opened.
+ */
+bool CacheService_open(long userId);
+
+/**
+ * @brief Closes the log and frees the loaded cache.
+ */
+void CacheService_close(void);
+
+/**
+ * @brief Copies the cached contact IDs into out_ids.
+ * @return The number copied (at most max).
+ */
+int CacheService_get_contacts(long* out_ids, int max);
+
+/**
+ * @brief Copies the cached rooms into out_ids and out_names.
+ * @return The number copied (at most max).
+ */
+int CacheService_get_rooms(long* out_ids, char out_names[][256], int max);
+
+/**
+ * @brief Records a contact (nothing is written if it is already cached).
+ */
+void CacheService_put_contact(long contactId);
+
+/**
+ * @brief Records a room and its name.
+ */
+void CacheService_put_room(long roomId, const char* name);
+
+/**
+ * @brief Records the username of a user.
+ */
+void CacheService_put_username(long userId, const char* username);
+
+/**
+ * @brief Returns the cached messages of a chat, oldest first.
+ * @param out_messages Receives the messages; valid until the chat is changed.
+ * @return Their number (0 if none are cached).
+ */
+int CacheService_get_messages(bool isGroup, long chatId, const CachedMessage** out_messages);
+
+/**
+ * @brief Records a message after the chat's cached ones.
+ * Messages without an ID, or not newer than the last cached one, are ignored.
+ */
+void CacheService_put_message(bool isGroup, long chatId, long messageId, long senderId, const char* time, const char* text);
+
+/**
+ * @brief Forgets the cached messages of a chat (e.g., they no longer join up
+ * with the server's history).
+ */
+void CacheService_reset_chat(bool isGroup, long chatId);
+
+#endif // CACHE_SERVICE_H
@@ -1,5 +1,7 @@
 #include "messageService.h"
 #include "../networkService/networkService.h"
+#include "../authService/authService.h"
+#include "../../utils/rowDecoder/rowDecoder.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h> // For usleep
@@ -41,13 +43,72 @@ static bool send_command_and_wait_for_response(const char* command, const char*
     return false;
 }
 
-bool MessageService_send_dm(long receiverId, const char* message) {
-    if (message == NULL || strlen(message) == 0) return false;
+static void feed_rows(char* chunk, size_t length, void* context) {
+    RowDecoder_feed((RowDecoder*)context, chunk, length);
+}
+
+// Sends a command whose reply is "<success_prefix>rows" and decodes the rows
+// while they arrive (see Network_set_reply_stream): nothing waits for, or
+// copies, the whole reply. The decoder is finished before returning.
+static bool send_command_and_stream_rows(const char* command, const char* success_prefix, RowDecoder* decoder) {
+    Network_clear_response();
+    Network_set_reply_stream(success_prefix, feed_rows, decoder);
+
+    bool received = false;
+    if (Network_send(command) != 0) {
+        fprintf(stderr, "MessageService: Failed to send command to network service.\n");
+    } else {
+        char response[1024];
+        for (int i = 0; i < 40; i++) { // Wait up to 4 seconds, like the history requests did
+            usleep(100000);
+            Network_get_response(response, sizeof(response));
+            if (strlen(response) > 0) {
+                received = strcmp(response, success_prefix) == 0;
+                if (!received) fprintf(stderr, "MessageService: Received unexpected response: %s\n", response);
+                break;
+            }
+        }
+        if (response[0] == '\0') fprintf(stderr, "MessageService: Timed out waiting for server response.\n");
+    }
+
+    Network_set_reply_stream(NULL, NULL, NULL);
+    RowDecoder_finish(decoder);
+    return received;
+}
+
+// Sends a message command and reads its acknowledgement: "<prefix>^id^time".
+// A reply starting with reject_prefix is a refusal; no reply, or another
+// error (e.g., ERROR^NOT_LOGGED_IN), may pass on a retry.
+static MessageSendResult send_message_command(const char* command, const char* success_prefix, const char* reject_prefix,
+                                              long* out_messageId, char* out_time) {
+    if (out_messageId != NULL) *out_messageId = 0;
+    if (out_time != NULL) out_time[0] = '\0';
+    if (!send_command_and_wait_for_response(command, success_prefix)) {
+        char response[1024];
+        Network_get_response(response, sizeof(response));
+        return strncmp(response, reject_prefix, strlen(reject_prefix)) == 0 ? MESSAGE_SEND_REJECTED : MESSAGE_SEND_FAILED;
+    }
+
+    char response[1024];
+    Network_get_response(response, sizeof(response));
+    char* id_str = strchr(response, '^');
+    if (id_str == NULL) return MESSAGE_SEND_OK;
+    if (out_messageId != NULL) *out_messageId = atol(id_str + 1);
+    char* time_str = strchr(id_str + 1, '^');
+    if (time_str != NULL && out_time != NULL) {
+        strncpy(out_time, time_str + 1, MESSAGE_TIME_SIZE - 1);
+        out_time[MESSAGE_TIME_SIZE - 1] = '\0';
+    }
+    return MESSAGE_SEND_OK;
+}
+
+MessageSendResult MessageService_send_dm(long receiverId, const char* message, long clientId, long* out_messageId, char* out_time) {
+    if (message == NULL || strlen(message) == 0) return MESSAGE_SEND_REJECTED;
 
     char command[2048];
-    snprintf(command, sizeof(command), "SEND_DM^%ld^%s", receiverId, message);
+    snprintf(command, sizeof(command), "SEND_DM^%ld^%s^%ld", receiverId, message, clientId);
 
-    return send_command_and_wait_for_response(command, "SEND_DM_SUCCESS");
+    return send_message_command(command, "SEND_DM_SUCCESS", "SEND_DM_FAIL", out_messageId, out_time);
 }
 
 char* MessageService_get_history(long contactId) {
@@ -89,72 +150,37 @@ char* MessageService_get_history(long contactId) {
     return NULL;
 }
 
-long* MessageService_get_contacts(int* count) {
-    *count = 0;
-    const char* command = "GET_CONTACTS";
-
-    Network_clear_response();
-    if (Network_send(command) != 0) {
-        fprintf(stderr, "MessageService: Failed to send GET_CONTACTS command.\n");
-        return NULL;
+// Rows "id;" of GET_CONTACTS, collected in a growing array
+typedef struct {
+    long* ids;
+    int count;
+    int capacity;
+} ContactRows;
+
+static void on_contact_row(char** fields, int fieldCount, void* context) {
+    ContactRows* rows = context;
+    if (rows->count == rows->capacity) {
+        int capacity = rows->capacity == 0 ? 32 : rows->capacity * 2;
+        long* ids = realloc(rows->ids, sizeof(long) * capacity);
+        if (ids == NULL) return;
+        rows->ids = ids;
+        rows->capacity = capacity;
     }
+    rows->ids[rows->count++] = atol(fields[0]);
+}
 
-    char response[8192]; // Buffer for contact list
-    const char* success_prefix = "CONTACTS_DATA^";
-
-    for (int i = 0; i < 20; i++) { // 2 second timeout
-        usleep(100000);
-        memset(response, 0, sizeof(response));
-        Network_get_response(response, sizeof(response));
-
-        if (strlen(response) > 0) {
-            if (strncmp(response, success_prefix, strlen(success_prefix)) == 0) {
-                char* data_str = response + strlen(success_prefix);
-                if (strlen(data_str) == 0) {
-                    return NULL; // No contacts
-                }
-
-                // First pass: count the contacts to allocate exact memory
-                int num_contacts = 0;
-                char* data_copy_for_count = strdup(data_str);
-                char* token_count = strtok(data_copy_for_count, ",");
-                while (token_count != NULL) {
-                    num_contacts++;
-                    token_count = strtok(NULL, ",");
-                }
-                free(data_copy_for_count);
-
-                if (num_contacts == 0) {
-                    return NULL;
-                }
-
-                // Second pass: allocate memory and parse IDs
-                long* contacts_array = malloc(num_contacts * sizeof(long));
-                if (contacts_array == NULL) {
-                    return NULL; // Malloc failed
-                }
-
-                int index = 0;
-                char* data_copy_for_parse = strdup(data_str);
-                char* token_parse = strtok(data_copy_for_parse, ",");
-                while (token_parse != NULL && index < num_contacts) {
-                    contacts_array[index++] = atol(token_parse);
-                    token_parse = strtok(NULL, ",");
-                }
-                free(data_copy_for_parse);
-
-                *count = num_contacts;
-                return contacts_array;
+long* MessageService_get_contacts(int* count) {
+    *count = 0;
+    ContactRows rows = { NULL, 0, 0 };
+    RowDecoder decoder;
+    RowDecoder_init(&decoder, on_contact_row, &rows);
 
-            } else {
-                fprintf(stderr, "MessageService: Received unexpected contacts response: %s\n", response);
-                return NULL;
-            }
-        }
+    if (!send_command_and_stream_rows("GET_CONTACTS", "CONTACTS_DATA^", &decoder) || rows.count == 0) {
+        free(rows.ids);
+        return NULL; // No contacts, or no answer
     }
-
-    fprintf(stderr, "MessageService: Timed out waiting for contacts response.\n");
-    return NULL;
+    *count = rows.count;
+    return rows.ids;
 }
 
 bool MessageService_get_user_info(long userId, char* out_username, int buffer_size) {
@@ -327,55 +353,30 @@ bool MessageService_join_group(long groupId, char* out_groupName, int buffer_siz
     return false;
 }
 
-int MessageService_get_my_groups(long* out_groupIds, char out_groupNames[][256], int max_groups) {
-    const char* command = "GET_MY_GROUPS";
-
-    Network_clear_response();
-    if (Network_send(command) != 0) {
-        fprintf(stderr, "MessageService: Failed to send GET_MY_GROUPS command.\n");
-        return 0;
-    }
-
-    char response[8192];
-    const char* success_prefix = "MY_GROUPS_DATA^";
+// Rows "groupId,groupName;" of GET_MY_GROUPS, copied into the caller's arrays
+typedef struct {
+    long* ids;
+    char (*names)[256];
+    int count;
+    int max;
+} GroupRows;
+
+static void on_group_row(char** fields, int fieldCount, void* context) {
+    GroupRows* rows = context;
+    if (fieldCount < 2 || rows->count >= rows->max) return;
+    rows->ids[rows->count] = atol(fields[0]);
+    strncpy(rows->names[rows->count], fields[1], 255);
+    rows->names[rows->count][255] = '\0';
+    rows->count++;
+}
 
-    for (int i = 0; i < 20; i++) {
-        usleep(100000);
-        memset(response, 0, sizeof(response));
-        Network_get_response(response, sizeof(response));
+int MessageService_get_my_groups(long* out_groupIds, char out_groupNames[][256], int max_groups) {
+    GroupRows rows = { out_groupIds, out_groupNames, 0, max_groups };
+    RowDecoder decoder;
+    RowDecoder_init(&decoder, on_group_row, &rows);
 
-        if (strlen(response) > 0) {
-            if (strncmp(response, success_prefix, strlen(success_prefix)) == 0) {
-                char* data_str = response + strlen(success_prefix);
-                if (strlen(data_str) == 0) return 0;
-
-                int count = 0;
-                char* data_copy = strdup(data_str);
-                char* outer_saveptr = NULL;
-                char* token = strtok_r(data_copy, ";", &outer_saveptr);
-
-                while (token != NULL && count < max_groups) {
-                    char* inner_saveptr = NULL;
-                    char* token_copy = strdup(token);
-                    char* gid_str = strtok_r(token_copy, ",", &inner_saveptr);
-                    char* gname_str = strtok_r(NULL, ",", &inner_saveptr);
-
-                    if (gid_str != NULL && gname_str != NULL) {
-                        out_groupIds[count] = atol(gid_str);
-                        strncpy(out_groupNames[count], gname_str, 255);
-                        out_groupNames[count][255] = '\0';
-                        count++;
-                    }
-                    free(token_copy);
-                    token = strtok_r(NULL, ";", &outer_saveptr);
-                }
-                free(data_copy);
-                return count;
-            }
-            return 0;
-        }
-    }
-    return 0;
+    if (!send_command_and_stream_rows("GET_MY_GROUPS", "MY_GROUPS_DATA^", &decoder)) return 0;
+    return rows.count;
 }
 
 char* MessageService_get_group_history(long groupId) {
@@ -407,32 +408,75 @@ char* MessageService_get_group_history(long groupId) {
     return NULL;
 }
 
-bool MessageService_send_group_message(long groupId, const char* message) {
-    if (message == NULL || strlen(message) == 0) return false;
+// Rows "senderId,message,time,id;" of a history page, appended to a store
+typedef struct {
+    MessageStore* store;
+    long my_user_id;
+    long after_id;      // Rows up to this ID are already known
+    bool failed;
+} HistoryRows;
+
+static void on_history_row(char** fields, int fieldCount, void* context) {
+    HistoryRows* rows = context;
+    if (fieldCount < 4 || rows->failed) return;
+    MessageInput message = {
+        .id = atol(fields[3]),
+        .sender_id = atol(fields[0]),
+        .text = fields[1],
+        .time = fields[2],
+    };
+    message.is_me = message.sender_id == rows->my_user_id;
+    if (message.id <= rows->after_id) return;
+    if (MessageStore_append(rows->store, &message) == -1) rows->failed = true;
+}
+
+static bool load_history(const char* command, const char* success_prefix, long afterId, MessageStore* out) {
+    HistoryRows rows = { out, AuthService_get_current_user_id(), afterId, false };
+    RowDecoder decoder;
+    RowDecoder_init(&decoder, on_history_row, &rows);
+    return send_command_and_stream_rows(command, success_prefix, &decoder) && !rows.failed;
+}
+
+bool MessageService_load_history_before(long chatId, bool isGroup, long beforeId, MessageStore* out) {
+    char command[256];
+    snprintf(command, sizeof(command), "%s^%ld^%ld", isGroup ? "GET_GROUP_BEFORE" : "GET_DM_BEFORE", chatId, beforeId);
+    return load_history(command, isGroup ? "GROUP_BEFORE_DATA^" : "DM_BEFORE_DATA^", 0, out);
+}
+
+bool MessageService_load_history_since(long chatId, bool isGroup, const char* since, long afterId, MessageStore* out) {
+    if (since == NULL) return false;
+    char command[256];
+    snprintf(command, sizeof(command), "%s^%ld^%s", isGroup ? "GET_GROUP_SINCE" : "GET_DM_SINCE", chatId, since);
+    return load_history(command, isGroup ? "GROUP_SINCE_DATA^" : "DM_SINCE_DATA^", afterId, out);
+}
+
+MessageSendResult MessageService_send_group_message(long groupId, const char* message, long clientId, long* out_messageId, char* out_time) {
+    if (message == NULL || strlen(message) == 0) return MESSAGE_SEND_REJECTED;
 
     char command[2048];
-    snprintf(command, sizeof(command), "SEND_GROUP_MSG^%ld^%s", groupId, message);
+    snprintf(command, sizeof(command), "SEND_GROUP_MSG^%ld^%s^%ld", groupId, message, clientId);
 
-    Network_clear_response();
+    return send_message_command(command, "SEND_GROUP_MSG_SUCCESS", "SEND_GROUP_MSG_FAIL", out_messageId, out_time);
+}
+
+void MessageService_ack_dm(long messageId) {
+    char command[64];
+    snprintf(command, sizeof(command), "ACK_DM^%ld", messageId);
     if (Network_send(command) != 0) {
-        fprintf(stderr, "MessageService: Failed to send SEND_GROUP_MSG command.\n");
-        return false;
+        fprintf(stderr, "MessageService: Failed to acknowledge DM %ld.\n", messageId);
     }
+}
 
-    char response[1024];
-    const char* success_prefix = "SEND_GROUP_MSG_SUCCESS";
-
-    for (int i = 0; i < 20; i++) {
-        usleep(100000);
-        memset(response, 0, sizeof(response));
-        Network_get_response(response, sizeof(response));
+void MessageService_ack_group_message(long messageId) {
+    char command[64];
+    snprintf(command, sizeof(command), "ACK_GROUP_MSG^%ld", messageId);
+    if (Network_send(command) != 0) {
+        fprintf(stderr, "MessageService: Failed to acknowledge group message %ld.\n", messageId);
+    }
+}
 
-        if (strlen(response) > 0) {
-            if (strncmp(response, success_prefix, strlen(success_prefix)) == 0) {
-                return true;
-            }
-            return false;
-        }
+void MessageService_request_missed(void) {
+    if (Network_send("GET_MISSED") != 0) {
+        fprintf(stderr, "MessageService: Failed to send GET_MISSED command.\n");
     }
-    return false;
 }
@@ -2,6 +2,17 @@
 #define MESSAGE_SERVICE_H
 
 #include <stdbool.h>
+#include "../../utils/messageStore/messageStore.h"
+
+// Size of a message time as the server formats it ("YYYY-MM-DD HH:MM:SS"), with room to spare
+#define MESSAGE_TIME_SIZE 32
+
+// Outcome of sending a message
+typedef enum {
+    MESSAGE_SEND_OK,
+    MESSAGE_SEND_REJECTED,  // The server refused it (SEND_*_FAIL): sending it again will not help
+    MESSAGE_SEND_FAILED     // Not confirmed (no connection, timeout, not logged in): it may be sent again
+} MessageSendResult;
 
 /**
  * @brief Sends a direct message to another user.
@@ -9,9 +20,16 @@
  * confirmation from the server.
  * @param receiverId The ID of the user to send the message to.
  * @param message The content of the message.
- * @return true on successful send and confirmation, false otherwise.
+ * @param clientId An ID the client gave the message, unique for the user.
+ *        The server saves a message once per client ID, so a send retried
+ *        after a lost confirmation is not saved twice. 0 for none.
+ * @param out_messageId Receives the server's message ID; may be NULL.
+ * @param out_time Receives the time the server saved the message at
+ *        (MESSAGE_TIME_SIZE bytes), "" if it did not say; may be NULL.
+ * @return MESSAGE_SEND_OK once the server confirmed it; otherwise whether it
+ *         was refused or may be sent again.
  */
-bool MessageService_send_dm(long receiverId, const char* message);
+MessageSendResult MessageService_send_dm(long receiverId, const char* message, long clientId, long* out_messageId, char* out_time);
 
 /**
  * @brief Requests the message history with another user.
@@ -88,12 +106,61 @@ int MessageService_get_my_groups(long* out_groupIds, char out_groupNames[][256],
  */
 char* MessageService_get_group_history(long groupId);
 
+/**
+ * @brief Loads the page of a DM or group history that precedes a message.
+ * This is a blocking call. The rows are decoded as they arrive and appended
+ * to 'out', oldest first. Pass LONG_MAX as beforeId for the latest page.
+ * @param chatId The other user's ID, or the group ID.
+ * @param isGroup Whether chatId is a group.
+ * @param beforeId Only messages with a smaller ID are returned.
+ * @param out Receives the messages (none if there are no older ones).
+ * @return true on success; on failure 'out' may hold part of the page.
+ */
+bool MessageService_load_history_before(long chatId, bool isGroup, long beforeId, MessageStore* out);
+
+/**
+ * @brief Loads the messages of a DM or group sent at or after a time, oldest
+ * first, one page at most, and appends them to 'out' like
+ * MessageService_load_history_before. This is a blocking call.
+ * @param since A message time, as the server returned it.
+ * @param afterId Messages with this ID or a smaller one are skipped (already known).
+ * @return true on success.
+ */
+bool MessageService_load_history_since(long chatId, bool isGroup, const char* since, long afterId, MessageStore* out);
+
 /**
  * @brief Sends a message to a group.
  * @param groupId The ID of the group.
  * @param message The message content.
- * @return true on success, false on failure.
+ * @param clientId An ID the client gave the message (see MessageService_send_dm).
+ * @param out_messageId Receives the server's message ID; may be NULL.
+ * @param out_time Receives the time it was saved at (see MessageService_send_dm); may be NULL.
+ * @return See MessageService_send_dm.
+ */
+MessageSendResult MessageService_send_group_message(long groupId, const char* message, long clientId, long* out_messageId, char* out_time);
+
+// ============ DELIVERY ============
+
+/**
+ * @brief Tells the server that a direct message reached this client.
+ * Fire-and-forget: the server does not answer, so this never blocks and
+ * may be called from the network listener thread.
+ * @param messageId The ID of the received message.
+ */
+void MessageService_ack_dm(long messageId);
+
+/**
+ * @brief Tells the server that a group message reached this client.
+ * Fire-and-forget, like MessageService_ack_dm.
+ * @param messageId The ID of the received group message.
+ */
+void MessageService_ack_group_message(long messageId);
+
+/**
+ * @brief Asks for the next batch of messages missed while offline.
+ * The answer arrives asynchronously as MISSED_DATA, like the batch that
+ * follows LOGIN_SUCCESS.
  */
-bool MessageService_send_group_message(long groupId, const char* message);
+void MessageService_request_missed(void);
 
 #endif // MESSAGE_SERVICE_H
@@ -14,53 +14,185 @@
 static int g_socket_fd = -1;
 static pthread_t g_listener_thread;
 static bool g_is_connected = false;
+static bool g_listener_started = false; // Joined by the next disconnect or reconnect
+
+// Where Network_connect last connected, for Network_reconnect
+static char g_server_ip[64] = "";
+static int g_server_port = 0;
 
 // Buffer for the last server response and a mutex to protect it
-static char g_last_response[2048];
-static pthread_mutex_t g_response_mutex;
+// (sized for the largest reply, a 16KB history page)
+static char g_last_response[16384];
+static pthread_mutex_t g_response_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Serializes sends from the UI thread and from async handlers (acknowledgements)
+static pthread_mutex_t g_send_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Callback function for asynchronous, server-pushed messages
 static async_message_handler_t g_async_handler = NULL;
 
+// Async messages that arrive before a handler is registered (e.g., the
+// MISSED_DATA batch right after login) wait here, in arrival order.
+// Handlers run with g_async_mutex held, so they never overlap.
+#define MAX_PENDING_ASYNC 32
+static char* g_pending_async[MAX_PENDING_ASYNC];
+static int g_pending_async_count = 0;
+static pthread_mutex_t g_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Bytes received but not yet split into frames; every frame ends with '\n'
+static char g_stream[65536];
+static size_t g_stream_length = 0;
+
+// The reply streamed to a handler (see Network_set_reply_stream).
+// g_in_reply_stream is listener-only state: a streamed frame is being received.
+static char g_reply_prefix[64];
+static reply_chunk_handler_t g_reply_handler = NULL;
+static void* g_reply_context = NULL;
+static unsigned g_reply_generation = 0; // Counts registrations
+static pthread_mutex_t g_reply_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Listener-only state: the streamed frame being received, and the
+// registration it belongs to (a later one must not get its tail)
+static bool g_in_reply_stream = false;
+static unsigned g_stream_generation = 0;
+
+static bool is_async_command(const char* frame) {
+    // Add any future async commands here
+    static const char* ASYNC_COMMANDS[] = { "RECEIVE_DM", "RECEIVE_GROUP_MSG", "MISSED_DATA" };
+    size_t length = strcspn(frame, "^");
+    for (size_t i = 0; i < sizeof(ASYNC_COMMANDS) / sizeof(ASYNC_COMMANDS[0]); i++) {
+        if (strlen(ASYNC_COMMANDS[i]) == length && strncmp(frame, ASYNC_COMMANDS[i], length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Routes one complete frame (without its '\n').
+static void dispatch_frame(const char* frame) {
+    printf("[Server Response]: %s\n", frame);
+
+    if (is_async_command(frame)) {
+        // This is a pushed message from the server, use the callback
+        pthread_mutex_lock(&g_async_mutex);
+        if (g_async_handler != NULL) {
+            g_async_handler(frame);
+        } else if (g_pending_async_count < MAX_PENDING_ASYNC) {
+            g_pending_async[g_pending_async_count] = strdup(frame);
+            if (g_pending_async[g_pending_async_count] != NULL) g_pending_async_count++;
+        }
+        pthread_mutex_unlock(&g_async_mutex);
+    } else {
+        // This is a direct reply to a client command, store it in the buffer
+        pthread_mutex_lock(&g_response_mutex);
+        strncpy(g_last_response, frame, sizeof(g_last_response) - 1);
+        g_last_response[sizeof(g_last_response) - 1] = '\0'; // Ensure null-termination
+        pthread_mutex_unlock(&g_response_mutex);
+    }
+}
 
+// If the frame at data starts the streamed reply, returns the length of its
+// prefix (else 0). Needs as many bytes as the prefix has, or the whole frame;
+// *undecided is set when it cannot tell yet.
+static size_t reply_stream_prefix(const char* data, size_t available, bool* undecided) {
+    *undecided = false;
+    pthread_mutex_lock(&g_reply_mutex);
+    size_t prefix_length = strlen(g_reply_prefix);
+    if (g_reply_handler == NULL) {
+        prefix_length = 0;
+    } else if (available < prefix_length) {
+        *undecided = memcmp(data, g_reply_prefix, available) == 0 && memchr(data, '\n', available) == NULL;
+        prefix_length = 0;
+    } else if (memcmp(data, g_reply_prefix, prefix_length) != 0) {
+        prefix_length = 0;
+    } else {
+        g_stream_generation = g_reply_generation;
+    }
+    pthread_mutex_unlock(&g_reply_mutex);
+    return prefix_length;
+}
+
+// Hands a piece of the streamed reply to its handler, if it is still registered
+static void feed_reply_stream(char* data, size_t length) {
+    pthread_mutex_lock(&g_reply_mutex);
+    if (g_reply_handler != NULL && g_reply_generation == g_stream_generation && length > 0) {
+        g_reply_handler(data, length, g_reply_context);
+    }
+    pthread_mutex_unlock(&g_reply_mutex);
+}
+
+// The streamed reply is complete: answer the polling with its prefix alone
+static void end_reply_stream(void) {
+    pthread_mutex_lock(&g_reply_mutex);
+    if (g_reply_handler == NULL || g_reply_generation != g_stream_generation) {
+        pthread_mutex_unlock(&g_reply_mutex);
+        return; // Nobody waits for it anymore
+    }
+    char prefix[sizeof(g_reply_prefix)];
+    strcpy(prefix, g_reply_prefix);
+    g_reply_handler = NULL;
+    g_reply_context = NULL;
+    g_reply_prefix[0] = '\0';
+    pthread_mutex_unlock(&g_reply_mutex);
+
+    pthread_mutex_lock(&g_response_mutex);
+    strcpy(g_last_response, prefix);
+    pthread_mutex_unlock(&g_response_mutex);
+}
+
+// Splits the received bytes into frames and dispatches them; returns how
+// many bytes were used. A partial frame is left for the next recv, unless
+// it is a streamed reply, whose bytes are handed over as they come.
+static size_t process_stream(void) {
+    size_t start = 0;
+    while (start < g_stream_length) {
+        char* data = g_stream + start;
+        size_t available = g_stream_length - start;
+        char* newline = memchr(data, '\n', available);
+
+        if (!g_in_reply_stream) {
+            bool undecided;
+            size_t prefix_length = reply_stream_prefix(data, available, &undecided);
+            if (prefix_length > 0) {
+                g_in_reply_stream = true;
+                start += prefix_length;
+                continue;
+            }
+            if (undecided || newline == NULL) break;
+            *newline = '\0';
+            if (newline > data) dispatch_frame(data);
+            start += (size_t)(newline - data) + 1;
+            continue;
+        }
+
+        size_t length = newline != NULL ? (size_t)(newline - data) : available;
+        feed_reply_stream(data, length);
+        start += length;
+        if (newline != NULL) {
+            g_in_reply_stream = false;
+            end_reply_stream();
+            start++;
+        }
+    }
+    return start;
+}
 
 // The function that will run in the background to handle incoming messages
 static void* handleConnection(void* arg) {
-    char server_message[2048];
-    const char* separator = "^";
-    
     while (g_is_connected) {
-        memset(server_message, 0, sizeof(server_message));
-        int recv_size = recv(g_socket_fd, server_message, sizeof(server_message) - 1, 0);
+        if (g_stream_length == sizeof(g_stream)) {
+            fprintf(stderr, "Network: Dropping an oversized frame.\n");
+            g_stream_length = 0;
+        }
+        int recv_size = recv(g_socket_fd, g_stream + g_stream_length, sizeof(g_stream) - g_stream_length, 0);
         
         if (recv_size > 0) {
-            server_message[recv_size] = '\0';
-            printf("[Server Response]: %s\n", server_message);
-
-            // Make a copy to safely parse the command
-            char* msg_copy = strdup(server_message);
-            if (msg_copy == NULL) { continue; } // strdup failed
-            char* command = strtok(msg_copy, separator);
-
-            bool is_async = false;
-            if(command != NULL) {
-                // Add any future async commands here
-                if (strcmp(command, "RECEIVE_DM") == 0 || strcmp(command, "RECEIVE_GROUP_MSG") == 0) {
-                    is_async = true;
-                }
-            }
-            free(msg_copy);
-
-            if (is_async && g_async_handler != NULL) {
-                // This is a pushed message from the server, use the callback
-                g_async_handler(server_message);
-            } else {
-                // This is a direct reply to a client command, store it in the buffer
-                pthread_mutex_lock(&g_response_mutex);
-                strncpy(g_last_response, server_message, sizeof(g_last_response) - 1);
-                g_last_response[sizeof(g_last_response) - 1] = '\0'; // Ensure null-termination
-                pthread_mutex_unlock(&g_response_mutex);
-            }
+            g_stream_length += recv_size;
+
+            // Dispatch every complete frame; keep the partial tail for the next recv
+            size_t start = process_stream();
+            memmove(g_stream, g_stream + start, g_stream_length - start);
+            g_stream_length -= start;
 
         } else {
             // Server closed connection or an error occurred
@@ -76,11 +208,9 @@ static void* handleConnection(void* arg) {
 
 int Network_connect(const char* ip, int port) {
     if (g_is_connected) return g_socket_fd;
-
-    // Initialize the response mutex
-    if (pthread_mutex_init(&g_response_mutex, NULL) != 0) {
-        perror("mutex init failed");
-        return -1;
+    if (ip != g_server_ip) { // Not when reconnecting
+        strncpy(g_server_ip, ip, sizeof(g_server_ip) - 1);
+        g_server_port = port;
     }
 
     struct sockaddr_in server_addr;
@@ -113,17 +243,30 @@ int Network_start_listener() {
         perror("could not create listener thread");
         return -1;
     }
+    g_listener_started = true;
     printf("Network listener thread started.\n");
     return 0;
 }
 
 int Network_send(const char* message) {
     if (!g_is_connected) return -1;
-    if (send(g_socket_fd, message, strlen(message), 0) < 0) {
+
+    // Frame the message with a trailing '\n' and send it in one piece
+    size_t length = strlen(message);
+    char* frame = malloc(length + 1);
+    if (frame == NULL) return -1;
+    memcpy(frame, message, length);
+    frame[length] = '\n';
+
+    int status = 0;
+    pthread_mutex_lock(&g_send_mutex);
+    if (send(g_socket_fd, frame, length + 1, MSG_NOSIGNAL) < 0) { // A lost connection fails the send, not the process
         perror("Send failed");
-        return -1;
+        status = -1;
     }
-    return 0;
+    pthread_mutex_unlock(&g_send_mutex);
+    free(frame);
+    return status;
 }
 
 void Network_disconnect() {
@@ -134,10 +277,9 @@ void Network_disconnect() {
         shutdown(g_socket_fd, SHUT_RD); 
         
         pthread_join(g_listener_thread, NULL); // Wait for the listener thread
+        g_listener_started = false;
         close(g_socket_fd);
         g_socket_fd = -1;
-
-        pthread_mutex_destroy(&g_response_mutex); // Clean up the mutex
         printf("Disconnected from server.\n");
     }
 }
@@ -149,7 +291,18 @@ void Network_clear_response() {
 }
 
 void Network_set_async_message_handler(async_message_handler_t handler) {
+    pthread_mutex_lock(&g_async_mutex);
     g_async_handler = handler;
+
+    // Deliver what arrived before the handler existed
+    if (handler != NULL) {
+        for (int i = 0; i < g_pending_async_count; i++) {
+            handler(g_pending_async[i]);
+            free(g_pending_async[i]);
+        }
+        g_pending_async_count = 0;
+    }
+    pthread_mutex_unlock(&g_async_mutex);
 }
 
 void Network_get_response(char* buffer, int buffer_size) {
@@ -158,3 +311,42 @@ void Network_get_response(char* buffer, int buffer_size) {
     buffer[buffer_size - 1] = '\0'; // Ensure null termination
     pthread_mutex_unlock(&g_response_mutex);
 }
+
+void Network_set_reply_stream(const char* prefix, reply_chunk_handler_t handler, void* context) {
+    pthread_mutex_lock(&g_reply_mutex);
+    g_reply_generation++;
+    if (prefix != NULL && handler != NULL && strlen(prefix) < sizeof(g_reply_prefix)) {
+        strcpy(g_reply_prefix, prefix);
+        g_reply_handler = handler;
+        g_reply_context = context;
+    } else {
+        g_reply_prefix[0] = '\0';
+        g_reply_handler = NULL;
+        g_reply_context = NULL;
+    }
+    pthread_mutex_unlock(&g_reply_mutex);
+}
+
+bool Network_is_connected(void) {
+    return g_is_connected;
+}
+
+int Network_reconnect(void) {
+    if (g_is_connected) return 0;
+    if (g_server_ip[0] == '\0') return -1;
+
+    // Clean up after the lost connection: its listener has finished
+    if (g_listener_started) {
+        pthread_join(g_listener_thread, NULL);
+        g_listener_started = false;
+    }
+    if (g_socket_fd != -1) {
+        close(g_socket_fd);
+        g_socket_fd = -1;
+    }
+    g_stream_length = 0;
+    g_in_reply_stream = false;
+
+    if (Network_connect(g_server_ip, g_server_port) < 0) return -1;
+    return Network_start_listener();
+}
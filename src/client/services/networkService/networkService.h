@@ -1,6 +1,9 @@
 #ifndef NETWORK_SERVICE_H
 #define NETWORK_SERVICE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 /**
  * @brief Attempts to connect to the server.
  * @param ip The IP address of the server (e.g., "127.0.0.1").
@@ -19,7 +22,9 @@ int Network_start_listener();
 
 /**
  * @brief Sends a message to the server.
- * This function should be thread-safe.
+ * The message is framed with a trailing '\n'; server frames end with '\n'
+ * too, and the listener thread splits the stream back into frames.
+ * This function is thread-safe.
  * @param message The null-terminated string to send.
  * @return 0 on success, -1 on failure (e.g., not connected).
  */
@@ -30,6 +35,19 @@ int Network_send(const char* message);
  */
 void Network_disconnect();
 
+/**
+ * @brief Returns false once the server closed the connection (or it was never made).
+ */
+bool Network_is_connected(void);
+
+/**
+ * @brief Connects again to the last server, after the connection was lost,
+ * and restarts the listener. The server sees a new client: log in again.
+ * This is a blocking call.
+ * @return 0 on success (or if still connected), -1 on failure.
+ */
+int Network_reconnect(void);
+
 /**
  * @brief Clears the last received server response buffer.
  * Should be called before sending a new command that expects a response.
@@ -51,10 +69,30 @@ typedef void (*async_message_handler_t)(const char* message);
 
 /**
  * @brief Registers a callback function to handle asynchronous messages from the server.
- * Asynchronous messages (like RECEIVE_DM) will be passed to this handler
- * instead of being placed in the standard response buffer.
+ * Asynchronous messages (RECEIVE_DM, RECEIVE_GROUP_MSG, MISSED_DATA) will be
+ * passed to this handler instead of being placed in the standard response
+ * buffer. Messages received before a handler is set are queued and handed
+ * to it when it is registered.
  * @param handler The function to call when an async message is received.
  */
 void Network_set_async_message_handler(async_message_handler_t handler);
 
+/**
+ * @brief Defines the function pointer type for receiving a streamed reply.
+ * The chunk is in the listener's buffer: the handler may modify it, but
+ * must not keep it.
+ */
+typedef void (*reply_chunk_handler_t)(char* chunk, size_t length, void* context);
+
+/**
+ * @brief Streams the next reply that starts with a prefix (e.g., a history
+ * page) to a handler as its bytes arrive, without the prefix, instead of
+ * storing it in the response buffer. Replies of any size can be streamed.
+ * When the reply ends, the response buffer holds just the prefix, so the
+ * usual polling sees it complete. Call with NULL to stop streaming; the
+ * rest of a reply being streamed is then discarded.
+ * @param prefix The reply prefix, up to 63 characters.
+ */
+void Network_set_reply_stream(const char* prefix, reply_chunk_handler_t handler, void* context);
+
 #endif // NETWORK_SERVICE_H
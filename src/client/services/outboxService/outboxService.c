@@ -0,0 +1,133 @@
+#include "outboxService.h"
+#include "../messageService/messageService.h"
+#include "../networkService/networkService.h"
+#include "../authService/authService.h"
+#include "../taskService/taskService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// A queued message and when to try it
+typedef struct {
+    OutboxMessage message;
+    int retry_seconds;  // Wait after the next failure
+    time_t retry_after;
+} OutboxEntry;
+
+// A send running on the task worker, on a copy of the queue's head
+typedef struct {
+    OutboxMessage message;
+    long message_id;
+    char time[MESSAGE_TIME_SIZE];
+    MessageSendResult result;
+} SendTask;
+
+// --- Module-level static variables ---
+static OutboxEntry* g_entries = NULL; // Queue, oldest first
+static int g_entry_count = 0;
+static int g_entry_capacity = 0;
+static bool g_sending = false;        // The head is on the task worker
+static outbox_listener_t g_listener = NULL;
+
+// Unique for the user across runs: the start time, then a counter
+static long next_client_id() {
+    static long base = 0;
+    static long counter = 0;
+    if (base == 0) base = (long)time(NULL) * 100000;
+    return base + ++counter;
+}
+
+static void run_send(void* context) {
+    SendTask* task = context;
+    const OutboxMessage* message = &task->message;
+    task->result = MESSAGE_SEND_FAILED;
+
+    // The server forgot this client with the lost connection: log in again
+    if (!Network_is_connected()) {
+        if (Network_reconnect() != 0 || !AuthService_relogin()) return;
+        printf("OutboxService: Reconnected to the server.\n");
+    }
+
+    task->result = message->is_group
+        ? MessageService_send_group_message(message->chat_id, message->text, message->client_id, &task->message_id, task->time)
+        : MessageService_send_dm(message->chat_id, message->text, message->client_id, &task->message_id, task->time);
+}
+
+static void finish_send(void* context) {
+    SendTask* task = context;
+    g_sending = false;
+
+    long messageId = 0;
+    if (task->result == MESSAGE_SEND_FAILED) {
+        OutboxEntry* head = &g_entries[0];
+        head->retry_after = time(NULL) + head->retry_seconds;
+        head->retry_seconds *= 2;
+        if (head->retry_seconds > OUTBOX_RETRY_MAX_SECONDS) head->retry_seconds = OUTBOX_RETRY_MAX_SECONDS;
+        fprintf(stderr, "OutboxService: Send failed; retrying in %ld s.\n", (long)(head->retry_after - time(NULL)));
+    } else {
+        // Sent or refused, the head leaves: only OutboxService_update starts sends
+        memmove(g_entries, g_entries + 1, sizeof(OutboxEntry) * (g_entry_count - 1));
+        g_entry_count--;
+        if (task->result == MESSAGE_SEND_REJECTED) {
+            fprintf(stderr, "OutboxService: The server refused a message; it will not be sent.\n");
+            messageId = OUTBOX_REJECTED;
+        } else {
+            messageId = task->message_id;
+        }
+    }
+
+    if (g_listener != NULL) {
+        const char* time = task->result == MESSAGE_SEND_OK && task->time[0] != '\0' ? task->time : NULL;
+        g_listener(&task->message, messageId, time);
+    }
+    free(task);
+    OutboxService_update();
+}
+
+void OutboxService_set_listener(outbox_listener_t listener) {
+    g_listener = listener;
+}
+
+long OutboxService_send(bool isGroup, long chatId, const char* text) {
+    if (text == NULL || text[0] == '\0') return 0;
+    if (g_entry_count == g_entry_capacity) {
+        int capacity = g_entry_capacity == 0 ? 16 : g_entry_capacity * 2;
+        OutboxEntry* entries = realloc(g_entries, sizeof(OutboxEntry) * capacity);
+        if (entries == NULL) return 0;
+        g_entries = entries;
+        g_entry_capacity = capacity;
+    }
+
+    OutboxEntry* entry = &g_entries[g_entry_count++];
+    entry->message.client_id = next_client_id();
+    entry->message.is_group = isGroup;
+    entry->message.chat_id = chatId;
+    strncpy(entry->message.text, text, sizeof(entry->message.text) - 1);
+    entry->message.text[sizeof(entry->message.text) - 1] = '\0';
+    entry->retry_seconds = OUTBOX_RETRY_MIN_SECONDS;
+    entry->retry_after = 0;
+
+    OutboxService_update();
+    return entry->message.client_id;
+}
+
+int OutboxService_get_pending(bool isGroup, long chatId, OutboxMessage* out_messages, int max) {
+    int count = 0;
+    for (int i = 0; i < g_entry_count && count < max; i++) {
+        if (g_entries[i].message.is_group == isGroup && g_entries[i].message.chat_id == chatId) {
+            out_messages[count++] = g_entries[i].message;
+        }
+    }
+    return count;
+}
+
+void OutboxService_update(void) {
+    if (g_sending || g_entry_count == 0) return;
+    if (g_entries[0].retry_after > time(NULL)) return;
+
+    SendTask* task = calloc(1, sizeof(SendTask));
+    if (task == NULL) return;
+    task->message = g_entries[0].message;
+    g_sending = TaskService_post(run_send, finish_send, task) == 0;
+}
@@ -0,0 +1,70 @@
+#ifndef OUTBOX_SERVICE_H
+#define OUTBOX_SERVICE_H
+#include <stdbool.h>
+
+/*
+ * Sends the user's messages in the background, so a chat shows them at
+ * once (pending) and typing never waits for the server.
+ *
+ * - OutboxService_send queues a message under a new client message ID.
+ *   Messages go out one at a time, in order, on the task worker (see
+ *   taskService.h).
+ * - When the server confirms one, the listener gets its server message ID.
+ *   When an attempt fails, the listener is told too and the message is
+ *   tried again later (OUTBOX_RETRY_MIN_SECONDS, doubling up to
+ *   OUTBOX_RETRY_MAX_SECONDS), after reconnecting and logging in again if
+ *   the connection was lost. A message the server refuses is dropped, so
+ *   it does not hold up the ones behind it.
+ * - The server saves a message once per client ID, so a retry after a lost
+ *   confirmation does not send it twice.
+ *
+ * Call these functions from the UI thread only.
+ */
+
+#define OUTBOX_TEXT_SIZE 1024
+#define OUTBOX_RETRY_MIN_SECONDS 1
+#define OUTBOX_RETRY_MAX_SECONDS 30
+#define OUTBOX_REJECTED -1  // Message ID reported for a message the server refused
+
+typedef struct {
+    long client_id;
+    bool is_group;
+    long chat_id;       // The receiver's user ID, or the group ID
+    char text[OUTBOX_TEXT_SIZE];
+} OutboxMessage;
+
+/**
+ * @brief Defines the function told about a send attempt.
+ * @param message The message (valid during the call only).
+ * @param messageId The server's message ID once confirmed, 0 if this attempt
+ *        failed and the message will be tried again, or OUTBOX_REJECTED if
+ *        the server refused it and it left the outbox.
+ * @param time The time the server saved the message at, or NULL if not
+ *        known (not confirmed, or a server that does not say).
+ */
+typedef void (*outbox_listener_t)(const OutboxMessage* message, long messageId, const char* time);
+
+/**
+ * @brief Registers the function told about send attempts (one at a time).
+ */
+void OutboxService_set_listener(outbox_listener_t listener);
+
+/**
+ * @brief Queues a message to a user or group.
+ * @return Its client message ID, or 0 if it could not be queued.
+ */
+long OutboxService_send(bool isGroup, long chatId, const char* text);
+
+/**
+ * @brief Copies the unconfirmed messages of a chat, oldest first (e.g., to
+ *        show them again when the chat is reopened).
+ * @return The number copied (at most max).
+ */
+int OutboxService_get_pending(bool isGroup, long chatId, OutboxMessage* out_messages, int max);
+
+/**
+ * @brief Starts the next send when one is due. Call it once per frame.
+ */
+void OutboxService_update(void);
+
+#endif // OUTBOX_SERVICE_H
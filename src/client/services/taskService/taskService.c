@@ -0,0 +1,183 @@
+#include "taskService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef struct Task {
+    task_work_t work;
+    task_done_t done;
+    void* context;
+    struct Task* next;
+} Task;
+
+// A FIFO of tasks, linked through 'next'
+typedef struct {
+    Task* head;
+    Task* tail;
+} TaskQueue;
+
+// --- Module-level static variables ---
+static pthread_t g_worker_thread;
+static bool g_is_running = false;
+
+// Tasks waiting for the worker, and the number queued or running
+static TaskQueue g_pending = { NULL, NULL };
+static int g_busy_count = 0;
+static pthread_mutex_t g_pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_pending_cond = PTHREAD_COND_INITIALIZER;
+
+// Tasks whose work is done, waiting for the next drain on the UI thread
+static TaskQueue g_completed = { NULL, NULL };
+static pthread_mutex_t g_completed_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void queue_push(TaskQueue* queue, Task* task) {
+    task->next = NULL;
+    if (queue->tail != NULL) {
+        queue->tail->next = task;
+    } else {
+        queue->head = task;
+    }
+    queue->tail = task;
+}
+
+static Task* queue_pop(TaskQueue* queue) {
+    Task* task = queue->head;
+    if (task != NULL) {
+        queue->head = task->next;
+        if (queue->head == NULL) queue->tail = NULL;
+    }
+    return task;
+}
+
+static void complete_task(Task* task) {
+    pthread_mutex_lock(&g_completed_mutex);
+    queue_push(&g_completed, task);
+    pthread_mutex_unlock(&g_completed_mutex);
+}
+
+// The worker thread: runs queued work one task at a time
+static void* run_worker(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_pending_mutex);
+    while (g_is_running) {
+        Task* task = queue_pop(&g_pending);
+        if (task == NULL) {
+            pthread_cond_wait(&g_pending_cond, &g_pending_mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&g_pending_mutex);
+
+        task->work(task->context);
+        complete_task(task);
+
+        pthread_mutex_lock(&g_pending_mutex);
+        g_busy_count--;
+    }
+    pthread_mutex_unlock(&g_pending_mutex);
+    return NULL;
+}
+
+int TaskService_start() {
+    pthread_mutex_lock(&g_pending_mutex);
+    if (g_is_running) {
+        pthread_mutex_unlock(&g_pending_mutex);
+        return 0;
+    }
+    g_is_running = true;
+    pthread_mutex_unlock(&g_pending_mutex);
+
+    if (pthread_create(&g_worker_thread, NULL, run_worker, NULL) != 0) {
+        fprintf(stderr, "TaskService: Failed to create the worker thread.\n");
+        g_is_running = false;
+        return -1;
+    }
+    return 0;
+}
+
+int TaskService_post(task_work_t work, task_done_t done, void* context) {
+    Task* task = malloc(sizeof(Task));
+    if (task == NULL) {
+        free(context);
+        return -1;
+    }
+    task->work = work;
+    task->done = done;
+    task->context = context;
+
+    // Nothing to run off the UI thread: straight to the completion queue
+    if (work == NULL) {
+        complete_task(task);
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_pending_mutex);
+    if (!g_is_running) {
+        pthread_mutex_unlock(&g_pending_mutex);
+        fprintf(stderr, "TaskService: Dropping a task, the worker is not running.\n");
+        free(task);
+        free(context);
+        return -1;
+    }
+    queue_push(&g_pending, task);
+    g_busy_count++;
+    pthread_cond_signal(&g_pending_cond);
+    pthread_mutex_unlock(&g_pending_mutex);
+    return 0;
+}
+
+int TaskService_drain() {
+    // 1. Take every finished task at once, so done functions can post new ones
+    pthread_mutex_lock(&g_completed_mutex);
+    Task* task = g_completed.head;
+    g_completed.head = NULL;
+    g_completed.tail = NULL;
+    pthread_mutex_unlock(&g_completed_mutex);
+
+    // 2. Run them in completion order
+    int count = 0;
+    while (task != NULL) {
+        Task* next = task->next;
+        if (task->done != NULL) {
+            task->done(task->context);
+        } else {
+            free(task->context);
+        }
+        free(task);
+        task = next;
+        count++;
+    }
+    return count;
+}
+
+bool TaskService_is_busy() {
+    pthread_mutex_lock(&g_pending_mutex);
+    bool busy = g_busy_count > 0;
+    pthread_mutex_unlock(&g_pending_mutex);
+    return busy;
+}
+
+void TaskService_stop() {
+    pthread_mutex_lock(&g_pending_mutex);
+    if (!g_is_running) {
+        pthread_mutex_unlock(&g_pending_mutex);
+        return;
+    }
+    g_is_running = false;
+    pthread_cond_signal(&g_pending_cond);
+    pthread_mutex_unlock(&g_pending_mutex);
+    pthread_join(g_worker_thread, NULL);
+
+    // The worker is gone: drop what it never ran, and what was never drained
+    Task* task;
+    while ((task = queue_pop(&g_pending)) != NULL) {
+        free(task->context);
+        free(task);
+    }
+    g_busy_count = 0;
+    pthread_mutex_lock(&g_completed_mutex);
+    while ((task = queue_pop(&g_completed)) != NULL) {
+        free(task->context);
+        free(task);
+    }
+    pthread_mutex_unlock(&g_completed_mutex);
+}
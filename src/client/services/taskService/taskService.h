@@ -0,0 +1,61 @@
+#ifndef TASK_SERVICE_H
+#define TASK_SERVICE_H
+#include <stdbool.h>
+
+/*
+ * Runs blocking work (network requests) off the raylib render thread.
+ *
+ * - TaskService_post queues a task: its work function runs on the worker
+ *   thread, one task at a time and in posting order (the services share one
+ *   response buffer, so requests must not overlap).
+ * - When the work is done, the task's done function runs on the UI thread,
+ *   from TaskService_drain, which the main loop calls once per frame. Done
+ *   functions may touch screen state freely and may post further tasks.
+ * - The context pointer belongs to the task: allocate it with malloc and
+ *   release it in the done function. Tasks still queued at shutdown are
+ *   dropped and their context freed with free().
+ */
+
+/**
+ * @brief Defines the function run on the worker thread.
+ */
+typedef void (*task_work_t)(void* context);
+
+/**
+ * @brief Defines the function run on the UI thread once the work is done.
+ */
+typedef void (*task_done_t)(void* context);
+
+/**
+ * @brief Starts the worker thread.
+ * @return 0 on success, -1 on thread creation failure.
+ */
+int TaskService_start();
+
+/**
+ * @brief Queues a task. Callable from any thread.
+ * @param work Runs on the worker thread, or NULL to only run done (on the next drain).
+ * @param done Runs on the UI thread afterwards, or NULL.
+ * @param context Handed to both functions.
+ * @return 0 on success, -1 if the task cannot be queued (context is then freed).
+ */
+int TaskService_post(task_work_t work, task_done_t done, void* context);
+
+/**
+ * @brief Runs the done functions of the tasks finished since the last call.
+ * Call it from the UI thread, once per frame.
+ * @return The number of tasks run (the screen changed if any).
+ */
+int TaskService_drain();
+
+/**
+ * @brief Returns true while tasks are queued or running (for loading indicators).
+ */
+bool TaskService_is_busy();
+
+/**
+ * @brief Stops the worker after its current task and drops the queued ones.
+ */
+void TaskService_stop();
+
+#endif // TASK_SERVICE_H
@@ -0,0 +1,199 @@
+#include "usernameService.h"
+#include "../messageService/messageService.h"
+#include "../taskService/taskService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define USERNAME_BUCKET_COUNT (USERNAME_CACHE_CAPACITY * 2)
+
+typedef enum {
+    ENTRY_FREE,
+    ENTRY_PENDING,   // A lookup is in flight
+    ENTRY_RESOLVED,
+    ENTRY_FAILED,    // The last lookup failed; retry after retry_after
+} EntryState;
+
+// One cached user. Entries are chained in a hash bucket and in the LRU list
+// (most recently used first); both links are indexes into g_entries, -1 for none.
+typedef struct {
+    long user_id;
+    char username[256];
+    EntryState state;
+    time_t retry_after;
+    int bucket_next;
+    int lru_prev;
+    int lru_next;
+} CacheEntry;
+
+// A lookup running on the task worker
+typedef struct {
+    long user_id;
+    char username[256];
+    bool found;
+} LookupTask;
+
+// --- Module-level static variables ---
+static CacheEntry g_entries[USERNAME_CACHE_CAPACITY];
+static int g_buckets[USERNAME_BUCKET_COUNT];
+static int g_lru_head = -1;
+static int g_lru_tail = -1;
+static int g_entry_count = 0;
+static bool g_is_initialized = false;
+static username_listener_t g_listener = NULL;
+
+static void init_cache() {
+    for (int i = 0; i < USERNAME_BUCKET_COUNT; i++) g_buckets[i] = -1;
+    for (int i = 0; i < USERNAME_CACHE_CAPACITY; i++) g_entries[i].state = ENTRY_FREE;
+    g_is_initialized = true;
+}
+
+static int bucket_of(long userId) {
+    unsigned long hash = (unsigned long)userId * 2654435761UL;
+    return (int)(hash % USERNAME_BUCKET_COUNT);
+}
+
+static int find_entry(long userId) {
+    for (int i = g_buckets[bucket_of(userId)]; i != -1; i = g_entries[i].bucket_next) {
+        if (g_entries[i].user_id == userId) return i;
+    }
+    return -1;
+}
+
+static void lru_unlink(int index) {
+    CacheEntry* entry = &g_entries[index];
+    if (entry->lru_prev != -1) g_entries[entry->lru_prev].lru_next = entry->lru_next;
+    else g_lru_head = entry->lru_next;
+    if (entry->lru_next != -1) g_entries[entry->lru_next].lru_prev = entry->lru_prev;
+    else g_lru_tail = entry->lru_prev;
+}
+
+static void lru_push_front(int index) {
+    g_entries[index].lru_prev = -1;
+    g_entries[index].lru_next = g_lru_head;
+    if (g_lru_head != -1) g_entries[g_lru_head].lru_prev = index;
+    g_lru_head = index;
+    if (g_lru_tail == -1) g_lru_tail = index;
+}
+
+static void touch_entry(int index) {
+    if (g_lru_head == index) return;
+    lru_unlink(index);
+    lru_push_front(index);
+}
+
+// Frees the least recently used entry without a lookup in flight.
+// Returns its index, or -1 if every entry is pending.
+static int evict_entry() {
+    for (int i = g_lru_tail; i != -1; i = g_entries[i].lru_prev) {
+        if (g_entries[i].state == ENTRY_PENDING) continue;
+
+        int* link = &g_buckets[bucket_of(g_entries[i].user_id)];
+        while (*link != i) link = &g_entries[*link].bucket_next;
+        *link = g_entries[i].bucket_next;
+        lru_unlink(i);
+        g_entries[i].state = ENTRY_FREE;
+        return i;
+    }
+    return -1;
+}
+
+// Adds an entry for a user that is not cached. Returns its index, or -1.
+static int insert_entry(long userId) {
+    int index = -1;
+    if (g_entry_count < USERNAME_CACHE_CAPACITY) {
+        index = g_entry_count++;
+    } else {
+        index = evict_entry();
+        if (index == -1) return -1;
+    }
+
+    CacheEntry* entry = &g_entries[index];
+    entry->user_id = userId;
+    entry->username[0] = '\0';
+    entry->retry_after = 0;
+    int bucket = bucket_of(userId);
+    entry->bucket_next = g_buckets[bucket];
+    g_buckets[bucket] = index;
+    lru_push_front(index);
+    return index;
+}
+
+static void run_lookup(void* context) {
+    LookupTask* task = context;
+    task->found = MessageService_get_user_info(task->user_id, task->username, sizeof(task->username));
+}
+
+static void finish_lookup(void* context) {
+    LookupTask* task = context;
+    int index = find_entry(task->user_id);
+    if (index != -1 && g_entries[index].state == ENTRY_PENDING) {
+        if (task->found) {
+            strncpy(g_entries[index].username, task->username, sizeof(g_entries[index].username) - 1);
+            g_entries[index].username[sizeof(g_entries[index].username) - 1] = '\0';
+            g_entries[index].state = ENTRY_RESOLVED;
+        } else {
+            g_entries[index].state = ENTRY_FAILED;
+            g_entries[index].retry_after = time(NULL) + USERNAME_RETRY_SECONDS;
+        }
+    }
+    if (task->found && g_listener != NULL) g_listener(task->user_id, task->username);
+    free(task);
+}
+
+static void start_lookup(int index) {
+    LookupTask* task = calloc(1, sizeof(LookupTask));
+    if (task == NULL) return;
+    task->user_id = g_entries[index].user_id;
+    g_entries[index].state = ENTRY_PENDING;
+    if (TaskService_post(run_lookup, finish_lookup, task) != 0) {
+        g_entries[index].state = ENTRY_FAILED;
+        g_entries[index].retry_after = time(NULL) + USERNAME_RETRY_SECONDS;
+    }
+}
+
+void UsernameService_set_listener(username_listener_t listener) {
+    g_listener = listener;
+}
+
+bool UsernameService_lookup(long userId, char* out_name, int buffer_size) {
+    if (out_name == NULL || buffer_size <= 0) return false;
+    if (!g_is_initialized) init_cache();
+
+    int index = find_entry(userId);
+    if (index != -1) {
+        touch_entry(index);
+        if (g_entries[index].state == ENTRY_RESOLVED) {
+            strncpy(out_name, g_entries[index].username, buffer_size - 1);
+            out_name[buffer_size - 1] = '\0';
+            return true;
+        }
+        if (g_entries[index].state == ENTRY_FAILED && time(NULL) >= g_entries[index].retry_after) {
+            start_lookup(index);
+        }
+    } else {
+        index = insert_entry(userId);
+        if (index != -1) start_lookup(index);
+    }
+
+    snprintf(out_name, buffer_size, "User %ld", userId);
+    return false;
+}
+
+void UsernameService_remember(long userId, const char* username) {
+    if (username == NULL) return;
+    if (!g_is_initialized) init_cache();
+
+    int index = find_entry(userId);
+    if (index == -1) {
+        index = insert_entry(userId);
+        if (index == -1) return;
+    } else {
+        touch_entry(index);
+    }
+    // A lookup still in flight finds the entry resolved and leaves it be
+    strncpy(g_entries[index].username, username, sizeof(g_entries[index].username) - 1);
+    g_entries[index].username[sizeof(g_entries[index].username) - 1] = '\0';
+    g_entries[index].state = ENTRY_RESOLVED;
+}
@@ -0,0 +1,47 @@
+#ifndef USERNAME_SERVICE_H
+#define USERNAME_SERVICE_H
+#include <stdbool.h>
+
+/*
+ * Resolves user IDs to usernames without blocking the UI thread.
+ *
+ * - Known names come from an LRU cache of USERNAME_CACHE_CAPACITY entries.
+ * - An unknown name reads as the placeholder "User <id>" and starts one
+ *   GET_USER_INFO request on the task worker (see taskService.h); further
+ *   lookups of the same ID while it is in flight share that request.
+ * - When the reply arrives, the listener is told, so screens can replace
+ *   the placeholders they show. A failed lookup is retried at the earliest
+ *   USERNAME_RETRY_SECONDS later.
+ *
+ * Call these functions from the UI thread only.
+ */
+
+#define USERNAME_CACHE_CAPACITY 512
+#define USERNAME_RETRY_SECONDS 30
+
+/**
+ * @brief Defines the function told when a username has been resolved.
+ */
+typedef void (*username_listener_t)(long userId, const char* username);
+
+/**
+ * @brief Registers the function told about resolved usernames (one at a time).
+ */
+void UsernameService_set_listener(username_listener_t listener);
+
+/**
+ * @brief Copies the username of a user into out_name.
+ * If it is not cached, copies the placeholder and starts a lookup.
+ * @param userId The user to look up.
+ * @param out_name Receives the username or the placeholder.
+ * @param buffer_size The size of out_name.
+ * @return true if out_name holds the real username.
+ */
+bool UsernameService_lookup(long userId, char* out_name, int buffer_size);
+
+/**
+ * @brief Caches a username learned elsewhere (e.g., from a user search).
+ */
+void UsernameService_remember(long userId, const char* username);
+
+#endif // USERNAME_SERVICE_H
@@ -0,0 +1,121 @@
+#include "chatDirectory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int bucket_of(const ChatDirectory* directory, bool isRoom, long id) {
+    unsigned long hash = ((unsigned long)id * 2 + (isRoom ? 1 : 0)) * 2654435761UL;
+    return (int)(hash & (unsigned long)(directory->bucket_count - 1));
+}
+
+static void build_label(ChatEntry* entry) {
+    const char* prefix = entry->is_room ? "Room -> " : "";
+    if (entry->unread > 0) {
+        snprintf(entry->label, sizeof(entry->label), "%s%s (%d)", prefix, entry->name, entry->unread);
+    } else {
+        snprintf(entry->label, sizeof(entry->label), "%s%s", prefix, entry->name);
+    }
+}
+
+// Doubles the bucket table and chains every entry again
+static int grow_buckets(ChatDirectory* directory) {
+    int bucket_count = directory->bucket_count == 0 ? 64 : directory->bucket_count * 2;
+    int* buckets = malloc(sizeof(int) * bucket_count);
+    if (buckets == NULL) return -1;
+    free(directory->buckets);
+    directory->buckets = buckets;
+    directory->bucket_count = bucket_count;
+
+    for (int i = 0; i < bucket_count; i++) buckets[i] = -1;
+    for (int i = 0; i < directory->count; i++) {
+        ChatEntry* entry = &directory->entries[i];
+        int bucket = bucket_of(directory, entry->is_room, entry->id);
+        entry->bucket_next = buckets[bucket];
+        buckets[bucket] = i;
+    }
+    return 0;
+}
+
+static int reserve_entry(ChatDirectory* directory) {
+    if (directory->count == directory->capacity) {
+        int capacity = directory->capacity == 0 ? 64 : directory->capacity * 2;
+        ChatEntry* entries = realloc(directory->entries, sizeof(ChatEntry) * capacity);
+        if (entries == NULL) return -1;
+        directory->entries = entries;
+        int* order = realloc(directory->order, sizeof(int) * capacity);
+        if (order == NULL) return -1;
+        directory->order = order;
+        directory->capacity = capacity;
+    }
+    if (directory->count >= directory->bucket_count) return grow_buckets(directory);
+    return 0;
+}
+
+ChatEntry* ChatDirectory_find(const ChatDirectory* directory, bool isRoom, long id) {
+    if (directory->bucket_count == 0) return NULL;
+    for (int i = directory->buckets[bucket_of(directory, isRoom, id)]; i != -1; i = directory->entries[i].bucket_next) {
+        ChatEntry* entry = &directory->entries[i];
+        if (entry->id == id && entry->is_room == isRoom) return entry;
+    }
+    return NULL;
+}
+
+ChatEntry* ChatDirectory_add(ChatDirectory* directory, bool isRoom, long id, const char* name, bool* out_added) {
+    if (out_added != NULL) *out_added = false;
+    ChatEntry* existing = ChatDirectory_find(directory, isRoom, id);
+    if (existing != NULL) return existing;
+    if (reserve_entry(directory) != 0) return NULL;
+
+    int index = directory->count++;
+    ChatEntry* entry = &directory->entries[index];
+    entry->id = id;
+    entry->is_room = isRoom;
+    entry->unread = 0;
+    entry->position = index;
+    directory->order[index] = index;
+    ChatDirectory_set_name(entry, name);
+
+    int bucket = bucket_of(directory, isRoom, id);
+    entry->bucket_next = directory->buckets[bucket];
+    directory->buckets[bucket] = index;
+
+    if (out_added != NULL) *out_added = true;
+    return entry;
+}
+
+void ChatDirectory_set_name(ChatEntry* entry, const char* name) {
+    strncpy(entry->name, name != NULL ? name : "", sizeof(entry->name) - 1);
+    entry->name[sizeof(entry->name) - 1] = '\0';
+    build_label(entry);
+}
+
+void ChatDirectory_set_unread(ChatEntry* entry, int unread) {
+    if (entry->unread == unread) return;
+    entry->unread = unread;
+    build_label(entry);
+}
+
+void ChatDirectory_touch(ChatDirectory* directory, ChatEntry* entry) {
+    int index = (int)(entry - directory->entries);
+    int position = entry->position;
+    if (position == 0) return;
+
+    // Shift the entries above it down by one
+    memmove(directory->order + 1, directory->order, sizeof(int) * position);
+    directory->order[0] = index;
+    for (int p = 0; p <= position; p++) {
+        directory->entries[directory->order[p]].position = p;
+    }
+}
+
+ChatEntry* ChatDirectory_at(const ChatDirectory* directory, int position) {
+    if (position < 0 || position >= directory->count) return NULL;
+    return &directory->entries[directory->order[position]];
+}
+
+void ChatDirectory_free(ChatDirectory* directory) {
+    free(directory->entries);
+    free(directory->buckets);
+    free(directory->order);
+    memset(directory, 0, sizeof(ChatDirectory));
+}
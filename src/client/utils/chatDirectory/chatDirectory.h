@@ -0,0 +1,80 @@
+#ifndef CHAT_DIRECTORY_H
+#define CHAT_DIRECTORY_H
+
+#include <stdbool.h>
+
+/*
+ * The conversations of the sidebar: direct chats (contacts) and rooms.
+ *
+ * - Entries are found by kind and ID through a hash index, so incoming
+ *   messages do not scan the list; the index grows with the directory.
+ * - Each entry keeps the text the sidebar shows (its label), rebuilt only
+ *   when the name or unread count changes.
+ * - The sidebar order is by last activity: a touched entry moves to the
+ *   top. New entries go to the bottom until they see activity.
+ *
+ * Entry pointers stay valid until the next ChatDirectory_add.
+ */
+
+#define CHAT_LABEL_SIZE 300
+
+typedef struct {
+    long id;
+    bool is_room;
+    char name[256];              // Username (or its placeholder) or room name
+    char label[CHAT_LABEL_SIZE]; // Sidebar text, e.g. "Room -> name (3)"
+    int unread;                  // Messages received while another chat was open
+    int position;                // Index in the sidebar order
+    int bucket_next;             // Next entry in the same hash bucket, -1 if none
+} ChatEntry;
+
+typedef struct {
+    ChatEntry* entries;  // In the order they were added
+    int count;
+    int capacity;
+
+    int* buckets;        // First entry of each bucket, -1 if none
+    int bucket_count;    // A power of two, at least 'count'
+
+    int* order;          // Entry indexes, most recent activity first
+} ChatDirectory;
+
+/**
+ * @brief Returns the entry of a contact or room, or NULL.
+ */
+ChatEntry* ChatDirectory_find(const ChatDirectory* directory, bool isRoom, long id);
+
+/**
+ * @brief Adds a contact or room at the bottom of the order, unless it exists.
+ * @param name Its name (copied).
+ * @param out_added Set to whether the entry is new; may be NULL.
+ * @return The new or existing entry, or NULL if memory runs out.
+ */
+ChatEntry* ChatDirectory_add(ChatDirectory* directory, bool isRoom, long id, const char* name, bool* out_added);
+
+/**
+ * @brief Renames an entry and rebuilds its label.
+ */
+void ChatDirectory_set_name(ChatEntry* entry, const char* name);
+
+/**
+ * @brief Sets the unread count of an entry and rebuilds its label.
+ */
+void ChatDirectory_set_unread(ChatEntry* entry, int unread);
+
+/**
+ * @brief Moves an entry to the top of the order (it just saw a message).
+ */
+void ChatDirectory_touch(ChatDirectory* directory, ChatEntry* entry);
+
+/**
+ * @brief Returns the entry at a position of the sidebar order, or NULL.
+ */
+ChatEntry* ChatDirectory_at(const ChatDirectory* directory, int position);
+
+/**
+ * @brief Removes every entry and frees the tables.
+ */
+void ChatDirectory_free(ChatDirectory* directory);
+
+#endif // CHAT_DIRECTORY_H
@@ -7,5 +7,7 @@
 #define WINDOW_SCREEN_HEIGHT 600
 #define WINDOW_TITLE "Yahuu"
 #define WINDOW_FRAME 60
+#define WINDOW_IDLE_FRAME 2  // Redraws per second while nothing changes
+#define WINDOW_IDLE_POLL 30  // Input polls per second while nothing changes
 
 #endif
@@ -1,10 +1,45 @@
 #include "fonts.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define GLYPH_TABLE_SIZE 4096 // Codepoints tried per font, loaded or not (power of two)
+#define FONT_FILE_COUNT 2
+#define DYNAMIC_FONT_COUNT 4
 
 Font Font_Opensans_Bold_30 = {0};
 Font Font_Opensans_Bold_20 = {0};
 Font Font_Opensans_Regular_20 = {0};
 Font Font_Opensans_Bold_17 = {0};
 
+typedef struct {
+    const char *path;
+    unsigned char *data;
+    int size;
+} FontFile;
+
+// A font whose atlas grows as glyphs are required
+typedef struct {
+    Font *font;              // The variable the screens draw with
+    FontFile *file;
+    int size;
+    Image atlas;             // Gray + alpha, uploaded as font->texture
+    int penX, penY, rowHeight;
+    int glyphCapacity;
+    int tried[GLYPH_TABLE_SIZE]; // Codepoint + 1 of every glyph tried, 0 for free slots
+    int triedCount;
+} DynamicFont;
+
+static FontFile g_files[FONT_FILE_COUNT] = {
+    { "assets/fonts/opensans/OpenSans-Regular.ttf", NULL, 0 },
+    { "assets/fonts/opensans/OpenSans-SemiBold.ttf", NULL, 0 },
+};
+
+static DynamicFont g_fonts[DYNAMIC_FONT_COUNT] = {
+    { .font = &Font_Opensans_Bold_30, .file = &g_files[1], .size = 30 },
+    { .font = &Font_Opensans_Regular_20, .file = &g_files[0], .size = 20 },
+    { .font = &Font_Opensans_Bold_20, .file = &g_files[1], .size = 20 },
+    { .font = &Font_Opensans_Bold_17, .file = &g_files[1], .size = 17 },
+};
 
 void debugFont(Font font, const char* fontName)
 {
@@ -17,39 +52,187 @@ void debugFont(Font font, const char* fontName)
         setDebugMessage(TextFormat("Loaded font: %s", fontName));
     }
 }
-void loadFonts()
+
+// Marks a codepoint as tried; returns false if it already was (or the table is full)
+static bool markTried(DynamicFont *dynamicFont, int codepoint)
+{
+    if (dynamicFont->triedCount >= GLYPH_TABLE_SIZE / 2) return false;
+    unsigned int slot = ((unsigned int)codepoint * 2654435761u) & (GLYPH_TABLE_SIZE - 1);
+    while (dynamicFont->tried[slot] != 0) {
+        if (dynamicFont->tried[slot] == codepoint + 1) return false;
+        slot = (slot + 1) & (GLYPH_TABLE_SIZE - 1);
+    }
+    dynamicFont->tried[slot] = codepoint + 1;
+    dynamicFont->triedCount++;
+    return true;
+}
+
+// Finds room for a w x h glyph (padding included); grows the atlas if needed
+static bool placeGlyph(DynamicFont *dynamicFont, int w, int h, int *outX, int *outY)
+{
+    if (w > GLYPH_ATLAS_WIDTH) return false;
+    if (dynamicFont->penX + w > GLYPH_ATLAS_WIDTH) {
+        dynamicFont->penX = 0;
+        dynamicFont->penY += dynamicFont->rowHeight;
+        dynamicFont->rowHeight = 0;
+    }
+
+    Image *atlas = &dynamicFont->atlas;
+    int height = atlas->height;
+    while (dynamicFont->penY + h > height && height < GLYPH_ATLAS_MAX_HEIGHT) height *= 2;
+    if (dynamicFont->penY + h > height) return false;
+    if (height != atlas->height) {
+        // Rows are contiguous, so the new rows simply go after the old ones
+        unsigned char *data = realloc(atlas->data, (size_t)GLYPH_ATLAS_WIDTH * height * 2);
+        if (data == NULL) return false;
+        memset(data + (size_t)GLYPH_ATLAS_WIDTH * atlas->height * 2, 0, (size_t)GLYPH_ATLAS_WIDTH * (height - atlas->height) * 2);
+        atlas->data = data;
+        atlas->height = height;
+    }
+
+    *outX = dynamicFont->penX;
+    *outY = dynamicFont->penY;
+    dynamicFont->penX += w;
+    if (h > dynamicFont->rowHeight) dynamicFont->rowHeight = h;
+    return true;
+}
+
+// Rasterizes codepoints into the atlas and the font's glyph table
+static void addGlyphs(DynamicFont *dynamicFont, int *codepoints, int count)
 {
+    Font *font = dynamicFont->font;
+    if (dynamicFont->file->data == NULL || count == 0) return;
+    if (font->glyphCount + count > dynamicFont->glyphCapacity) {
+        int capacity = dynamicFont->glyphCapacity == 0 ? 128 : dynamicFont->glyphCapacity;
+        while (capacity < font->glyphCount + count) capacity *= 2;
+        GlyphInfo *glyphs = realloc(font->glyphs, sizeof(GlyphInfo) * capacity);
+        if (glyphs != NULL) font->glyphs = glyphs;
+        Rectangle *recs = realloc(font->recs, sizeof(Rectangle) * capacity);
+        if (recs != NULL) font->recs = recs;
+        if (glyphs == NULL || recs == NULL) return;
+        dynamicFont->glyphCapacity = capacity;
+    }
 
-    // Load fonts here
-    Font_Opensans_Bold_30 = LoadFontEx(
-        "assets/fonts/opensans/OpenSans-SemiBold.ttf",
-        30,
-        0,
-        0
-    );
-
-    Font_Opensans_Regular_20 = LoadFontEx(
-        "assets/fonts/opensans/OpenSans-Regular.ttf",
-        20,
-        0,
-        0
-    );
-
-    Font_Opensans_Bold_20 = LoadFontEx(
-        "assets/fonts/opensans/OpenSans-SemiBold.ttf",
-        20,
-        0,
-        0
-    );
-    Font_Opensans_Bold_17 = LoadFontEx(
-        "assets/fonts/opensans/OpenSans-SemiBold.ttf",
-        17,
-        0,
-        0
-    );
+    GlyphInfo *loaded = LoadFontData(dynamicFont->file->data, dynamicFont->file->size, dynamicFont->size, codepoints, count, FONT_DEFAULT);
+    if (loaded == NULL) return;
+
+    int oldHeight = dynamicFont->atlas.height;
+    unsigned char *pixels = dynamicFont->atlas.data;
+    for (int i = 0; i < count; i++) {
+        Image *image = &loaded[i].image;
+        int x, y;
+        if (!placeGlyph(dynamicFont, image->width + 2 * GLYPH_PADDING, image->height + 2 * GLYPH_PADDING, &x, &y)) continue;
+        pixels = dynamicFont->atlas.data;
+
+        // Glyph images are grayscale coverage: white text, coverage as alpha
+        const unsigned char *coverage = image->data;
+        for (int row = 0; row < image->height; row++) {
+            unsigned char *dest = pixels + ((size_t)(y + GLYPH_PADDING + row) * GLYPH_ATLAS_WIDTH + x + GLYPH_PADDING) * 2;
+            for (int col = 0; col < image->width; col++) {
+                dest[col * 2] = 255;
+                dest[col * 2 + 1] = coverage[row * image->width + col];
+            }
+        }
+
+        int index = font->glyphCount++;
+        font->glyphs[index] = loaded[i];
+        font->glyphs[index].image = (Image){ 0 }; // The atlas has the pixels
+        font->recs[index] = (Rectangle){ x + GLYPH_PADDING, y + GLYPH_PADDING, image->width, image->height };
+    }
+    UnloadFontData(loaded, count);
+
+    // A grown atlas needs a new texture; otherwise the pixels are replaced
+    if (font->texture.id == 0 || dynamicFont->atlas.height != oldHeight) {
+        if (font->texture.id != 0) UnloadTexture(font->texture);
+        font->texture = LoadTextureFromImage(dynamicFont->atlas);
+    } else {
+        UpdateTexture(font->texture, dynamicFont->atlas.data);
+    }
+}
+
+static void loadDynamicFont(DynamicFont *dynamicFont)
+{
+    Font *font = dynamicFont->font;
+    font->baseSize = dynamicFont->size;
+    font->glyphPadding = GLYPH_PADDING;
+    dynamicFont->atlas = (Image){
+        .data = calloc((size_t)GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_MIN_HEIGHT, 2),
+        .width = GLYPH_ATLAS_WIDTH,
+        .height = GLYPH_ATLAS_MIN_HEIGHT,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+    };
+    if (dynamicFont->atlas.data == NULL || dynamicFont->file->data == NULL) {
+        font->baseSize = 0;
+        return;
+    }
+
+    // Printable ASCII up front: it is in nearly every text
+    int codepoints[95];
+    int count = 0;
+    for (int codepoint = 32; codepoint < 127; codepoint++) {
+        if (markTried(dynamicFont, codepoint)) codepoints[count++] = codepoint;
+    }
+    addGlyphs(dynamicFont, codepoints, count);
+}
+
+void loadFonts()
+{
+    // Read each file once; its sizes rasterize from the same data
+    for (int i = 0; i < FONT_FILE_COUNT; i++) {
+        g_files[i].data = LoadFileData(g_files[i].path, &g_files[i].size);
+    }
+    for (int i = 0; i < DYNAMIC_FONT_COUNT; i++) {
+        loadDynamicFont(&g_fonts[i]);
+    }
 
     debugFont(Font_Opensans_Bold_30, "OpenSans-SemiBold.ttf - size 30");
     debugFont(Font_Opensans_Bold_20, "OpenSans-SemiBold.ttf - size 20");
     debugFont(Font_Opensans_Regular_20, "OpenSans-Regular.ttf - size 20");
     debugFont(Font_Opensans_Bold_17, "OpenSans-SemiBold.ttf - size 17");
 }
+
+void unloadFonts()
+{
+    for (int i = 0; i < DYNAMIC_FONT_COUNT; i++) {
+        Font *font = g_fonts[i].font;
+        if (font->texture.id != 0) UnloadTexture(font->texture);
+        free(font->glyphs);
+        free(font->recs);
+        free(g_fonts[i].atlas.data);
+        *font = (Font){ 0 };
+        g_fonts[i].atlas.data = NULL;
+    }
+    for (int i = 0; i < FONT_FILE_COUNT; i++) {
+        UnloadFileData(g_files[i].data);
+        g_files[i].data = NULL;
+    }
+}
+
+void requireGlyphs(const char *text)
+{
+    if (text == NULL) return;
+
+    // Most texts are plain ASCII, which every font already has
+    const char *cursor = text;
+    while (*cursor != '\0' && (unsigned char)*cursor < 0x80) cursor++;
+    if (*cursor == '\0') return;
+
+    for (int i = 0; i < DYNAMIC_FONT_COUNT; i++) {
+        int codepoints[64];
+        int count = 0;
+        const char *next = cursor;
+        while (*next != '\0') {
+            int size = 0;
+            int codepoint = GetCodepointNext(next, &size);
+            next += size > 0 ? size : 1;
+            if (codepoint < 0x80 || !markTried(&g_fonts[i], codepoint)) continue;
+            codepoints[count++] = codepoint;
+            if (count == 64) {
+                addGlyphs(&g_fonts[i], codepoints, count);
+                count = 0;
+            }
+        }
+        addGlyphs(&g_fonts[i], codepoints, count);
+    }
+}
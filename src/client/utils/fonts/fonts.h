@@ -3,11 +3,33 @@
 #include "raylib.h"
 #include "../../utils/debugger/debugger.h"
 
+/*
+ * The UI fonts, with glyphs loaded on first use.
+ *
+ * Each font starts with printable ASCII only. requireGlyphs rasterizes any
+ * other codepoint of a text (Vietnamese diacritics, ...) into every font,
+ * once: the glyphs go into the font's atlas, which grows GLYPH_ATLAS_WIDTH
+ * wide and up to GLYPH_ATLAS_MAX_HEIGHT high. Past that, new codepoints draw
+ * as the fallback glyph, so video memory stays bounded.
+ *
+ * Each TTF file is read once and shared by its sizes. The Font variables
+ * change as glyphs are added: keep pointers to them, not copies.
+ */
+
+#define GLYPH_ATLAS_WIDTH 512
+#define GLYPH_ATLAS_MIN_HEIGHT 128
+#define GLYPH_ATLAS_MAX_HEIGHT 2048
+#define GLYPH_PADDING 2
+
 extern Font Font_Opensans_Bold_30;
 extern Font Font_Opensans_Regular_20;
 extern Font Font_Opensans_Bold_20;
 extern Font Font_Opensans_Bold_17;
 
 void loadFonts();
+void unloadFonts();
+
+// Loads the glyphs of a UTF-8 text that the fonts do not have yet
+void requireGlyphs(const char *text);
 
 #endif
@@ -0,0 +1,282 @@
+#include "messageStore.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A block of a page's string arena
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaBlock;
+
+struct MessagePage {
+    StoredMessage messages[MESSAGE_STORE_PAGE_CAPACITY];
+    int count;
+    ArenaBlock* arena;  // The block being filled comes first
+};
+
+static MessagePage* page_create() {
+    MessagePage* page = malloc(sizeof(MessagePage));
+    if (page == NULL) return NULL;
+    page->count = 0;
+    page->arena = NULL;
+    return page;
+}
+
+static void page_free(MessagePage* page) {
+    ArenaBlock* block = page->arena;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(page);
+}
+
+// Copies a string into the page's arena; strings longer than a block get their own
+static const char* page_copy(MessagePage* page, const char* text) {
+    if (text == NULL) text = "";
+    size_t length = strlen(text) + 1;
+    ArenaBlock* block = page->arena;
+    if (block == NULL || block->size - block->used < length) {
+        size_t size = length > MESSAGE_STORE_ARENA_BLOCK ? length : MESSAGE_STORE_ARENA_BLOCK;
+        ArenaBlock* fresh = malloc(sizeof(ArenaBlock) + size);
+        if (fresh == NULL) return NULL;
+        fresh->used = 0;
+        fresh->size = size;
+        if (block != NULL && length > MESSAGE_STORE_ARENA_BLOCK) {
+            // Keep filling the current block after this oversized string
+            fresh->next = block->next;
+            block->next = fresh;
+        } else {
+            fresh->next = block;
+            page->arena = fresh;
+        }
+        block = fresh;
+    }
+    char* copy = block->data + block->used;
+    memcpy(copy, text, length);
+    block->used += length;
+    return copy;
+}
+
+static int intern_sender(MessageStore* store, long userId) {
+    int index = MessageStore_find_sender(store, userId);
+    if (index != -1) return index;
+
+    if (store->sender_count == store->sender_capacity) {
+        int capacity = store->sender_capacity == 0 ? 16 : store->sender_capacity * 2;
+        MessageSender* senders = realloc(store->senders, sizeof(MessageSender) * capacity);
+        if (senders == NULL) return -1;
+        store->senders = senders;
+        store->sender_capacity = capacity;
+    }
+    MessageSender* sender = &store->senders[store->sender_count];
+    sender->user_id = userId;
+    sender->name[0] = '\0';
+    return store->sender_count++;
+}
+
+// Fills the next entry of a page; returns -1 if memory runs out
+static int page_add(MessageStore* store, MessagePage* page, const MessageInput* input) {
+    StoredMessage* message = &page->messages[page->count];
+    message->id = input->id;
+    message->client_id = input->client_id;
+    message->is_me = input->is_me;
+    message->sender = intern_sender(store, input->sender_id);
+    message->text = page_copy(page, input->text);
+    message->time = page_copy(page, input->time);
+    if (message->sender == -1 || message->text == NULL || message->time == NULL) return -1;
+    page->count++;
+    return 0;
+}
+
+static int reserve_pages(MessageStore* store, int extra) {
+    if (store->page_count + extra <= store->page_capacity) return 0;
+    int capacity = store->page_capacity == 0 ? 8 : store->page_capacity;
+    while (capacity < store->page_count + extra) capacity *= 2;
+    MessagePage** pages = realloc(store->pages, sizeof(MessagePage*) * capacity);
+    if (pages == NULL) return -1;
+    store->pages = pages;
+    store->page_capacity = capacity;
+    return 0;
+}
+
+void MessageStore_clear(MessageStore* store) {
+    for (int i = 0; i < store->page_count; i++) {
+        page_free(store->pages[i]);
+    }
+    store->page_count = 0;
+    store->count = 0;
+    store->sender_count = 0;
+    store->has_older = false;
+}
+
+int MessageStore_append(MessageStore* store, const MessageInput* message) {
+    MessagePage* page = store->page_count > 0 ? store->pages[store->page_count - 1] : NULL;
+    if (page == NULL || page->count == MESSAGE_STORE_PAGE_CAPACITY) {
+        if (reserve_pages(store, 1) != 0) return -1;
+        page = page_create();
+        if (page == NULL) return -1;
+        store->pages[store->page_count++] = page;
+    }
+    if (page_add(store, page, message) != 0) return -1;
+    return store->count++;
+}
+
+int MessageStore_prepend(MessageStore* store, const MessageInput* messages, int count) {
+    if (count <= 0) return 0;
+    int page_total = (count + MESSAGE_STORE_PAGE_CAPACITY - 1) / MESSAGE_STORE_PAGE_CAPACITY;
+    if (reserve_pages(store, page_total) != 0) return -1;
+
+    // 1. Fill the new pages aside
+    MessagePage* fresh[page_total];
+    for (int p = 0; p < page_total; p++) {
+        fresh[p] = page_create();
+        int first = p * MESSAGE_STORE_PAGE_CAPACITY;
+        int last = first + MESSAGE_STORE_PAGE_CAPACITY < count ? first + MESSAGE_STORE_PAGE_CAPACITY : count;
+        for (int i = first; fresh[p] != NULL && i < last; i++) {
+            if (page_add(store, fresh[p], &messages[i]) != 0) {
+                page_free(fresh[p]);
+                fresh[p] = NULL;
+            }
+        }
+        if (fresh[p] == NULL) {
+            for (int q = 0; q < p; q++) page_free(fresh[q]);
+            return -1;
+        }
+    }
+
+    // 2. Put them in front of the loaded ones
+    memmove(store->pages + page_total, store->pages, sizeof(MessagePage*) * store->page_count);
+    memcpy(store->pages, fresh, sizeof(MessagePage*) * page_total);
+    store->page_count += page_total;
+    store->count += count;
+    return 0;
+}
+
+int MessageStore_move_front(MessageStore* store, MessageStore* older) {
+    if (older->page_count == 0) return 0;
+    if (reserve_pages(store, older->page_count) != 0) return -1;
+
+    // 1. Point the moved messages at this store's sender table
+    int remap[older->sender_count];
+    for (int i = 0; i < older->sender_count; i++) {
+        remap[i] = intern_sender(store, older->senders[i].user_id);
+        if (remap[i] == -1) return -1;
+        if (store->senders[remap[i]].name[0] == '\0') {
+            strcpy(store->senders[remap[i]].name, older->senders[i].name);
+        }
+    }
+    for (int p = 0; p < older->page_count; p++) {
+        MessagePage* page = older->pages[p];
+        for (int i = 0; i < page->count; i++) {
+            page->messages[i].sender = remap[page->messages[i].sender];
+        }
+    }
+
+    // 2. The pages themselves change hands
+    memmove(store->pages + older->page_count, store->pages, sizeof(MessagePage*) * store->page_count);
+    memcpy(store->pages, older->pages, sizeof(MessagePage*) * older->page_count);
+    store->page_count += older->page_count;
+    store->count += older->count;
+
+    older->page_count = 0;
+    older->count = 0;
+    older->sender_count = 0;
+    return 0;
+}
+
+void MessageStore_free(MessageStore* store) {
+    MessageStore_clear(store);
+    free(store->pages);
+    free(store->senders);
+    memset(store, 0, sizeof(MessageStore));
+}
+
+int MessageStore_evict_front(MessageStore* store) {
+    if (store->page_count <= 1) return 0;
+    MessagePage* page = store->pages[0];
+    int dropped = page->count;
+    page_free(page);
+    memmove(store->pages, store->pages + 1, sizeof(MessagePage*) * (store->page_count - 1));
+    store->page_count--;
+    store->count -= dropped;
+    store->has_older = true;
+    return dropped;
+}
+
+int MessageStore_front_count(const MessageStore* store) {
+    return store->page_count > 0 ? store->pages[0]->count : 0;
+}
+
+// Finds a pending message; sets *out_page and *out_index (in the store)
+static StoredMessage* find_pending(MessageStore* store, long clientId, MessagePage** out_page, int* out_index) {
+    if (clientId <= 0) return NULL;
+    // Pending messages are among the newest: search from the end
+    int index = store->count;
+    for (int p = store->page_count - 1; p >= 0; p--) {
+        MessagePage* page = store->pages[p];
+        index -= page->count;
+        for (int i = page->count - 1; i >= 0; i--) {
+            if (page->messages[i].client_id == clientId) {
+                *out_page = page;
+                *out_index = index + i;
+                return &page->messages[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+int MessageStore_confirm(MessageStore* store, long clientId, long messageId, const char* time) {
+    MessagePage* page;
+    int index;
+    StoredMessage* message = find_pending(store, clientId, &page, &index);
+    if (message == NULL) return -1;
+    message->id = messageId;
+    message->client_id = 0;
+    // The pending time stays if memory runs out
+    const char* saved_time = time != NULL ? page_copy(page, time) : NULL;
+    if (saved_time != NULL) message->time = saved_time;
+    return index;
+}
+
+int MessageStore_reject(MessageStore* store, long clientId) {
+    MessagePage* page;
+    int index;
+    StoredMessage* message = find_pending(store, clientId, &page, &index);
+    if (message == NULL) return -1;
+    message->client_id = MESSAGE_REJECTED;
+    return index;
+}
+
+const StoredMessage* MessageStore_get(const MessageStore* store, int index) {
+    if (index < 0 || index >= store->count) return NULL;
+    for (int p = 0; p < store->page_count; p++) {
+        if (index < store->pages[p]->count) return &store->pages[p]->messages[index];
+        index -= store->pages[p]->count;
+    }
+    return NULL;
+}
+
+MessageSender* MessageStore_sender_of(MessageStore* store, const StoredMessage* message) {
+    return &store->senders[message->sender];
+}
+
+int MessageStore_find_sender(const MessageStore* store, long userId) {
+    for (int i = 0; i < store->sender_count; i++) {
+        if (store->senders[i].user_id == userId) return i;
+    }
+    return -1;
+}
+
+long MessageStore_oldest_id(const MessageStore* store) {
+    for (int p = 0; p < store->page_count; p++) {
+        for (int i = 0; i < store->pages[p]->count; i++) {
+            if (store->pages[p]->messages[i].id > 0) return store->pages[p]->messages[i].id;
+        }
+    }
+    return 0;
+}
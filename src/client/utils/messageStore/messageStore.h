@@ -0,0 +1,143 @@
+#ifndef MESSAGE_STORE_H
+#define MESSAGE_STORE_H
+
+#include <stdbool.h>
+
+/*
+ * The messages of the open chat, in chronological order.
+ *
+ * - Messages live in pages of up to MESSAGE_STORE_PAGE_CAPACITY entries.
+ *   A page keeps its texts and times in its own arena (blocks of
+ *   MESSAGE_STORE_ARENA_BLOCK bytes), so a message costs its real length.
+ * - Senders are interned: a message holds an index into the sender table,
+ *   where each user's name is stored once.
+ * - Pages are added at the end as messages arrive and at the front as
+ *   older history is loaded; the oldest page can be evicted to bound
+ *   memory, and loaded again later (see MessageStore_oldest_id).
+ *
+ * Message indexes count from the first loaded message, so they shift when
+ * pages are added or evicted at the front.
+ */
+
+#define MESSAGE_STORE_PAGE_CAPACITY 128
+#define MESSAGE_STORE_ARENA_BLOCK 8192
+#define MESSAGE_REJECTED -1 // client_id of a message the server refused
+
+typedef struct {
+    long user_id;
+    char name[256];     // "" until the caller fills it in
+} MessageSender;
+
+typedef struct {
+    long id;            // Server message ID, 0 if not known (e.g., just sent)
+    long client_id;     // Outbox ID while the server has not confirmed it, MESSAGE_REJECTED if it refused it, else 0
+    int sender;         // Index in the sender table
+    bool is_me;
+    const char* text;   // In the page's arena
+    const char* time;
+} StoredMessage;
+
+// A message to add, before it is copied into the store
+typedef struct {
+    long id;
+    long sender_id;
+    const char* text;
+    const char* time;
+    bool is_me;
+    long client_id;     // See StoredMessage
+} MessageInput;
+
+typedef struct MessagePage MessagePage;
+
+typedef struct {
+    MessagePage** pages;
+    int page_count;
+    int page_capacity;
+    int count;          // Messages in the loaded pages
+
+    MessageSender* senders;
+    int sender_count;
+    int sender_capacity;
+
+    bool has_older;     // Older messages exist on the server (never loaded or evicted)
+} MessageStore;
+
+/**
+ * @brief Removes every message and sender (e.g., when another chat is opened).
+ */
+void MessageStore_clear(MessageStore* store);
+
+/**
+ * @brief Appends a message after the newest one.
+ * @return Its index, or -1 if memory runs out.
+ */
+int MessageStore_append(MessageStore* store, const MessageInput* message);
+
+/**
+ * @brief Adds older messages, in chronological order, before the first one.
+ * @return 0 on success, -1 if memory runs out (the store is unchanged).
+ */
+int MessageStore_prepend(MessageStore* store, const MessageInput* messages, int count);
+
+/**
+ * @brief Moves every message of another store, all older than this store's,
+ *        before the first one. Their pages change hands without copying
+ *        (e.g., a history page decoded aside); 'older' is left empty.
+ * @return 0 on success, -1 if memory runs out (both stores are unchanged,
+ *         apart from senders this store may have gained).
+ */
+int MessageStore_move_front(MessageStore* store, MessageStore* older);
+
+/**
+ * @brief Clears a store and frees its tables; it can be used again.
+ */
+void MessageStore_free(MessageStore* store);
+
+/**
+ * @brief Drops the oldest page and marks the store as having older messages.
+ * @return The number of messages dropped (0 if only one page is loaded).
+ */
+int MessageStore_evict_front(MessageStore* store);
+
+/**
+ * @brief Returns the number of messages in the oldest page (what
+ *        MessageStore_evict_front would drop, if more than one page is loaded).
+ */
+int MessageStore_front_count(const MessageStore* store);
+
+/**
+ * @brief Gives a pending message (see StoredMessage.client_id) its server ID
+ *        and, if not NULL, the time the server saved it at.
+ * @return Its index, or -1 if it is not loaded.
+ */
+int MessageStore_confirm(MessageStore* store, long clientId, long messageId, const char* time);
+
+/**
+ * @brief Marks a pending message as refused by the server: its client_id
+ *        becomes MESSAGE_REJECTED.
+ * @return Its index, or -1 if it is not loaded.
+ */
+int MessageStore_reject(MessageStore* store, long clientId);
+
+/**
+ * @brief Returns the message at an index, or NULL.
+ */
+const StoredMessage* MessageStore_get(const MessageStore* store, int index);
+
+/**
+ * @brief Returns the sender of a message.
+ */
+MessageSender* MessageStore_sender_of(MessageStore* store, const StoredMessage* message);
+
+/**
+ * @brief Returns the sender table index of a user, or -1 if no loaded message is theirs.
+ */
+int MessageStore_find_sender(const MessageStore* store, long userId);
+
+/**
+ * @brief Returns the ID of the oldest loaded message that has one, or 0.
+ * Older pages are requested from the server with IDs below it.
+ */
+long MessageStore_oldest_id(const MessageStore* store);
+
+#endif // MESSAGE_STORE_H
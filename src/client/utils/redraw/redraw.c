@@ -0,0 +1,32 @@
+#include "redraw.h"
+#include <raylib.h>
+#include "../constants/constants.h"
+
+static int g_dirtyFrames = REDRAW_FRAMES; // The first frames are always drawn
+static double g_dirtyAt = -1;             // When a scheduled change is due, -1 for none
+static double g_lastDrawTime = 0;
+
+void markScreenDirty()
+{
+    g_dirtyFrames = REDRAW_FRAMES;
+}
+
+void markScreenDirtyIn(double seconds)
+{
+    double at = GetTime() + seconds;
+    if (g_dirtyAt < 0 || at < g_dirtyAt) g_dirtyAt = at;
+}
+
+bool takeScreenRedraw()
+{
+    double now = GetTime();
+    if (g_dirtyAt >= 0 && now >= g_dirtyAt) {
+        g_dirtyAt = -1;
+        markScreenDirty();
+    }
+    if (g_dirtyFrames == 0 && now - g_lastDrawTime < 1.0 / WINDOW_IDLE_FRAME) return false;
+
+    if (g_dirtyFrames > 0) g_dirtyFrames--;
+    g_lastDrawTime = now;
+    return true;
+}
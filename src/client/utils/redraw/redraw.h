@@ -0,0 +1,29 @@
+#ifndef REDRAW_H
+#define REDRAW_H
+#include <stdbool.h>
+
+/*
+ * Decides which frames are drawn.
+ *
+ * The screens draw everything from their current state every time they
+ * run, so a frame only needs drawing when that state or the input changed.
+ * Whatever changes what is shown marks the screen dirty; the main loop
+ * draws while it is dirty and otherwise only polls input (see main.c).
+ *
+ * - markScreenDirty: something changed now. The next REDRAW_FRAMES frames
+ *   are drawn, so widgets that react to a click one frame late catch up.
+ * - markScreenDirtyIn: something changes later on its own (a blinking
+ *   cursor); the screen becomes dirty then.
+ * - A clean screen is still drawn WINDOW_IDLE_FRAME times per second, in
+ *   case a change was not marked.
+ */
+
+#define REDRAW_FRAMES 2
+
+void markScreenDirty();
+void markScreenDirtyIn(double seconds);
+
+// True if this frame should be drawn; counts it as drawn
+bool takeScreenRedraw();
+
+#endif
@@ -0,0 +1,106 @@
+#include "rowDecoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Index of the first unescaped ';' in data, or -1. *escaped carries the
+// escape state in and out, for rows split across chunks.
+static long find_row_end(const char* data, size_t length, bool* escaped) {
+    for (size_t i = 0; i < length; i++) {
+        if (*escaped) {
+            *escaped = false;
+        } else if (data[i] == '\\') {
+            *escaped = true;
+        } else if (data[i] == ';') {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+// Unescapes row[0, length) in place, cuts it into fields and hands it over.
+// row[length] must be writable (it held the ';').
+static void decode_row(RowDecoder* decoder, char* row, size_t length) {
+    if (length == 0) return;
+    char* fields[ROW_DECODER_MAX_FIELDS];
+    int field_count = 1;
+    fields[0] = row;
+
+    size_t write = 0;
+    for (size_t read = 0; read < length; read++) {
+        char c = row[read];
+        if (c == '\\' && read + 1 < length) {
+            row[write++] = row[++read];
+        } else if (c == ',' && field_count < ROW_DECODER_MAX_FIELDS) {
+            row[write++] = '\0';
+            fields[field_count++] = row + write;
+        } else {
+            row[write++] = c;
+        }
+    }
+    row[write] = '\0';
+    decoder->handler(fields, field_count, decoder->context);
+}
+
+static int carry_append(RowDecoder* decoder, const char* data, size_t length) {
+    if (decoder->carry_length + length + 1 > decoder->carry_capacity) {
+        size_t capacity = decoder->carry_capacity == 0 ? 256 : decoder->carry_capacity;
+        while (capacity < decoder->carry_length + length + 1) capacity *= 2;
+        char* carry = realloc(decoder->carry, capacity);
+        if (carry == NULL) return -1;
+        decoder->carry = carry;
+        decoder->carry_capacity = capacity;
+    }
+    memcpy(decoder->carry + decoder->carry_length, data, length);
+    decoder->carry_length += length;
+    return 0;
+}
+
+void RowDecoder_init(RowDecoder* decoder, row_handler_t handler, void* context) {
+    memset(decoder, 0, sizeof(RowDecoder));
+    decoder->handler = handler;
+    decoder->context = context;
+}
+
+int RowDecoder_feed(RowDecoder* decoder, char* chunk, size_t length) {
+    size_t start = 0;
+
+    // 1. Finish the row cut by the previous chunk
+    if (decoder->carry_length > 0 || decoder->escaped) {
+        long end = find_row_end(chunk, length, &decoder->escaped);
+        size_t taken = end >= 0 ? (size_t)end : length;
+        if (carry_append(decoder, chunk, taken) != 0) {
+            decoder->carry_length = 0;
+            return -1;
+        }
+        if (end < 0) return 0;
+        decode_row(decoder, decoder->carry, decoder->carry_length);
+        decoder->carry_length = 0;
+        start = taken + 1;
+    }
+
+    // 2. Rows that lie in this chunk are decoded where they are
+    while (start < length) {
+        long end = find_row_end(chunk + start, length - start, &decoder->escaped);
+        if (end < 0) break;
+        decode_row(decoder, chunk + start, (size_t)end);
+        start += (size_t)end + 1;
+    }
+
+    // 3. Keep the cut row
+    if (start < length && carry_append(decoder, chunk + start, length - start) != 0) {
+        decoder->carry_length = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void RowDecoder_finish(RowDecoder* decoder) {
+    if (decoder->carry_length > 0) {
+        decode_row(decoder, decoder->carry, decoder->carry_length);
+    }
+    free(decoder->carry);
+    decoder->carry = NULL;
+    decoder->carry_length = 0;
+    decoder->carry_capacity = 0;
+    decoder->escaped = false;
+}
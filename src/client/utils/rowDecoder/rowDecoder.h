@@ -0,0 +1,51 @@
+#ifndef ROW_DECODER_H
+#define ROW_DECODER_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Splits server reply rows, "field,field,...;field,...;", as they arrive.
+ *
+ * - Field values escape the delimiters with a backslash ("\,", "\;" and
+ *   "\\"), so message texts and names may contain them.
+ * - Each complete row goes to the row handler with its fields unescaped
+ *   and null-terminated.
+ * - Rows are decoded in place, in the chunk that was fed. The only copy is
+ *   a row cut by the end of a chunk, which waits in the decoder until the
+ *   rest of it arrives.
+ *
+ * Field pointers are valid during the handler call only.
+ */
+
+#define ROW_DECODER_MAX_FIELDS 16 // Further commas stay in the last field
+
+typedef void (*row_handler_t)(char** fields, int fieldCount, void* context);
+
+typedef struct {
+    row_handler_t handler;
+    void* context;
+    char* carry;          // Raw bytes of a row cut by the end of a chunk
+    size_t carry_length;
+    size_t carry_capacity;
+    bool escaped;         // The last byte fed was an escaping backslash
+} RowDecoder;
+
+/**
+ * @brief Sets up a decoder that hands its rows to handler.
+ */
+void RowDecoder_init(RowDecoder* decoder, row_handler_t handler, void* context);
+
+/**
+ * @brief Decodes the complete rows of a chunk (which it modifies) and keeps
+ *        the cut row, if any, for the next call.
+ * @return 0 on success, -1 if memory for a cut row runs out (it is dropped).
+ */
+int RowDecoder_feed(RowDecoder* decoder, char* chunk, size_t length);
+
+/**
+ * @brief Ends the input: a last row without its ';' is handed over, and the
+ *        decoder's memory is freed.
+ */
+void RowDecoder_finish(RowDecoder* decoder);
+
+#endif // ROW_DECODER_H
@@ -1,10 +1,12 @@
 #include "states.h"
+#include "../redraw/redraw.h"
 
 enum ScreenState g_screenState = LOGIN;
 
 void changeScreenState(enum ScreenState newState)
 {
     g_screenState = newState;
+    markScreenDirty();
 }
 
 enum ScreenState getScreenState()
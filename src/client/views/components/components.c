@@ -1,22 +1,17 @@
 #include "components.h"
 #include <raylib.h>
 #include <stdio.h>
+#include <math.h>
+#include "../../utils/redraw/redraw.h"
+#include "../../utils/fonts/fonts.h"
 
 TextField createTextField(char *placeHolder, char *value, bool *isActive, Rectangle bounds, float roundedness, float segments, Font *font) {
-    static int frameCounter = 0;
-    if (*isActive) {
-        frameCounter++;
-        if (frameCounter > 10000) {
-            frameCounter = 0;
-        }
-    }
     TextField textField = {
         .bounds = bounds,
         .roundedness = roundedness,
         .segments = segments,
         .font = font,
         .isActive = isActive,
-        .framesCounter = frameCounter,
         .charCount = strlen(value),
         .text = value,
         .placeHolder = placeHolder,
@@ -55,17 +50,25 @@ void drawTextField(TextField *textField)
         if (*textField->isActive) {
             int key = GetCharPressed();
 
-            if ((key >= 32) && (key <= 125) && (textField->charCount < MAX_TEXT_LENGTH)) {
-                textField->text[textField->charCount] = (char)key;
-                textField->charCount++;
-                textField->text[textField->charCount] = '\0'; //End
+            // Keys are codepoints; the text is UTF-8 (e.g., Vietnamese input)
+            if ((key >= 32 && key <= 125) || key >= 0xA0) {
+                int size = 0;
+                const char *utf8 = CodepointToUTF8(key, &size);
+                if (textField->charCount + size < MAX_TEXT_LENGTH) {
+                    memcpy(textField->text + textField->charCount, utf8, size);
+                    textField->charCount += size;
+                    textField->text[textField->charCount] = '\0'; //End
+                    requireGlyphs(utf8);
+                }
             }
 
+            // Remove the last character with all of its UTF-8 bytes
             if (IsKeyPressed(KEY_BACKSPACE) && (textField->charCount > 0)) {
-                textField->text[--textField->charCount] = '\0';
+                do {
+                    textField->charCount--;
+                } while (textField->charCount > 0 && ((unsigned char)textField->text[textField->charCount] & 0xC0) == 0x80);
+                textField->text[textField->charCount] = '\0';
             }
-
-            textField->framesCounter++;
         }
 
 
@@ -93,9 +96,12 @@ void drawTextField(TextField *textField)
         );
 
 
-        // Draw cursor
+        // Draw cursor; it blinks on the clock, so idle frames are only drawn when it toggles
         if (*textField->isActive) {
-            if ((textField->framesCounter/20) % 2 == 0) {
+            double phase = fmod(GetTime(), CURSOR_BLINK_PERIOD);
+            bool cursorShown = phase < CURSOR_BLINK_PERIOD / 2;
+            markScreenDirtyIn((cursorShown ? CURSOR_BLINK_PERIOD / 2 : CURSOR_BLINK_PERIOD) - phase);
+            if (cursorShown) {
                 Vector2 textMesuare = MeasureTextEx(*textField->font, textField->text, 20, 1.0f);
                 int textWidth = textMesuare.x;
                 Vector2 startPos = {
@@ -261,8 +267,6 @@ void DrawBubbleChat(Rectangle bounds,
                     Color textColor,
                     bool isMe) {
     Vector2 measureTextEx = MeasureTextEx(font, text, fontSize, 1.0f);
-    printf("%f", measureTextEx.x);
-    printf("%f", bounds.x);
     if (isMe) {
         Rectangle bubble = {
             200 + bounds.width - measureTextEx.x - 20,
@@ -6,6 +6,7 @@
 #include "../../utils/colors/colors.h"
 
 #define MAX_TEXT_LENGTH 99999
+#define CURSOR_BLINK_PERIOD 0.66 // Seconds for the text cursor to show and hide once
 
 // Định nghĩa một kiểu dữ liệu mới tên là "ButtonCallback"
 // Nó đại diện cho một hàm có dạng: void TenHam(void)
@@ -17,7 +18,6 @@ typedef struct {
 
     Rectangle bounds;
     bool *isActive;
-    int framesCounter;
     float roundedness;
     float segments;
     Font *font;
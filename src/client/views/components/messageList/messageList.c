@@ -0,0 +1,272 @@
+#include "messageList.h"
+#include "../../../utils/fonts/fonts.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ROW_NAME_HEIGHT 20   // Space above the bubble, where the sender name goes
+#define ROW_GAP 20           // Space below the bubble
+#define BUBBLE_PADDING 10
+#define BUBBLE_MARGIN 20     // Between the bubble and the side of the pane
+#define NAME_MARGIN 30
+#define TEXT_SPACING 1.0f
+
+// Growable list of line spans, filled while wrapping one message
+typedef struct {
+    int* spans;
+    int count;
+    int capacity;
+} SpanBuffer;
+
+static int span_push(SpanBuffer* buffer, int start, int end) {
+    if (buffer->count == buffer->capacity) {
+        int capacity = buffer->capacity == 0 ? 8 : buffer->capacity * 2;
+        int* spans = realloc(buffer->spans, sizeof(int) * 2 * capacity);
+        if (spans == NULL) return -1;
+        buffer->spans = spans;
+        buffer->capacity = capacity;
+    }
+    buffer->spans[buffer->count * 2] = start;
+    buffer->spans[buffer->count * 2 + 1] = end;
+    buffer->count++;
+    return 0;
+}
+
+// Width of text[start, end) in the list's font
+static float measure_span(const MessageList* list, const char* text, int start, int end) {
+    char line[1025];
+    int length = end - start;
+    if (length <= 0) return 0;
+    if (length > (int)sizeof(line) - 1) length = sizeof(line) - 1;
+    memcpy(line, text + start, length);
+    line[length] = '\0';
+    return MeasureTextEx(*list->font, line, list->font_size, TEXT_SPACING).x;
+}
+
+// The longest prefix of text[start, end) that fits a line, cut at a UTF-8
+// boundary and holding at least one character. For words wider than a line.
+static int fit_prefix(const MessageList* list, const char* text, int start, int end) {
+    int low = start + 1;
+    while (low < end && ((unsigned char)text[low] & 0xC0) == 0x80) low++;
+    int high = end;
+    while (low < high) {
+        int middle = low + (high - low + 1) / 2;
+        if (measure_span(list, text, start, middle) <= list->max_text_width) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    while (low > start + 1 && ((unsigned char)text[low] & 0xC0) == 0x80) low--;
+    return low;
+}
+
+// Word-wraps a message into spans; returns the width of its widest line, or -1
+static float wrap_text(const MessageList* list, const char* text, SpanBuffer* out) {
+    int length = (int)strlen(text);
+    int line_start = 0;
+    int last_fit = -1;       // End of the last word that fit on the current line
+    float last_fit_width = 0;
+    float widest = 0;
+
+    int i = 0;
+    while (i <= length) {
+        if (i < length && text[i] != ' ' && text[i] != '\n') {
+            i++;
+            continue;
+        }
+
+        // A word ends at i: does the line still fit with it?
+        float width = measure_span(list, text, line_start, i);
+        if (width > list->max_text_width) {
+            if (last_fit >= line_start) {
+                // Wrap before this word and look at it again on the next line
+                if (span_push(out, line_start, last_fit) != 0) return -1;
+                if (last_fit_width > widest) widest = last_fit_width;
+                line_start = last_fit + 1;
+                last_fit = -1;
+                continue;
+            }
+            // A single word wider than a line: cut it
+            int cut = fit_prefix(list, text, line_start, i);
+            float cut_width = measure_span(list, text, line_start, cut);
+            if (span_push(out, line_start, cut) != 0) return -1;
+            if (cut_width > widest) widest = cut_width;
+            line_start = cut;
+            continue;
+        }
+
+        last_fit = i;
+        last_fit_width = width;
+        if (i == length || text[i] == '\n') {
+            if (span_push(out, line_start, i) != 0) return -1;
+            if (width > widest) widest = width;
+            line_start = i + 1;
+            last_fit = -1;
+        }
+        i++;
+    }
+    return widest;
+}
+
+static float measure_name(const MessageList* list, const char* senderName) {
+    if (senderName == NULL || senderName[0] == '\0') return 0;
+    return MeasureTextEx(*list->name_font, senderName, list->name_font_size, TEXT_SPACING).x;
+}
+
+void MessageList_init(MessageList* list, Font* font, float fontSize, Font* nameFont, float nameFontSize, float maxTextWidth) {
+    memset(list, 0, sizeof(MessageList));
+    list->font = font;
+    list->font_size = fontSize;
+    list->name_font = nameFont;
+    list->name_font_size = nameFontSize;
+    list->max_text_width = maxTextWidth;
+}
+
+void MessageList_clear(MessageList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->rows[i].line_spans);
+    }
+    list->count = 0;
+    list->content_height = 0;
+}
+
+static int reserve_row(MessageList* list) {
+    if (list->count < list->capacity) return 0;
+    int capacity = list->capacity == 0 ? 256 : list->capacity * 2;
+    MessageRow* rows = realloc(list->rows, sizeof(MessageRow) * capacity);
+    if (rows == NULL) return -1;
+    list->rows = rows;
+    list->capacity = capacity;
+    return 0;
+}
+
+// Lays out a row; its offset is left to the caller
+static int layout_row(const MessageList* list, MessageRow* row, const char* text, const char* senderName, bool isMe) {
+    requireGlyphs(text);
+    requireGlyphs(senderName);
+    SpanBuffer spans = { NULL, 0, 0 };
+    float widest = wrap_text(list, text != NULL ? text : "", &spans);
+    if (widest < 0) {
+        free(spans.spans);
+        return -1;
+    }
+    row->is_me = isMe;
+    row->line_count = spans.count;
+    row->line_spans = spans.spans;
+    row->bubble_width = widest + BUBBLE_PADDING * 2;
+    row->bubble_height = spans.count * list->font_size + BUBBLE_PADDING * 2;
+    row->height = ROW_NAME_HEIGHT + row->bubble_height + ROW_GAP;
+    row->name_width = measure_name(list, senderName);
+    return 0;
+}
+
+int MessageList_push(MessageList* list, const char* text, const char* senderName, bool isMe) {
+    if (reserve_row(list) != 0) return -1;
+    MessageRow* row = &list->rows[list->count];
+    if (layout_row(list, row, text, senderName, isMe) != 0) return -1;
+    row->y = list->content_height;
+
+    list->content_height += row->height;
+    list->count++;
+    return 0;
+}
+
+float MessageList_push_front(MessageList* list, const char* text, const char* senderName, bool isMe) {
+    if (reserve_row(list) != 0) return -1;
+    MessageRow row;
+    if (layout_row(list, &row, text, senderName, isMe) != 0) return -1;
+    row.y = 0;
+
+    memmove(list->rows + 1, list->rows, sizeof(MessageRow) * list->count);
+    list->rows[0] = row;
+    list->count++;
+    for (int i = 1; i < list->count; i++) {
+        list->rows[i].y += row.height;
+    }
+    list->content_height += row.height;
+    return row.height;
+}
+
+float MessageList_drop_front(MessageList* list, int count) {
+    if (count > list->count) count = list->count;
+    if (count <= 0) return 0;
+    float removed = count < list->count ? list->rows[count].y : list->content_height;
+    for (int i = 0; i < count; i++) {
+        free(list->rows[i].line_spans);
+    }
+    memmove(list->rows, list->rows + count, sizeof(MessageRow) * (list->count - count));
+    list->count -= count;
+    for (int i = 0; i < list->count; i++) {
+        list->rows[i].y -= removed;
+    }
+    list->content_height -= removed;
+    return removed;
+}
+
+void MessageList_set_name(MessageList* list, int index, const char* senderName) {
+    if (index < 0 || index >= list->count) return;
+    requireGlyphs(senderName);
+    list->rows[index].name_width = measure_name(list, senderName);
+}
+
+bool MessageList_visible_range(const MessageList* list, float top, float bottom, int* first, int* last) {
+    if (list->count == 0 || bottom < 0 || top > list->content_height) return false;
+
+    // First row whose bottom edge is below 'top'
+    int low = 0, high = list->count - 1;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (list->rows[middle].y + list->rows[middle].height < top) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *first = low;
+
+    // Last row whose top edge is above 'bottom'
+    low = *first;
+    high = list->count - 1;
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (list->rows[middle].y > bottom) {
+            high = middle - 1;
+        } else {
+            low = middle;
+        }
+    }
+    *last = low;
+    return true;
+}
+
+void MessageList_draw_row(const MessageList* list, int index, Rectangle page, float scrollY,
+                          const char* text, const char* senderName, Color textColor, Color nameColor) {
+    if (index < 0 || index >= list->count || text == NULL) return;
+    const MessageRow* row = &list->rows[index];
+    float rowY = page.y + scrollY + row->y;
+
+    // Sender name above the bubble, on the bubble's side
+    if (senderName != NULL && senderName[0] != '\0') {
+        float nameX = row->is_me ? page.x + page.width - row->name_width - NAME_MARGIN : page.x + NAME_MARGIN;
+        DrawTextEx(*list->name_font, senderName, (Vector2){ nameX, rowY + 2 }, list->name_font_size, TEXT_SPACING, nameColor);
+    }
+
+    Rectangle bubble = {
+        row->is_me ? page.x + page.width - row->bubble_width - BUBBLE_MARGIN : page.x + BUBBLE_MARGIN,
+        rowY + ROW_NAME_HEIGHT,
+        row->bubble_width,
+        row->bubble_height
+    };
+    DrawRectangleRounded(bubble, 0.3f, 10, ColorAlpha(WHITE, 0.5f));
+
+    char line[1025];
+    for (int i = 0; i < row->line_count; i++) {
+        int start = row->line_spans[i * 2];
+        int length = row->line_spans[i * 2 + 1] - start;
+        if (length > (int)sizeof(line) - 1) length = sizeof(line) - 1;
+        memcpy(line, text + start, length);
+        line[length] = '\0';
+        Vector2 position = { bubble.x + BUBBLE_PADDING, bubble.y + BUBBLE_PADDING + i * list->font_size };
+        DrawTextEx(*list->font, line, position, list->font_size, TEXT_SPACING, textColor);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef MESSAGE_LIST_H
+#define MESSAGE_LIST_H
+
+#include <stdbool.h>
+#include <raylib.h>
+
+/*
+ * Layout of a scrolling chat pane with rows of different heights.
+ *
+ * Each message is measured and word-wrapped once, when it is pushed; a row
+ * keeps its line breaks, bubble size and its offset from the top of the
+ * list (a prefix sum of the row heights). Drawing finds the visible rows
+ * with a binary search on those offsets and measures nothing, so the cost
+ * of a frame does not grow with the length of the conversation.
+ *
+ * The list does not copy the texts: rows are pushed in message order and
+ * the caller hands the same text back when drawing row i. Rows can also be
+ * added or removed at the front, for history loaded or evicted there.
+ */
+
+typedef struct {
+    float y;              // Top of the row, from the top of the list
+    float height;         // Row height, spacing included
+    float bubble_width;
+    float bubble_height;
+    float name_width;     // Width of the sender name line, 0 if none
+    bool is_me;
+    int line_count;
+    int* line_spans;      // Start and end byte offsets of each line, in pairs
+} MessageRow;
+
+typedef struct {
+    MessageRow* rows;
+    int count;
+    int capacity;
+    float content_height; // Sum of the row heights
+
+    Font* font;           // Pointers: the fonts grow as glyphs are loaded (see fonts.h)
+    float font_size;
+    Font* name_font;
+    float name_font_size;
+    float max_text_width; // Lines wrap past this width
+} MessageList;
+
+/**
+ * @brief Sets up an empty list.
+ * @param maxTextWidth Width past which a message wraps to a new line.
+ */
+void MessageList_init(MessageList* list, Font* font, float fontSize, Font* nameFont, float nameFontSize, float maxTextWidth);
+
+/**
+ * @brief Removes every row (e.g., when another chat is opened).
+ */
+void MessageList_clear(MessageList* list);
+
+/**
+ * @brief Lays out a message and appends its row.
+ * @param text The message text.
+ * @param senderName A name shown above the bubble, or NULL/"" for none.
+ * @param isMe Whether the bubble goes on the right.
+ * @return 0 on success, -1 if memory runs out.
+ */
+int MessageList_push(MessageList* list, const char* text, const char* senderName, bool isMe);
+
+/**
+ * @brief Lays out a message and inserts its row before the first one
+ *        (older history). The rows below move down by its height.
+ * @return The height of the new row, or -1 if memory runs out.
+ */
+float MessageList_push_front(MessageList* list, const char* text, const char* senderName, bool isMe);
+
+/**
+ * @brief Removes the first 'count' rows (evicted history); the others move up.
+ * @return The total height of the removed rows.
+ */
+float MessageList_drop_front(MessageList* list, int count);
+
+/**
+ * @brief Measures a row's sender name again after it changed (no relayout of the text).
+ */
+void MessageList_set_name(MessageList* list, int index, const char* senderName);
+
+/**
+ * @brief Finds the rows that intersect [top, bottom] (list coordinates).
+ * @return false if there are none; otherwise sets *first and *last.
+ */
+bool MessageList_visible_range(const MessageList* list, float top, float bottom, int* first, int* last);
+
+/**
+ * @brief Draws one row.
+ * @param page The chat pane; rows are placed at page.y + scrollY + row.y.
+ * @param text The text the row was pushed with.
+ * @param senderName The current sender name, or NULL for none.
+ */
+void MessageList_draw_row(const MessageList* list, int index, Rectangle page, float scrollY,
+                          const char* text, const char* senderName, Color textColor, Color nameColor);
+
+#endif // MESSAGE_LIST_H
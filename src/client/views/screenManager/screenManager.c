@@ -1,4 +1,27 @@
 #include "screenManager.h"
+#include "../../utils/redraw/redraw.h"
+
+// Input that can change what a screen shows: keys, the mouse, the window.
+// The key queue is read here; the screens use IsKeyPressed and the char queue.
+static bool hasInputActivity()
+{
+    static bool wasFocused = true;
+    bool isFocused = IsWindowFocused();
+    bool focusChanged = isFocused != wasFocused;
+    wasFocused = isFocused;
+
+    Vector2 mouseDelta = GetMouseDelta();
+    return GetKeyPressed() != 0 || focusChanged || IsWindowResized() ||
+           mouseDelta.x != 0 || mouseDelta.y != 0 || GetMouseWheelMove() != 0 ||
+           IsMouseButtonPressed(MOUSE_BUTTON_LEFT) || IsMouseButtonReleased(MOUSE_BUTTON_LEFT) ||
+           IsMouseButtonPressed(MOUSE_BUTTON_RIGHT) || IsMouseButtonReleased(MOUSE_BUTTON_RIGHT);
+}
+
+bool shouldDrawScreen()
+{
+    if (hasInputActivity()) markScreenDirty();
+    return takeScreenRedraw();
+}
 
 void updateScreen()
 {
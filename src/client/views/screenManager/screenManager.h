@@ -7,5 +7,6 @@
 #include "../screens/chatScreen/chatScreen.h"
 #include "../../utils/debugger/debugger.h"
 void updateScreen();
+bool shouldDrawScreen();
 
 #endif
@@ -4,36 +4,38 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "../../../services/networkService/networkService.h"
 #include "../../../services/messageService/messageService.h"
 #include "../../../services/authService/authService.h"
+#include "../../../services/taskService/taskService.h"
+#include "../../../services/usernameService/usernameService.h"
+#include "../../../services/cacheService/cacheService.h"
+#include "../../../services/outboxService/outboxService.h"
 #include "../../components/components.h"
+#include "../../components/messageList/messageList.h"
+#include "../../../utils/messageStore/messageStore.h"
+#include "../../../utils/rowDecoder/rowDecoder.h"
+#include "../../../utils/chatDirectory/chatDirectory.h"
 
 // --- Module State ---
-typedef struct {
-    long sender_id;
-    char sender_name[256]; // Username of sender (for room messages)
-    char message[1024];
-    char time[32];
-    bool is_me; // NOTE: is_me logic requires knowing our own user ID.
-} ChatMessage;
+#define MAX_LOADED_PAGES 8         // Store pages kept before the oldest is evicted
+#define LOAD_OLDER_THRESHOLD 100.0f // Distance from the top that loads older history
+#define EVICT_MARGIN 2000.0f       // Distance kept above the view after an eviction
+#define SYNC_MAX_BATCHES 4         // SINCE requests tried before reloading the latest page
+#define MAX_LISTED_CHATS 4096      // Contacts or rooms read at login (server rooms, cached lists)
+#define MAX_SHOWN_PENDING 16       // Unconfirmed messages shown again when a chat is (re)loaded
 
 static long g_my_user_id = -1; // Placeholder for the current user's ID
 
-// Contact info with username
-typedef struct {
-    long id;
-    char username[256];
-} ContactInfo;
-
-static ContactInfo g_contacts[1024];
-static int g_contact_count = 0;
+static ChatDirectory g_chats; // Contacts and rooms of the sidebar (see chatDirectory.h)
 
 static long g_current_chat_contact_id = -1;
 static char g_current_chat_contact_name[256] = "";
-static ChatMessage g_chat_messages[2048];
-static int g_chat_message_count = 0;
+static MessageStore g_store; // Messages of the open chat (see messageStore.h)
+static MessageStore g_held_live; // Pushed to the open chat while its history loads (see show_live_message)
 static bool g_should_scroll_to_bottom = false; // Flag to auto-scroll when new messages arrive
+static MessageList g_message_list; // Cached layout of g_store, row i for message i
 
 // New Chat Dialog state
 static bool g_show_new_chat_dialog = false;
@@ -45,13 +47,6 @@ static long g_new_chat_found_user_id = -1;
 static char g_new_chat_found_username[256] = "";
 
 // Room/Group state
-typedef struct {
-    long id;
-    char name[256];
-} RoomInfo;
-
-static RoomInfo g_rooms[256];
-static int g_room_count = 0;
 static bool g_is_current_chat_room = false; // true if chatting in a room, false for DM
 
 // Room Dialog state
@@ -63,67 +58,223 @@ static bool g_room_action_done = false;
 static bool g_room_action_success = false;
 static char g_room_action_message[256] = "";
 
-// --- Helper Functions ---
-static void parse_and_load_messages(const char* history_data) {
-    g_chat_message_count = 0;
-    if (history_data == NULL || strlen(history_data) == 0) {
-        return;
-    }
+// Requests in flight on the task worker (see taskService.h); the panels
+// draw a loading state meanwhile
+static bool g_lists_loading = false;
+static bool g_history_loading = false;
+static bool g_older_loading = false;
+static bool g_chat_synced = false; // The open chat's messages join up with the cache; new ones are cached
+static float g_scroll_adjust = 0; // Added to the chat pane's scroll when rows change above the view
+static bool g_send_failed = false; // The outbox is retrying a message of the open chat
+static bool g_send_rejected = false; // The server refused a message of the open chat
+static bool g_new_chat_searching = false;
+static bool g_room_action_pending = false;
 
-    char* history_copy = strdup(history_data);
-    char* outer_saveptr = NULL;
-    char* inner_saveptr = NULL;
-    
-    char* msg_token = strtok_r(history_copy, ";", &outer_saveptr);
+// Delivery catch-up: the server keeps one cursor per kind and any
+// acknowledgement moves it, so acknowledging a live push while MISSED_DATA
+// batches are still coming would skip the ones not fetched yet. Those
+// acknowledgements wait for the last batch (see ack_pushed_message), and
+// the held pushes come again in a batch, where they are skipped.
+typedef struct {
+    long* ids;          // Sorted, for a binary search per missed row
+    int count;
+    int capacity;
+    long newest;        // Acknowledged after the last batch
+} HeldPushes;
 
-    while (msg_token != NULL && g_chat_message_count < 2048) {
-        // Make a copy of msg_token for inner parsing
-        char* msg_copy = strdup(msg_token);
-        
-        char* sender_str = strtok_r(msg_copy, ",", &inner_saveptr);
-        char* message_str = strtok_r(NULL, ",", &inner_saveptr);
-        char* time_str = strtok_r(NULL, ",", &inner_saveptr);
-
-        if (sender_str && message_str && time_str) {
-            ChatMessage* msg = &g_chat_messages[g_chat_message_count];
-            msg->sender_id = atol(sender_str);
-            strncpy(msg->message, message_str, sizeof(msg->message) - 1);
-            msg->message[sizeof(msg->message) - 1] = '\0';
-            strncpy(msg->time, time_str, sizeof(msg->time) - 1);
-            msg->time[sizeof(msg->time) - 1] = '\0';
-            msg->is_me = (msg->sender_id == g_my_user_id);
-            msg->sender_name[0] = '\0'; // Will be populated later for rooms
-            g_chat_message_count++;
+static bool g_catching_up = false;
+static HeldPushes g_held_dms = { NULL, 0, 0, 0 };
+static HeldPushes g_held_group_messages = { NULL, 0, 0, 0 };
+
+// --- Background Tasks ---
+// Each task copies what it needs into its context, runs the blocking
+// MessageService call on the worker and applies the result on the UI
+// thread. Results for a chat that is no longer open are dropped.
+
+typedef struct {
+    long* contact_ids; // Heap array from MessageService, NULL if none
+    int contact_count;
+    long room_ids[MAX_LISTED_CHATS];
+    char room_names[MAX_LISTED_CHATS][256];
+    int room_count;
+} ListsTask;
+
+typedef struct {
+    long chat_id;
+    bool is_room;
+    long before_id; // LONG_MAX for the latest page
+    bool older;     // Goes in front of the loaded messages
+    bool sync;      // Only the messages after the cached ones (after_id, sent at or after 'since')
+    long after_id;
+    char since[32];
+    bool replaced;  // The sync found too many and loaded the latest page instead
+    MessageStore rows; // Decoded by MessageService as they arrive
+    bool loaded;    // false if the request failed
+} HistoryTask;
+
+typedef struct {
+    char query[256];
+    long user_id;
+    char username[256];
+    bool found;
+} SearchTask;
+
+typedef struct {
+    bool is_join;
+    char name[256];  // Room name to create, or the joined room's name
+    long room_id;    // Room to join, or the created room's ID
+    bool success;
+} RoomTask;
+
+typedef struct {
+    bool is_group;
+    long message_id; // 0 asks for the next MISSED_DATA batch instead
+} AckTask;
+
+static void addRoomToList(long roomId, const char* roomName);
+static void handle_async_messages(const char* message);
+
+// Replaces the "User <id>" placeholders of a user (see usernameService.h)
+static void on_username_resolved(long userId, const char* username) {
+    requireGlyphs(username);
+    CacheService_put_username(userId, username);
+    ChatEntry* contact = ChatDirectory_find(&g_chats, false, userId);
+    if (contact != NULL) {
+        ChatDirectory_set_name(contact, username);
+        if (!g_is_current_chat_room && g_current_chat_contact_id == userId) {
+            strncpy(g_current_chat_contact_name, contact->name, sizeof(g_current_chat_contact_name) - 1);
+        }
+    }
+    // Room messages of this sender show the name from now on
+    int sender = MessageStore_find_sender(&g_store, userId);
+    if (g_is_current_chat_room && sender != -1 && userId != g_my_user_id) {
+        MessageSender* entry = &g_store.senders[sender];
+        strncpy(entry->name, username, sizeof(entry->name) - 1);
+        entry->name[sizeof(entry->name) - 1] = '\0';
+        for (int i = 0; i < g_store.count; i++) {
+            if (MessageStore_get(&g_store, i)->sender == sender) {
+                MessageList_set_name(&g_message_list, i, entry->name);
+            }
         }
-        
-        free(msg_copy);
-        msg_token = strtok_r(NULL, ";", &outer_saveptr);
     }
-    free(history_copy);
-    g_should_scroll_to_bottom = true; // Auto-scroll when loading chat history
-    printf("ChatScreen: Parsed and loaded %d messages.\n", g_chat_message_count);
 }
 
+static void run_ack(void* context) {
+    AckTask* task = context;
+    if (task->message_id == 0) {
+        MessageService_request_missed();
+    } else if (task->is_group) {
+        MessageService_ack_group_message(task->message_id);
+    } else {
+        MessageService_ack_dm(task->message_id);
+    }
+}
 
-static void add_contact_if_not_exists(long contactId) {
-    bool found = false;
-    for (int i = 0; i < g_contact_count; i++) {
-        if (g_contacts[i].id == contactId) {
-            found = true;
-            break;
-        }
+static void post_ack(bool is_group, long messageId) {
+    AckTask* task = malloc(sizeof(AckTask));
+    if (task == NULL) return;
+    task->is_group = is_group;
+    task->message_id = messageId;
+    TaskService_post(run_ack, NULL, task);
+}
+
+// Acknowledges a live push, or holds the acknowledgement during a catch-up
+static void ack_pushed_message(bool is_group, long messageId) {
+    if (!g_catching_up) {
+        post_ack(is_group, messageId);
+        return;
     }
-    if (!found && g_contact_count < 1024) {
-        g_contacts[g_contact_count].id = contactId;
-        // Try to fetch username
-        if (!MessageService_get_user_info(contactId, g_contacts[g_contact_count].username, sizeof(g_contacts[g_contact_count].username))) {
-            snprintf(g_contacts[g_contact_count].username, sizeof(g_contacts[g_contact_count].username), "User %ld", contactId);
+    HeldPushes* held = is_group ? &g_held_group_messages : &g_held_dms;
+    if (messageId > held->newest) held->newest = messageId;
+
+    if (held->count == held->capacity) {
+        int capacity = held->capacity == 0 ? 64 : held->capacity * 2;
+        long* ids = realloc(held->ids, sizeof(long) * capacity);
+        if (ids == NULL) {
+            fprintf(stderr, "ChatScreen: Out of memory; message %ld may show twice.\n", messageId);
+            return;
         }
-        g_contact_count++;
+        held->ids = ids;
+        held->capacity = capacity;
+    }
+    // Pushes mostly come in ID order: the insertion point is near the end
+    int at = held->count;
+    while (at > 0 && held->ids[at - 1] > messageId) at--;
+    memmove(held->ids + at + 1, held->ids + at, sizeof(long) * (held->count - at));
+    held->ids[at] = messageId;
+    held->count++;
+}
+
+// Whether a missed message was already shown as a push during the catch-up
+static bool was_pushed(bool is_group, long messageId) {
+    const HeldPushes* held = is_group ? &g_held_group_messages : &g_held_dms;
+    int low = 0, high = held->count - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (held->ids[middle] == messageId) return true;
+        if (held->ids[middle] < messageId) low = middle + 1;
+        else high = middle - 1;
+    }
+    return false;
+}
+
+// Forgets the held pushes of a kind once the catch-up is over
+static void release_held(HeldPushes* held) {
+    free(held->ids);
+    *held = (HeldPushes){ NULL, 0, 0, 0 };
+}
+
+static void apply_async_message(void* context) {
+    handle_async_messages(context);
+    free(context);
+}
+
+// Hands a pushed frame from the network thread to the next drain, so that
+// chat state is only ever touched on the UI thread
+static void queue_async_message(const char* message) {
+    char* frame = strdup(message);
+    if (frame != NULL) TaskService_post(NULL, apply_async_message, frame);
+}
+
+// --- Helper Functions ---
+static const char* sender_name_of(const StoredMessage* msg) {
+    return g_is_current_chat_room ? MessageStore_sender_of(&g_store, msg)->name : NULL;
+}
+
+// Lays out one message at the end of the message list
+static void layout_message(int index) {
+    const StoredMessage* msg = MessageStore_get(&g_store, index);
+    MessageList_push(&g_message_list, msg->text, sender_name_of(msg), msg->is_me);
+}
+
+static void rebuild_message_list() {
+    MessageList_clear(&g_message_list);
+    for (int i = 0; i < g_store.count; i++) {
+        layout_message(i);
+    }
+}
+
+// Adds a contact; without a known username it shows "User <id>" until the
+// username service answers.
+static void add_contact_if_not_exists(long contactId, const char* username) {
+    if (ChatDirectory_find(&g_chats, false, contactId) != NULL) return;
+
+    char name[256];
+    if (username != NULL) {
+        UsernameService_remember(contactId, username);
+        CacheService_put_username(contactId, username);
+        strncpy(name, username, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+    } else {
+        UsernameService_lookup(contactId, name, sizeof(name));
     }
+    if (ChatDirectory_add(&g_chats, false, contactId, name, NULL) == NULL) return;
+    CacheService_put_contact(contactId);
+    requireGlyphs(name);
 }
 
-// Helper to get username by ID (with caching)
+// Helper to get username by ID. Unknown names read "User <id>" until the
+// username service resolves them (see on_username_resolved).
 static void get_username_by_id(long userId, char* out_name, int buffer_size) {
     if (out_name == NULL || buffer_size <= 0) return;
     
@@ -134,23 +285,148 @@ static void get_username_by_id(long userId, char* out_name, int buffer_size) {
         return;
     }
     
-    // Check in contacts cache
-    for (int i = 0; i < g_contact_count; i++) {
-        if (g_contacts[i].id == userId) {
-            strncpy(out_name, g_contacts[i].username, buffer_size - 1);
-            out_name[buffer_size - 1] = '\0';
-            return;
+    UsernameService_lookup(userId, out_name, buffer_size);
+}
+
+// Fills in the sender names that are not known yet (room histories only)
+static void fill_sender_names() {
+    if (!g_is_current_chat_room) return;
+    for (int i = 0; i < g_store.sender_count; i++) {
+        MessageSender* sender = &g_store.senders[i];
+        if (sender->name[0] == '\0') {
+            get_username_by_id(sender->user_id, sender->name, sizeof(sender->name));
         }
     }
-    
-    // Not in cache, fetch from server
-    if (!MessageService_get_user_info(userId, out_name, buffer_size)) {
-        snprintf(out_name, buffer_size, "User %ld", userId);
+}
+
+// Appends a message to the open chat; messageId is 0 and time NULL if not known.
+// Only messages with the server's time are cached: the newest cached time is
+// where the next sync resumes (see post_history).
+static void append_chat_message(long messageId, long senderId, const char* text, const char* time) {
+    MessageInput input = { messageId, senderId, text, time != NULL ? time : "Just now", senderId == g_my_user_id };
+    int index = MessageStore_append(&g_store, &input);
+    if (index == -1) return;
+    if (g_chat_synced && time != NULL) {
+        CacheService_put_message(g_is_current_chat_room, g_current_chat_contact_id, messageId, senderId, time, text);
     }
+    fill_sender_names();
+    layout_message(index);
+    g_should_scroll_to_bottom = true;
+}
+
+// Shows a message pushed to the open chat. While its history is loading, the
+// message waits in g_held_live: appended now, it would come before the rows
+// of the sync and would not be cached (see flush_held_live).
+static void show_live_message(long messageId, long senderId, const char* text, const char* time) {
+    if (!g_history_loading) {
+        append_chat_message(messageId, senderId, text, time);
+        return;
+    }
+    MessageInput input = { messageId, senderId, text, time != NULL ? time : "", senderId == g_my_user_id };
+    MessageStore_append(&g_held_live, &input);
+}
+
+// Shows a message of the outbox until the server confirms it (see on_outbox_result)
+static void append_pending_message(long clientId, const char* text) {
+    MessageInput input = { 0, g_my_user_id, text, "Just now", true, clientId };
+    int index = MessageStore_append(&g_store, &input);
+    if (index == -1) return;
+    fill_sender_names();
+    layout_message(index);
+    g_should_scroll_to_bottom = true;
+}
+
+// Shows the open chat's unconfirmed messages after the loaded ones
+static void append_pending_messages() {
+    OutboxMessage pending[MAX_SHOWN_PENDING];
+    int count = OutboxService_get_pending(g_is_current_chat_room, g_current_chat_contact_id, pending, MAX_SHOWN_PENDING);
+    for (int i = 0; i < count; i++) {
+        append_pending_message(pending[i].client_id, pending[i].text);
+    }
+}
+
+// Moves a chat to the top of the sidebar. 'unread' counts a message that
+// arrived while another chat was open.
+static void note_chat_activity(bool isRoom, long chatId, bool unread) {
+    ChatEntry* entry = ChatDirectory_find(&g_chats, isRoom, chatId);
+    if (entry == NULL) return;
+    if (unread) ChatDirectory_set_unread(entry, entry->unread + 1);
+    ChatDirectory_touch(&g_chats, entry);
+}
+
+// Counts of a MISSED_DATA batch, filled row by row
+typedef struct {
+    long last_dm_id;
+    long last_group_message_id;
+    int loaded;
+} MissedBatch;
+
+// One missed message: "D,senderId,id,time,message" or "G,groupId,senderId,id,time,message"
+static void on_missed_row(char** fields, int fieldCount, void* context) {
+    MissedBatch* batch = context;
+    if (fieldCount >= 5 && strcmp(fields[0], "D") == 0) {
+        long senderId = atol(fields[1]);
+        long messageId = atol(fields[2]);
+        if (messageId > batch->last_dm_id) batch->last_dm_id = messageId;
+        if (was_pushed(false, messageId)) return;
+        add_contact_if_not_exists(senderId, NULL);
+        bool open = !g_is_current_chat_room && senderId == g_current_chat_contact_id;
+        if (open) show_live_message(messageId, senderId, fields[4], fields[3]);
+        note_chat_activity(false, senderId, !open);
+        batch->loaded++;
+    } else if (fieldCount >= 6 && strcmp(fields[0], "G") == 0) {
+        long groupId = atol(fields[1]);
+        long messageId = atol(fields[3]);
+        if (messageId > batch->last_group_message_id) batch->last_group_message_id = messageId;
+        if (was_pushed(true, messageId)) return;
+        bool open = g_is_current_chat_room && groupId == g_current_chat_contact_id;
+        if (open) show_live_message(messageId, atol(fields[2]), fields[5], fields[4]);
+        note_chat_activity(true, groupId, !open);
+        batch->loaded++;
+    }
+}
+
+// Loads a MISSED_DATA batch ("<more>^D,senderId,id,time,message;...;G,groupId,senderId,id,time,message;...")
+// and acknowledges it.
+static void load_missed_messages(char* batch) {
+    char* rows = strchr(batch, '^');
+    if (rows == NULL) return;
+    bool more = batch[0] == '1';
+    rows++;
+
+    MissedBatch missed = { 0, 0, 0 };
+    RowDecoder decoder;
+    RowDecoder_init(&decoder, on_missed_row, &missed);
+    RowDecoder_feed(&decoder, rows, strlen(rows));
+    RowDecoder_finish(&decoder);
+
+    // Acknowledge the newest message of each kind; the server moves its cursors there.
+    // After the last batch, the pushes held meanwhile are acknowledged too.
+    g_catching_up = more;
+    if (!more) {
+        if (g_held_dms.newest > missed.last_dm_id) missed.last_dm_id = g_held_dms.newest;
+        if (g_held_group_messages.newest > missed.last_group_message_id) missed.last_group_message_id = g_held_group_messages.newest;
+        release_held(&g_held_dms);
+        release_held(&g_held_group_messages);
+    }
+    if (missed.last_dm_id > 0) post_ack(false, missed.last_dm_id);
+    if (missed.last_group_message_id > 0) post_ack(true, missed.last_group_message_id);
+    if (more) post_ack(false, 0);
+    printf("ChatScreen: Loaded %d missed messages.\n", missed.loaded);
 }
 
 // --- Async Message Handler ---
+// Runs on the UI thread, from the task drain (see queue_async_message).
 static void handle_async_messages(const char* message) {
+    if (strncmp(message, "MISSED_DATA^", strlen("MISSED_DATA^")) == 0) {
+        char* batch = strdup(message + strlen("MISSED_DATA^"));
+        if (batch != NULL) {
+            load_missed_messages(batch);
+            free(batch);
+        }
+        return;
+    }
+
     char* msg_copy = strdup(message);
     if (msg_copy == NULL) return;
 
@@ -161,88 +437,391 @@ static void handle_async_messages(const char* message) {
         if (strcmp(command, "RECEIVE_DM") == 0) {
             char* senderId_str = strtok(NULL, separator);
             char* msg_content = strtok(NULL, separator);
+            char* messageId_str = strtok(NULL, separator);
+            char* time_str = strtok(NULL, separator);
             if (senderId_str && msg_content) {
                 long senderId = atol(senderId_str);
-                add_contact_if_not_exists(senderId);
-
-                if (!g_is_current_chat_room && senderId == g_current_chat_contact_id && g_chat_message_count < 2048) {
-                    ChatMessage* msg = &g_chat_messages[g_chat_message_count];
-                    msg->sender_id = senderId;
-                    strncpy(msg->message, msg_content, sizeof(msg->message) - 1);
-                    msg->message[sizeof(msg->message) - 1] = '\0';
-                    strcpy(msg->time, "Just now");
-                    msg->is_me = false; // Message from others
-                    msg->sender_name[0] = '\0'; // Not needed for DM
-                    g_chat_message_count++;
-                    g_should_scroll_to_bottom = true;
+                add_contact_if_not_exists(senderId, NULL);
+
+                bool open = !g_is_current_chat_room && senderId == g_current_chat_contact_id;
+                if (open) {
+                    show_live_message(messageId_str ? atol(messageId_str) : 0, senderId, msg_content, time_str);
                     printf("ChatScreen: Received DM from %ld\n", senderId);
                 }
+                note_chat_activity(false, senderId, !open);
+                if (messageId_str) ack_pushed_message(false, atol(messageId_str));
             }
         } else if (strcmp(command, "RECEIVE_GROUP_MSG") == 0) {
             char* groupId_str = strtok(NULL, separator);
             char* senderId_str = strtok(NULL, separator);
             char* msg_content = strtok(NULL, separator);
+            char* messageId_str = strtok(NULL, separator);
+            char* time_str = strtok(NULL, separator);
             if (groupId_str && senderId_str && msg_content) {
                 long groupId = atol(groupId_str);
                 long senderId = atol(senderId_str);
 
                 // If we're currently viewing this room, add the message
-                if (g_is_current_chat_room && groupId == g_current_chat_contact_id && g_chat_message_count < 2048) {
-                    ChatMessage* msg = &g_chat_messages[g_chat_message_count];
-                    msg->sender_id = senderId;
-                    strncpy(msg->message, msg_content, sizeof(msg->message) - 1);
-                    msg->message[sizeof(msg->message) - 1] = '\0';
-                    strcpy(msg->time, "Just now");
-                    msg->is_me = (senderId == g_my_user_id);
-                    // Get sender username for room message
-                    get_username_by_id(senderId, msg->sender_name, sizeof(msg->sender_name));
-                    g_chat_message_count++;
-                    g_should_scroll_to_bottom = true;
+                bool open = g_is_current_chat_room && groupId == g_current_chat_contact_id;
+                if (open) {
+                    show_live_message(messageId_str ? atol(messageId_str) : 0, senderId, msg_content, time_str);
                     printf("ChatScreen: Received group message in room %ld from %ld\n", groupId, senderId);
                 }
+                note_chat_activity(true, groupId, !open);
+                if (messageId_str) ack_pushed_message(true, atol(messageId_str));
             }
         }
     }
     free(msg_copy);
 }
 
+static void run_lists(void* context) {
+    ListsTask* task = context;
+    task->contact_ids = MessageService_get_contacts(&task->contact_count);
+    task->room_count = MessageService_get_my_groups(task->room_ids, task->room_names, MAX_LISTED_CHATS);
+}
+
+static void finish_lists(void* context) {
+    ListsTask* task = context;
+
+    // Contacts show "User <id>" until their usernames arrive
+    for (int i = 0; i < task->contact_count; i++) {
+        add_contact_if_not_exists(task->contact_ids[i], NULL);
+    }
+    free(task->contact_ids);
+
+    for (int i = 0; i < task->room_count; i++) {
+        addRoomToList(task->room_ids[i], task->room_names[i]);
+    }
+    printf("ChatScreen: Loaded %d contacts and %d rooms.\n", task->contact_count, task->room_count);
+    g_lists_loading = false;
+
+    // Pushes that arrived meanwhile (and the post-login MISSED_DATA batch)
+    // are delivered now, on top of the loaded lists
+    Network_set_async_message_handler(queue_async_message);
+    free(task);
+}
+
+// Asks for the messages after the cached ones, a page at a time. A page
+// can hold several messages sent at 'since' (or end early when the reply
+// is full), so asking stops once a page brings nothing newer.
+// Returns false if the gap is too long to close this way.
+static bool sync_history(HistoryTask* task) {
+    long newest = task->after_id;
+    for (int batch = 0; batch < SYNC_MAX_BATCHES; batch++) {
+        int known = task->rows.count;
+        task->loaded = MessageService_load_history_since(task->chat_id, task->is_room, task->since, newest, &task->rows);
+        if (!task->loaded || task->rows.count == known) return true;
+
+        const StoredMessage* last = MessageStore_get(&task->rows, task->rows.count - 1);
+        newest = last->id;
+        strncpy(task->since, last->time, sizeof(task->since) - 1);
+    }
+    return false;
+}
+
+static void run_history(void* context) {
+    HistoryTask* task = context;
+    if (task->sync) {
+        if (sync_history(task)) return;
+        MessageStore_clear(&task->rows);
+        task->replaced = true;
+    }
+    task->loaded = MessageService_load_history_before(task->chat_id, task->is_room, task->before_id, &task->rows);
+}
+
+// Whether a message is among the newest loaded ones (pushed during a sync)
+static bool has_recent_message(long messageId) {
+    for (int i = g_store.count - 1; i >= 0 && i >= g_store.count - CACHE_CHAT_MESSAGES; i--) {
+        if (MessageStore_get(&g_store, i)->id == messageId) return true;
+    }
+    return false;
+}
+
+// Applies the messages that arrived since the cached ones
+static void apply_sync(MessageStore* rows) {
+    g_chat_synced = true;
+    int added = 0;
+    for (int i = 0; i < rows->count; i++) {
+        const StoredMessage* msg = MessageStore_get(rows, i);
+        if (has_recent_message(msg->id)) continue;
+        append_chat_message(msg->id, MessageStore_sender_of(rows, msg)->user_id, msg->text, msg->time);
+        added++;
+    }
+    printf("ChatScreen: Synced %d new messages.\n", added);
+}
+
+// Shows the messages held while the history loaded, after it. Those the
+// history already brought are skipped; the others are cached like any push.
+static void flush_held_live() {
+    for (int i = 0; i < g_held_live.count; i++) {
+        const StoredMessage* msg = MessageStore_get(&g_held_live, i);
+        if (msg->id != 0 && has_recent_message(msg->id)) continue;
+        long senderId = MessageStore_sender_of(&g_held_live, msg)->user_id;
+        append_chat_message(msg->id, senderId, msg->text, msg->time[0] != '\0' ? msg->time : NULL);
+    }
+    MessageStore_clear(&g_held_live);
+}
+
+// Puts an older page in front of the loaded messages, keeping the view where it was
+static void prepend_older(MessageStore* rows) {
+    int count = rows->count;
+    if (MessageStore_move_front(&g_store, rows) != 0) return;
+    fill_sender_names();
+    float added = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        const StoredMessage* msg = MessageStore_get(&g_store, i);
+        float height = MessageList_push_front(&g_message_list, msg->text, sender_name_of(msg), msg->is_me);
+        if (height < 0) {
+            // Out of memory: lay the whole list out again rather than leave it misaligned
+            rebuild_message_list();
+            return;
+        }
+        added += height;
+    }
+    g_scroll_adjust -= added;
+}
+
+static void finish_history(void* context) {
+    HistoryTask* task = context;
+    bool same_chat = task->chat_id == g_current_chat_contact_id && task->is_room == g_is_current_chat_room;
+    // An older page only fits if nothing was evicted or reloaded meanwhile
+    bool still_wanted = same_chat && (!task->older || MessageStore_oldest_id(&g_store) == task->before_id);
+    if (still_wanted && task->loaded) {
+        int count = task->rows.count;
+        if (task->older) {
+            prepend_older(&task->rows);
+        } else if (task->sync && !task->replaced) {
+            apply_sync(&task->rows);
+        } else {
+            // The cache restarts from this page
+            CacheService_reset_chat(task->is_room, task->chat_id);
+            for (int i = 0; i < count; i++) {
+                const StoredMessage* msg = MessageStore_get(&task->rows, i);
+                CacheService_put_message(task->is_room, task->chat_id, msg->id, MessageStore_sender_of(&task->rows, msg)->user_id, msg->time, msg->text);
+            }
+            g_chat_synced = true;
+            MessageStore_clear(&g_store);
+            MessageStore_move_front(&g_store, &task->rows);
+            fill_sender_names();
+            rebuild_message_list();
+            append_pending_messages();
+            g_should_scroll_to_bottom = true; // Auto-scroll when loading chat history
+            printf("ChatScreen: Loaded %d messages.\n", count);
+        }
+        if (!task->sync || task->replaced) g_store.has_older = count > 0;
+    }
+    if (same_chat) {
+        if (task->older) {
+            g_older_loading = false;
+        } else {
+            g_history_loading = false;
+            flush_held_live();
+        }
+    }
+    MessageStore_free(&task->rows);
+    free(task);
+}
+
+static void post_history(bool older) {
+    HistoryTask* task = calloc(1, sizeof(HistoryTask));
+    if (task == NULL) return;
+    task->chat_id = g_current_chat_contact_id;
+    task->is_room = g_is_current_chat_room;
+    task->older = older;
+    task->before_id = older ? MessageStore_oldest_id(&g_store) : LONG_MAX;
+    for (int i = g_store.count - 1; !older && i >= 0; i--) {
+        // Cached messages are shown; only what came after them is needed
+        // (pending ones, without an ID, are not from the server)
+        const StoredMessage* newest = MessageStore_get(&g_store, i);
+        if (newest->id == 0) continue;
+        task->sync = true;
+        task->after_id = newest->id;
+        strncpy(task->since, newest->time, sizeof(task->since) - 1);
+        break;
+    }
+    bool posted = TaskService_post(run_history, finish_history, task) == 0;
+    if (older) g_older_loading = posted;
+    else g_history_loading = posted;
+}
+
+// Loads the page before the oldest loaded message, when the view nears the top
+static void load_older_if_needed(float viewTop) {
+    if (viewTop > LOAD_OLDER_THRESHOLD || !g_store.has_older) return;
+    if (g_history_loading || g_older_loading || MessageStore_oldest_id(&g_store) == 0) return;
+    post_history(true);
+}
+
+// Drops the oldest page while the view is well below it, bounding the memory
+// of a chat that keeps growing. Dropped pages load again on the way up.
+static void evict_old_pages(float viewTop) {
+    while (g_store.page_count > MAX_LOADED_PAGES && !g_older_loading) {
+        int front = MessageStore_front_count(&g_store);
+        if (front >= g_message_list.count) return;
+        float front_height = g_message_list.rows[front].y;
+        if (viewTop - front_height < EVICT_MARGIN) return;
+
+        MessageList_drop_front(&g_message_list, MessageStore_evict_front(&g_store));
+        g_scroll_adjust += front_height;
+        viewTop -= front_height;
+    }
+}
+
+// Opens a chat and loads its history in the background
+static void open_chat(long chatId, bool isRoom) {
+    g_current_chat_contact_id = chatId;
+    g_is_current_chat_room = isRoom;
+    MessageStore_clear(&g_store);
+    MessageStore_clear(&g_held_live);
+    MessageList_clear(&g_message_list);
+    g_send_failed = false;
+    g_send_rejected = false;
+    g_older_loading = false;
+    g_chat_synced = false;
+
+    // Show the cached messages right away; the request then only fetches newer ones
+    const CachedMessage* cached = NULL;
+    int cached_count = CacheService_get_messages(isRoom, chatId, &cached);
+    MessageInput* inputs = cached_count > 0 ? malloc(sizeof(MessageInput) * cached_count) : NULL;
+    if (inputs != NULL) {
+        for (int i = 0; i < cached_count; i++) {
+            inputs[i] = (MessageInput){ cached[i].id, cached[i].sender_id, cached[i].text, cached[i].time, cached[i].sender_id == g_my_user_id };
+        }
+        if (MessageStore_prepend(&g_store, inputs, cached_count) == 0) {
+            g_store.has_older = true;
+            fill_sender_names();
+            rebuild_message_list();
+            g_should_scroll_to_bottom = true;
+        }
+        free(inputs);
+    }
+    append_pending_messages();
+    post_history(false);
+}
+
+// A send of the outbox was confirmed (messageId > 0), will be retried (0) or was refused
+static void on_outbox_result(const OutboxMessage* message, long messageId, const char* time) {
+    bool same_chat = message->chat_id == g_current_chat_contact_id && message->is_group == g_is_current_chat_room;
+    if (messageId == 0) {
+        if (same_chat) g_send_failed = true;
+        return;
+    }
+    if (messageId == OUTBOX_REJECTED) {
+        // It stays in the chat, marked, until the chat is reloaded
+        if (same_chat && MessageStore_reject(&g_store, message->client_id) != -1) {
+            g_send_failed = false;
+            g_send_rejected = true;
+        }
+        return;
+    }
+
+    note_chat_activity(message->is_group, message->chat_id, false);
+    if (!same_chat) return;
+    g_send_failed = false;
+    int index = MessageStore_confirm(&g_store, message->client_id, messageId, time);
+    // Without the server's time it is left to the next sync (see append_chat_message)
+    if (index != -1 && g_chat_synced && time != NULL) {
+        const StoredMessage* msg = MessageStore_get(&g_store, index);
+        CacheService_put_message(message->is_group, message->chat_id, messageId, g_my_user_id, time, msg->text);
+    }
+}
+
+static void run_search(void* context) {
+    SearchTask* task = context;
+    task->found = MessageService_search_user(task->query, &task->user_id, task->username, sizeof(task->username));
+}
+
+static void finish_search(void* context) {
+    SearchTask* task = context;
+    g_new_chat_user_found = task->found;
+    g_new_chat_found_user_id = task->user_id;
+    strncpy(g_new_chat_found_username, task->username, sizeof(g_new_chat_found_username) - 1);
+    g_new_chat_found_username[sizeof(g_new_chat_found_username) - 1] = '\0';
+    requireGlyphs(g_new_chat_found_username);
+    g_new_chat_search_done = true;
+    g_new_chat_searching = false;
+    free(task);
+}
+
+static void run_room_action(void* context) {
+    RoomTask* task = context;
+    if (task->is_join) {
+        task->success = MessageService_join_group(task->room_id, task->name, sizeof(task->name));
+    } else {
+        task->success = MessageService_create_group(task->name, &task->room_id) && task->room_id > 0;
+    }
+}
+
+static void finish_room_action(void* context) {
+    RoomTask* task = context;
+    g_room_action_success = task->success;
+    if (task->is_join) {
+        if (task->success) {
+            snprintf(g_room_action_message, sizeof(g_room_action_message), "Joined room: %s", task->name);
+            addRoomToList(task->room_id, task->name);
+        } else {
+            snprintf(g_room_action_message, sizeof(g_room_action_message), "Failed to join (not found or already member)");
+        }
+    } else {
+        if (task->success) {
+            snprintf(g_room_action_message, sizeof(g_room_action_message), "Room created! ID: %ld", task->room_id);
+            addRoomToList(task->room_id, task->name);
+        } else {
+            snprintf(g_room_action_message, sizeof(g_room_action_message), "Failed to create room");
+        }
+    }
+    g_room_action_done = true;
+    g_room_action_pending = false;
+    free(task);
+}
+
+static void post_room_action(bool isJoin) {
+    RoomTask* task = calloc(1, sizeof(RoomTask));
+    if (task == NULL) return;
+    task->is_join = isJoin;
+    if (isJoin) {
+        task->room_id = atol(g_room_input);
+    } else {
+        strncpy(task->name, g_room_input, sizeof(task->name) - 1);
+    }
+    g_room_action_done = false;
+    g_room_action_pending = TaskService_post(run_room_action, finish_room_action, task) == 0;
+}
+
 void drawChatListPanel()
 {
     static bool isInitialized = false;
     if (!isInitialized) {
         // One-time initialization for this screen
-        Network_set_async_message_handler(handle_async_messages);
-        
         // Get the current user ID from auth service
         g_my_user_id = AuthService_get_current_user_id();
         printf("ChatScreen: Initialized with user ID: %ld\n", g_my_user_id);
+        UsernameService_set_listener(on_username_resolved);
+        OutboxService_set_listener(on_outbox_result);
+        MessageList_init(&g_message_list, &Font_Opensans_Regular_20, 20, &Font_Opensans_Regular_20, 14, 400);
 
-        // Load contacts (DMs)
-        int count = 0;
-        long* contact_ids = MessageService_get_contacts(&count);
-        if (contact_ids != NULL) {
-            int num_contacts = count < 1024 ? count : 1024;
-            for (int i = 0; i < num_contacts; i++) {
-                g_contacts[i].id = contact_ids[i];
-                // Fetch username for each contact
-                if (!MessageService_get_user_info(contact_ids[i], g_contacts[i].username, sizeof(g_contacts[i].username))) {
-                    snprintf(g_contacts[i].username, sizeof(g_contacts[i].username), "User %ld", contact_ids[i]);
-                }
+        // Draw the cached lists at once; the server's are merged in below
+        long* cached_ids = malloc(sizeof(long) * MAX_LISTED_CHATS);
+        char (*cached_room_names)[256] = malloc(sizeof(*cached_room_names) * MAX_LISTED_CHATS);
+        if (CacheService_open(g_my_user_id) && cached_ids != NULL && cached_room_names != NULL) {
+            int cached_contacts = CacheService_get_contacts(cached_ids, MAX_LISTED_CHATS);
+            for (int i = 0; i < cached_contacts; i++) {
+                add_contact_if_not_exists(cached_ids[i], NULL);
+            }
+            int cached_rooms = CacheService_get_rooms(cached_ids, cached_room_names, MAX_LISTED_CHATS);
+            for (int i = 0; i < cached_rooms; i++) {
+                addRoomToList(cached_ids[i], cached_room_names[i]);
             }
-            g_contact_count = num_contacts;
-            free(contact_ids);
         }
-        
-        // Load rooms/groups
-        long room_ids[256];
-        char room_names[256][256];
-        g_room_count = MessageService_get_my_groups(room_ids, room_names, 256);
-        for (int i = 0; i < g_room_count; i++) {
-            g_rooms[i].id = room_ids[i];
-            strncpy(g_rooms[i].name, room_names[i], sizeof(g_rooms[i].name) - 1);
-            g_rooms[i].name[sizeof(g_rooms[i].name) - 1] = '\0';
-        }
-        printf("ChatScreen: Loaded %d rooms.\n", g_room_count);
+        free(cached_ids);
+        free(cached_room_names);
+
+        // Load contacts (DMs) and rooms/groups in the background; the
+        // async handler is registered once they are in (see finish_lists)
+        ListsTask* task = calloc(1, sizeof(ListsTask));
+        if (task != NULL) {
+            g_lists_loading = TaskService_post(run_lists, finish_lists, task) == 0;
+        }
         
         isInitialized = true;
     }
@@ -287,8 +866,8 @@ void drawChatListPanel()
 
     Rectangle Position_GuiListView = { 0, 180, Panel_ChatList.width, 420 };
 
-    // Total items = contacts + rooms
-    float numberOfItems = g_contact_count + g_room_count;
+    // One item per contact or room, most recently active first
+    float numberOfItems = g_chats.count;
     float itemHeight = 40;
     static float scrollY = 0.0f;
     static float scrollSpeed = 20.0f;
@@ -306,62 +885,36 @@ void drawChatListPanel()
     }
 
     BeginScissorMode((int)Position_GuiListView.x, (int)Position_GuiListView.y, (int)Position_GuiListView.width, (int)Position_GuiListView.height);
-    
-    int itemIndex = 0;
-    
-    // Draw rooms first (with "Room -> " prefix)
-    for (int i = 0; i < g_room_count; i++)
+
+    // Only the items in view are visited
+    int firstItem = (int)(-scrollY / itemHeight);
+    int lastItem = (int)((Position_GuiListView.height - scrollY) / itemHeight);
+    for (int itemIndex = firstItem; itemIndex <= lastItem && itemIndex < g_chats.count; itemIndex++)
     {
+        ChatEntry* chat = ChatDirectory_at(&g_chats, itemIndex);
         float itemY = Position_GuiListView.y + scrollY + (itemIndex * itemHeight);
-        if (itemY + itemHeight >= Position_GuiListView.y && itemY <= Position_GuiListView.y + Position_GuiListView.height) {
-            Rectangle Position_ChatListButton = { 0, itemY, Panel_ChatList.width, 40 };
-
-            // Click handling for room
-            if (CheckCollisionPointRec(mousePos, Position_ChatListButton) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                g_current_chat_contact_id = g_rooms[i].id;
-                snprintf(g_current_chat_contact_name, sizeof(g_current_chat_contact_name), "Room -> %s", g_rooms[i].name);
-                g_is_current_chat_room = true;
-                char* history_str = MessageService_get_group_history(g_current_chat_contact_id);
-                parse_and_load_messages(history_str);
-                if (history_str) free(history_str);
-                
-                // Fetch sender names for room messages
-                for (int j = 0; j < g_chat_message_count; j++) {
-                    get_username_by_id(g_chat_messages[j].sender_id, g_chat_messages[j].sender_name, sizeof(g_chat_messages[j].sender_name));
-                }
-            }
+        Rectangle Position_ChatListButton = { 0, itemY, Panel_ChatList.width, 40 };
 
-            char room_display[300];
-            snprintf(room_display, sizeof(room_display), "Room -> %s", g_rooms[i].name);
-            ChatListButton(Position_ChatListButton, room_display, Font_Opensans_Bold_17, 15, (Color){60, 60, 80, 255}, COLOR_DARKTHEME_BLACK, COLOR_DARKTHEME_GRAY, (Color){150, 200, 255, 255}, 0);
+        // Click handling: the unread count clears and the label then reads as the chat title
+        if (CheckCollisionPointRec(mousePos, Position_ChatListButton) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+            ChatDirectory_set_unread(chat, 0);
+            strncpy(g_current_chat_contact_name, chat->is_room ? chat->label : chat->name, sizeof(g_current_chat_contact_name) - 1);
+            g_current_chat_contact_name[sizeof(g_current_chat_contact_name) - 1] = '\0';
+            open_chat(chat->id, chat->is_room);
         }
-        itemIndex++;
-    }
-    
-    // Draw contacts (DMs)
-    for (int i = 0; i < g_contact_count; i++)
-    {
-        float itemY = Position_GuiListView.y + scrollY + (itemIndex * itemHeight);
-        if (itemY + itemHeight >= Position_GuiListView.y && itemY <= Position_GuiListView.y + Position_GuiListView.height) {
-            Rectangle Position_ChatListButton = { 0, itemY, Panel_ChatList.width, 40 };
-
-            // Click handling for contact
-            if (CheckCollisionPointRec(mousePos, Position_ChatListButton) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                g_current_chat_contact_id = g_contacts[i].id;
-                strncpy(g_current_chat_contact_name, g_contacts[i].username, sizeof(g_current_chat_contact_name) - 1);
-                g_current_chat_contact_name[sizeof(g_current_chat_contact_name) - 1] = '\0';
-                g_is_current_chat_room = false;
-                char* history_str = MessageService_get_history(g_current_chat_contact_id);
-                parse_and_load_messages(history_str);
-                if (history_str) free(history_str);
-            }
 
-            ChatListButton(Position_ChatListButton, g_contacts[i].username, Font_Opensans_Bold_17, 15, COLOR_DARKTHEME_GRAY, COLOR_DARKTHEME_BLACK, COLOR_DARKTHEME_GRAY, WHITE, 0);
+        if (chat->is_room) {
+            ChatListButton(Position_ChatListButton, chat->label, Font_Opensans_Bold_17, 15, (Color){60, 60, 80, 255}, COLOR_DARKTHEME_BLACK, COLOR_DARKTHEME_GRAY, (Color){150, 200, 255, 255}, 0);
+        } else {
+            ChatListButton(Position_ChatListButton, chat->label, Font_Opensans_Bold_17, 15, COLOR_DARKTHEME_GRAY, COLOR_DARKTHEME_BLACK, COLOR_DARKTHEME_GRAY, WHITE, 0);
         }
-        itemIndex++;
     }
     
     EndScissorMode();
+
+    if (g_lists_loading) {
+        DrawTextEx(Font_Opensans_Regular_20, "Loading chats...", (Vector2){ 20, Position_GuiListView.y + 10 }, 16, 1, COLOR_DARKTHEME_GRAY);
+    }
 }
 
 void drawChatSection()
@@ -382,11 +935,10 @@ void drawChatSection()
     Rectangle Position_ChatPage = { 200, Position_ChatName.y + Position_ChatName.height, 600, Position_ChatSection.height - Position_ChatName.height - 40 };
     DrawRectangleRec(Position_ChatPage, COLOR_DARKTHEME_GRAY);
 
-    float numberOfItems = g_chat_message_count;
-    float itemHeight = 80;
+    // Rows have the heights of their wrapped text (see messageList.h)
     static float scrollY = 0.0f;
     static float scrollSpeed = 20.0f;
-    float contentHeight = numberOfItems * itemHeight;
+    float contentHeight = g_message_list.content_height;
     float maxScroll = contentHeight - Position_ChatPage.height;
     if (maxScroll < 0) maxScroll = 0;
     
@@ -411,34 +963,47 @@ void drawChatSection()
         }
     }
 
+    // Older pages load near the top and the oldest is evicted far from it;
+    // both move the rows, so the scroll follows to keep the view still
+    if (g_current_chat_contact_id != -1) {
+        load_older_if_needed(-scrollY);
+        evict_old_pages(-scrollY);
+    }
+    if (g_scroll_adjust != 0) {
+        scrollY += g_scroll_adjust;
+        g_scroll_adjust = 0;
+        if (scrollY > 0) scrollY = 0;
+    }
+
     BeginScissorMode((int)Position_ChatPage.x, (int)Position_ChatPage.y, (int)Position_ChatPage.width, (int)Position_ChatPage.height);
-    for (int i = 0; i < numberOfItems; i++)
-    {
-        float itemY = Position_ChatPage.y + scrollY + (i * itemHeight);
-        if (itemY + itemHeight < Position_ChatPage.y || itemY > Position_ChatPage.y + Position_ChatPage.height) continue;
-
-        Rectangle Position_bubbleChat = { Position_ChatPage.x, itemY + 20, Position_ChatPage.width, 40 };
-
-        // For room messages, show sender name above the bubble
-        if (g_is_current_chat_room && strlen(g_chat_messages[i].sender_name) > 0) {
-            Color nameColor = g_chat_messages[i].is_me ? (Color){150, 200, 255, 255} : (Color){255, 200, 150, 255};
-            Vector2 namePos;
-            if (g_chat_messages[i].is_me) {
-                // Align right for my messages
-                Vector2 nameSize = MeasureTextEx(Font_Opensans_Regular_20, g_chat_messages[i].sender_name, 14, 1);
-                namePos = (Vector2){ Position_ChatPage.x + Position_ChatPage.width - nameSize.x - 30, itemY + 2 };
-            } else {
-                // Align left for others
-                namePos = (Vector2){ Position_ChatPage.x + 30, itemY + 2 };
-            }
-            DrawTextEx(Font_Opensans_Regular_20, g_chat_messages[i].sender_name, namePos, 14, 1, nameColor);
+    int firstRow, lastRow;
+    if (MessageList_visible_range(&g_message_list, -scrollY, -scrollY + Position_ChatPage.height, &firstRow, &lastRow)) {
+        for (int i = firstRow; i <= lastRow; i++)
+        {
+            const StoredMessage* msg = MessageStore_get(&g_store, i);
+            if (msg == NULL) break;
+            // For room messages, show sender name above the bubble
+            Color nameColor = msg->is_me ? (Color){150, 200, 255, 255} : (Color){255, 200, 150, 255};
+            // Pending messages are faded, refused ones red
+            Color textColor = msg->client_id == MESSAGE_REJECTED ? (Color){200, 40, 40, 255}
+                            : msg->client_id != 0 ? ColorAlpha(BLACK, 0.5f) : BLACK;
+            MessageList_draw_row(&g_message_list, i, Position_ChatPage, scrollY, msg->text, sender_name_of(msg), textColor, nameColor);
         }
-
-        // Use is_me from message to determine bubble position (left/right)
-        DrawBubbleChat(Position_bubbleChat, g_chat_messages[i].message, Font_Opensans_Regular_20, 20, BLACK, g_chat_messages[i].is_me);
     }
     EndScissorMode();
 
+    if (g_history_loading && g_store.count == 0) {
+        const char* loadingText = "Loading messages...";
+        Vector2 loadingSize = MeasureTextEx(Font_Opensans_Regular_20, loadingText, 18, 1);
+        DrawTextEx(Font_Opensans_Regular_20, loadingText,
+            (Vector2){ Position_ChatPage.x + Position_ChatPage.width/2 - loadingSize.x/2, Position_ChatPage.y + 20 }, 18, 1, WHITE);
+    }
+    if (g_send_failed) {
+        DrawTextEx(Font_Opensans_Regular_20, "Not sent yet, retrying...", (Vector2){ 210, 530 }, 14, 1, (Color){255, 100, 100, 255});
+    } else if (g_send_rejected) {
+        DrawTextEx(Font_Opensans_Regular_20, "The server refused a message; it was not sent.", (Vector2){ 210, 530 }, 14, 1, (Color){255, 100, 100, 255});
+    }
+
     // Draw the input box
     Rectangle Position_InputBox = {
         210,
@@ -462,41 +1027,10 @@ void drawChatSection()
     // Handle sending message when Enter is pressed
     if (dynamic_chatscreen_isActive && IsKeyPressed(KEY_ENTER)) {
         if (g_current_chat_contact_id != -1 && strlen(dynamic_chatsceen_input) > 0) {
-            // Save message content before sending (in case input gets modified)
-            char message_to_send[100];
-            strncpy(message_to_send, dynamic_chatsceen_input, sizeof(message_to_send) - 1);
-            message_to_send[sizeof(message_to_send) - 1] = '\0';
-            
-            bool send_success = false;
-            
-            // Send via appropriate service based on chat type
-            if (g_is_current_chat_room) {
-                send_success = MessageService_send_group_message(g_current_chat_contact_id, message_to_send);
-            } else {
-                send_success = MessageService_send_dm(g_current_chat_contact_id, message_to_send);
-            }
-            
-            if (send_success && g_chat_message_count < 2048) {
-                // Add the sent message to local chat display
-                ChatMessage* msg = &g_chat_messages[g_chat_message_count];
-                msg->sender_id = g_my_user_id;
-                strncpy(msg->message, message_to_send, sizeof(msg->message) - 1);
-                msg->message[sizeof(msg->message) - 1] = '\0';
-                strcpy(msg->time, "Just now");
-                msg->is_me = true;
-                // Set sender name for room messages
-                if (g_is_current_chat_room) {
-                    strcpy(msg->sender_name, "Me");
-                } else {
-                    msg->sender_name[0] = '\0';
-                }
-                g_chat_message_count++;
-                g_should_scroll_to_bottom = true; // Auto-scroll to show sent message
-                
-                printf("ChatScreen: Message sent successfully.\n");
-            } else if (!send_success) {
-                printf("ChatScreen: Failed to send message.\n");
-            }
+            // The message shows at once, pending, while the outbox sends it
+            // (see on_outbox_result)
+            long clientId = OutboxService_send(g_is_current_chat_room, g_current_chat_contact_id, dynamic_chatsceen_input);
+            if (clientId != 0) append_pending_message(clientId, dynamic_chatsceen_input);
             
             // Clear input field after sending
             memset(dynamic_chatsceen_input, 0, sizeof(dynamic_chatsceen_input));
@@ -551,18 +1085,20 @@ static void drawNewChatDialog()
     drawTextField(&searchField);
     
     // Handle Enter key to search
-    if (g_new_chat_search_active && IsKeyPressed(KEY_ENTER) && strlen(g_new_chat_search_input) > 0) {
-        g_new_chat_user_found = MessageService_search_user(
-            g_new_chat_search_input,
-            &g_new_chat_found_user_id,
-            g_new_chat_found_username,
-            sizeof(g_new_chat_found_username)
-        );
-        g_new_chat_search_done = true;
+    if (g_new_chat_search_active && IsKeyPressed(KEY_ENTER) && strlen(g_new_chat_search_input) > 0 && !g_new_chat_searching) {
+        SearchTask* task = calloc(1, sizeof(SearchTask));
+        if (task != NULL) {
+            strncpy(task->query, g_new_chat_search_input, sizeof(task->query) - 1);
+            task->user_id = -1;
+            g_new_chat_search_done = false;
+            g_new_chat_searching = TaskService_post(run_search, finish_search, task) == 0;
+        }
     }
     
     // Show search result
-    if (g_new_chat_search_done) {
+    if (g_new_chat_searching) {
+        DrawTextEx(Font_Opensans_Regular_20, "Searching...", (Vector2){ dialogRect.x + 30, dialogRect.y + 135 }, 18, 1, WHITE);
+    } else if (g_new_chat_search_done) {
         Vector2 resultPos = { dialogRect.x + 30, dialogRect.y + 135 };
         
         if (g_new_chat_user_found) {
@@ -590,10 +1126,9 @@ static void drawNewChatDialog()
             
             if (btnHover && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
                 // Add contact and start chat
-                add_contact_if_not_exists(g_new_chat_found_user_id);
-                g_current_chat_contact_id = g_new_chat_found_user_id;
+                add_contact_if_not_exists(g_new_chat_found_user_id, g_new_chat_found_username);
                 strncpy(g_current_chat_contact_name, g_new_chat_found_username, sizeof(g_current_chat_contact_name) - 1);
-                g_chat_message_count = 0; // Clear messages for new chat
+                open_chat(g_new_chat_found_user_id, false);
                 g_show_new_chat_dialog = false;
             }
         } else {
@@ -619,16 +1154,10 @@ static void drawNewChatDialog()
 }
 
 static void addRoomToList(long roomId, const char* roomName) {
-    // Check if room already exists
-    for (int i = 0; i < g_room_count; i++) {
-        if (g_rooms[i].id == roomId) return;
-    }
-    if (g_room_count < 256) {
-        g_rooms[g_room_count].id = roomId;
-        strncpy(g_rooms[g_room_count].name, roomName, sizeof(g_rooms[g_room_count].name) - 1);
-        g_rooms[g_room_count].name[sizeof(g_rooms[g_room_count].name) - 1] = '\0';
-        g_room_count++;
-    }
+    bool added = false;
+    if (ChatDirectory_add(&g_chats, true, roomId, roomName, &added) == NULL || !added) return;
+    CacheService_put_room(roomId, roomName);
+    requireGlyphs(roomName);
 }
 
 static void drawRoomDialog()
@@ -707,16 +1236,8 @@ static void drawRoomDialog()
             17, 1, WHITE);
         
         if ((actionHover && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) || (g_room_input_active && IsKeyPressed(KEY_ENTER))) {
-            if (strlen(g_room_input) > 0) {
-                long newRoomId = -1;
-                g_room_action_success = MessageService_create_group(g_room_input, &newRoomId);
-                if (g_room_action_success && newRoomId > 0) {
-                    snprintf(g_room_action_message, sizeof(g_room_action_message), "Room created! ID: %ld", newRoomId);
-                    addRoomToList(newRoomId, g_room_input);
-                } else {
-                    snprintf(g_room_action_message, sizeof(g_room_action_message), "Failed to create room");
-                }
-                g_room_action_done = true;
+            if (strlen(g_room_input) > 0 && !g_room_action_pending) {
+                post_room_action(false);
             }
         }
         
@@ -730,7 +1251,9 @@ static void drawRoomDialog()
         }
         
         // Show result
-        if (g_room_action_done) {
+        if (g_room_action_pending) {
+            DrawTextEx(Font_Opensans_Regular_20, "Please wait...", (Vector2){ dialogRect.x + 30, dialogRect.y + 200 }, 16, 1, WHITE);
+        } else if (g_room_action_done) {
             Color resultColor = g_room_action_success ? (Color){100, 255, 100, 255} : (Color){255, 100, 100, 255};
             DrawTextEx(Font_Opensans_Regular_20, g_room_action_message, (Vector2){ dialogRect.x + 30, dialogRect.y + 200 }, 16, 1, resultColor);
         }
@@ -753,17 +1276,8 @@ static void drawRoomDialog()
             17, 1, WHITE);
         
         if ((actionHover && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) || (g_room_input_active && IsKeyPressed(KEY_ENTER))) {
-            if (strlen(g_room_input) > 0) {
-                long roomId = atol(g_room_input);
-                char roomName[256] = "";
-                g_room_action_success = MessageService_join_group(roomId, roomName, sizeof(roomName));
-                if (g_room_action_success) {
-                    snprintf(g_room_action_message, sizeof(g_room_action_message), "Joined room: %s", roomName);
-                    addRoomToList(roomId, roomName);
-                } else {
-                    snprintf(g_room_action_message, sizeof(g_room_action_message), "Failed to join (not found or already member)");
-                }
-                g_room_action_done = true;
+            if (strlen(g_room_input) > 0 && !g_room_action_pending) {
+                post_room_action(true);
             }
         }
         
@@ -777,7 +1291,9 @@ static void drawRoomDialog()
         }
         
         // Show result
-        if (g_room_action_done) {
+        if (g_room_action_pending) {
+            DrawTextEx(Font_Opensans_Regular_20, "Please wait...", (Vector2){ dialogRect.x + 30, dialogRect.y + 200 }, 16, 1, WHITE);
+        } else if (g_room_action_done) {
             Color resultColor = g_room_action_success ? (Color){100, 255, 100, 255} : (Color){255, 100, 100, 255};
             DrawTextEx(Font_Opensans_Regular_20, g_room_action_message, (Vector2){ dialogRect.x + 30, dialogRect.y + 200 }, 16, 1, resultColor);
         }
@@ -1,22 +1,60 @@
 #include "loginScreen.h"
 #include <raylib.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../../services/taskService/taskService.h"
 
 
 static char dynamic_login_usernameValue[100] = "";
 static bool dynamic_login_usernameIsActive = false;
 static char dynamic_login_passwordValue[100] = "";
 static bool dynamic_login_passwordIsActive = false;
-void login()
+
+// A login request runs on the task worker (see taskService.h)
+typedef struct {
+    char username[100];
+    char password[100];
+    long userId;
+    bool status;
+} LoginTask;
+
+static bool g_login_pending = false;
+
+static void run_login(void* context)
 {
-    long userId = -1;
-    bool status = AuthService_login(dynamic_login_usernameValue, dynamic_login_passwordValue, &userId);
-    if (status) {
-        printf("Login successful! User ID: %ld\n", userId);
+    LoginTask* task = context;
+    task->status = AuthService_login(task->username, task->password, &task->userId);
+}
+
+static void finish_login(void* context)
+{
+    LoginTask* task = context;
+    g_login_pending = false;
+    if (task->status) {
+        printf("Login successful! User ID: %ld\n", task->userId);
         changeScreenState(CHAT);
     } else {
         setDebugMessage("Login failed!!!");
     }
+    free(task);
+}
+
+void login()
+{
+    if (g_login_pending) return;
+
+    LoginTask* task = calloc(1, sizeof(LoginTask));
+    if (task == NULL) return;
+    strncpy(task->username, dynamic_login_usernameValue, sizeof(task->username) - 1);
+    strncpy(task->password, dynamic_login_passwordValue, sizeof(task->password) - 1);
+    task->userId = -1;
+
+    if (TaskService_post(run_login, finish_login, task) == 0) {
+        g_login_pending = true;
+    } else {
+        setDebugMessage("Login failed!!!");
+    }
 }
 
 void drawLoginScreen()
@@ -146,7 +184,7 @@ void drawLoginScreen()
         COLOR_DARKTHEME_PURPLE,
         COLOR_DARKTHEME_BLACK,
         COLOR_DARKTHEME_BLACK,
-        "Login",
+        g_login_pending ? "Logging in..." : "Login",
         &Font_Opensans_Regular_20,
         20,
         login
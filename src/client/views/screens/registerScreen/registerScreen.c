@@ -9,12 +9,11 @@ static bool dynamic_signup_passwordIsActive = false;
 static int dynamic_signup_status = -99;
 void signup()
 {
+    // The reply arrives on a later frame; the controller changes the screen
     bool status = Register_onClickRegisterButton(dynamic_signup_usernameValue, dynamic_signup_passwordValue);
     if (!status) {
         dynamic_signup_passwordIsActive = false;
         //TODO: Display dialog
-    } else {
-        changeScreenState(LOGIN);
     }
 
 
@@ -175,7 +174,7 @@ void drawRegisterScreen()
            COLOR_DARKTHEME_PURPLE,
            COLOR_DARKTHEME_BLACK,
            COLOR_DARKTHEME_BLACK,
-           "Register",
+           Register_is_pending() ? "Signing up..." : "Register",
            &Font_Opensans_Regular_20,
            20,
            signup
@@ -2,25 +2,39 @@
 #include "services/userService/userService.h"
 #include "services/socketService/socketService.h"
 #include "services/sessionManager/sessionManager.h"
+#include "services/metricsService/metricsService.h"
+#include "services/adminService/adminService.h"
+#include "services/logService/logService.h"
+
+#define SERVER_PORT 8080
+#define ADMIN_PORT 9108 // Loopback-only admin/metrics endpoint
 
 
 int main() {
-    printf("Server starting...\n");
+    // 0. Initialize observability before any worker thread exists
+    Log_init();
+    Metrics_init();
+    LOG_INFO("server", "Server starting...");
 
     // 1. Initialize data layer
     if (UserService_createDocument() != 0) {
-        // fprintf(stderr, "FATAL: Could not initialize the user document. Exiting.\n");
+        // LOG_ERROR("server", "Could not initialize the user document. Exiting.");
         // return 1;
     }
-    printf("User document structure is ready.\n");
+    LOG_INFO("server", "User document structure is ready.");
 
     // 1.1 Initialize Session Manager
     SessionManager_init();
 
+    // 1.2 Start the admin endpoint (metrics); the server keeps running without it
+    if (AdminService_start(ADMIN_PORT) != 0) {
+        LOG_WARN("server", "Could not start admin endpoint on port %d.", ADMIN_PORT);
+    }
+
     // 2. Initialize network layer
-    int server_fd = Socket_init(8080, 10); // Listen on port 8080
+    int server_fd = Socket_init(SERVER_PORT, 10);
     if (server_fd < 0) {
-        fprintf(stderr, "FATAL: Could not initialize server socket. Exiting.\n");
+        LOG_ERROR("server", "Could not initialize server socket. Exiting.");
         return 1;
     }
 
@@ -28,6 +42,7 @@ int main() {
     Socket_run(server_fd);
 
     // The lines below are now effectively unreachable
-    printf("Server shutting down.\n");
+    LOG_INFO("server", "Server shutting down.");
+    Log_shutdown();
     return 0;
 }
@@ -68,6 +68,20 @@ User* User_read(long id) {
 User* User_read_by_username(const char* username) {
     if (username == NULL) return NULL;
 
+    // Unknown usernames are rejected by the Bloom filter without a scan
+    if (Peach_field_may_contain(USER_COLLECTION, "username", username) == 0) {
+        return NULL;
+    }
+
+    // Known ones are found through the username B+tree...
+    PeachRecordSet* match = Peach_index_scan(USER_COLLECTION, "username", username, username, 1);
+    if (match != NULL) {
+        User* found_user = record_to_user(match->head);
+        Peach_free_record_set(match);
+        return found_user;
+    }
+
+    // ...or, without one, by a scan
     PeachRecordSet* record_set = Peach_read_all_records(USER_COLLECTION);
     if (record_set == NULL) {
         return NULL;
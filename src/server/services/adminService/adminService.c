@@ -0,0 +1,173 @@
+#include "adminService.h"
+#include "../metricsService/metricsService.h"
+#include "../logService/logService.h"
+#include "../peachdb/peachdb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static int g_admin_fd = -1;
+static pthread_t g_admin_thread;
+
+static void send_all(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(sock, data, len);
+        if (written <= 0) return;
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+static void send_response(int sock, const char* status, const char* content_type, const char* body, size_t body_len) {
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 %s\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %zu\r\n"
+                              "Connection: close\r\n\r\n",
+                              status, content_type, body_len);
+    send_all(sock, header, (size_t)header_len);
+    send_all(sock, body, body_len);
+}
+
+static void handle_request(int sock) {
+    char request[1024];
+    ssize_t read_size = recv(sock, request, sizeof(request) - 1, 0);
+    if (read_size <= 0) return;
+    request[read_size] = '\0';
+
+    // Request line: <METHOD> <PATH> HTTP/1.x
+    char method[16] = "";
+    char path[256] = "";
+    if (sscanf(request, "%15s %255s", method, path) != 2) {
+        const char* body = "Bad Request\n";
+        send_response(sock, "400 Bad Request", "text/plain", body, strlen(body));
+        return;
+    }
+
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/metrics") == 0) {
+        size_t len = 0;
+        char* metrics = Metrics_render_prometheus(&len);
+        if (metrics == NULL) {
+            const char* body = "Could not render metrics\n";
+            send_response(sock, "500 Internal Server Error", "text/plain", body, strlen(body));
+            return;
+        }
+        send_response(sock, "200 OK", "text/plain; version=0.0.4", metrics, len);
+        free(metrics);
+    } else if (strcmp(method, "GET") == 0 && strcmp(path, "/loglevel") == 0) {
+        char body[32];
+        int len = snprintf(body, sizeof(body), "%s\n", Log_level_name(Log_get_level()));
+        send_response(sock, "200 OK", "text/plain", body, (size_t)len);
+    } else if ((strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0) && strncmp(path, "/loglevel?level=", 16) == 0) {
+        LogLevel level;
+        if (Log_level_from_name(path + 16, &level) != 0) {
+            const char* body = "Unknown level (expected error, warn, info or debug)\n";
+            send_response(sock, "400 Bad Request", "text/plain", body, strlen(body));
+            return;
+        }
+        Log_set_level(level);
+        LOG_WARN("admin", "Log level changed to %s.", Log_level_name(level));
+        char body[32];
+        int len = snprintf(body, sizeof(body), "%s\n", Log_level_name(level));
+        send_response(sock, "200 OK", "text/plain", body, (size_t)len);
+    } else if (strcmp(method, "GET") == 0 && strcmp(path, "/backup") == 0) {
+        PeachBackupStatus status;
+        Peach_backup_status(&status);
+        char body[512];
+        int len = snprintf(body, sizeof(body),
+                           "running %d\nlast_status %d\ndir %s\nbytes_total %lld\nbytes_copied %lld\n"
+                           "collections_appended %d\ncollections_copied %d\n",
+                           status.running, status.last_status, status.dest_dir, status.bytes_total,
+                           status.bytes_copied, status.collections_appended, status.collections_copied);
+        send_response(sock, "200 OK", "text/plain", body, (size_t)len);
+    } else if (strcmp(method, "POST") == 0 && strncmp(path, "/backup?dir=", 12) == 0) {
+        // /backup?dir=<path>[&full=1]; incremental into an existing backup unless full=1
+        char dest_dir[256];
+        snprintf(dest_dir, sizeof(dest_dir), "%s", path + 12);
+        char* options = strchr(dest_dir, '&');
+        int incremental = 1;
+        if (options != NULL) {
+            incremental = strstr(options, "full=1") == NULL;
+            *options = '\0';
+        }
+        if (dest_dir[0] == '\0' || Peach_backup_start(dest_dir, incremental) != 0) {
+            const char* body = "Could not start backup (see the log)\n";
+            send_response(sock, "409 Conflict", "text/plain", body, strlen(body));
+            return;
+        }
+        LOG_WARN("admin", "%s backup to '%s' started.", incremental ? "Incremental" : "Full", dest_dir);
+        const char* body = "Backup started\n";
+        send_response(sock, "202 Accepted", "text/plain", body, strlen(body));
+    } else if (strcmp(method, "POST") == 0 && strcmp(path, "/indexes/save") == 0) {
+        int saved = Peach_save_indexes();
+        char body[64];
+        int len = snprintf(body, sizeof(body), "saved %d\n", saved);
+        send_response(sock, saved >= 0 ? "200 OK" : "500 Internal Server Error", "text/plain", body, (size_t)len);
+    } else {
+        const char* body = "Not Found\n";
+        send_response(sock, "404 Not Found", "text/plain", body, strlen(body));
+    }
+}
+
+static void* admin_loop(void* arg) {
+    (void)arg;
+    for (;;) {
+        int client_sock = accept(g_admin_fd, NULL, NULL);
+        if (client_sock < 0) {
+            LOG_ERROR("admin", "admin accept failed: %s", strerror(errno));
+            continue;
+        }
+        handle_request(client_sock);
+        close(client_sock);
+    }
+    return NULL;
+}
+
+int AdminService_start(int port) {
+    int opt = 1;
+    struct sockaddr_in address;
+
+    g_admin_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (g_admin_fd < 0) {
+        LOG_ERROR("admin", "admin socket failed: %s", strerror(errno));
+        return -1;
+    }
+    setsockopt(g_admin_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // Loopback only: the admin port must never be reachable from the network
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    if (bind(g_admin_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        LOG_ERROR("admin", "admin bind failed: %s", strerror(errno));
+        close(g_admin_fd);
+        g_admin_fd = -1;
+        return -1;
+    }
+    if (listen(g_admin_fd, 4) < 0) {
+        LOG_ERROR("admin", "admin listen failed: %s", strerror(errno));
+        close(g_admin_fd);
+        g_admin_fd = -1;
+        return -1;
+    }
+
+    if (pthread_create(&g_admin_thread, NULL, admin_loop, NULL) != 0) {
+        LOG_ERROR("admin", "could not create admin thread: %s", strerror(errno));
+        close(g_admin_fd);
+        g_admin_fd = -1;
+        return -1;
+    }
+    pthread_detach(g_admin_thread);
+
+    LOG_INFO("admin", "Admin endpoint listening on 127.0.0.1:%d (GET /metrics, GET|POST /loglevel, GET|POST /backup, POST /indexes/save)", port);
+    return 0;
+}
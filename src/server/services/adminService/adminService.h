@@ -0,0 +1,26 @@
+#ifndef ADMIN_SERVICE_H
+#define ADMIN_SERVICE_H
+
+/*==================[ ADMIN SERVICE ]============================
+ * A tiny HTTP/1.0 endpoint bound to 127.0.0.1 only, for operators and
+ * scrapers running on the server host. It runs on its own thread so it
+ * never competes with client handler threads.
+ *
+ * Routes:
+ *   GET /metrics   Prometheus text exposition of the metrics service
+ *   GET /loglevel  Current log level
+ *   POST /loglevel?level=debug   Changes the log level at runtime
+ *   GET /backup    Progress of the running or last PeachDB backup
+ *   POST /backup?dir=/path[&full=1]   Backs up peachdata/ into /path in the
+ *                  background; incremental if /path holds a previous backup
+ *   POST /indexes/save   Snapshots the built PeachDB indexes for the next start
+ ==========================================================*/
+
+/**
+ * @brief Starts the admin HTTP listener on a background thread.
+ * @param port The loopback port to listen on (e.g., 9108).
+ * @return 0 on success, -1 on failure (and logs the error details).
+ */
+int AdminService_start(int port);
+
+#endif // ADMIN_SERVICE_H
@@ -0,0 +1,187 @@
+#include "deliveryService.h"
+#include "../groupService/groupService.h"
+#include "../logService/logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define CURSOR_COLLECTION "deliverycursors"
+#define MAX_OR_GROUPS 32 // See PeachPredicate.or_group
+
+// Serializes the read-modify-write of cursors
+static pthread_mutex_t g_cursor_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Reads both cursors of a user.
+// Returns 0 if found, 1 if the user has no cursors yet, -1 on failure.
+static int read_cursors(long userId, long* out_dm, long* out_group) {
+    // fields: userId^lastDmId^lastGroupMsgId
+    PeachPredicate by_user = { .field = 0, .op = PEACH_EQ, .number = userId };
+    PeachQuery query = { .where = &by_user, .where_count = 1, .limit = 1, .order = PEACH_ORDER_ASC };
+    PeachRecordSet* rows = Peach_query(CURSOR_COLLECTION, &query);
+    if (rows == NULL) return -1;
+
+    int status = 1;
+    if (rows->head != NULL && rows->head->num_fields >= 3) {
+        *out_dm = atol(rows->head->fields[1]);
+        *out_group = atol(rows->head->fields[2]);
+        status = 0;
+    }
+    Peach_free_record_set(rows);
+    return status;
+}
+
+static int write_cursors(long userId, long dm, long group, bool exists) {
+    char key[32];
+    char record[128];
+    snprintf(key, sizeof(key), "%ld", userId);
+    snprintf(record, sizeof(record), "%ld^%ld^%ld", userId, dm, group);
+    if (exists) {
+        return Peach_update_record(CURSOR_COLLECTION, key, record);
+    }
+    return Peach_write_record(CURSOR_COLLECTION, record);
+}
+
+int DeliveryService_open_user(long userId) {
+    pthread_mutex_lock(&g_cursor_mutex);
+    long dm = 0, group = 0;
+    int status = read_cursors(userId, &dm, &group);
+    if (status == 1) {
+        // Start at the newest messages: everything older was either never
+        // addressed to this user or predates delivery tracking
+        dm = Peach_get_highest_key("messages");
+        group = Peach_get_highest_key("groupmessages");
+        status = (dm < 0 || group < 0) ? -1 : write_cursors(userId, dm, group, false);
+    }
+    pthread_mutex_unlock(&g_cursor_mutex);
+
+    if (status != 0) {
+        LOG_ERROR("delivery", "Could not open delivery cursors of user %ld.", userId);
+    }
+    return status;
+}
+
+// Moves one cursor forward; 'group_cursor' selects which one.
+static int advance_cursor(long userId, long messageId, bool group_cursor) {
+    pthread_mutex_lock(&g_cursor_mutex);
+    long dm = 0, group = 0;
+    int status = read_cursors(userId, &dm, &group);
+    if (status == 0) {
+        long* cursor = group_cursor ? &group : &dm;
+        if (messageId > *cursor) {
+            *cursor = messageId;
+            status = write_cursors(userId, dm, group, true);
+        }
+    } else if (status == 1) {
+        LOG_WARN("delivery", "User %ld acknowledged message %ld without delivery cursors.", userId, messageId);
+        status = -1;
+    }
+    pthread_mutex_unlock(&g_cursor_mutex);
+    return status;
+}
+
+int DeliveryService_ack_dm(long userId, long messageId) {
+    return advance_cursor(userId, messageId, false);
+}
+
+int DeliveryService_ack_group_message(long userId, long messageId) {
+    return advance_cursor(userId, messageId, true);
+}
+
+// Missed rows carry what the client needs to show and acknowledge them
+static const int MISSED_DM_FIELDS[] = { 1, 0, 4, 3 };       // senderId^id^time^message
+static const int MISSED_GROUP_FIELDS[] = { 1, 2, 0, 4, 3 }; // groupId^senderId^id^time^message
+
+PeachRecordSet* DeliveryService_get_missed_dms(long userId) {
+    long dm = 0, group = 0;
+    if (read_cursors(userId, &dm, &group) != 0) return NULL;
+
+    // fields: id^senderId^receiverId^message^time
+    PeachPredicate undelivered[] = {
+        { .field = 2, .op = PEACH_EQ, .number = userId },
+        { .field = 0, .op = PEACH_GT, .number = dm },
+    };
+    PeachQuery query = {
+        .where = undelivered,
+        .where_count = 2,
+        .select = MISSED_DM_FIELDS,
+        .select_count = 4,
+        .limit = DELIVERY_BATCH_SIZE,
+        .order = PEACH_ORDER_ASC
+    };
+    return Peach_query("messages", &query);
+}
+
+// Keeps the first DELIVERY_BATCH_SIZE records whose groupId (field 0) is in 'groups'.
+static void keep_member_groups(PeachRecordSet* messages, const long* groups, int group_count) {
+    PeachRecord** link = &messages->head;
+    messages->record_count = 0;
+    while (*link != NULL) {
+        PeachRecord* record = *link;
+        long groupId = atol(record->fields[0]);
+        bool member = false;
+        for (int i = 0; i < group_count && !member; i++) {
+            member = groups[i] == groupId;
+        }
+        if (member && messages->record_count < DELIVERY_BATCH_SIZE) {
+            messages->record_count++;
+            link = &record->next;
+        } else {
+            *link = record->next;
+            free(record->fields[0]);
+            free(record->fields);
+            free(record);
+        }
+    }
+}
+
+PeachRecordSet* DeliveryService_get_missed_group_messages(long userId) {
+    long dm = 0, group = 0;
+    if (read_cursors(userId, &dm, &group) != 0) return NULL;
+
+    int group_count = 0;
+    long* groups = GroupService_get_user_groups(userId, &group_count);
+    if (groups == NULL || group_count == 0) {
+        free(groups);
+        PeachRecordSet* empty = calloc(1, sizeof(PeachRecordSet));
+        if (empty != NULL) empty->num_fields = 5;
+        return empty;
+    }
+
+    // fields: id^groupId^senderId^message^time
+    // One OR group per joined group: groupId = g AND id > cursor AND senderId != user
+    bool pushdown = group_count <= MAX_OR_GROUPS;
+    int where_count = pushdown ? group_count * 3 : 2;
+    PeachPredicate* where = calloc((size_t)where_count, sizeof(PeachPredicate));
+    if (where == NULL) {
+        free(groups);
+        return NULL;
+    }
+    if (pushdown) {
+        for (int i = 0; i < group_count; i++) {
+            where[i * 3 + 0] = (PeachPredicate){ .field = 1, .op = PEACH_EQ, .number = groups[i], .or_group = i };
+            where[i * 3 + 1] = (PeachPredicate){ .field = 0, .op = PEACH_GT, .number = group, .or_group = i };
+            where[i * 3 + 2] = (PeachPredicate){ .field = 2, .op = PEACH_NE, .number = userId, .or_group = i };
+        }
+    } else {
+        // Too many groups for one query: filter membership after the scan
+        where[0] = (PeachPredicate){ .field = 0, .op = PEACH_GT, .number = group };
+        where[1] = (PeachPredicate){ .field = 2, .op = PEACH_NE, .number = userId };
+    }
+
+    PeachQuery query = {
+        .where = where,
+        .where_count = where_count,
+        .select = MISSED_GROUP_FIELDS,
+        .select_count = 5,
+        .limit = pushdown ? DELIVERY_BATCH_SIZE : 0,
+        .order = PEACH_ORDER_ASC
+    };
+    PeachRecordSet* messages = Peach_query("groupmessages", &query);
+    if (messages != NULL && !pushdown) {
+        keep_member_groups(messages, groups, group_count);
+    }
+    free(where);
+    free(groups);
+    return messages;
+}
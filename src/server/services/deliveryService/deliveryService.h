@@ -0,0 +1,67 @@
+#ifndef DELIVERY_SERVICE_H
+#define DELIVERY_SERVICE_H
+
+#include "../peachdb/peachdb.h" // For PeachRecordSet
+
+/*==================[ DELIVERY CURSORS ]==========================
+ * Remembers, per user, the newest direct message and the newest group
+ * message that the user's client acknowledged (ACK_DM / ACK_GROUP_MSG).
+ * Every newer message addressed to the user is undelivered: it was saved
+ * while the user was offline, or its push was lost. Undelivered messages
+ * are streamed in one MISSED_DATA batch right after LOGIN_SUCCESS.
+ *
+ * Collection: deliverycursors(userId^lastDmId^lastGroupMsgId)
+ * Message ids only grow, so a cursor is a single id per kind.
+ ==========================================================*/
+
+// Maximum number of messages of each kind in one MISSED_DATA batch
+#define DELIVERY_BATCH_SIZE 100
+
+/**
+ * @brief Creates the cursors of a user if they do not exist yet.
+ * New cursors start at the newest existing messages, so a user only
+ * receives messages sent after the cursors were created.
+ * @param userId The ID of the user.
+ * @return 0 on success, -1 on failure.
+ */
+int DeliveryService_open_user(long userId);
+
+/**
+ * @brief Records that a user's client received a direct message.
+ * Acknowledgements of older messages than the cursor are ignored. A client
+ * still fetching MISSED_DATA batches must not acknowledge live pushes until
+ * the last one: the cursor would move past the batches not fetched yet.
+ * @param userId The ID of the receiving user.
+ * @param messageId The ID of the acknowledged message.
+ * @return 0 on success, -1 on failure.
+ */
+int DeliveryService_ack_dm(long userId, long messageId);
+
+/**
+ * @brief Records that a user's client received a group message.
+ * @param userId The ID of the receiving user.
+ * @param messageId The ID of the acknowledged group message.
+ * @return 0 on success, -1 on failure.
+ */
+int DeliveryService_ack_group_message(long userId, long messageId);
+
+/**
+ * @brief Retrieves the oldest undelivered direct messages of a user.
+ * @param userId The ID of the user.
+ * @return Up to DELIVERY_BATCH_SIZE messages in chronological order, each with
+ *         the fields senderId^id^time^message, or NULL on failure.
+ *         The caller is responsible for freeing the record set.
+ */
+PeachRecordSet* DeliveryService_get_missed_dms(long userId);
+
+/**
+ * @brief Retrieves the oldest undelivered messages of the user's groups,
+ *        excluding the user's own messages.
+ * @param userId The ID of the user.
+ * @return Up to DELIVERY_BATCH_SIZE messages in chronological order, each with
+ *         the fields groupId^senderId^id^time^message, or NULL on failure.
+ *         The caller is responsible for freeing the record set.
+ */
+PeachRecordSet* DeliveryService_get_missed_group_messages(long userId);
+
+#endif // DELIVERY_SERVICE_H
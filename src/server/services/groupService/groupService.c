@@ -1,5 +1,6 @@
 #include "groupService.h"
 #include "../peachdb/peachdb.h"
+#include "../logService/logService.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -17,7 +18,7 @@ long GroupService_create_group(const char* groupName, long ownerId) {
     snprintf(group_record_str, sizeof(group_record_str), "%ld^%s^%ld", new_groupId, groupName, ownerId);
 
     if (Peach_write_record("groups", group_record_str) != 0) {
-        fprintf(stderr, "GroupService Error: Failed to write to 'groups' collection.\n");
+        LOG_ERROR("group", "Failed to write to 'groups' collection.");
         return -1;
     }
 
@@ -28,16 +29,16 @@ long GroupService_create_group(const char* groupName, long ownerId) {
     snprintf(groupuser_record_str, sizeof(groupuser_record_str), "%ld^%ld^%ld", new_groupusers_id, new_groupId, ownerId);
 
     if (Peach_write_record("groupusers", groupuser_record_str) != 0) {
-        fprintf(stderr, "GroupService Warning: Created group '%s' (%ld), but failed to add owner as member.\n", groupName, new_groupId);
+        LOG_WARN("group", "Created group '%s' (%ld), but failed to add owner as member.", groupName, new_groupId);
         // In a real database, we would roll back the previous insert.
         // Here, we accept the inconsistent state but still return the group ID.
     }
 
-    printf("GroupService: Created group '%s' with ID %ld. Owner %ld added.\n", groupName, new_groupId, ownerId);
+    LOG_INFO("group", "Created group '%s' with ID %ld. Owner %ld added.", groupName, new_groupId, ownerId);
     return new_groupId;
 }
 
-long GroupService_save_group_message(long groupId, long senderId, const char* message) {
+long GroupService_save_group_message(long groupId, long senderId, const char* message, char* out_time) {
     if (message == NULL || strlen(message) == 0) {
         return -1;
     }
@@ -58,67 +59,39 @@ long GroupService_save_group_message(long groupId, long senderId, const char* me
 
     // 4. Write the record to the database
     if (Peach_write_record("groupmessages", record_str) != 0) {
-        fprintf(stderr, "GroupService Error: Failed to write group message to database.\n");
+        LOG_ERROR("group", "Failed to write group message to database.");
         return -1;
     }
 
+    if (out_time != NULL) strcpy(out_time, time_str);
     return next_id;
 }
 
 PeachRecordSet* GroupService_get_group_members(long groupId) {
-    PeachRecordSet* all_records = Peach_read_all_records("groupusers");
-    if (all_records == NULL) {
-        return NULL;
-    }
-
-    PeachRecordSet* filtered_set = calloc(1, sizeof(PeachRecordSet));
-    if (filtered_set == NULL) {
-        Peach_free_record_set(all_records);
-        return NULL;
-    }
-
-    filtered_set->num_fields = all_records->num_fields;
-    PeachRecord* filtered_tail = NULL;
-
-    PeachRecord* current = all_records->head;
-    PeachRecord* next = NULL;
-
-    while (current != NULL) {
-        next = current->next;
-        
-        // The second field (index 1) is groupId
-        long record_groupId = atol(current->fields[1]);
-
-        if (record_groupId == groupId) {
-            // Match found, move the node to the filtered list
-            if (filtered_set->head == NULL) {
-                filtered_set->head = current;
-            } else {
-                filtered_tail->next = current;
-            }
-            filtered_tail = current;
-            current->next = NULL; // Unlink from any subsequent nodes
-            filtered_set->record_count++;
-        } else {
-            // No match, free this record completely
-            free(current->fields[0]); // The data string
-            free(current->fields);    // The array of pointers
-            free(current);            // The node struct
-        }
-        current = next;
-    }
-
-    // Free the original container struct (its nodes have been either moved or freed)
-    free(all_records);
+    // fields: id^groupId^userId
+    PeachPredicate in_group = { .field = 1, .op = PEACH_EQ, .number = groupId };
+    PeachQuery query = { .where = &in_group, .where_count = 1, .order = PEACH_ORDER_ASC };
+    return Peach_query("groupusers", &query);
+}
 
-    return filtered_set;
+bool GroupService_is_member(long groupId, long userId) {
+    // fields: id^groupId^userId
+    PeachPredicate membership[] = {
+        { .field = 1, .op = PEACH_EQ, .number = groupId },
+        { .field = 2, .op = PEACH_EQ, .number = userId },
+    };
+    PeachQuery query = { .where = membership, .where_count = 2, .limit = 1, .order = PEACH_ORDER_ASC };
+    PeachRecordSet* rows = Peach_query("groupusers", &query);
+    bool member = rows != NULL && rows->head != NULL;
+    Peach_free_record_set(rows);
+    return member;
 }
 
 int GroupService_join_group(long groupId, long userId) {
     // First check if group exists
     char group_name[256];
     if (GroupService_get_group_name(groupId, group_name, sizeof(group_name)) != 0) {
-        fprintf(stderr, "GroupService Error: Group %ld not found.\n", groupId);
+        LOG_ERROR("group", "Group %ld not found.", groupId);
         return -1;
     }
 
@@ -129,7 +102,7 @@ int GroupService_join_group(long groupId, long userId) {
             long member_userId = atol(rec->fields[2]); // userId is the 3rd field
             if (member_userId == userId) {
                 Peach_free_record_set(members);
-                fprintf(stderr, "GroupService: User %ld already in group %ld.\n", userId, groupId);
+                LOG_WARN("group", "User %ld already in group %ld.", userId, groupId);
                 return -1; // Already a member
             }
         }
@@ -142,11 +115,11 @@ int GroupService_join_group(long groupId, long userId) {
     snprintf(record_str, sizeof(record_str), "%ld^%ld^%ld", new_id, groupId, userId);
 
     if (Peach_write_record("groupusers", record_str) != 0) {
-        fprintf(stderr, "GroupService Error: Failed to add user to group.\n");
+        LOG_ERROR("group", "Failed to add user to group.");
         return -1;
     }
 
-    printf("GroupService: User %ld joined group %ld.\n", userId, groupId);
+    LOG_INFO("group", "User %ld joined group %ld.", userId, groupId);
     return 0;
 }
 
@@ -208,47 +181,57 @@ int GroupService_get_group_name(long groupId, char* out_name, int buffer_size) {
     return found;
 }
 
-PeachRecordSet* GroupService_get_group_history(long groupId) {
-    PeachRecordSet* all_records = Peach_read_all_records("groupmessages");
-    if (all_records == NULL) {
-        return NULL;
-    }
-
-    PeachRecordSet* filtered_set = calloc(1, sizeof(PeachRecordSet));
-    if (filtered_set == NULL) {
-        Peach_free_record_set(all_records);
-        return NULL;
-    }
-
-    filtered_set->num_fields = all_records->num_fields;
-    PeachRecord* filtered_tail = NULL;
+// History rows only carry what the client displays: senderId^message^time
+static const int GROUP_HISTORY_FIELDS[] = { 2, 3, 4 };
 
-    PeachRecord* current = all_records->head;
-    PeachRecord* next = NULL;
-
-    while (current != NULL) {
-        next = current->next;
-        
-        // fields: id^groupId^senderId^message^time
-        long record_groupId = atol(current->fields[1]);
+PeachRecordSet* GroupService_get_group_history(long groupId) {
+    // fields: id^groupId^senderId^message^time
+    PeachPredicate in_group = { .field = 1, .op = PEACH_EQ, .number = groupId };
+    PeachQuery query = {
+        .where = &in_group,
+        .where_count = 1,
+        .select = GROUP_HISTORY_FIELDS,
+        .select_count = 3,
+        .limit = GROUP_HISTORY_PAGE_SIZE,
+        .order = PEACH_ORDER_TAIL
+    };
+    return Peach_query("groupmessages", &query);
+}
 
-        if (record_groupId == groupId) {
-            if (filtered_set->head == NULL) {
-                filtered_set->head = current;
-            } else {
-                filtered_tail->next = current;
-            }
-            filtered_tail = current;
-            current->next = NULL;
-            filtered_set->record_count++;
-        } else {
-            free(current->fields[0]);
-            free(current->fields);
-            free(current);
-        }
-        current = next;
-    }
+// Catch-up rows also carry the id: senderId^message^time^id
+static const int GROUP_SINCE_FIELDS[] = { 2, 3, 4, 0 };
+
+PeachRecordSet* GroupService_get_group_history_since(long groupId, const char* since) {
+    if (since == NULL) return NULL;
+    // fields: id^groupId^senderId^message^time
+    PeachPredicate in_group_since[] = {
+        { .field = 4, .op = PEACH_GE, .text = since },
+        { .field = 1, .op = PEACH_EQ, .number = groupId },
+    };
+    PeachQuery query = {
+        .where = in_group_since,
+        .where_count = 2,
+        .select = GROUP_SINCE_FIELDS,
+        .select_count = 4,
+        .limit = GROUP_HISTORY_PAGE_SIZE,
+        .order = PEACH_ORDER_ASC
+    };
+    return Peach_query("groupmessages", &query);
+}
 
-    free(all_records);
-    return filtered_set;
+PeachRecordSet* GroupService_get_group_history_before(long groupId, long beforeId) {
+    // fields: id^groupId^senderId^message^time
+    PeachPredicate in_group_before[] = {
+        { .field = 0, .op = PEACH_LT, .number = beforeId },
+        { .field = 1, .op = PEACH_EQ, .number = groupId },
+    };
+    PeachQuery query = {
+        .where = in_group_before,
+        .where_count = 2,
+        .select = GROUP_SINCE_FIELDS,
+        .select_count = 4,
+        .limit = GROUP_HISTORY_PAGE_SIZE,
+        .order = PEACH_ORDER_TAIL
+    };
+    return Peach_query("groupmessages", &query);
 }
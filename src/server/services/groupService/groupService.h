@@ -1,8 +1,12 @@
 #ifndef GROUP_SERVICE_H
 #define GROUP_SERVICE_H
 
+#include <stdbool.h>
 #include "../peachdb/peachdb.h" // For PeachRecordSet
 
+// Number of most recent messages returned by a group history request
+#define GROUP_HISTORY_PAGE_SIZE 100
+
 /**
  * @brief Creates a new group and adds the owner as the first member.
  * 
@@ -18,9 +22,11 @@ long GroupService_create_group(const char* groupName, long ownerId);
  * @param groupId The ID of the group receiving the message.
  * @param senderId The ID of the user sending the message.
  * @param message The content of the message.
+ * @param out_time Receives the time the message was saved at, formatted
+ *        "YYYY-MM-DD HH:MM:SS" (at least 20 bytes); may be NULL.
  * @return The ID of the newly created message on success, or -1 on failure.
  */
-long GroupService_save_group_message(long groupId, long senderId, const char* message);
+long GroupService_save_group_message(long groupId, long senderId, const char* message, char* out_time);
 
 /**
  * @brief Retrieves all members of a specific group.
@@ -31,6 +37,15 @@ long GroupService_save_group_message(long groupId, long senderId, const char* me
  */
 PeachRecordSet* GroupService_get_group_members(long groupId);
 
+/**
+ * @brief Checks whether a user is a member of a group.
+ * 
+ * @param groupId The ID of the group.
+ * @param userId The ID of the user.
+ * @return true if the user is a member, false otherwise (or on failure).
+ */
+bool GroupService_is_member(long groupId, long userId);
+
 /**
  * @brief Joins a user to an existing group.
  * 
@@ -60,11 +75,35 @@ long* GroupService_get_user_groups(long userId, int* count);
 int GroupService_get_group_name(long groupId, char* out_name, int buffer_size);
 
 /**
- * @brief Retrieves message history for a group.
+ * @brief Retrieves the latest GROUP_HISTORY_PAGE_SIZE messages of a group.
  * 
  * @param groupId The ID of the group.
- * @return A PeachRecordSet containing messages, or NULL on failure.
+ * @return A PeachRecordSet of the messages in chronological order, each with
+ *         the fields senderId^message^time, or NULL on failure.
  */
 PeachRecordSet* GroupService_get_group_history(long groupId);
 
+/**
+ * @brief Retrieves the messages of a group sent at or after a point in time.
+ * At most GROUP_HISTORY_PAGE_SIZE messages are returned; the caller fetches
+ * the next page from the time of the last one.
+ *
+ * @param groupId The ID of the group.
+ * @param since The earliest time, formatted "YYYY-MM-DD HH:MM:SS" (inclusive).
+ * @return A PeachRecordSet of the messages in chronological order, each with
+ *         the fields senderId^message^time^id, or NULL on failure.
+ */
+PeachRecordSet* GroupService_get_group_history_since(long groupId, const char* since);
+
+/**
+ * @brief Retrieves the page of messages of a group that precedes a message.
+ *
+ * @param groupId The ID of the group.
+ * @param beforeId Only messages with a smaller ID are returned.
+ * @return A PeachRecordSet of at most GROUP_HISTORY_PAGE_SIZE messages in
+ *         chronological order, each with the fields senderId^message^time^id,
+ *         or NULL on failure.
+ */
+PeachRecordSet* GroupService_get_group_history_before(long groupId, long beforeId);
+
 #endif // GROUP_SERVICE_H
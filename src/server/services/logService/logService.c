@@ -0,0 +1,339 @@
+#include "logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // For strcasecmp
+#include <stdarg.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_RING_CAPACITY 128 // Entries per thread, must be a power of two
+#define LOG_MESSAGE_MAX 256
+#define LOG_FLUSH_INTERVAL_MS 10
+
+typedef struct {
+    uint64_t ts_us;       // Wall-clock time, microseconds since the epoch
+    uint8_t level;
+    const char* module;   // Static string, never copied
+    int thread_id;
+    char message[LOG_MESSAGE_MAX];
+} LogEntry;
+
+// Single-producer (owning thread) / single-consumer (flusher) ring.
+typedef struct LogRing {
+    LogEntry entries[LOG_RING_CAPACITY];
+    _Atomic uint64_t head;   // Next slot the producer writes
+    _Atomic uint64_t tail;   // Next slot the flusher reads
+    _Atomic bool retired;    // Owning thread has exited
+    int thread_id;
+    struct LogRing* next;
+} LogRing;
+
+_Atomic int g_log_level = LOG_LEVEL_INFO;
+
+static _Atomic int g_log_format = LOG_FORMAT_TEXT;
+static _Atomic bool g_flusher_running = false;
+static _Atomic bool g_stop_requested = false;
+static _Atomic uint64_t g_dropped = 0;
+static _Atomic int g_next_thread_id = 1;
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_ring_key;
+static pthread_mutex_t g_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LogRing* g_rings = NULL; // Protected by g_rings_mutex
+static pthread_t g_flusher_thread;
+
+static __thread LogRing* t_ring = NULL;
+static __thread int t_thread_id = 0;
+
+static const char* LEVEL_NAMES[] = { "error", "warn", "info", "debug" };
+static const char* LEVEL_LABELS[] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
+
+static uint64_t wall_clock_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static int current_thread_id() {
+    if (t_thread_id == 0) {
+        t_thread_id = atomic_fetch_add(&g_next_thread_id, 1);
+    }
+    return t_thread_id;
+}
+
+// pthread key destructor: the flusher frees the ring once it is drained.
+static void retire_ring(void* arg) {
+    LogRing* ring = (LogRing*)arg;
+    if (ring != NULL) {
+        atomic_store_explicit(&ring->retired, true, memory_order_release);
+    }
+}
+
+static void init_once() {
+    pthread_key_create(&g_ring_key, retire_ring);
+}
+
+static LogRing* get_ring() {
+    if (t_ring != NULL) return t_ring;
+
+    pthread_once(&g_once, init_once);
+    LogRing* ring = calloc(1, sizeof(LogRing));
+    if (ring == NULL) return NULL;
+    ring->thread_id = current_thread_id();
+
+    pthread_mutex_lock(&g_rings_mutex);
+    ring->next = g_rings;
+    g_rings = ring;
+    pthread_mutex_unlock(&g_rings_mutex);
+
+    pthread_setspecific(g_ring_key, ring);
+    t_ring = ring;
+    return ring;
+}
+
+// --- Formatting (flusher side) ---
+
+static size_t format_timestamp(uint64_t ts_us, char* out, size_t size) {
+    time_t seconds = (time_t)(ts_us / 1000000ULL);
+    struct tm tm_utc;
+    gmtime_r(&seconds, &tm_utc);
+    size_t len = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &tm_utc);
+    len += (size_t)snprintf(out + len, size - len, ".%06uZ", (unsigned)(ts_us % 1000000ULL));
+    return len;
+}
+
+static size_t json_escape(const char* in, char* out, size_t size) {
+    size_t len = 0;
+    for (const unsigned char* p = (const unsigned char*)in; *p != '\0' && len + 7 < size; p++) {
+        if (*p == '"' || *p == '\\') {
+            out[len++] = '\\';
+            out[len++] = (char)*p;
+        } else if (*p < 0x20) {
+            len += (size_t)snprintf(out + len, size - len, "\\u%04x", *p);
+        } else {
+            out[len++] = (char)*p;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static int format_entry(const LogEntry* entry, char* out, size_t size) {
+    char ts[40];
+    format_timestamp(entry->ts_us, ts, sizeof(ts));
+    int level = entry->level <= LOG_LEVEL_DEBUG ? entry->level : LOG_LEVEL_DEBUG;
+
+    if (atomic_load_explicit(&g_log_format, memory_order_relaxed) == LOG_FORMAT_JSON) {
+        char escaped[LOG_MESSAGE_MAX * 6 + 1];
+        json_escape(entry->message, escaped, sizeof(escaped));
+        return snprintf(out, size, "{\"ts\":\"%s\",\"level\":\"%s\",\"module\":\"%s\",\"tid\":%d,\"msg\":\"%s\"}\n",
+                        ts, LEVEL_NAMES[level], entry->module, entry->thread_id, escaped);
+    }
+    return snprintf(out, size, "%s %s [%s] t=%d %s\n",
+                    ts, LEVEL_LABELS[level], entry->module, entry->thread_id, entry->message);
+}
+
+static void write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written <= 0) return;
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+static void write_entry_sync(const LogEntry* entry) {
+    char line[LOG_MESSAGE_MAX * 6 + 128];
+    int len = format_entry(entry, line, sizeof(line));
+    if (len > 0) {
+        write_all(STDERR_FILENO, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+    }
+}
+
+void Log_write(LogLevel level, const char* module, const char* fmt, ...) {
+    LogEntry local;
+    LogRing* ring = atomic_load_explicit(&g_flusher_running, memory_order_acquire) ? get_ring() : NULL;
+    LogEntry* entry = &local;
+    uint64_t head = 0;
+
+    if (ring != NULL) {
+        head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - tail >= LOG_RING_CAPACITY) {
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+            return; // Never block the caller
+        }
+        entry = &ring->entries[head & (LOG_RING_CAPACITY - 1)];
+    }
+
+    entry->ts_us = wall_clock_us();
+    entry->level = (uint8_t)level;
+    entry->module = module != NULL ? module : "-";
+    entry->thread_id = current_thread_id();
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(entry->message, sizeof(entry->message), fmt, args);
+    va_end(args);
+
+    if (ring != NULL) {
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    } else {
+        write_entry_sync(entry);
+    }
+}
+
+// --- Flusher ---
+
+typedef struct {
+    LogEntry* items;
+    size_t count;
+    size_t capacity;
+} LogBatch;
+
+static int compare_entries(const void* a, const void* b) {
+    const LogEntry* ea = (const LogEntry*)a;
+    const LogEntry* eb = (const LogEntry*)b;
+    if (ea->ts_us != eb->ts_us) return ea->ts_us < eb->ts_us ? -1 : 1;
+    return ea->thread_id - eb->thread_id;
+}
+
+static void drain_ring(LogRing* ring, LogBatch* batch) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (tail < head) {
+        if (batch->count == batch->capacity) {
+            size_t new_capacity = batch->capacity ? batch->capacity * 2 : 256;
+            LogEntry* grown = realloc(batch->items, new_capacity * sizeof(LogEntry));
+            if (grown == NULL) break;
+            batch->items = grown;
+            batch->capacity = new_capacity;
+        }
+        batch->items[batch->count++] = ring->entries[tail & (LOG_RING_CAPACITY - 1)];
+        tail++;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+}
+
+static void flush_once(LogBatch* batch) {
+    batch->count = 0;
+
+    pthread_mutex_lock(&g_rings_mutex);
+    LogRing** link = &g_rings;
+    while (*link != NULL) {
+        LogRing* ring = *link;
+        bool retired = atomic_load_explicit(&ring->retired, memory_order_acquire);
+        drain_ring(ring, batch);
+        if (retired && atomic_load_explicit(&ring->tail, memory_order_relaxed) == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&g_rings_mutex);
+
+    uint64_t dropped = atomic_exchange_explicit(&g_dropped, 0, memory_order_relaxed);
+    if (batch->count == 0 && dropped == 0) return;
+
+    qsort(batch->items, batch->count, sizeof(LogEntry), compare_entries);
+
+    // One write per batch
+    size_t out_cap = (batch->count + 1) * (LOG_MESSAGE_MAX + 128);
+    char* out = malloc(out_cap);
+    if (out == NULL) return;
+    size_t out_len = 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        int len = format_entry(&batch->items[i], out + out_len, out_cap - out_len);
+        if (len > 0 && out_len + (size_t)len < out_cap) out_len += (size_t)len;
+    }
+    if (dropped > 0) {
+        LogEntry notice = { .ts_us = wall_clock_us(), .level = LOG_LEVEL_WARN, .module = "log", .thread_id = 0 };
+        snprintf(notice.message, sizeof(notice.message), "Dropped %llu log entries (ring buffers full).", (unsigned long long)dropped);
+        int len = format_entry(&notice, out + out_len, out_cap - out_len);
+        if (len > 0 && out_len + (size_t)len < out_cap) out_len += (size_t)len;
+    }
+    write_all(STDERR_FILENO, out, out_len);
+    free(out);
+}
+
+static void* flusher_main(void* arg) {
+    (void)arg;
+    LogBatch batch = {0};
+    struct timespec interval = { 0, LOG_FLUSH_INTERVAL_MS * 1000000L };
+
+    while (!atomic_load_explicit(&g_stop_requested, memory_order_acquire)) {
+        flush_once(&batch);
+        nanosleep(&interval, NULL);
+    }
+    flush_once(&batch); // Final drain
+    free(batch.items);
+    return NULL;
+}
+
+int Log_init() {
+    pthread_once(&g_once, init_once);
+
+    LogLevel level;
+    const char* env_level = getenv("YAHUU_LOG_LEVEL");
+    if (env_level != NULL && Log_level_from_name(env_level, &level) == 0) {
+        Log_set_level(level);
+    }
+    const char* env_format = getenv("YAHUU_LOG_FORMAT");
+    if (env_format != NULL && strcmp(env_format, "json") == 0) {
+        Log_set_format(LOG_FORMAT_JSON);
+    }
+
+    if (atomic_load(&g_flusher_running)) return 0;
+    atomic_store(&g_stop_requested, false);
+    if (pthread_create(&g_flusher_thread, NULL, flusher_main, NULL) != 0) {
+        LOG_ERROR("log", "Could not start the log flusher thread; logging stays synchronous.");
+        return -1;
+    }
+    atomic_store_explicit(&g_flusher_running, true, memory_order_release);
+    return 0;
+}
+
+void Log_shutdown() {
+    if (!atomic_load(&g_flusher_running)) return;
+    atomic_store_explicit(&g_flusher_running, false, memory_order_release);
+    atomic_store_explicit(&g_stop_requested, true, memory_order_release);
+    pthread_join(g_flusher_thread, NULL);
+}
+
+void Log_set_level(LogLevel level) {
+    if (level < LOG_LEVEL_ERROR) level = LOG_LEVEL_ERROR;
+    if (level > LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    atomic_store_explicit(&g_log_level, (int)level, memory_order_relaxed);
+}
+
+LogLevel Log_get_level() {
+    return (LogLevel)atomic_load_explicit(&g_log_level, memory_order_relaxed);
+}
+
+void Log_set_format(LogFormat format) {
+    atomic_store_explicit(&g_log_format, (int)format, memory_order_relaxed);
+}
+
+int Log_level_from_name(const char* name, LogLevel* out_level) {
+    if (name == NULL || out_level == NULL) return -1;
+    for (int i = LOG_LEVEL_ERROR; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcasecmp(name, LEVEL_NAMES[i]) == 0) {
+            *out_level = (LogLevel)i;
+            return 0;
+        }
+    }
+    if (strcasecmp(name, "warning") == 0) {
+        *out_level = LOG_LEVEL_WARN;
+        return 0;
+    }
+    return -1;
+}
+
+const char* Log_level_name(LogLevel level) {
+    if (level < LOG_LEVEL_ERROR || level > LOG_LEVEL_DEBUG) return "unknown";
+    return LEVEL_NAMES[level];
+}
@@ -0,0 +1,108 @@
+#ifndef LOG_SERVICE_H
+#define LOG_SERVICE_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*==================[ LOG SERVICE ]==============================
+ * Asynchronous, structured logging for the server.
+ *
+ * Every logging thread owns a lock-free single-producer ring buffer.
+ * A background flusher drains all rings every few milliseconds, orders
+ * the batch by timestamp and writes it with a single write per batch,
+ * so handler threads never wait on stdout/stderr locks.
+ *
+ * Levels can be changed at runtime (Log_set_level, or the admin
+ * endpoint). The LOG_* macros check the level *before* evaluating and
+ * formatting their arguments, so disabled levels cost one relaxed load.
+ * A full ring drops the entry (counted, reported by the flusher) rather
+ * than blocking the caller.
+ *
+ * Until Log_init() has started the flusher (e.g., in the benchmark or
+ * the PeachDB test), entries are written synchronously to stderr.
+ *
+ * Environment (read by Log_init):
+ *   YAHUU_LOG_LEVEL   error | warn | info | debug   (default: info)
+ *   YAHUU_LOG_FORMAT  text | json                   (default: text)
+ ==========================================================*/
+
+typedef enum {
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN  = 1,
+    LOG_LEVEL_INFO  = 2,
+    LOG_LEVEL_DEBUG = 3
+} LogLevel;
+
+typedef enum {
+    LOG_FORMAT_TEXT, // 2026-01-01T10:00:00.000000Z INFO  [socket] t=3 message
+    LOG_FORMAT_JSON  // {"ts":"...","level":"info","module":"socket","tid":3,"msg":"..."}
+} LogFormat;
+
+extern _Atomic int g_log_level;
+
+#define LOG_AT(level, module, ...) \
+    do { \
+        if (Log_enabled(level)) Log_write((level), (module), __VA_ARGS__); \
+    } while (0)
+
+#define LOG_ERROR(module, ...) LOG_AT(LOG_LEVEL_ERROR, module, __VA_ARGS__)
+#define LOG_WARN(module, ...)  LOG_AT(LOG_LEVEL_WARN, module, __VA_ARGS__)
+#define LOG_INFO(module, ...)  LOG_AT(LOG_LEVEL_INFO, module, __VA_ARGS__)
+#define LOG_DEBUG(module, ...) LOG_AT(LOG_LEVEL_DEBUG, module, __VA_ARGS__)
+
+/**
+ * @brief Returns true if messages at the given level are currently emitted.
+ */
+static inline bool Log_enabled(LogLevel level) {
+    return (int)level <= atomic_load_explicit(&g_log_level, memory_order_relaxed);
+}
+
+/**
+ * @brief Reads the environment configuration and starts the background flusher.
+ * Must be called once on server startup.
+ * @return 0 on success, -1 if the flusher thread could not be started
+ *         (logging then stays synchronous).
+ */
+int Log_init();
+
+/**
+ * @brief Drains all pending entries and stops the flusher thread.
+ */
+void Log_shutdown();
+
+/**
+ * @brief Formats a message into the calling thread's ring buffer.
+ * Prefer the LOG_* macros, which skip formatting for disabled levels.
+ * @param level The severity of the message.
+ * @param module A static string naming the subsystem (e.g., "peachdb").
+ * @param fmt printf-style format string.
+ */
+void Log_write(LogLevel level, const char* module, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Changes the minimum level that is emitted, effective immediately.
+ */
+void Log_set_level(LogLevel level);
+
+/**
+ * @brief Returns the current minimum level.
+ */
+LogLevel Log_get_level();
+
+/**
+ * @brief Selects the output format.
+ */
+void Log_set_format(LogFormat format);
+
+/**
+ * @brief Parses a level name ("error", "warn", "info", "debug").
+ * @return 0 on success, -1 if the name is not recognized.
+ */
+int Log_level_from_name(const char* name, LogLevel* out_level);
+
+/**
+ * @brief Returns the lowercase name of a level.
+ */
+const char* Log_level_name(LogLevel level);
+
+#endif // LOG_SERVICE_H
@@ -1,11 +1,12 @@
 #include "messageService.h"
 #include "../peachdb/peachdb.h"
+#include "../logService/logService.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
 
-long MessageService_save_dm(long senderId, long receiverId, const char* message) {
+long MessageService_save_dm(long senderId, long receiverId, const char* message, char* out_time) {
     if (message == NULL || strlen(message) == 0) {
         return -1;
     }
@@ -27,64 +28,84 @@ long MessageService_save_dm(long senderId, long receiverId, const char* message)
 
     // 4. Write the record to the database
     if (Peach_write_record("messages", record_str) != 0) {
-        fprintf(stderr, "MessageService Error: Failed to write direct message to database.\n");
+        LOG_ERROR("message", "Failed to write direct message to database.");
         return -1;
     }
 
+    if (out_time != NULL) strcpy(out_time, time_str);
     return next_id; // Return the new message ID on success
 }
 
-PeachRecordSet* MessageService_get_history(long userId1, long userId2) {
-    PeachRecordSet* all_records = Peach_read_all_records("messages");
-    if (all_records == NULL) {
-        return NULL;
-    }
-
-    PeachRecordSet* filtered_set = calloc(1, sizeof(PeachRecordSet));
-    if (filtered_set == NULL) {
-        Peach_free_record_set(all_records);
-        return NULL;
-    }
-
-    filtered_set->num_fields = all_records->num_fields;
-    PeachRecord* filtered_tail = NULL;
-
-    PeachRecord* current = all_records->head;
-    PeachRecord* next = NULL;
+// History rows only carry what the client displays: senderId^message^time
+static const int HISTORY_FIELDS[] = { 1, 3, 4 };
 
-    while (current != NULL) {
-        next = current->next;
-        
-        // fields: id^senderId^receiverId^message^time
-        long senderId = atol(current->fields[1]);
-        long receiverId = atol(current->fields[2]);
-
-        bool is_match = (senderId == userId1 && receiverId == userId2) ||
-                        (senderId == userId2 && receiverId == userId1);
-
-        if (is_match) {
-            // Match found, move the node to the filtered list
-            if (filtered_set->head == NULL) {
-                filtered_set->head = current;
-            } else {
-                filtered_tail->next = current;
-            }
-            filtered_tail = current;
-            current->next = NULL; // Unlink from any subsequent nodes
-            filtered_set->record_count++;
-        } else {
-            // No match, free this record completely
-            free(current->fields[0]); // The data string
-            free(current->fields);    // The array of pointers
-            free(current);            // The node struct
-        }
-        current = next;
-    }
+PeachRecordSet* MessageService_get_history(long userId1, long userId2) {
+    // fields: id^senderId^receiverId^message^time
+    // (sender = 1 AND receiver = 2) OR (sender = 2 AND receiver = 1)
+    PeachPredicate conversation[] = {
+        { .field = 1, .op = PEACH_EQ, .number = userId1, .or_group = 0 },
+        { .field = 2, .op = PEACH_EQ, .number = userId2, .or_group = 0 },
+        { .field = 1, .op = PEACH_EQ, .number = userId2, .or_group = 1 },
+        { .field = 2, .op = PEACH_EQ, .number = userId1, .or_group = 1 },
+    };
+    PeachQuery query = {
+        .where = conversation,
+        .where_count = 4,
+        .select = HISTORY_FIELDS,
+        .select_count = 3,
+        .limit = MESSAGE_HISTORY_PAGE_SIZE,
+        .order = PEACH_ORDER_TAIL
+    };
+    return Peach_query("messages", &query);
+}
 
-    // Free the original container struct
-    free(all_records);
+// Catch-up rows also carry the id, so a client can drop the messages of the
+// boundary second it already has
+static const int SINCE_FIELDS[] = { 1, 3, 4, 0 };
+
+PeachRecordSet* MessageService_get_history_since(long userId1, long userId2, const char* since) {
+    if (since == NULL) return NULL;
+    // fields: id^senderId^receiverId^message^time
+    // time >= since AND ((sender = 1 AND receiver = 2) OR (sender = 2 AND receiver = 1))
+    PeachPredicate conversation[] = {
+        { .field = 4, .op = PEACH_GE, .text = since, .or_group = 0 },
+        { .field = 1, .op = PEACH_EQ, .number = userId1, .or_group = 0 },
+        { .field = 2, .op = PEACH_EQ, .number = userId2, .or_group = 0 },
+        { .field = 4, .op = PEACH_GE, .text = since, .or_group = 1 },
+        { .field = 1, .op = PEACH_EQ, .number = userId2, .or_group = 1 },
+        { .field = 2, .op = PEACH_EQ, .number = userId1, .or_group = 1 },
+    };
+    PeachQuery query = {
+        .where = conversation,
+        .where_count = 6,
+        .select = SINCE_FIELDS,
+        .select_count = 4,
+        .limit = MESSAGE_HISTORY_PAGE_SIZE,
+        .order = PEACH_ORDER_ASC
+    };
+    return Peach_query("messages", &query);
+}
 
-    return filtered_set;
+PeachRecordSet* MessageService_get_history_before(long userId1, long userId2, long beforeId) {
+    // fields: id^senderId^receiverId^message^time
+    // id < before AND ((sender = 1 AND receiver = 2) OR (sender = 2 AND receiver = 1))
+    PeachPredicate conversation[] = {
+        { .field = 0, .op = PEACH_LT, .number = beforeId, .or_group = 0 },
+        { .field = 1, .op = PEACH_EQ, .number = userId1, .or_group = 0 },
+        { .field = 2, .op = PEACH_EQ, .number = userId2, .or_group = 0 },
+        { .field = 0, .op = PEACH_LT, .number = beforeId, .or_group = 1 },
+        { .field = 1, .op = PEACH_EQ, .number = userId2, .or_group = 1 },
+        { .field = 2, .op = PEACH_EQ, .number = userId1, .or_group = 1 },
+    };
+    PeachQuery query = {
+        .where = conversation,
+        .where_count = 6,
+        .select = SINCE_FIELDS,
+        .select_count = 4,
+        .limit = MESSAGE_HISTORY_PAGE_SIZE,
+        .order = PEACH_ORDER_TAIL
+    };
+    return Peach_query("messages", &query);
 }
 
 long* MessageService_get_contacts(long userId, int* count) {
@@ -4,26 +4,50 @@
 #include <stdbool.h>
 #include "../peachdb/peachdb.h" // For PeachRecordSet
 
+// Number of most recent messages returned by a history request
+#define MESSAGE_HISTORY_PAGE_SIZE 100
+
 /**
  * @brief Saves a new direct message to the database.
  * 
  * @param senderId The ID of the user sending the message.
  * @param receiverId The ID of the user receiving the message.
  * @param message The content of the message.
+ * @param out_time Receives the time the message was saved at, formatted
+ *        "YYYY-MM-DD HH:MM:SS" (at least 20 bytes); may be NULL.
  * @return The ID of the newly created message on success, or -1 on failure.
  */
-long MessageService_save_dm(long senderId, long receiverId, const char* message);
+long MessageService_save_dm(long senderId, long receiverId, const char* message, char* out_time);
 
 /**
- * @brief Retrieves the message history between two users.
+ * @brief Retrieves the latest page of messages between two users.
+ * The collection is scanned backwards from its end, so the cost depends on
+ * how far back the last MESSAGE_HISTORY_PAGE_SIZE messages reach, not on the
+ * size of the collection.
  * 
  * @param userId1 The ID of the first user.
  * @param userId2 The ID of the second user.
- * @return A PeachRecordSet containing the messages, or NULL on failure.
+ * @return A PeachRecordSet of the messages in chronological order, each with
+ *         the fields senderId^message^time, or NULL on failure.
  *         The caller is responsible for freeing the record set.
  */
 PeachRecordSet* MessageService_get_history(long userId1, long userId2);
 
+/**
+ * @brief Retrieves the messages between two users sent at or after a point in time.
+ * Uses the time index of 'messages', so only the messages since 'since'
+ * are read. At most MESSAGE_HISTORY_PAGE_SIZE messages are returned; the
+ * caller fetches the next page from the time of the last one.
+ *
+ * @param userId1 The ID of the first user.
+ * @param userId2 The ID of the second user.
+ * @param since The earliest time, formatted "YYYY-MM-DD HH:MM:SS" (inclusive).
+ * @return A PeachRecordSet of the messages in chronological order, each with
+ *         the fields senderId^message^time^id, or NULL on failure.
+ *         The caller is responsible for freeing the record set.
+ */
+PeachRecordSet* MessageService_get_history_since(long userId1, long userId2, const char* since);
+
 /**
  * @brief Gets a list of unique user IDs that the given user has conversed with.
  * 
@@ -35,4 +59,19 @@ PeachRecordSet* MessageService_get_history(long userId1, long userId2);
 long* MessageService_get_contacts(long userId, int* count);
 
 
+/**
+ * @brief Retrieves the page of messages between two users that precedes a message.
+ * Used to scroll back past the latest page: the caller passes the ID of
+ * the oldest message it has. The scan is backwards, like
+ * MessageService_get_history.
+ *
+ * @param userId1 The ID of the first user.
+ * @param userId2 The ID of the second user.
+ * @param beforeId Only messages with a smaller ID are returned.
+ * @return A PeachRecordSet of at most MESSAGE_HISTORY_PAGE_SIZE messages in
+ *         chronological order, each with the fields senderId^message^time^id,
+ *         or NULL on failure. The caller is responsible for freeing the record set.
+ */
+PeachRecordSet* MessageService_get_history_before(long userId1, long userId2, long beforeId);
+
 #endif // MESSAGE_SERVICE_H
@@ -0,0 +1,393 @@
+#include "metricsService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#define MAX_DB_COLLECTIONS 64
+#define COLLECTION_NAME_LEN 64
+
+// HDR-style histogram layout (see metricsService.h)
+#define HIST_SUB_BITS 3
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_VALUE ((1ULL << 31) - 1)
+#define HIST_BUCKETS (HIST_SUB_COUNT + (31 - HIST_SUB_BITS) * HIST_SUB_COUNT)
+
+static const char* COMMAND_NAMES[METRICS_CMD_COUNT] = {
+    "REGISTER", "LOGIN", "SEND_DM", "CREATE_GROUP", "JOIN_GROUP", "GET_MY_GROUPS",
+    "GET_GROUP_HISTORY", "SEND_GROUP_MSG", "GET_DM_HISTORY", "GET_CONTACTS",
+    "GET_USER_INFO", "SEARCH_USER", "GET_DM_SINCE", "GET_GROUP_SINCE",
+    "GET_DM_BEFORE", "GET_GROUP_BEFORE",
+    "ACK_DM", "ACK_GROUP_MSG", "GET_MISSED", "UNKNOWN"
+};
+
+static const char* GAUGE_NAMES[METRICS_GAUGE_COUNT] = {
+    "yahuu_active_sessions",
+    "yahuu_connections",
+    "yahuu_inflight_requests"
+};
+
+static const char* GAUGE_HELP[METRICS_GAUGE_COUNT] = {
+    "Logged-in users.",
+    "Open client connections.",
+    "Requests received but not yet answered."
+};
+
+// Prometheus bucket boundaries, in microseconds
+static const uint64_t EXPORT_BUCKETS_US[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+#define EXPORT_BUCKET_COUNT (sizeof(EXPORT_BUCKETS_US) / sizeof(EXPORT_BUCKETS_US[0]))
+
+// Counters owned by a single thread. Only the owner writes them.
+typedef struct MetricsShard {
+    _Atomic uint64_t requests[METRICS_CMD_COUNT];
+    _Atomic uint64_t latency_sum_us[METRICS_CMD_COUNT];
+    _Atomic uint64_t latency_buckets[METRICS_CMD_COUNT][HIST_BUCKETS];
+    _Atomic int64_t gauges[METRICS_GAUGE_COUNT];
+    _Atomic uint64_t db_bytes_read[MAX_DB_COLLECTIONS];
+    _Atomic uint64_t db_bytes_written[MAX_DB_COLLECTIONS];
+    struct MetricsShard* next;
+} MetricsShard;
+
+// Plain (non-atomic) snapshot used while rendering
+typedef struct {
+    uint64_t requests[METRICS_CMD_COUNT];
+    uint64_t latency_sum_us[METRICS_CMD_COUNT];
+    uint64_t latency_buckets[METRICS_CMD_COUNT][HIST_BUCKETS];
+    int64_t gauges[METRICS_GAUGE_COUNT];
+    uint64_t db_bytes_read[MAX_DB_COLLECTIONS];
+    uint64_t db_bytes_written[MAX_DB_COLLECTIONS];
+} MetricsSnapshot;
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_shard_key;
+static pthread_mutex_t g_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MetricsShard* g_shards = NULL;      // Live shards (protected by g_registry_mutex)
+static MetricsShard g_retired_shard;       // Counts of exited threads (protected by g_registry_mutex)
+static uint64_t g_start_us = 0;
+
+static char g_collection_names[MAX_DB_COLLECTIONS][COLLECTION_NAME_LEN];
+static _Atomic int g_collection_count = 0;
+
+static __thread MetricsShard* t_shard = NULL;
+
+uint64_t Metrics_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Single-writer add: a relaxed load+store is enough and avoids a locked instruction.
+static inline void shard_add_u64(_Atomic uint64_t* counter, uint64_t delta) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+static inline void shard_add_i64(_Atomic int64_t* counter, int64_t delta) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+static int histogram_index(uint64_t value) {
+    if (value > HIST_MAX_VALUE) value = HIST_MAX_VALUE;
+    if (value < HIST_SUB_COUNT) return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+    return HIST_SUB_COUNT + (msb - HIST_SUB_BITS) * HIST_SUB_COUNT + sub;
+}
+
+// Largest value that falls into the given bucket.
+static uint64_t histogram_upper_bound(int index) {
+    if (index < HIST_SUB_COUNT) return (uint64_t)index;
+    int msb = (index - HIST_SUB_COUNT) / HIST_SUB_COUNT + HIST_SUB_BITS;
+    int sub = (index - HIST_SUB_COUNT) % HIST_SUB_COUNT;
+    uint64_t width = 1ULL << (msb - HIST_SUB_BITS);
+    return ((uint64_t)(HIST_SUB_COUNT + sub) << (msb - HIST_SUB_BITS)) + width - 1;
+}
+
+static void merge_shard(MetricsShard* into, MetricsShard* from) {
+    for (int c = 0; c < METRICS_CMD_COUNT; c++) {
+        shard_add_u64(&into->requests[c], atomic_load_explicit(&from->requests[c], memory_order_relaxed));
+        shard_add_u64(&into->latency_sum_us[c], atomic_load_explicit(&from->latency_sum_us[c], memory_order_relaxed));
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            shard_add_u64(&into->latency_buckets[c][b], atomic_load_explicit(&from->latency_buckets[c][b], memory_order_relaxed));
+        }
+    }
+    for (int g = 0; g < METRICS_GAUGE_COUNT; g++) {
+        shard_add_i64(&into->gauges[g], atomic_load_explicit(&from->gauges[g], memory_order_relaxed));
+    }
+    for (int i = 0; i < MAX_DB_COLLECTIONS; i++) {
+        shard_add_u64(&into->db_bytes_read[i], atomic_load_explicit(&from->db_bytes_read[i], memory_order_relaxed));
+        shard_add_u64(&into->db_bytes_written[i], atomic_load_explicit(&from->db_bytes_written[i], memory_order_relaxed));
+    }
+}
+
+static void add_to_snapshot(MetricsSnapshot* snapshot, MetricsShard* shard) {
+    for (int c = 0; c < METRICS_CMD_COUNT; c++) {
+        snapshot->requests[c] += atomic_load_explicit(&shard->requests[c], memory_order_relaxed);
+        snapshot->latency_sum_us[c] += atomic_load_explicit(&shard->latency_sum_us[c], memory_order_relaxed);
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            snapshot->latency_buckets[c][b] += atomic_load_explicit(&shard->latency_buckets[c][b], memory_order_relaxed);
+        }
+    }
+    for (int g = 0; g < METRICS_GAUGE_COUNT; g++) {
+        snapshot->gauges[g] += atomic_load_explicit(&shard->gauges[g], memory_order_relaxed);
+    }
+    for (int i = 0; i < MAX_DB_COLLECTIONS; i++) {
+        snapshot->db_bytes_read[i] += atomic_load_explicit(&shard->db_bytes_read[i], memory_order_relaxed);
+        snapshot->db_bytes_written[i] += atomic_load_explicit(&shard->db_bytes_written[i], memory_order_relaxed);
+    }
+}
+
+// pthread key destructor: fold an exiting thread's counts into the retired shard.
+static void retire_shard(void* arg) {
+    MetricsShard* shard = (MetricsShard*)arg;
+    if (shard == NULL) return;
+
+    pthread_mutex_lock(&g_registry_mutex);
+    MetricsShard** link = &g_shards;
+    while (*link != NULL && *link != shard) {
+        link = &(*link)->next;
+    }
+    if (*link == shard) {
+        *link = shard->next;
+    }
+    merge_shard(&g_retired_shard, shard);
+    pthread_mutex_unlock(&g_registry_mutex);
+
+    free(shard);
+}
+
+static void init_once() {
+    pthread_key_create(&g_shard_key, retire_shard);
+    g_start_us = Metrics_now_us();
+}
+
+static MetricsShard* get_shard() {
+    if (t_shard != NULL) return t_shard;
+
+    pthread_once(&g_once, init_once);
+    MetricsShard* shard = calloc(1, sizeof(MetricsShard));
+    if (shard == NULL) return NULL;
+
+    pthread_mutex_lock(&g_registry_mutex);
+    shard->next = g_shards;
+    g_shards = shard;
+    pthread_mutex_unlock(&g_registry_mutex);
+
+    pthread_setspecific(g_shard_key, shard);
+    t_shard = shard;
+    return shard;
+}
+
+void Metrics_init() {
+    pthread_once(&g_once, init_once);
+}
+
+MetricsCommand Metrics_command_from_name(const char* name) {
+    if (name == NULL) return METRICS_CMD_UNKNOWN;
+    for (int c = 0; c < METRICS_CMD_UNKNOWN; c++) {
+        if (strcmp(name, COMMAND_NAMES[c]) == 0) {
+            return (MetricsCommand)c;
+        }
+    }
+    return METRICS_CMD_UNKNOWN;
+}
+
+void Metrics_record_command(MetricsCommand command, uint64_t latency_us) {
+    MetricsShard* shard = get_shard();
+    if (shard == NULL || command < 0 || command >= METRICS_CMD_COUNT) return;
+    shard_add_u64(&shard->requests[command], 1);
+    shard_add_u64(&shard->latency_sum_us[command], latency_us);
+    shard_add_u64(&shard->latency_buckets[command][histogram_index(latency_us)], 1);
+}
+
+void Metrics_gauge_add(MetricsGauge gauge, long delta) {
+    MetricsShard* shard = get_shard();
+    if (shard == NULL || gauge < 0 || gauge >= METRICS_GAUGE_COUNT) return;
+    shard_add_i64(&shard->gauges[gauge], delta);
+}
+
+// Returns the slot of a collection name, registering it on first use.
+// Lookups are lock-free; only registration takes the mutex.
+static int collection_slot(const char* collection) {
+    int count = atomic_load_explicit(&g_collection_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_collection_names[i], collection) == 0) return i;
+    }
+
+    int slot = -1;
+    pthread_mutex_lock(&g_registry_mutex);
+    count = atomic_load_explicit(&g_collection_count, memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_collection_names[i], collection) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1 && count < MAX_DB_COLLECTIONS) {
+        strncpy(g_collection_names[count], collection, COLLECTION_NAME_LEN - 1);
+        g_collection_names[count][COLLECTION_NAME_LEN - 1] = '\0';
+        atomic_store_explicit(&g_collection_count, count + 1, memory_order_release);
+        slot = count;
+    }
+    pthread_mutex_unlock(&g_registry_mutex);
+    return slot;
+}
+
+void Metrics_add_db_io(const char* collection, size_t bytes_read, size_t bytes_written) {
+    if (collection == NULL || (bytes_read == 0 && bytes_written == 0)) return;
+    MetricsShard* shard = get_shard();
+    int slot = collection_slot(collection);
+    if (shard == NULL || slot < 0) return;
+    if (bytes_read > 0) shard_add_u64(&shard->db_bytes_read[slot], bytes_read);
+    if (bytes_written > 0) shard_add_u64(&shard->db_bytes_written[slot], bytes_written);
+}
+
+// --- Rendering ---
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+    bool failed;
+} TextBuffer;
+
+static void buffer_appendf(TextBuffer* buf, const char* fmt, ...) {
+    if (buf->failed) return;
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        int needed = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, args);
+        va_end(args);
+        if (needed < 0) {
+            buf->failed = true;
+            return;
+        }
+        if (buf->len + (size_t)needed < buf->cap) {
+            buf->len += (size_t)needed;
+            return;
+        }
+        size_t new_cap = buf->cap * 2 + (size_t)needed;
+        char* grown = realloc(buf->data, new_cap);
+        if (grown == NULL) {
+            buf->failed = true;
+            return;
+        }
+        buf->data = grown;
+        buf->cap = new_cap;
+    }
+}
+
+static double quantile_seconds(const uint64_t* buckets, uint64_t total, double q) {
+    if (total == 0) return 0.0;
+    uint64_t target = (uint64_t)(q * (double)total + 0.5);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= target) {
+            return histogram_upper_bound(b) / 1e6;
+        }
+    }
+    return histogram_upper_bound(HIST_BUCKETS - 1) / 1e6;
+}
+
+char* Metrics_render_prometheus(size_t* out_len) {
+    pthread_once(&g_once, init_once);
+
+    MetricsSnapshot* snap = calloc(1, sizeof(MetricsSnapshot));
+    if (snap == NULL) return NULL;
+
+    pthread_mutex_lock(&g_registry_mutex);
+    add_to_snapshot(snap, &g_retired_shard);
+    for (MetricsShard* shard = g_shards; shard != NULL; shard = shard->next) {
+        add_to_snapshot(snap, shard);
+    }
+    int collection_count = atomic_load_explicit(&g_collection_count, memory_order_acquire);
+    pthread_mutex_unlock(&g_registry_mutex);
+
+    TextBuffer buf = { .data = malloc(8192), .len = 0, .cap = 8192, .failed = false };
+    if (buf.data == NULL) {
+        free(snap);
+        return NULL;
+    }
+    buf.data[0] = '\0';
+
+    // 1. Request counters
+    buffer_appendf(&buf, "# HELP yahuu_requests_total Requests handled, by command.\n");
+    buffer_appendf(&buf, "# TYPE yahuu_requests_total counter\n");
+    for (int c = 0; c < METRICS_CMD_COUNT; c++) {
+        buffer_appendf(&buf, "yahuu_requests_total{command=\"%s\"} %llu\n",
+                       COMMAND_NAMES[c], (unsigned long long)snap->requests[c]);
+    }
+
+    // 2. Latency histograms (coarse Prometheus buckets derived from the HDR buckets)
+    buffer_appendf(&buf, "# HELP yahuu_request_latency_seconds Request handling latency, by command.\n");
+    buffer_appendf(&buf, "# TYPE yahuu_request_latency_seconds histogram\n");
+    for (int c = 0; c < METRICS_CMD_COUNT; c++) {
+        int b = 0;
+        uint64_t cumulative = 0;
+        for (size_t e = 0; e < EXPORT_BUCKET_COUNT; e++) {
+            while (b < HIST_BUCKETS && histogram_upper_bound(b) <= EXPORT_BUCKETS_US[e]) {
+                cumulative += snap->latency_buckets[c][b++];
+            }
+            buffer_appendf(&buf, "yahuu_request_latency_seconds_bucket{command=\"%s\",le=\"%g\"} %llu\n",
+                           COMMAND_NAMES[c], EXPORT_BUCKETS_US[e] / 1e6, (unsigned long long)cumulative);
+        }
+        buffer_appendf(&buf, "yahuu_request_latency_seconds_bucket{command=\"%s\",le=\"+Inf\"} %llu\n",
+                       COMMAND_NAMES[c], (unsigned long long)snap->requests[c]);
+        buffer_appendf(&buf, "yahuu_request_latency_seconds_sum{command=\"%s\"} %.6f\n",
+                       COMMAND_NAMES[c], snap->latency_sum_us[c] / 1e6);
+        buffer_appendf(&buf, "yahuu_request_latency_seconds_count{command=\"%s\"} %llu\n",
+                       COMMAND_NAMES[c], (unsigned long long)snap->requests[c]);
+    }
+
+    // 3. Precise quantiles straight from the HDR buckets
+    static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    buffer_appendf(&buf, "# HELP yahuu_request_latency_quantile_seconds Request latency quantiles (HDR, ~12.5%% precision).\n");
+    buffer_appendf(&buf, "# TYPE yahuu_request_latency_quantile_seconds gauge\n");
+    for (int c = 0; c < METRICS_CMD_COUNT; c++) {
+        if (snap->requests[c] == 0) continue;
+        for (size_t q = 0; q < sizeof(QUANTILES) / sizeof(QUANTILES[0]); q++) {
+            buffer_appendf(&buf, "yahuu_request_latency_quantile_seconds{command=\"%s\",quantile=\"%g\"} %.6f\n",
+                           COMMAND_NAMES[c], QUANTILES[q],
+                           quantile_seconds(snap->latency_buckets[c], snap->requests[c], QUANTILES[q]));
+        }
+    }
+
+    // 4. PeachDB I/O per collection
+    buffer_appendf(&buf, "# HELP yahuu_peachdb_read_bytes_total Bytes read from PeachDB collection files.\n");
+    buffer_appendf(&buf, "# TYPE yahuu_peachdb_read_bytes_total counter\n");
+    for (int i = 0; i < collection_count; i++) {
+        buffer_appendf(&buf, "yahuu_peachdb_read_bytes_total{collection=\"%s\"} %llu\n",
+                       g_collection_names[i], (unsigned long long)snap->db_bytes_read[i]);
+    }
+    buffer_appendf(&buf, "# HELP yahuu_peachdb_written_bytes_total Bytes written to PeachDB collection files.\n");
+    buffer_appendf(&buf, "# TYPE yahuu_peachdb_written_bytes_total counter\n");
+    for (int i = 0; i < collection_count; i++) {
+        buffer_appendf(&buf, "yahuu_peachdb_written_bytes_total{collection=\"%s\"} %llu\n",
+                       g_collection_names[i], (unsigned long long)snap->db_bytes_written[i]);
+    }
+
+    // 5. Gauges
+    for (int g = 0; g < METRICS_GAUGE_COUNT; g++) {
+        buffer_appendf(&buf, "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                       GAUGE_NAMES[g], GAUGE_HELP[g], GAUGE_NAMES[g], GAUGE_NAMES[g], (long long)snap->gauges[g]);
+    }
+
+    buffer_appendf(&buf, "# HELP yahuu_uptime_seconds Time since the metrics service started.\n");
+    buffer_appendf(&buf, "# TYPE yahuu_uptime_seconds gauge\n");
+    buffer_appendf(&buf, "yahuu_uptime_seconds %.3f\n", (Metrics_now_us() - g_start_us) / 1e6);
+
+    free(snap);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+    if (out_len != NULL) *out_len = buf.len;
+    return buf.data;
+}
@@ -0,0 +1,99 @@
+#ifndef METRICS_SERVICE_H
+#define METRICS_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*==================[ METRICS SERVICE ]==========================
+ * Every thread that records a metric gets its own shard of counters.
+ * A shard is only ever written by its owning thread (relaxed atomic
+ * stores, no locks on the hot path) and is merged with all other shards
+ * when the metrics are rendered. Shards of exited threads are folded
+ * into a shared "retired" shard so their counts are never lost.
+ *
+ * Latencies are kept in HDR-style log-linear histograms: values below
+ * 8us get exact buckets, larger values get 8 sub-buckets per power of
+ * two (~12.5% relative precision) up to ~35 minutes.
+ ==========================================================*/
+
+// Commands understood by the socket service, used as metric labels.
+typedef enum {
+    METRICS_CMD_REGISTER,
+    METRICS_CMD_LOGIN,
+    METRICS_CMD_SEND_DM,
+    METRICS_CMD_CREATE_GROUP,
+    METRICS_CMD_JOIN_GROUP,
+    METRICS_CMD_GET_MY_GROUPS,
+    METRICS_CMD_GET_GROUP_HISTORY,
+    METRICS_CMD_SEND_GROUP_MSG,
+    METRICS_CMD_GET_DM_HISTORY,
+    METRICS_CMD_GET_CONTACTS,
+    METRICS_CMD_GET_USER_INFO,
+    METRICS_CMD_SEARCH_USER,
+    METRICS_CMD_GET_DM_SINCE,
+    METRICS_CMD_GET_GROUP_SINCE,
+    METRICS_CMD_GET_DM_BEFORE,
+    METRICS_CMD_GET_GROUP_BEFORE,
+    METRICS_CMD_ACK_DM,
+    METRICS_CMD_ACK_GROUP_MSG,
+    METRICS_CMD_GET_MISSED,
+    METRICS_CMD_UNKNOWN,
+    METRICS_CMD_COUNT
+} MetricsCommand;
+
+// Gauges are tracked as per-thread deltas and summed on read.
+typedef enum {
+    METRICS_GAUGE_ACTIVE_SESSIONS,   // Logged-in users in the session manager
+    METRICS_GAUGE_CONNECTIONS,       // Open client sockets (one handler thread each)
+    METRICS_GAUGE_INFLIGHT_REQUESTS, // Requests received but not yet answered
+    METRICS_GAUGE_COUNT
+} MetricsGauge;
+
+/**
+ * @brief Initializes the metrics service.
+ * Must be called once on server startup, before any worker thread is created.
+ */
+void Metrics_init();
+
+/**
+ * @brief Maps a protocol command name (e.g., "SEND_DM") to its metric label.
+ * @param name The command name, may be NULL.
+ * @return The matching MetricsCommand, or METRICS_CMD_UNKNOWN.
+ */
+MetricsCommand Metrics_command_from_name(const char* name);
+
+/**
+ * @brief Counts one handled request and records its latency.
+ * @param command The command that was handled.
+ * @param latency_us The time spent handling it, in microseconds.
+ */
+void Metrics_record_command(MetricsCommand command, uint64_t latency_us);
+
+/**
+ * @brief Adds to a gauge (use a negative delta to decrease it).
+ */
+void Metrics_gauge_add(MetricsGauge gauge, long delta);
+
+/**
+ * @brief Accounts PeachDB file I/O against a collection.
+ * @param collection The collection name.
+ * @param bytes_read Bytes read from the collection's files.
+ * @param bytes_written Bytes written to the collection's files.
+ */
+void Metrics_add_db_io(const char* collection, size_t bytes_read, size_t bytes_written);
+
+/**
+ * @brief Returns a monotonic timestamp in microseconds, for latency measurements.
+ */
+uint64_t Metrics_now_us();
+
+/**
+ * @brief Merges all shards and renders them in the Prometheus text format (v0.0.4).
+ * @param out_len Where the length of the rendered text is stored (may be NULL).
+ * @return A heap-allocated, null-terminated string, or NULL on failure.
+ *         The caller is responsible for freeing it.
+ */
+char* Metrics_render_prometheus(size_t* out_len);
+
+#endif // METRICS_SERVICE_H
@@ -0,0 +1,300 @@
+#include "backup.h"
+#include "../recovery/recovery.h"
+#include "../../../logService/logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define COPY_BLOCK_SIZE (64 * 1024)
+#define TAIL_CHECK_SIZE 4096 // Bytes compared before appending to a previous copy
+
+typedef struct {
+    char name[64];
+    unsigned long inode;
+    long length;
+} ManifestEntry;
+
+static PeachBackupStatus g_status = { .last_status = 1 };
+static pthread_mutex_t g_status_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// --- Status ---
+
+bool PeachBackup_begin(const char* dest_dir) {
+    pthread_mutex_lock(&g_status_mutex);
+    bool claimed = !g_status.running;
+    if (claimed) {
+        int last_status = g_status.last_status;
+        memset(&g_status, 0, sizeof(g_status));
+        g_status.running = 1;
+        g_status.last_status = last_status;
+        snprintf(g_status.dest_dir, sizeof(g_status.dest_dir), "%s", dest_dir);
+    }
+    pthread_mutex_unlock(&g_status_mutex);
+    return claimed;
+}
+
+void PeachBackup_end(int status) {
+    pthread_mutex_lock(&g_status_mutex);
+    g_status.running = 0;
+    g_status.last_status = status;
+    pthread_mutex_unlock(&g_status_mutex);
+}
+
+void PeachBackup_get_status(PeachBackupStatus* out) {
+    pthread_mutex_lock(&g_status_mutex);
+    *out = g_status;
+    pthread_mutex_unlock(&g_status_mutex);
+}
+
+static void add_progress(long long total, long long copied, int appended, int copied_in_full) {
+    pthread_mutex_lock(&g_status_mutex);
+    g_status.bytes_total += total;
+    g_status.bytes_copied += copied;
+    g_status.collections_appended += appended;
+    g_status.collections_copied += copied_in_full;
+    pthread_mutex_unlock(&g_status_mutex);
+}
+
+// --- Snapshot ---
+
+static int ensure_dir(const char* path) {
+    if (mkdir(path, 0700) != 0 && errno != EEXIST) {
+        LOG_ERROR("peachdb", "Error creating directory %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int PeachBackup_prepare_staging(void) {
+    if (ensure_dir(PEACH_BACKUP_STAGING_PATH) != 0) return -1;
+
+    DIR* dir = opendir(PEACH_BACKUP_STAGING_PATH);
+    if (dir == NULL) return -1;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", PEACH_BACKUP_STAGING_PATH, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+    return 0;
+}
+
+int PeachBackup_add_file(PeachSnapshot* snapshot, const char* collection_name, const char* collection_path) {
+    struct stat st;
+    if (stat(collection_path, &st) != 0) {
+        if (errno == ENOENT) return 1;
+        LOG_ERROR("peachdb", "Could not stat '%s' for backup: %s", collection_path, strerror(errno));
+        return -1;
+    }
+    if (strlen(collection_name) >= sizeof(snapshot->files[0].name)) return -1;
+
+    PeachSnapshotFile* grown = realloc(snapshot->files, (size_t)(snapshot->file_count + 1) * sizeof(PeachSnapshotFile));
+    if (grown == NULL) return -1;
+    snapshot->files = grown;
+
+    PeachSnapshotFile* file = &snapshot->files[snapshot->file_count];
+    const char* extension = strrchr(collection_path, '.');
+    snprintf(file->name, sizeof(file->name), "%s", collection_name);
+    snprintf(file->extension, sizeof(file->extension), "%s", extension != NULL ? extension : ".lpdb");
+    snprintf(file->link_path, sizeof(file->link_path), "%s/%s%s", PEACH_BACKUP_STAGING_PATH, collection_name,
+             file->extension);
+    if (link(collection_path, file->link_path) != 0) {
+        LOG_ERROR("peachdb", "Could not link '%s' for backup: %s", collection_path, strerror(errno));
+        return -1;
+    }
+    file->length = (long)st.st_size;
+    file->inode = (unsigned long)st.st_ino;
+    snapshot->file_count++;
+    add_progress(file->length, 0, 0, 0);
+    return 0;
+}
+
+void PeachBackup_release(PeachSnapshot* snapshot) {
+    for (int i = 0; i < snapshot->file_count; i++) {
+        unlink(snapshot->files[i].link_path);
+    }
+    free(snapshot->files);
+    free(snapshot->index_text);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// --- Copy ---
+
+static ManifestEntry* read_manifest(const char* dest_dir, int* out_count) {
+    *out_count = 0;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dest_dir, PEACH_BACKUP_MANIFEST);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return NULL; // No previous backup
+
+    int count = 0;
+    ManifestEntry* entries = NULL;
+    if (fscanf(file, "%d", &count) == 1 && count > 0 && count <= 4096) {
+        entries = calloc((size_t)count, sizeof(ManifestEntry));
+    }
+    int read = 0;
+    while (entries != NULL && read < count &&
+           fscanf(file, "%63s %lu %ld", entries[read].name, &entries[read].inode, &entries[read].length) == 3) {
+        read++;
+    }
+    fclose(file);
+    *out_count = read;
+    return entries;
+}
+
+static const ManifestEntry* find_entry(const ManifestEntry* entries, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(entries[i].name, name) == 0) return &entries[i];
+    }
+    return NULL;
+}
+
+// Copies bytes [from, to) of 'in' to the same offsets of 'out'.
+static int copy_range(int in, int out, long from, long to) {
+    char* buffer = malloc(COPY_BLOCK_SIZE);
+    if (buffer == NULL) return -1;
+    while (from < to) {
+        size_t chunk = to - from < COPY_BLOCK_SIZE ? (size_t)(to - from) : COPY_BLOCK_SIZE;
+        ssize_t length = pread(in, buffer, chunk, from);
+        if (length <= 0 || pwrite(out, buffer, (size_t)length, from) != length) {
+            free(buffer);
+            return -1;
+        }
+        from += length;
+        add_progress(0, length, 0, 0);
+    }
+    free(buffer);
+    return 0;
+}
+
+// True if both files hold the same bytes just before 'length'.
+static bool tails_match(int in, int out, long length) {
+    char expected[TAIL_CHECK_SIZE];
+    char actual[TAIL_CHECK_SIZE];
+    size_t size = length < TAIL_CHECK_SIZE ? (size_t)length : TAIL_CHECK_SIZE;
+    return pread(in, expected, size, length - (long)size) == (ssize_t)size &&
+           pread(out, actual, size, length - (long)size) == (ssize_t)size &&
+           memcmp(expected, actual, size) == 0;
+}
+
+static int copy_collection(const PeachSnapshotFile* file, const char* dest_dir, const ManifestEntry* previous) {
+    char target[512];
+    snprintf(target, sizeof(target), "%s/collections/%s%s", dest_dir, file->name, file->extension);
+    int in = open(file->link_path, O_RDONLY);
+    if (in < 0) return -1;
+
+    // 1. Incremental: the file was only appended to since the previous backup
+    if (previous != NULL && previous->inode == file->inode && previous->length <= file->length) {
+        int out = open(target, O_RDWR);
+        struct stat st;
+        if (out >= 0 && fstat(out, &st) == 0 && st.st_size >= previous->length &&
+            tails_match(in, out, previous->length)) {
+            // Bytes past the manifest length come from an interrupted backup
+            int status = (ftruncate(out, previous->length) == 0 &&
+                          copy_range(in, out, previous->length, file->length) == 0 &&
+                          fsync(out) == 0) ? 0 : -1;
+            close(out);
+            close(in);
+            if (status == 0) add_progress(0, 0, 1, 0);
+            return status;
+        }
+        if (out >= 0) close(out);
+    }
+
+    // 2. Full copy into a temporary file that replaces the previous copy
+    char temp[520];
+    snprintf(temp, sizeof(temp), "%s.tmp", target);
+    int out = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+    int status = (copy_range(in, out, 0, file->length) == 0 && fsync(out) == 0) ? 0 : -1;
+    close(out);
+    close(in);
+    if (status == 0 && rename(temp, target) != 0) status = -1;
+    if (status != 0) {
+        remove(temp);
+        return -1;
+    }
+    add_progress(0, 0, 0, 1);
+    return 0;
+}
+
+// Replaces a file with 'data' through a synced temporary file.
+static int write_file_atomic(const char* path, const char* data, size_t length) {
+    char temp[520];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return -1;
+    int status = (write(fd, data, length) == (ssize_t)length && fsync(fd) == 0) ? 0 : -1;
+    close(fd);
+    if (status == 0 && rename(temp, path) != 0) status = -1;
+    if (status != 0) remove(temp);
+    return status;
+}
+
+static int write_manifest(const PeachSnapshot* snapshot, const char* dest_dir) {
+    size_t capacity = 32 + (size_t)snapshot->file_count * 128;
+    char* text = malloc(capacity);
+    if (text == NULL) return -1;
+    size_t length = (size_t)snprintf(text, capacity, "%d\n", snapshot->file_count);
+    for (int i = 0; i < snapshot->file_count; i++) {
+        const PeachSnapshotFile* file = &snapshot->files[i];
+        length += (size_t)snprintf(text + length, capacity - length, "%s %lu %ld\n", file->name, file->inode, file->length);
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dest_dir, PEACH_BACKUP_MANIFEST);
+    int status = write_file_atomic(path, text, length);
+    free(text);
+    return status;
+}
+
+int PeachBackup_copy(const PeachSnapshot* snapshot, const char* dest_dir, bool incremental) {
+    // 1. Prepare the layout of peachdata/
+    char collections_dir[512];
+    snprintf(collections_dir, sizeof(collections_dir), "%s/collections", dest_dir);
+    if (ensure_dir(dest_dir) != 0 || ensure_dir(collections_dir) != 0) return -1;
+
+    // 2. Copy the collections, extending those a previous backup already holds
+    int previous_count = 0;
+    ManifestEntry* previous = incremental ? read_manifest(dest_dir, &previous_count) : NULL;
+    int status = 0;
+    for (int i = 0; i < snapshot->file_count && status == 0; i++) {
+        const PeachSnapshotFile* file = &snapshot->files[i];
+        status = copy_collection(file, dest_dir, find_entry(previous, previous_count, file->name));
+        if (status != 0) {
+            LOG_ERROR("peachdb", "Backup of collection '%s' to '%s' failed: %s", file->name, dest_dir, strerror(errno));
+        }
+    }
+    free(previous);
+    PeachRecovery_sync_dir(collections_dir);
+
+    // 3. The index and the manifest go last, so they only describe complete copies
+    if (status == 0) {
+        char index_path[512];
+        snprintf(index_path, sizeof(index_path), "%s/index.mpdb", dest_dir);
+        status = write_file_atomic(index_path, snapshot->index_text, snapshot->index_length);
+    }
+    if (status == 0) status = write_manifest(snapshot, dest_dir);
+    PeachRecovery_sync_dir(dest_dir);
+
+    PeachBackupStatus result;
+    PeachBackup_get_status(&result);
+    if (status == 0) {
+        LOG_INFO("peachdb", "Backup to '%s' done: %lld of %lld bytes copied (%d collections appended, %d copied in full).",
+                 dest_dir, result.bytes_copied, result.bytes_total, result.collections_appended, result.collections_copied);
+    } else {
+        LOG_ERROR("peachdb", "Backup to '%s' failed.", dest_dir);
+    }
+    return status;
+}
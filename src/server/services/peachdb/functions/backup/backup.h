@@ -0,0 +1,90 @@
+#ifndef PEACH_BACKUP_H
+#define PEACH_BACKUP_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "../../peachdb.h"
+
+/*==================[ PEACHDB ONLINE BACKUP ]=====================
+ * A snapshot freezes a consistent point of peachdata/ without stopping
+ * writers: while every collection lock is held (see locks.h), each
+ * collection file is hard-linked into a staging directory and its length
+ * is recorded. Afterwards:
+ *   - appends grow the linked file past the recorded length, and the copy
+ *     stops at that length;
+ *   - updates and deletes rename a new file over the collection, which
+ *     leaves the linked (old) file untouched.
+ * So the staged links plus lengths keep describing the snapshot point
+ * while the copy runs in the background.
+ *
+ * A backup directory has the layout of peachdata/ (restore by copying it
+ * back) plus a manifest of what it holds:
+ *
+ * backup.manifest format:
+ *   Line 1: <number_of_collections>
+ *   Line 2...N: <collection_name> <source_inode> <length>
+ *
+ * An incremental backup into the same directory only appends the bytes
+ * past <length> to collections whose file was not rewritten since (same
+ * inode, same bytes before <length>); other collections are copied in full.
+ ==========================================================*/
+
+#define PEACH_BACKUP_STAGING_PATH "peachdata/.snapshot"
+#define PEACH_BACKUP_MANIFEST "backup.manifest"
+
+typedef struct {
+    char name[64];
+    char extension[8];      // ".lpdb", or ".lpdz" for a compressed segment
+    char link_path[256];    // Hard link to the collection file at the snapshot point
+    long length;            // Bytes of the file that belong to the snapshot
+    unsigned long inode;    // Rewrites (update/delete) create a new inode
+} PeachSnapshotFile;
+
+typedef struct {
+    PeachSnapshotFile* files;
+    int file_count;
+    char* index_text;       // Copy of index.mpdb at the snapshot point
+    size_t index_length;
+} PeachSnapshot;
+
+/**
+ * @brief Claims the single backup slot.
+ * @return true if no other backup is running; the caller must then call PeachBackup_end().
+ */
+bool PeachBackup_begin(const char* dest_dir);
+
+/**
+ * @brief Releases the backup slot and records the outcome for PeachBackup_get_status().
+ */
+void PeachBackup_end(int status);
+
+/**
+ * @brief Creates the staging directory and removes links left by an interrupted backup.
+ * @return 0 on success, -1 on failure.
+ */
+int PeachBackup_prepare_staging(void);
+
+/**
+ * @brief Adds a collection file to a snapshot by hard-linking it into the staging directory.
+ * The caller must hold the collection's lock. The backup copy keeps the file's extension.
+ * @return 0 on success, 1 if the file does not exist, -1 on failure.
+ */
+int PeachBackup_add_file(PeachSnapshot* snapshot, const char* collection_name, const char* collection_path);
+
+/**
+ * @brief Copies a snapshot into a backup directory (no locks are needed).
+ * @param incremental Append to the copies of a previous backup in dest_dir when possible.
+ * @return 0 on success, -1 on failure.
+ */
+int PeachBackup_copy(const PeachSnapshot* snapshot, const char* dest_dir, bool incremental);
+
+/**
+ * @brief Removes the staged links of a snapshot and frees it.
+ */
+void PeachBackup_release(PeachSnapshot* snapshot);
+
+/**
+ * @brief Reports the running or last backup.
+ */
+void PeachBackup_get_status(PeachBackupStatus* out);
+
+#endif // PEACH_BACKUP_H
@@ -0,0 +1,472 @@
+#include "bloom.h"
+#include "../checksum/checksum.h"
+#include "../pool/pool.h"
+#include "../indexfile/indexfile.h"
+#include "../../../metricsService/metricsService.h"
+#include "../../../logService/logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define MAX_BLOOM_COLLECTIONS 64
+#define MAX_BLOOM_FIELDS 8
+#define BLOOM_NAME_LEN 64
+#define BLOOM_BITS_PER_VALUE 10
+#define BLOOM_HASHES 7
+#define BLOOM_MIN_CAPACITY 1024
+
+typedef struct {
+    char field_name[BLOOM_NAME_LEN]; // Empty for the key filter
+    int field_index;                 // Resolved from the header at build time, -1 if unknown
+    uint64_t* bits;
+    size_t bit_count;
+    size_t capacity;                 // Values the filter was sized for
+    size_t count;                    // Values added since the last build
+} BloomFilter;
+
+typedef struct {
+    char name[BLOOM_NAME_LEN];
+    char path[256];
+    BloomFilter filters[MAX_BLOOM_FIELDS];
+    int filter_count;
+    size_t deleted;                  // Records deleted since the last build
+    _Atomic bool ready;
+    pthread_mutex_t build_mutex;     // Serializes lazy builds by concurrent readers
+} BloomSet;
+
+static BloomSet g_sets[MAX_BLOOM_COLLECTIONS];
+static _Atomic int g_set_count = 0;
+static pthread_mutex_t g_sets_mutex = PTHREAD_MUTEX_INITIALIZER; // Serializes registration
+
+// --- Hashing ---
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash_span(const char* value, size_t len) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)value[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Double hashing: probe i is h1 + i * h2.
+// 'shared' filters are filled by several build threads at once; their count is set afterwards.
+static void filter_add(BloomFilter* filter, const char* value, size_t len, bool shared) {
+    uint64_t hash = hash_span(value, len);
+    uint64_t h1 = mix64(hash);
+    uint64_t h2 = mix64(hash ^ 0x9e3779b97f4a7c15ULL) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + (uint64_t)i * h2) % filter->bit_count;
+        if (shared) {
+            __atomic_fetch_or(&filter->bits[bit >> 6], 1ULL << (bit & 63), __ATOMIC_RELAXED);
+        } else {
+            filter->bits[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+    if (!shared) filter->count++;
+}
+
+static bool filter_test(const BloomFilter* filter, const char* value, size_t len) {
+    uint64_t hash = hash_span(value, len);
+    uint64_t h1 = mix64(hash);
+    uint64_t h2 = mix64(hash ^ 0x9e3779b97f4a7c15ULL) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + (uint64_t)i * h2) % filter->bit_count;
+        if ((filter->bits[bit >> 6] & (1ULL << (bit & 63))) == 0) return false;
+    }
+    return true;
+}
+
+// Adds every indexed field of one '^'-separated line.
+static void add_line(BloomSet* set, const char* line, bool shared) {
+    int field = 0;
+    const char* start = line;
+    for (const char* p = line;; p++) {
+        if (*p == '^' || *p == '\0' || *p == '\n') {
+            for (int f = 0; f < set->filter_count; f++) {
+                BloomFilter* filter = &set->filters[f];
+                if (filter->field_index == field && filter->bits != NULL) {
+                    filter_add(filter, start, (size_t)(p - start), shared);
+                }
+            }
+            if (*p != '^') break;
+            field++;
+            start = p + 1;
+        }
+    }
+}
+
+// --- Building ---
+
+static int resolve_fields(BloomSet* set, char* header) {
+    header[strcspn(header, "\n")] = '\0';
+    for (int f = 0; f < set->filter_count; f++) {
+        BloomFilter* filter = &set->filters[f];
+        filter->field_index = -1;
+        if (filter->field_name[0] == '\0') {
+            filter->field_index = 0;
+            continue;
+        }
+        int index = 0;
+        const char* start = header;
+        for (const char* p = header;; p++) {
+            if (*p == '^' || *p == '\0') {
+                if ((size_t)(p - start) == strlen(filter->field_name) &&
+                    strncmp(start, filter->field_name, (size_t)(p - start)) == 0) {
+                    filter->field_index = index;
+                    break;
+                }
+                if (*p == '\0') break;
+                index++;
+                start = p + 1;
+            }
+        }
+        if (filter->field_index < 0) {
+            LOG_WARN("peachdb", "Bloom filter field '%s' not found in collection '%s'.", filter->field_name, set->name);
+        }
+    }
+    return 0;
+}
+
+// Scans the records of [start, end) of the collection file; with 'add' false they are only counted.
+static size_t scan_range(BloomSet* set, long start, long end, bool add, bool shared, size_t* bytes_read) {
+    FILE* file = fopen(set->path, "r");
+    if (file == NULL) return 0;
+    fseek(file, start, SEEK_SET);
+
+    char buffer[1024];
+    size_t records = 0;
+    long position = start;
+    while (position < end && fgets(buffer, sizeof(buffer), file) != NULL) {
+        size_t length = strlen(buffer);
+        position += (long)length;
+        *bytes_read += length;
+        if (buffer[0] == '\n' || buffer[0] == '\0') continue;
+        if (add) {
+            buffer[strcspn(buffer, "\n")] = '\0';
+            if (PeachChecksum_strip(buffer) == PEACH_LINE_CORRUPT) continue;
+            add_line(set, buffer, shared);
+        }
+        records++;
+    }
+    fclose(file);
+    return records;
+}
+
+typedef struct {
+    BloomSet* set;
+    long bounds[PEACH_POOL_MAX_CHUNKS + 1];
+    size_t records[PEACH_POOL_MAX_CHUNKS];
+    size_t bytes_read[PEACH_POOL_MAX_CHUNKS];
+    bool add;
+    bool shared;
+} BloomBuild;
+
+static void scan_chunk(int chunk, void* context) {
+    BloomBuild* build = context;
+    build->records[chunk] = scan_range(build->set, build->bounds[chunk], build->bounds[chunk + 1],
+                                       build->add, build->shared, &build->bytes_read[chunk]);
+}
+
+// --- Snapshots (see indexfile.h) ---
+
+static bool take(const char** cursor, const char* end, void* out, size_t size) {
+    if ((size_t)(end - *cursor) < size) return false;
+    memcpy(out, *cursor, size);
+    *cursor += size;
+    return true;
+}
+
+static void put(char** cursor, const void* data, size_t size) {
+    memcpy(*cursor, data, size);
+    *cursor += size;
+}
+
+static size_t filter_words(const BloomFilter* filter) {
+    return filter->bits != NULL ? (filter->bit_count + 63) / 64 : 0;
+}
+
+static int save_snapshot(BloomSet* set, long covered) {
+    size_t length = sizeof(uint32_t) + sizeof(uint64_t);
+    for (int f = 0; f < set->filter_count; f++) {
+        length += BLOOM_NAME_LEN + sizeof(int32_t) + 3 * sizeof(uint64_t) + filter_words(&set->filters[f]) * sizeof(uint64_t);
+    }
+    char* payload = malloc(length);
+    if (payload == NULL) return -1;
+
+    char* cursor = payload;
+    uint32_t filter_count = (uint32_t)set->filter_count;
+    put(&cursor, &filter_count, sizeof(filter_count));
+    for (int f = 0; f < set->filter_count; f++) {
+        BloomFilter* filter = &set->filters[f];
+        int32_t field_index = filter->field_index;
+        uint64_t sizes[3] = { filter->bits != NULL ? filter->bit_count : 0, filter->capacity, filter->count };
+        put(&cursor, filter->field_name, BLOOM_NAME_LEN);
+        put(&cursor, &field_index, sizeof(field_index));
+        put(&cursor, sizes, sizeof(sizes));
+        if (filter->bits != NULL) put(&cursor, filter->bits, filter_words(filter) * sizeof(uint64_t));
+    }
+    uint64_t deleted = set->deleted;
+    put(&cursor, &deleted, sizeof(deleted));
+
+    int status = PeachIndexFile_save(set->name, "bloom", set->path, covered, payload, length);
+    free(payload);
+    return status;
+}
+
+// Restores the filters from their snapshot. Returns the bytes of the file it covers, or -1.
+static long load_snapshot(BloomSet* set) {
+    PeachIndexFile snapshot;
+    if (PeachIndexFile_open(&snapshot, set->name, "bloom", set->path) != 0) return -1;
+    const char* cursor = snapshot.payload;
+    const char* end = snapshot.payload + snapshot.payload_length;
+
+    uint32_t filter_count = 0;
+    bool valid = take(&cursor, end, &filter_count, sizeof(filter_count)) && (int)filter_count == set->filter_count;
+    uint64_t* bits[MAX_BLOOM_FIELDS] = {0};
+    uint64_t sizes[MAX_BLOOM_FIELDS][3];
+    for (int f = 0; valid && f < set->filter_count; f++) {
+        char field_name[BLOOM_NAME_LEN];
+        int32_t field_index = 0;
+        valid = take(&cursor, end, field_name, sizeof(field_name)) &&
+                take(&cursor, end, &field_index, sizeof(field_index)) &&
+                take(&cursor, end, sizes[f], sizeof(sizes[f])) &&
+                strncmp(field_name, set->filters[f].field_name, BLOOM_NAME_LEN) == 0 &&
+                field_index == set->filters[f].field_index; // Declared on the same fields
+        size_t words = (sizes[f][0] + 63) / 64;
+        if (valid && words > 0) {
+            bits[f] = malloc(words * sizeof(uint64_t));
+            valid = bits[f] != NULL && take(&cursor, end, bits[f], words * sizeof(uint64_t));
+        }
+    }
+    uint64_t deleted = 0;
+    valid = valid && take(&cursor, end, &deleted, sizeof(deleted));
+    long covered = snapshot.covered;
+    PeachIndexFile_close(&snapshot);
+
+    if (!valid) {
+        for (int f = 0; f < set->filter_count; f++) free(bits[f]);
+        return -1;
+    }
+    for (int f = 0; f < set->filter_count; f++) {
+        BloomFilter* filter = &set->filters[f];
+        free(filter->bits);
+        filter->bits = bits[f];
+        filter->bit_count = (size_t)sizes[f][0];
+        filter->capacity = (size_t)sizes[f][1];
+        filter->count = (size_t)sizes[f][2];
+    }
+    set->deleted = (size_t)deleted;
+    return covered;
+}
+
+static bool over_capacity(const BloomSet* set) {
+    for (int f = 0; f < set->filter_count; f++) {
+        if (set->filters[f].bits != NULL && set->filters[f].count > set->filters[f].capacity) return true;
+    }
+    return false;
+}
+
+static int build_set(BloomSet* set) {
+    // 1. Read the header and find where the records end
+    FILE* file = fopen(set->path, "r");
+    if (file == NULL) return -1;
+    char buffer[1024];
+    if (fgets(buffer, sizeof(buffer), file) == NULL) {
+        fclose(file);
+        return -1;
+    }
+    size_t bytes_read = strlen(buffer);
+    resolve_fields(set, buffer);
+    long data_start = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+
+    // 2. Warm restart: take the snapshot and add what was appended since
+    long covered = load_snapshot(set);
+    if (covered >= data_start) {
+        scan_range(set, covered, size, true, false, &bytes_read);
+        if (!over_capacity(set)) {
+            Metrics_add_db_io(set->name, bytes_read, 0);
+            if (covered < size) save_snapshot(set, size);
+            return 0;
+        }
+    }
+
+    // 3. Count records to size the filters; big files are scanned in line-aligned chunks
+    BloomBuild* build = calloc(1, sizeof(BloomBuild));
+    if (build == NULL) return -1;
+    build->set = set;
+    int threads = size - data_start >= PEACH_POOL_CHUNK_MIN_BYTES ? PeachPool_threads() : 1;
+    int chunks = PeachPool_split_lines(set->path, data_start, size, threads, build->bounds);
+    if (chunks < 0) {
+        free(build);
+        return -1;
+    }
+    build->shared = chunks > 1;
+    PeachPool_run(chunks, threads, scan_chunk, build);
+    size_t records = 0;
+    for (int c = 0; c < chunks; c++) records += build->records[c];
+
+    // 4. Allocate with head room for inserts before the next rebuild
+    size_t capacity = records * 2 > BLOOM_MIN_CAPACITY ? records * 2 : BLOOM_MIN_CAPACITY;
+    for (int f = 0; f < set->filter_count; f++) {
+        BloomFilter* filter = &set->filters[f];
+        free(filter->bits);
+        filter->bits = NULL;
+        filter->count = 0;
+        if (filter->field_index < 0) continue;
+        filter->bit_count = capacity * BLOOM_BITS_PER_VALUE;
+        filter->capacity = capacity;
+        filter->bits = calloc((filter->bit_count + 63) / 64, sizeof(uint64_t));
+    }
+
+    // 5. Add every record
+    build->add = true;
+    PeachPool_run(chunks, threads, scan_chunk, build);
+    size_t added = 0;
+    for (int c = 0; c < chunks; c++) {
+        added += build->records[c];
+        bytes_read += build->bytes_read[c];
+    }
+    if (build->shared) {
+        for (int f = 0; f < set->filter_count; f++) set->filters[f].count = added;
+    }
+    free(build);
+    Metrics_add_db_io(set->name, bytes_read, 0);
+    set->deleted = 0;
+    save_snapshot(set, size);
+    return 0;
+}
+
+static void ensure_ready(BloomSet* set) {
+    if (atomic_load_explicit(&set->ready, memory_order_acquire)) return;
+    pthread_mutex_lock(&set->build_mutex);
+    if (!atomic_load_explicit(&set->ready, memory_order_relaxed) && build_set(set) == 0) {
+        atomic_store_explicit(&set->ready, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&set->build_mutex);
+}
+
+// --- Registry ---
+
+static BloomSet* find_set(const char* collection) {
+    int count = atomic_load_explicit(&g_set_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_sets[i].name, collection) == 0) return &g_sets[i];
+    }
+    return NULL;
+}
+
+static BloomFilter* find_filter(BloomSet* set, const char* field_name) {
+    const char* name = field_name != NULL ? field_name : "";
+    for (int f = 0; f < set->filter_count; f++) {
+        if (strcmp(set->filters[f].field_name, name) == 0) return &set->filters[f];
+    }
+    return NULL;
+}
+
+int PeachBloom_declare(const char* collection, const char* collection_path, const char* field_name) {
+    BloomSet* set = find_set(collection);
+    if (set != NULL && find_filter(set, field_name) != NULL) return 0; // Fast path
+
+    pthread_mutex_lock(&g_sets_mutex);
+    set = find_set(collection);
+    if (set == NULL) {
+        int count = atomic_load_explicit(&g_set_count, memory_order_relaxed);
+        if (count >= MAX_BLOOM_COLLECTIONS || strlen(collection) >= BLOOM_NAME_LEN) {
+            pthread_mutex_unlock(&g_sets_mutex);
+            return -1;
+        }
+        set = &g_sets[count];
+        snprintf(set->name, sizeof(set->name), "%s", collection);
+        snprintf(set->path, sizeof(set->path), "%s", collection_path);
+        pthread_mutex_init(&set->build_mutex, NULL);
+        atomic_store_explicit(&g_set_count, count + 1, memory_order_release);
+    }
+    if (find_filter(set, field_name) == NULL) {
+        if (set->filter_count >= MAX_BLOOM_FIELDS) {
+            pthread_mutex_unlock(&g_sets_mutex);
+            return -1;
+        }
+        BloomFilter* filter = &set->filters[set->filter_count];
+        memset(filter, 0, sizeof(*filter));
+        snprintf(filter->field_name, sizeof(filter->field_name), "%s", field_name != NULL ? field_name : "");
+        filter->field_index = -1;
+        set->filter_count++;
+        atomic_store_explicit(&set->ready, false, memory_order_release); // Build the new filter on next use
+    }
+    pthread_mutex_unlock(&g_sets_mutex);
+    return 0;
+}
+
+int PeachBloom_may_contain(const char* collection, const char* field_name, const char* value) {
+    BloomSet* set = find_set(collection);
+    if (set == NULL || value == NULL) return -1;
+    ensure_ready(set);
+    if (!atomic_load_explicit(&set->ready, memory_order_acquire)) return -1;
+
+    BloomFilter* filter = find_filter(set, field_name);
+    if (filter == NULL || filter->bits == NULL) return -1;
+    return filter_test(filter, value, strlen(value)) ? 1 : 0;
+}
+
+void PeachBloom_on_insert(const char* collection, const char* record_str) {
+    BloomSet* set = find_set(collection);
+    if (set == NULL || !atomic_load_explicit(&set->ready, memory_order_acquire)) return; // Built from the file later
+
+    add_line(set, record_str, false);
+    for (int f = 0; f < set->filter_count; f++) {
+        if (set->filters[f].bits != NULL && set->filters[f].count > set->filters[f].capacity) {
+            atomic_store_explicit(&set->ready, false, memory_order_release); // Over capacity: resize on next use
+            break;
+        }
+    }
+}
+
+void PeachBloom_on_delete(const char* collection) {
+    BloomSet* set = find_set(collection);
+    if (set == NULL || !atomic_load_explicit(&set->ready, memory_order_acquire)) return;
+
+    set->deleted++;
+    size_t values = set->filter_count > 0 ? set->filters[0].count : 0;
+    if (set->deleted > BLOOM_MIN_CAPACITY / 16 && set->deleted * 2 > values) {
+        atomic_store_explicit(&set->ready, false, memory_order_release);
+    }
+}
+
+void PeachBloom_invalidate(const char* collection) {
+    BloomSet* set = find_set(collection);
+    if (set != NULL) {
+        atomic_store_explicit(&set->ready, false, memory_order_release);
+    }
+}
+
+void PeachBloom_load(const char* collection) {
+    BloomSet* set = find_set(collection);
+    if (set != NULL) ensure_ready(set);
+}
+
+int PeachBloom_save(const char* collection) {
+    BloomSet* set = find_set(collection);
+    if (set == NULL || !atomic_load_explicit(&set->ready, memory_order_acquire)) return -1;
+    FILE* file = fopen(set->path, "r");
+    if (file == NULL) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return save_snapshot(set, size);
+}
@@ -0,0 +1,67 @@
+#ifndef PEACH_BLOOM_H
+#define PEACH_BLOOM_H
+#include <stdbool.h>
+
+/*==================[ PEACHDB BLOOM FILTERS ]=====================
+ * Per-collection, per-field Bloom filters that answer "this value is
+ * definitely not in the collection" without reading the file.
+ *
+ * - The key (first field) filter is declared by Peach_write_record; other
+ *   fields are declared with Peach_index_field (e.g., user.username).
+ * - Filters are built lazily from the collection file on first use after
+ *   startup, and rebuilt when they are over capacity or when too many
+ *   values were deleted (Bloom filters cannot forget values).
+ * - Inserts and updates add their values immediately.
+ * - Sized for ~1% false positives: 10 bits per value, 7 hash functions.
+ * - Every build saves a snapshot (see indexfile.h); the next build after
+ *   a restart starts from it and only reads the records appended since.
+ *   Large files are built by several threads (see pool.h).
+ *
+ * Callers must hold the collection's lock (see locks.h): shared for
+ * lookups, exclusive for the on_* hooks.
+ ==========================================================*/
+
+/**
+ * @brief Declares a filter on a field of a collection (idempotent).
+ * @param collection The collection name.
+ * @param collection_path Path of the collection file, used to (re)build the filter.
+ * @param field_name The field to index, or NULL for the key (first field).
+ * @return 0 on success, -1 if the filter table is full.
+ */
+int PeachBloom_declare(const char* collection, const char* collection_path, const char* field_name);
+
+/**
+ * @brief Tests whether a value may be stored in a field.
+ * @param field_name The field, or NULL for the key.
+ * @return 0 if the value is definitely absent, 1 if it may be present,
+ *         -1 if no usable filter exists (the caller must scan).
+ */
+int PeachBloom_may_contain(const char* collection, const char* field_name, const char* value);
+
+/**
+ * @brief Adds the indexed fields of a newly written or updated record.
+ */
+void PeachBloom_on_insert(const char* collection, const char* record_str);
+
+/**
+ * @brief Counts a deleted record; enough deletes schedule a rebuild.
+ */
+void PeachBloom_on_delete(const char* collection);
+
+/**
+ * @brief Forces all filters of a collection to be rebuilt on next use.
+ */
+void PeachBloom_invalidate(const char* collection);
+
+/**
+ * @brief Builds the filters of a collection now instead of on first use.
+ */
+void PeachBloom_load(const char* collection);
+
+/**
+ * @brief Saves a snapshot of the filters of a collection, if they are built.
+ * @return 0 on success, -1 if there is nothing to save or the write failed.
+ */
+int PeachBloom_save(const char* collection);
+
+#endif // PEACH_BLOOM_H
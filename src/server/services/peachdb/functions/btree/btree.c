@@ -0,0 +1,689 @@
+#include "btree.h"
+#include "../checksum/checksum.h"
+#include "../indexfile/indexfile.h"
+#include "../../../metricsService/metricsService.h"
+#include "../../../logService/logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MAX_BTREES 16
+#define BTREE_NAME_LEN 64
+#define BTREE_MAGIC "PEACHBT1"
+#define BTREE_MAX_DEPTH 16
+#define BTREE_MIN_PAGES 16
+
+typedef struct {
+    char value[PEACH_BTREE_VALUE_LEN];
+    int64_t offset;                     // Ties between equal values keep file order
+} BTreeKey;
+
+typedef struct {
+    uint16_t leaf;
+    uint16_t count;                     // Keys in the node
+    uint32_t next;                      // Leaves: the next leaf, 0 for the last one
+} NodeHeader;
+
+#define LEAF_CAPACITY ((PEACH_BTREE_PAGE_SIZE - sizeof(NodeHeader)) / sizeof(BTreeKey))
+#define INNER_CAPACITY ((PEACH_BTREE_PAGE_SIZE - sizeof(NodeHeader) - sizeof(uint32_t) - sizeof(int64_t)) / \
+                        (sizeof(BTreeKey) + sizeof(uint32_t)))
+#define BULK_FILL(capacity) ((capacity) * 7 / 8) // Room for a few inserts before the first splits
+
+typedef struct {
+    NodeHeader header;
+    BTreeKey keys[LEAF_CAPACITY];
+} LeafNode;
+
+// children[i] holds the keys < keys[i]; children[i + 1] the keys >= keys[i].
+typedef struct {
+    NodeHeader header;
+    uint32_t children[INNER_CAPACITY + 1];
+    BTreeKey keys[INNER_CAPACITY];
+} InnerNode;
+
+_Static_assert(sizeof(LeafNode) <= PEACH_BTREE_PAGE_SIZE, "leaf larger than a page");
+_Static_assert(sizeof(InnerNode) <= PEACH_BTREE_PAGE_SIZE, "inner node larger than a page");
+
+typedef struct {
+    char magic[8];
+    uint32_t page_size;
+    uint32_t root;
+    uint32_t page_count;                // Pages in use, the header included
+    int32_t field_index;
+    uint64_t collection_inode;          // The collection file the tree describes...
+    int64_t collection_size;            // ...and its size; -1 forces a rebuild
+    int64_t entry_count;
+} FileHeader;
+
+typedef struct {
+    char name[BTREE_NAME_LEN];
+    char field_name[BTREE_NAME_LEN];
+    char path[256];                     // The collection file
+    char index_path[300];               // The tree file
+    int fd;
+    char* map;
+    size_t map_length;
+    int field_index;                    // Resolved from the header when opened, -1 if unknown
+    bool usable;                        // false if a value is too long to be indexed
+    _Atomic bool ready;
+    pthread_mutex_t build_mutex;        // Serializes opening by concurrent readers
+} BTree;
+
+static BTree g_trees[MAX_BTREES];
+static _Atomic int g_tree_count = 0;
+static pthread_mutex_t g_trees_mutex = PTHREAD_MUTEX_INITIALIZER; // Serializes registration
+
+// --- Pages ---
+
+static FileHeader* file_header(BTree* tree) {
+    return (FileHeader*)tree->map;
+}
+
+static NodeHeader* node_at(const BTree* tree, uint32_t page) {
+    return (NodeHeader*)(tree->map + (size_t)page * PEACH_BTREE_PAGE_SIZE);
+}
+
+static int compare_key(const BTreeKey* key, const char* value, int64_t offset) {
+    int order = strcmp(key->value, value);
+    if (order != 0) return order;
+    return (key->offset > offset) - (key->offset < offset);
+}
+
+static int compare_keys(const void* a, const void* b) {
+    const BTreeKey* right = b;
+    return compare_key(a, right->value, right->offset);
+}
+
+// Child of an inner node that holds 'key': after every separator <= key.
+static int child_slot(const InnerNode* node, const BTreeKey* key) {
+    int low = 0;
+    int high = node->header.count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (compare_key(&node->keys[middle], key->value, key->offset) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// First slot of a leaf whose key is >= 'key'.
+static int leaf_slot(const LeafNode* node, const BTreeKey* key) {
+    int low = 0;
+    int high = node->header.count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (compare_key(&node->keys[middle], key->value, key->offset) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void unmap(BTree* tree) {
+    if (tree->map != NULL) munmap(tree->map, tree->map_length);
+    if (tree->fd >= 0) close(tree->fd);
+    tree->map = NULL;
+    tree->map_length = 0;
+    tree->fd = -1;
+}
+
+// Makes the file (and the mapping) hold at least 'pages' pages.
+static int reserve_pages(BTree* tree, uint32_t pages) {
+    size_t needed = (size_t)pages * PEACH_BTREE_PAGE_SIZE;
+    if (needed <= tree->map_length) return 0;
+    size_t length = tree->map_length * 2 > needed ? tree->map_length * 2 : needed;
+    if (ftruncate(tree->fd, (off_t)length) != 0) return -1;
+    char* map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, tree->fd, 0);
+    if (map == MAP_FAILED) return -1;
+    munmap(tree->map, tree->map_length);
+    tree->map = map;
+    tree->map_length = length;
+    return 0;
+}
+
+// Takes a zeroed page; reserve_pages() must have made room for it.
+static uint32_t new_page(BTree* tree, bool leaf) {
+    uint32_t page = file_header(tree)->page_count++;
+    NodeHeader* node = node_at(tree, page);
+    memset(node, 0, PEACH_BTREE_PAGE_SIZE);
+    node->leaf = leaf;
+    return page;
+}
+
+// --- Changes ---
+
+static int tree_insert(BTree* tree, const BTreeKey* key) {
+    // 1. Every level may split, and the root may grow a level
+    if (reserve_pages(tree, file_header(tree)->page_count + BTREE_MAX_DEPTH + 1) != 0) return -1;
+    FileHeader* header = file_header(tree);
+
+    // 2. Descend to the leaf, remembering the way back up
+    uint32_t path[BTREE_MAX_DEPTH];
+    int slots[BTREE_MAX_DEPTH];
+    int depth = 0;
+    uint32_t page = header->root;
+    while (!node_at(tree, page)->leaf) {
+        if (depth == BTREE_MAX_DEPTH) return -1;
+        InnerNode* inner = (InnerNode*)node_at(tree, page);
+        path[depth] = page;
+        slots[depth] = child_slot(inner, key);
+        page = inner->children[slots[depth]];
+        depth++;
+    }
+
+    // 3. Insert into the leaf, splitting it in two when it is full
+    LeafNode* leaf = (LeafNode*)node_at(tree, page);
+    int slot = leaf_slot(leaf, key);
+    header->entry_count++;
+    if (leaf->header.count < LEAF_CAPACITY) {
+        memmove(&leaf->keys[slot + 1], &leaf->keys[slot], (leaf->header.count - slot) * sizeof(BTreeKey));
+        leaf->keys[slot] = *key;
+        leaf->header.count++;
+        return 0;
+    }
+    BTreeKey keys[LEAF_CAPACITY + 1];
+    memcpy(keys, leaf->keys, slot * sizeof(BTreeKey));
+    keys[slot] = *key;
+    memcpy(&keys[slot + 1], &leaf->keys[slot], (LEAF_CAPACITY - slot) * sizeof(BTreeKey));
+    int left_count = (LEAF_CAPACITY + 1) / 2;
+    uint32_t right_page = new_page(tree, true);
+    LeafNode* right = (LeafNode*)node_at(tree, right_page);
+    memcpy(leaf->keys, keys, left_count * sizeof(BTreeKey));
+    memcpy(right->keys, &keys[left_count], (LEAF_CAPACITY + 1 - left_count) * sizeof(BTreeKey));
+    leaf->header.count = left_count;
+    right->header.count = LEAF_CAPACITY + 1 - left_count;
+    right->header.next = leaf->header.next;
+    leaf->header.next = right_page;
+    BTreeKey separator = right->keys[0];
+
+    // 4. Hand the new node to the parent, splitting full parents on the way up
+    while (depth > 0) {
+        depth--;
+        InnerNode* inner = (InnerNode*)node_at(tree, path[depth]);
+        int position = slots[depth];
+        int count = inner->header.count;
+        if (count < (int)INNER_CAPACITY) {
+            memmove(&inner->keys[position + 1], &inner->keys[position], (count - position) * sizeof(BTreeKey));
+            memmove(&inner->children[position + 2], &inner->children[position + 1],
+                    (count - position) * sizeof(uint32_t));
+            inner->keys[position] = separator;
+            inner->children[position + 1] = right_page;
+            inner->header.count++;
+            return 0;
+        }
+        BTreeKey inner_keys[INNER_CAPACITY + 1];
+        uint32_t children[INNER_CAPACITY + 2];
+        memcpy(inner_keys, inner->keys, position * sizeof(BTreeKey));
+        inner_keys[position] = separator;
+        memcpy(&inner_keys[position + 1], &inner->keys[position], (count - position) * sizeof(BTreeKey));
+        memcpy(children, inner->children, (position + 1) * sizeof(uint32_t));
+        children[position + 1] = right_page;
+        memcpy(&children[position + 2], &inner->children[position + 1], (count - position) * sizeof(uint32_t));
+
+        int middle = (INNER_CAPACITY + 1) / 2; // Moves up instead of staying in either half
+        uint32_t sibling_page = new_page(tree, false);
+        InnerNode* sibling = (InnerNode*)node_at(tree, sibling_page);
+        memcpy(inner->keys, inner_keys, middle * sizeof(BTreeKey));
+        memcpy(inner->children, children, (middle + 1) * sizeof(uint32_t));
+        inner->header.count = middle;
+        int sibling_count = INNER_CAPACITY - middle;
+        memcpy(sibling->keys, &inner_keys[middle + 1], sibling_count * sizeof(BTreeKey));
+        memcpy(sibling->children, &children[middle + 1], (sibling_count + 1) * sizeof(uint32_t));
+        sibling->header.count = sibling_count;
+        separator = inner_keys[middle];
+        right_page = sibling_page;
+    }
+
+    // 5. The root split: the tree grows a level
+    uint32_t root_page = new_page(tree, false);
+    InnerNode* root = (InnerNode*)node_at(tree, root_page);
+    root->children[0] = header->root;
+    root->children[1] = right_page;
+    root->keys[0] = separator;
+    root->header.count = 1;
+    header->root = root_page;
+    return 0;
+}
+
+// Removes one (value, offset) entry. Nodes are never merged; a leaf may become empty.
+static int tree_remove(BTree* tree, const BTreeKey* key) {
+    FileHeader* header = file_header(tree);
+    uint32_t page = header->root;
+    for (int depth = 0; !node_at(tree, page)->leaf; depth++) {
+        if (depth == BTREE_MAX_DEPTH) return -1;
+        InnerNode* inner = (InnerNode*)node_at(tree, page);
+        page = inner->children[child_slot(inner, key)];
+    }
+    LeafNode* leaf = (LeafNode*)node_at(tree, page);
+    int slot = leaf_slot(leaf, key);
+    if (slot == leaf->header.count || compare_key(&leaf->keys[slot], key->value, key->offset) != 0) return -1;
+    memmove(&leaf->keys[slot], &leaf->keys[slot + 1], (leaf->header.count - slot - 1) * sizeof(BTreeKey));
+    leaf->header.count--;
+    header->entry_count--;
+    return 0;
+}
+
+// Moves the offsets past 'after' by 'delta'. The order of the keys does not
+// change: the records past the changed one stay past it.
+static void shift_offsets(BTree* tree, long after, long delta) {
+    uint32_t page_count = file_header(tree)->page_count;
+    for (uint32_t page = 1; page < page_count; page++) {
+        NodeHeader* node = node_at(tree, page);
+        BTreeKey* keys = node->leaf ? ((LeafNode*)node)->keys : ((InnerNode*)node)->keys;
+        for (int i = 0; i < node->count; i++) {
+            if (keys[i].offset > after) keys[i].offset += delta;
+        }
+    }
+}
+
+// Records which collection file the tree now describes.
+static void remember_collection(BTree* tree) {
+    struct stat st;
+    FileHeader* header = file_header(tree);
+    if (stat(tree->path, &st) == 0) {
+        header->collection_inode = (uint64_t)st.st_ino;
+        header->collection_size = (int64_t)st.st_size;
+    } else {
+        header->collection_size = -1;
+    }
+}
+
+// --- Building ---
+
+// Copies field 'field_index' of a '^'-separated line; a missing field reads as "".
+// Returns false if the value does not fit.
+static bool copy_field(const char* line, int field_index, char* out, size_t size) {
+    const char* start = line;
+    for (int i = 0; i < field_index; i++) {
+        start = strchr(start, '^');
+        if (start == NULL) {
+            out[0] = '\0';
+            return true;
+        }
+        start++;
+    }
+    size_t len = strcspn(start, "^\n");
+    if (len >= size) return false;
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return true;
+}
+
+static int resolve_field(BTree* tree, char* header) {
+    header[strcspn(header, "\n")] = '\0';
+    int field = 0;
+    char* saveptr = NULL;
+    for (char* name = strtok_r(header, "^", &saveptr); name != NULL; name = strtok_r(NULL, "^", &saveptr)) {
+        if (strcmp(name, tree->field_name) == 0) return field;
+        field++;
+    }
+    LOG_WARN("peachdb", "B+tree field '%s' not found in collection '%s'.", tree->field_name, tree->name);
+    return -1;
+}
+
+// Appends one level of inner nodes above 'pages'; returns the number of nodes written.
+static int write_inner_level(FILE* file, uint32_t* next_page, const uint32_t* pages, const BTreeKey* first_keys,
+                             int count, uint32_t* out_pages, BTreeKey* out_first_keys) {
+    int fanout = BULK_FILL(INNER_CAPACITY) + 1;
+    int written = 0;
+    for (int start = 0; start < count; start += fanout) {
+        int children = count - start < fanout ? count - start : fanout;
+        InnerNode node;
+        memset(&node, 0, sizeof(node));
+        node.header.count = (uint16_t)(children - 1);
+        for (int i = 0; i < children; i++) {
+            node.children[i] = pages[start + i];
+            if (i > 0) node.keys[i - 1] = first_keys[start + i];
+        }
+        char page[PEACH_BTREE_PAGE_SIZE] = {0};
+        memcpy(page, &node, sizeof(node));
+        if (fwrite(page, sizeof(page), 1, file) != 1) return -1;
+        out_pages[written] = (*next_page)++;
+        out_first_keys[written] = first_keys[start];
+        written++;
+    }
+    return written;
+}
+
+// Bulk-loads the tree from the sorted records of the collection file, through a
+// temporary file and a rename.
+static int rebuild(BTree* tree) {
+    FILE* collection = fopen(tree->path, "r");
+    if (collection == NULL) return -1;
+    struct stat st;
+    if (fstat(fileno(collection), &st) != 0) {
+        fclose(collection);
+        return -1;
+    }
+
+    // 1. Collect (value, offset) of every record and sort them
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length = getline(&line, &line_capacity, collection);
+    long offset = length > 0 ? (long)length : 0;
+    BTreeKey* keys = NULL;
+    size_t key_count = 0;
+    size_t key_capacity = 0;
+    int status = 0;
+    while (status == 0 && tree->usable && (length = getline(&line, &line_capacity, collection)) >= 0) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] != '\0' && PeachChecksum_strip(line) != PEACH_LINE_CORRUPT) {
+            if (key_count == key_capacity) {
+                size_t capacity = key_capacity > 0 ? key_capacity * 2 : 1024;
+                BTreeKey* grown = realloc(keys, capacity * sizeof(BTreeKey));
+                if (grown == NULL) {
+                    status = -1;
+                    break;
+                }
+                keys = grown;
+                key_capacity = capacity;
+            }
+            BTreeKey* key = &keys[key_count];
+            memset(key, 0, sizeof(*key));
+            if (copy_field(line, tree->field_index, key->value, sizeof(key->value))) {
+                key->offset = offset;
+                key_count++;
+            } else {
+                tree->usable = false;
+            }
+        }
+        offset += (long)length;
+    }
+    free(line);
+    fclose(collection);
+    Metrics_add_db_io(tree->name, (size_t)offset, 0);
+    if (status != 0 || !tree->usable) {
+        free(keys);
+        return status;
+    }
+    if (key_count > 0) qsort(keys, key_count, sizeof(BTreeKey), compare_keys);
+
+    // 2. Leaves, left to right, then the inner levels above them
+    char temp_path[310];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", tree->index_path);
+    FILE* file = fopen(temp_path, "w");
+    if (file == NULL) {
+        LOG_ERROR("peachdb", "Could not write B+tree %s: %s", tree->index_path, strerror(errno));
+        free(keys);
+        return -1;
+    }
+    char page[PEACH_BTREE_PAGE_SIZE] = {0};
+    fwrite(page, sizeof(page), 1, file); // The header comes last
+
+    size_t per_leaf = BULK_FILL(LEAF_CAPACITY);
+    int leaf_count = key_count > 0 ? (int)((key_count + per_leaf - 1) / per_leaf) : 1;
+    uint32_t* pages = malloc((size_t)leaf_count * sizeof(uint32_t));
+    BTreeKey* first_keys = malloc((size_t)leaf_count * sizeof(BTreeKey));
+    uint32_t next_page = 1;
+    status = (pages != NULL && first_keys != NULL) ? 0 : -1;
+    for (int i = 0; status == 0 && i < leaf_count; i++) {
+        size_t start = (size_t)i * per_leaf;
+        size_t count = key_count - start < per_leaf ? key_count - start : per_leaf;
+        if (key_count == 0) count = 0;
+        LeafNode* leaf = (LeafNode*)page;
+        memset(page, 0, sizeof(page));
+        leaf->header.leaf = 1;
+        leaf->header.count = (uint16_t)count;
+        leaf->header.next = i + 1 < leaf_count ? next_page + 1 : 0;
+        if (count > 0) memcpy(leaf->keys, &keys[start], count * sizeof(BTreeKey));
+        if (fwrite(page, sizeof(page), 1, file) != 1) status = -1;
+        pages[i] = next_page++;
+        if (count > 0) first_keys[i] = keys[start];
+    }
+    int level_count = leaf_count;
+    while (status == 0 && level_count > 1) {
+        level_count = write_inner_level(file, &next_page, pages, first_keys, level_count, pages, first_keys);
+        if (level_count < 0) status = -1;
+    }
+
+    // 3. The header, pointing at the root
+    FileHeader* header = (FileHeader*)page;
+    memset(page, 0, sizeof(page));
+    memcpy(header->magic, BTREE_MAGIC, sizeof(header->magic));
+    header->page_size = PEACH_BTREE_PAGE_SIZE;
+    header->root = status == 0 ? pages[0] : 0;
+    header->page_count = next_page;
+    header->field_index = tree->field_index;
+    header->collection_inode = (uint64_t)st.st_ino;
+    header->collection_size = (int64_t)st.st_size;
+    header->entry_count = (int64_t)key_count;
+    if (status == 0 && (fseek(file, 0, SEEK_SET) != 0 || fwrite(page, sizeof(page), 1, file) != 1)) status = -1;
+    if (fclose(file) != 0) status = -1;
+    if (status == 0 && rename(temp_path, tree->index_path) != 0) status = -1;
+    if (status != 0) remove(temp_path);
+    free(pages);
+    free(first_keys);
+    free(keys);
+    if (status == 0) {
+        LOG_INFO("peachdb", "Built B+tree %s (%zu entries, %u pages).", tree->index_path, key_count, next_page);
+    }
+    return status;
+}
+
+// Maps the tree file if it describes the collection file as it is now.
+static int map_tree(BTree* tree) {
+    tree->fd = open(tree->index_path, O_RDWR);
+    if (tree->fd < 0) return -1;
+    struct stat st;
+    struct stat collection_st;
+    if (fstat(tree->fd, &st) != 0 || st.st_size < PEACH_BTREE_PAGE_SIZE || st.st_size % PEACH_BTREE_PAGE_SIZE != 0 ||
+        stat(tree->path, &collection_st) != 0) {
+        unmap(tree);
+        return -1;
+    }
+    tree->map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, tree->fd, 0);
+    if (tree->map == MAP_FAILED) {
+        tree->map = NULL;
+        unmap(tree);
+        return -1;
+    }
+    tree->map_length = (size_t)st.st_size;
+
+    FileHeader* header = file_header(tree);
+    bool valid = memcmp(header->magic, BTREE_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->page_size == PEACH_BTREE_PAGE_SIZE &&
+                 (size_t)header->page_count * PEACH_BTREE_PAGE_SIZE <= tree->map_length &&
+                 header->root > 0 && header->root < header->page_count &&
+                 header->field_index == tree->field_index &&
+                 header->collection_inode == (uint64_t)collection_st.st_ino &&
+                 header->collection_size == (int64_t)collection_st.st_size;
+    if (!valid) {
+        unmap(tree);
+        return -1;
+    }
+    return reserve_pages(tree, BTREE_MIN_PAGES);
+}
+
+static int open_tree(BTree* tree) {
+    // 1. Resolve the field from the collection header
+    FILE* collection = fopen(tree->path, "r");
+    if (collection == NULL) return -1;
+    char header[4096];
+    int status = fgets(header, sizeof(header), collection) != NULL ? 0 : -1;
+    fclose(collection);
+    if (status != 0) return -1;
+    tree->field_index = resolve_field(tree, header);
+    tree->usable = tree->field_index >= 0;
+    if (!tree->usable) return 0;
+
+    // 2. Map the file, or rebuild it when it is missing or out of date
+    if (map_tree(tree) == 0) return 0;
+    if (rebuild(tree) != 0) return -1;
+    if (!tree->usable) {
+        LOG_WARN("peachdb", "Values of '%s.%s' are too long for a B+tree; lookups will scan.", tree->name, tree->field_name);
+        return 0;
+    }
+    return map_tree(tree);
+}
+
+static bool ensure_ready(BTree* tree) {
+    if (atomic_load_explicit(&tree->ready, memory_order_acquire)) return true;
+    pthread_mutex_lock(&tree->build_mutex);
+    if (!atomic_load_explicit(&tree->ready, memory_order_relaxed)) {
+        unmap(tree);
+        if (open_tree(tree) == 0) {
+            atomic_store_explicit(&tree->ready, true, memory_order_release);
+        } else {
+            unmap(tree);
+        }
+    }
+    pthread_mutex_unlock(&tree->build_mutex);
+    return atomic_load_explicit(&tree->ready, memory_order_acquire);
+}
+
+// Drops a tree that fell out of step with its collection; the next use rebuilds it.
+static void drop_tree(BTree* tree) {
+    LOG_WARN("peachdb", "B+tree %s is out of date; it will be rebuilt.", tree->index_path);
+    file_header(tree)->collection_size = -1;
+    unmap(tree);
+    atomic_store_explicit(&tree->ready, false, memory_order_release);
+}
+
+// --- Registry ---
+
+static BTree* find_tree(const char* collection, const char* field_name) {
+    int count = atomic_load_explicit(&g_tree_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_trees[i].name, collection) == 0 && strcmp(g_trees[i].field_name, field_name) == 0) {
+            return &g_trees[i];
+        }
+    }
+    return NULL;
+}
+
+int PeachBTree_declare(const char* collection, const char* collection_path, const char* field_name) {
+    if (find_tree(collection, field_name) != NULL) return 0; // Fast path
+
+    pthread_mutex_lock(&g_trees_mutex);
+    int status = 0;
+    if (find_tree(collection, field_name) == NULL) {
+        int count = atomic_load_explicit(&g_tree_count, memory_order_relaxed);
+        if (count >= MAX_BTREES || strlen(collection) >= BTREE_NAME_LEN || strlen(field_name) >= BTREE_NAME_LEN) {
+            status = -1;
+        } else {
+            BTree* tree = &g_trees[count];
+            snprintf(tree->name, sizeof(tree->name), "%s", collection);
+            snprintf(tree->field_name, sizeof(tree->field_name), "%s", field_name);
+            snprintf(tree->path, sizeof(tree->path), "%s", collection_path);
+            snprintf(tree->index_path, sizeof(tree->index_path), "%s/%s.%s.idx",
+                     PEACH_INDEX_SNAPSHOT_PATH, collection, field_name);
+            tree->fd = -1;
+            tree->field_index = -1;
+            pthread_mutex_init(&tree->build_mutex, NULL);
+            atomic_store_explicit(&g_tree_count, count + 1, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&g_trees_mutex);
+    return status;
+}
+
+int PeachBTree_field(const char* collection, const char* field_name) {
+    BTree* tree = find_tree(collection, field_name);
+    if (tree == NULL || !ensure_ready(tree) || !tree->usable) return -1;
+    return tree->field_index;
+}
+
+int PeachBTree_seek(const char* collection, const char* field_name, const char* lo, PeachBTreeCursor* out) {
+    BTree* tree = find_tree(collection, field_name);
+    if (tree == NULL || !ensure_ready(tree) || !tree->usable) return -1;
+
+    BTreeKey key = { .offset = INT64_MIN };
+    snprintf(key.value, sizeof(key.value), "%s", lo != NULL ? lo : "");
+    uint32_t page = file_header(tree)->root;
+    for (int depth = 0; !node_at(tree, page)->leaf && depth < BTREE_MAX_DEPTH; depth++) {
+        InnerNode* inner = (InnerNode*)node_at(tree, page);
+        page = inner->children[child_slot(inner, &key)];
+    }
+    out->tree = tree;
+    out->page = page;
+    out->slot = leaf_slot((LeafNode*)node_at(tree, page), &key);
+    return 0;
+}
+
+bool PeachBTree_next(PeachBTreeCursor* cursor, const char** out_value, long* out_offset) {
+    const BTree* tree = cursor->tree;
+    while (cursor->page != 0) {
+        const LeafNode* leaf = (const LeafNode*)node_at(tree, cursor->page);
+        if (cursor->slot < leaf->header.count) {
+            const BTreeKey* key = &leaf->keys[cursor->slot++];
+            *out_value = key->value;
+            *out_offset = (long)key->offset;
+            return true;
+        }
+        cursor->page = leaf->header.next;
+        cursor->slot = 0;
+    }
+    return false;
+}
+
+void PeachBTree_on_append(const char* collection, const char* record_str, long offset, size_t line_length) {
+    int count = atomic_load_explicit(&g_tree_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        BTree* tree = &g_trees[i];
+        if (strcmp(tree->name, collection) != 0) continue;
+        if (!atomic_load_explicit(&tree->ready, memory_order_acquire) || !tree->usable) continue; // Checked when opened
+
+        BTreeKey key = { .offset = offset };
+        if (file_header(tree)->collection_size != offset ||
+            !copy_field(record_str, tree->field_index, key.value, sizeof(key.value)) ||
+            tree_insert(tree, &key) != 0) {
+            drop_tree(tree);
+            continue;
+        }
+        file_header(tree)->collection_size = offset + (long)line_length;
+    }
+}
+
+void PeachBTree_on_rewrite(const char* collection, long offset, const char* old_record, size_t old_length,
+                           const char* new_record, size_t new_length) {
+    int count = atomic_load_explicit(&g_tree_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        BTree* tree = &g_trees[i];
+        if (strcmp(tree->name, collection) != 0) continue;
+        if (!atomic_load_explicit(&tree->ready, memory_order_acquire) || !tree->usable) continue;
+
+        BTreeKey old_key = { .offset = offset };
+        BTreeKey new_key = { .offset = offset };
+        if (!copy_field(old_record, tree->field_index, old_key.value, sizeof(old_key.value)) ||
+            tree_remove(tree, &old_key) != 0) {
+            drop_tree(tree);
+            continue;
+        }
+        shift_offsets(tree, offset, (long)new_length - (long)old_length);
+        if (new_record != NULL && (!copy_field(new_record, tree->field_index, new_key.value, sizeof(new_key.value)) ||
+                                   tree_insert(tree, &new_key) != 0)) {
+            drop_tree(tree);
+            continue;
+        }
+        remember_collection(tree); // The rewrite is a new file
+    }
+}
+
+void PeachBTree_invalidate(const char* collection) {
+    int count = atomic_load_explicit(&g_tree_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_trees[i].name, collection) == 0) {
+            atomic_store_explicit(&g_trees[i].ready, false, memory_order_release);
+        }
+    }
+}
+
+void PeachBTree_load(const char* collection) {
+    int count = atomic_load_explicit(&g_tree_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_trees[i].name, collection) == 0) ensure_ready(&g_trees[i]);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef PEACH_BTREE_H
+#define PEACH_BTREE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*==================[ PEACHDB B+TREE INDEXES ]====================
+ * Persistent, ordered indexes from a text field to record offsets, kept
+ * in peachdata/indexes/<collection>.<field>.idx and read through mmap,
+ * so they do not have to fit in RAM and need no rebuild after a restart.
+ *
+ * - The file is a B+tree of PEACH_BTREE_PAGE_SIZE pages. Page 0 is the
+ *   header; leaves hold (value, offset) pairs in order and are chained
+ *   for ordered iteration. Equal values are ordered by offset, i.e. in
+ *   file order.
+ * - Appends insert their record; updates and deletes (which rewrite the
+ *   collection) remove and insert the changed record and move the
+ *   offsets of the records after it. Emptied leaves are not merged.
+ * - The header remembers the inode and size of the collection file it
+ *   describes. A tree that does not match its collection file (e.g.
+ *   after a crash or a repair) is rebuilt from the file when opened.
+ *   Writes to the tree are not synced: a power failure may require such
+ *   a rebuild, never a wrong answer from a matching file.
+ * - Values longer than PEACH_BTREE_VALUE_LEN - 1 bytes make the tree
+ *   unusable (lookups fall back to scans), like the time index.
+ *
+ * Callers must hold the collection's lock (see locks.h): shared for
+ * lookups and iteration, exclusive for the on_* hooks.
+ ==========================================================*/
+
+#define PEACH_BTREE_PAGE_SIZE 4096
+#define PEACH_BTREE_VALUE_LEN 48
+
+// Position in a tree; valid while the collection lock is held.
+typedef struct {
+    const void* tree;
+    uint32_t page;          // Current leaf, 0 at the end
+    int slot;
+} PeachBTreeCursor;
+
+/**
+ * @brief Declares a B+tree on a field of a collection (idempotent).
+ * @param collection The collection name.
+ * @param collection_path Path of the collection file, used to (re)build the tree.
+ * @param field_name The indexed field.
+ * @return 0 on success, -1 if the tree table is full or a name is too long.
+ */
+int PeachBTree_declare(const char* collection, const char* collection_path, const char* field_name);
+
+/**
+ * @brief Returns the position of the indexed field in the collection header,
+ *        or -1 if the field has no usable tree.
+ */
+int PeachBTree_field(const char* collection, const char* field_name);
+
+/**
+ * @brief Positions a cursor on the first entry whose value is >= lo.
+ * @param lo The lower bound, or NULL to start at the smallest value.
+ * @return 0 on success, -1 if the field has no usable tree.
+ */
+int PeachBTree_seek(const char* collection, const char* field_name, const char* lo, PeachBTreeCursor* out);
+
+/**
+ * @brief Reads the entry under the cursor and moves to the next one, in value order.
+ * @param out_value Receives the value (points into the tree).
+ * @param out_offset Receives the offset of the record in the collection file.
+ * @return false at the end of the tree.
+ */
+bool PeachBTree_next(PeachBTreeCursor* cursor, const char** out_value, long* out_offset);
+
+/**
+ * @brief Adds an appended record to the trees of its collection.
+ * @param record_str The record, without checksum or newline.
+ * @param offset Where the record starts in the collection file.
+ * @param line_length Bytes the record's line takes (checksum and newline included).
+ */
+void PeachBTree_on_append(const char* collection, const char* record_str, long offset, size_t line_length);
+
+/**
+ * @brief Follows a rewrite that replaced or removed one record of the collection.
+ * @param offset Where the changed record starts.
+ * @param old_record The record before the change, without checksum.
+ * @param old_length Bytes its line took.
+ * @param new_record The record after the change, or NULL if it was deleted.
+ * @param new_length Bytes its line takes now (0 if deleted).
+ */
+void PeachBTree_on_rewrite(const char* collection, long offset, const char* old_record, size_t old_length,
+                           const char* new_record, size_t new_length);
+
+/**
+ * @brief Makes the trees of a collection check their file against the collection on next use.
+ */
+void PeachBTree_invalidate(const char* collection);
+
+/**
+ * @brief Opens (or rebuilds) the trees of a collection now instead of on first use.
+ */
+void PeachBTree_load(const char* collection);
+
+#endif // PEACH_BTREE_H
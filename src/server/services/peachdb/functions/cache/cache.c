@@ -0,0 +1,567 @@
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define MAX_CACHED_COLLECTIONS 64
+#define CACHE_NAME_LEN 64
+#define SLOT_EMPTY -1
+#define SLOT_DELETED -2
+
+// One record, stored as a single '\0'-separated copy of its line.
+typedef struct {
+    char* line;
+    size_t line_len;   // Bytes in 'line', including the embedded separators
+    char** fields;     // Points into 'line'; missing trailing fields are NULL
+    bool live;         // false once the record is deleted
+} CachedRecord;
+
+typedef struct {
+    char name[CACHE_NAME_LEN];
+    int num_fields;
+    CachedRecord* records; // File order
+    size_t count;          // Slots used in 'records' (live + deleted)
+    size_t capacity;
+    size_t dead;           // Deleted records not compacted yet
+    int32_t* slots;        // Open-addressing hash table: key -> record index
+    size_t slot_count;     // Power of two
+    size_t slot_used;      // Occupied or deleted slots
+    bool has_duplicates;   // File contains repeated keys; hooks fall back to invalidation
+    long highest_key;
+    size_t payload_bytes;  // Record lines and field arrays, including deleted records
+    size_t bytes;          // Approximate memory footprint
+    bool referenced;       // CLOCK bit
+    bool evicted;          // Removed from the table, freed by the last unpin
+    int pins;              // Readers currently copying records out
+} CacheEntry;
+
+static pthread_mutex_t g_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CacheEntry* g_entries[MAX_CACHED_COLLECTIONS]; // Protected by g_cache_mutex
+static size_t g_budget = PEACH_CACHE_DEFAULT_BUDGET;
+static size_t g_total_bytes = 0;
+static int g_clock_hand = 0;
+
+// --- Entry helpers (no locking) ---
+
+static uint64_t hash_key(const char* key) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)key; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t record_bytes(const CachedRecord* record, int num_fields) {
+    return record->line_len + 1 + (size_t)num_fields * sizeof(char*);
+}
+
+static void recompute_bytes(CacheEntry* entry) {
+    entry->bytes = sizeof(CacheEntry) + entry->capacity * sizeof(CachedRecord) +
+                   entry->slot_count * sizeof(int32_t) + entry->payload_bytes;
+}
+
+static void free_entry(CacheEntry* entry) {
+    if (entry == NULL) return;
+    for (size_t i = 0; i < entry->count; i++) {
+        free(entry->records[i].line);
+        free(entry->records[i].fields);
+    }
+    free(entry->records);
+    free(entry->slots);
+    free(entry);
+}
+
+// Returns the slot holding 'key', or the first free slot if it is absent.
+static size_t find_slot(const CacheEntry* entry, const char* key, bool* found) {
+    size_t mask = entry->slot_count - 1;
+    size_t index = (size_t)hash_key(key) & mask;
+    size_t first_deleted = SIZE_MAX;
+    *found = false;
+    for (;;) {
+        int32_t slot = entry->slots[index];
+        if (slot == SLOT_EMPTY) {
+            return first_deleted != SIZE_MAX ? first_deleted : index;
+        }
+        if (slot == SLOT_DELETED) {
+            if (first_deleted == SIZE_MAX) first_deleted = index;
+        } else if (strcmp(entry->records[slot].fields[0], key) == 0) {
+            *found = true;
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+static int rebuild_slots(CacheEntry* entry, size_t min_records) {
+    size_t slot_count = 16;
+    while (slot_count < min_records * 2) slot_count <<= 1;
+    int32_t* slots = malloc(slot_count * sizeof(int32_t));
+    if (slots == NULL) return -1;
+    for (size_t i = 0; i < slot_count; i++) slots[i] = SLOT_EMPTY;
+
+    free(entry->slots);
+    entry->slots = slots;
+    entry->slot_count = slot_count;
+    entry->slot_used = 0;
+    entry->has_duplicates = false;
+
+    for (size_t i = 0; i < entry->count; i++) {
+        CachedRecord* record = &entry->records[i];
+        if (!record->live || record->fields[0][0] == '\0') continue;
+        bool found;
+        size_t index = find_slot(entry, record->fields[0], &found);
+        if (found) {
+            entry->has_duplicates = true;
+            continue;
+        }
+        entry->slots[index] = (int32_t)i;
+        entry->slot_used++;
+    }
+    return 0;
+}
+
+// Splits a record line the same way Peach_read_all_records does.
+static int fill_record(CachedRecord* record, const char* line, int num_fields) {
+    size_t len = strlen(line);
+    record->line = malloc(len + 1);
+    record->fields = calloc(num_fields > 0 ? num_fields : 1, sizeof(char*));
+    if (record->line == NULL || record->fields == NULL) {
+        free(record->line);
+        free(record->fields);
+        record->line = NULL;
+        record->fields = NULL;
+        return -1;
+    }
+    memcpy(record->line, line, len + 1);
+    record->line_len = len;
+    record->fields[0] = record->line;
+    int field_index = 1;
+    for (char* p = record->line; *p != '\0' && field_index < num_fields; p++) {
+        if (*p == '^') {
+            *p = '\0';
+            record->fields[field_index++] = p + 1;
+        }
+    }
+    record->live = true;
+    return 0;
+}
+
+static void recompute_highest_key(CacheEntry* entry) {
+    long highest = 0;
+    for (size_t i = 0; i < entry->count; i++) {
+        if (!entry->records[i].live) continue;
+        long key = atol(entry->records[i].fields[0]);
+        if (key > highest) highest = key;
+    }
+    entry->highest_key = highest;
+}
+
+static int reserve_records(CacheEntry* entry, size_t needed) {
+    if (needed <= entry->capacity) return 0;
+    size_t capacity = entry->capacity ? entry->capacity : 64;
+    while (capacity < needed) capacity *= 2;
+    CachedRecord* grown = realloc(entry->records, capacity * sizeof(CachedRecord));
+    if (grown == NULL) return -1;
+    entry->records = grown;
+    entry->capacity = capacity;
+    return 0;
+}
+
+// Drops deleted records once they make up half of the entry.
+static int maybe_compact(CacheEntry* entry) {
+    if (entry->dead < 64 || entry->dead * 2 < entry->count) return 0;
+    size_t write = 0;
+    for (size_t read = 0; read < entry->count; read++) {
+        if (entry->records[read].live) {
+            entry->records[write++] = entry->records[read];
+        } else {
+            entry->payload_bytes -= record_bytes(&entry->records[read], entry->num_fields);
+            free(entry->records[read].line);
+            free(entry->records[read].fields);
+        }
+    }
+    entry->count = write;
+    entry->dead = 0;
+    return rebuild_slots(entry, entry->count);
+}
+
+// --- Table helpers (g_cache_mutex held) ---
+
+static int find_entry_index(const char* collection) {
+    for (int i = 0; i < MAX_CACHED_COLLECTIONS; i++) {
+        if (g_entries[i] != NULL && strcmp(g_entries[i]->name, collection) == 0) return i;
+    }
+    return -1;
+}
+
+static void remove_entry_at(int index) {
+    CacheEntry* entry = g_entries[index];
+    g_entries[index] = NULL;
+    g_total_bytes -= entry->bytes;
+    if (entry->pins > 0) {
+        entry->evicted = true; // The last reader frees it
+    } else {
+        free_entry(entry);
+    }
+}
+
+// CLOCK sweep: evicts unreferenced collections until 'incoming' more bytes fit.
+static void evict_for(size_t incoming) {
+    int passes = 0;
+    while (g_total_bytes + incoming > g_budget && passes < 2 * MAX_CACHED_COLLECTIONS) {
+        CacheEntry* entry = g_entries[g_clock_hand];
+        if (entry != NULL) {
+            if (entry->referenced) {
+                entry->referenced = false;
+            } else {
+                remove_entry_at(g_clock_hand);
+            }
+        }
+        g_clock_hand = (g_clock_hand + 1) % MAX_CACHED_COLLECTIONS;
+        passes++;
+    }
+}
+
+// Re-accounts an entry after an in-place change; drops it if it outgrew the budget.
+static void account_change(int index, size_t old_bytes) {
+    CacheEntry* entry = g_entries[index];
+    g_total_bytes = g_total_bytes - old_bytes + entry->bytes;
+    if (entry->bytes > g_budget) {
+        remove_entry_at(index);
+        return;
+    }
+    if (g_total_bytes > g_budget) {
+        entry->referenced = true; // Keep the collection that was just written
+        evict_for(0);
+    }
+}
+
+// Pins an entry so it survives a concurrent eviction. Returns NULL on a miss.
+static CacheEntry* pin_entry(const char* collection) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    CacheEntry* entry = index >= 0 ? g_entries[index] : NULL;
+    if (entry != NULL) {
+        entry->referenced = true;
+        entry->pins++;
+    }
+    pthread_mutex_unlock(&g_cache_mutex);
+    return entry;
+}
+
+static void unpin_entry(CacheEntry* entry) {
+    pthread_mutex_lock(&g_cache_mutex);
+    entry->pins--;
+    if (entry->evicted && entry->pins == 0) free_entry(entry);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+// --- Public API ---
+
+void PeachCache_set_budget(size_t budget_bytes) {
+    pthread_mutex_lock(&g_cache_mutex);
+    g_budget = budget_bytes;
+    for (int i = 0; i < MAX_CACHED_COLLECTIONS; i++) {
+        if (g_entries[i] != NULL && g_entries[i]->bytes > g_budget) remove_entry_at(i);
+    }
+    evict_for(0);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+PeachRecordSet* PeachCache_lookup(const char* collection) {
+    // 1. Pin the entry so it survives a concurrent eviction while we copy
+    CacheEntry* entry = pin_entry(collection);
+    if (entry == NULL) return NULL;
+
+    // 2. Copy the live records into a caller-owned set
+    PeachRecordSet* set = calloc(1, sizeof(PeachRecordSet));
+    if (set != NULL) {
+        set->num_fields = entry->num_fields;
+        PeachRecord* tail = NULL;
+        for (size_t i = 0; i < entry->count; i++) {
+            const CachedRecord* cached = &entry->records[i];
+            if (!cached->live) continue;
+
+            PeachRecord* record = calloc(1, sizeof(PeachRecord));
+            char* line = malloc(cached->line_len + 1);
+            char** fields = calloc(entry->num_fields, sizeof(char*));
+            if (record == NULL || line == NULL || fields == NULL) {
+                free(record);
+                free(line);
+                free(fields);
+                Peach_free_record_set(set);
+                set = NULL;
+                break;
+            }
+            memcpy(line, cached->line, cached->line_len + 1);
+            for (int f = 0; f < entry->num_fields; f++) {
+                fields[f] = cached->fields[f] ? line + (cached->fields[f] - cached->line) : NULL;
+            }
+            record->fields = fields;
+            record->num_fields = entry->num_fields;
+
+            if (tail == NULL) set->head = record; else tail->next = record;
+            tail = record;
+            set->record_count++;
+        }
+    }
+
+    // 3. Unpin
+    unpin_entry(entry);
+    return set;
+}
+
+int PeachCache_field_count(const char* collection) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    int num_fields = index >= 0 ? g_entries[index]->num_fields : -1;
+    pthread_mutex_unlock(&g_cache_mutex);
+    return num_fields;
+}
+
+int PeachCache_scan(const char* collection, PeachCacheVisitor visit, void* context) {
+    CacheEntry* entry = pin_entry(collection);
+    if (entry == NULL) return -1;
+
+    for (size_t i = 0; i < entry->count; i++) {
+        const CachedRecord* record = &entry->records[i];
+        if (record->live && !visit(record->fields, entry->num_fields, context)) break;
+    }
+    int num_fields = entry->num_fields;
+    unpin_entry(entry);
+    return num_fields;
+}
+
+void PeachCache_store(const char* collection, const PeachRecordSet* record_set) {
+    if (record_set == NULL || strlen(collection) >= CACHE_NAME_LEN) return;
+
+    // 1. Cheap checks before building a copy
+    pthread_mutex_lock(&g_cache_mutex);
+    size_t budget = g_budget;
+    bool cached = find_entry_index(collection) >= 0;
+    pthread_mutex_unlock(&g_cache_mutex);
+    if (cached || budget == 0) return;
+
+    // 2. Build the entry outside the lock
+    CacheEntry* entry = calloc(1, sizeof(CacheEntry));
+    if (entry == NULL) return;
+    snprintf(entry->name, sizeof(entry->name), "%s", collection);
+    entry->num_fields = record_set->num_fields;
+    if (reserve_records(entry, (size_t)record_set->record_count + 1) != 0) {
+        free_entry(entry);
+        return;
+    }
+
+    for (PeachRecord* rec = record_set->head; rec != NULL; rec = rec->next) {
+        CachedRecord* record = &entry->records[entry->count];
+        size_t len = 0;
+        for (int f = 0; f < rec->num_fields && rec->fields[f] != NULL; f++) {
+            len += strlen(rec->fields[f]) + 1;
+        }
+        record->line = malloc(len > 0 ? len : 1);
+        record->fields = calloc(entry->num_fields > 0 ? entry->num_fields : 1, sizeof(char*));
+        if (record->line == NULL || record->fields == NULL) {
+            free(record->line);
+            free(record->fields);
+            free_entry(entry);
+            return;
+        }
+        // Fields are stored back to back, exactly like the tokenized line
+        char* cursor = record->line;
+        for (int f = 0; f < rec->num_fields && rec->fields[f] != NULL; f++) {
+            size_t field_len = strlen(rec->fields[f]);
+            memcpy(cursor, rec->fields[f], field_len + 1);
+            record->fields[f] = cursor;
+            cursor += field_len + 1;
+        }
+        if (len == 0) record->line[0] = '\0';
+        record->line_len = len > 0 ? len - 1 : 0;
+        record->live = true;
+        entry->count++;
+
+        entry->payload_bytes += record_bytes(record, entry->num_fields);
+        if (entry->payload_bytes > budget) { // Too large to ever fit
+            free_entry(entry);
+            return;
+        }
+    }
+    if (rebuild_slots(entry, entry->count) != 0) {
+        free_entry(entry);
+        return;
+    }
+    recompute_highest_key(entry);
+    recompute_bytes(entry);
+
+    // 3. Publish, evicting other collections if needed
+    pthread_mutex_lock(&g_cache_mutex);
+    if (find_entry_index(collection) >= 0 || entry->bytes > g_budget) {
+        pthread_mutex_unlock(&g_cache_mutex);
+        free_entry(entry);
+        return;
+    }
+    evict_for(entry->bytes);
+    int free_index = -1;
+    for (int i = 0; i < MAX_CACHED_COLLECTIONS; i++) {
+        if (g_entries[i] == NULL) {
+            free_index = i;
+            break;
+        }
+    }
+    if (free_index < 0 || g_total_bytes + entry->bytes > g_budget) {
+        pthread_mutex_unlock(&g_cache_mutex);
+        free_entry(entry);
+        return;
+    }
+    entry->referenced = true;
+    g_entries[free_index] = entry;
+    g_total_bytes += entry->bytes;
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+int PeachCache_contains_key(const char* collection, const char* key) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    if (index < 0) {
+        pthread_mutex_unlock(&g_cache_mutex);
+        return -1;
+    }
+    CacheEntry* entry = g_entries[index];
+    entry->referenced = true;
+    bool found;
+    find_slot(entry, key, &found);
+    pthread_mutex_unlock(&g_cache_mutex);
+    return found ? 1 : 0;
+}
+
+bool PeachCache_highest_key(const char* collection, long* out_key) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    if (index >= 0) {
+        g_entries[index]->referenced = true;
+        *out_key = g_entries[index]->highest_key;
+    }
+    pthread_mutex_unlock(&g_cache_mutex);
+    return index >= 0;
+}
+
+void PeachCache_on_append(const char* collection, const char* record_str) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    if (index < 0) {
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+    CacheEntry* entry = g_entries[index];
+    size_t old_bytes = entry->bytes;
+
+    if (reserve_records(entry, entry->count + 1) != 0 ||
+        fill_record(&entry->records[entry->count], record_str, entry->num_fields) != 0) {
+        remove_entry_at(index);
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+    CachedRecord* record = &entry->records[entry->count];
+    entry->count++;
+    entry->payload_bytes += record_bytes(record, entry->num_fields);
+
+    if ((entry->slot_used + 1) * 2 > entry->slot_count) {
+        if (rebuild_slots(entry, entry->count) != 0) {
+            remove_entry_at(index);
+            pthread_mutex_unlock(&g_cache_mutex);
+            return;
+        }
+    } else if (record->fields[0][0] != '\0') {
+        bool found;
+        size_t slot = find_slot(entry, record->fields[0], &found);
+        if (found) {
+            entry->has_duplicates = true;
+        } else {
+            if (entry->slots[slot] == SLOT_EMPTY) entry->slot_used++;
+            entry->slots[slot] = (int32_t)(entry->count - 1);
+        }
+    }
+    long key = atol(record->fields[0]);
+    if (key > entry->highest_key) entry->highest_key = key;
+
+    recompute_bytes(entry);
+    account_change(index, old_bytes);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void PeachCache_on_update(const char* collection, const char* key, const char* new_record_str) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    if (index < 0) {
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+    CacheEntry* entry = g_entries[index];
+    bool found;
+    size_t slot = find_slot(entry, key, &found);
+    if (entry->has_duplicates || !found) {
+        remove_entry_at(index); // Let the next read reload it from disk
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+
+    size_t old_bytes = entry->bytes;
+    CachedRecord* record = &entry->records[entry->slots[slot]];
+    CachedRecord replacement;
+    if (fill_record(&replacement, new_record_str, entry->num_fields) != 0) {
+        remove_entry_at(index);
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+    entry->payload_bytes += record_bytes(&replacement, entry->num_fields);
+    entry->payload_bytes -= record_bytes(record, entry->num_fields);
+    free(record->line);
+    free(record->fields);
+    *record = replacement; // The key is unchanged, so the hash slot stays valid
+
+    recompute_bytes(entry);
+    account_change(index, old_bytes);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void PeachCache_on_delete(const char* collection, const char* key) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    if (index < 0) {
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+    CacheEntry* entry = g_entries[index];
+    bool found;
+    size_t slot = find_slot(entry, key, &found);
+    if (entry->has_duplicates || !found) {
+        remove_entry_at(index);
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+
+    size_t old_bytes = entry->bytes;
+    CachedRecord* record = &entry->records[entry->slots[slot]];
+    record->live = false;
+    entry->slots[slot] = SLOT_DELETED;
+    entry->dead++;
+    if (atol(key) == entry->highest_key) recompute_highest_key(entry);
+
+    if (maybe_compact(entry) != 0) {
+        remove_entry_at(index);
+        pthread_mutex_unlock(&g_cache_mutex);
+        return;
+    }
+    recompute_bytes(entry);
+    account_change(index, old_bytes);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void PeachCache_invalidate(const char* collection) {
+    pthread_mutex_lock(&g_cache_mutex);
+    int index = find_entry_index(collection);
+    if (index >= 0) remove_entry_at(index);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
@@ -0,0 +1,84 @@
+#ifndef PEACH_CACHE_H
+#define PEACH_CACHE_H
+#include <stddef.h>
+#include <stdbool.h>
+#include "../../peachdb.h"
+
+/*==================[ PEACHDB RECORD CACHE ]======================
+ * Keeps the parsed records of recently used collections in memory so
+ * hot, small collections (user, groups, groupusers) are not re-read and
+ * re-parsed on every request.
+ *
+ * - A collection is cached as a whole, in file order, together with a
+ *   key -> record hash table and its highest numeric key.
+ * - The total size of all cached collections stays under a memory budget.
+ *   When it is exceeded, collections are evicted with the CLOCK algorithm
+ *   (a "referenced" bit per collection, cleared by the sweeping hand).
+ *   A collection larger than the whole budget is never cached.
+ * - Writes go to disk first and are then applied to the cached copy
+ *   (write-through), so the cache never serves stale records.
+ *
+ * Callers must hold the collection's lock (see locks.h): a shared lock
+ * for lookups/stores, an exclusive lock for the on_* write hooks.
+ ==========================================================*/
+
+#define PEACH_CACHE_DEFAULT_BUDGET (8u * 1024u * 1024u) // 8 MiB
+
+/**
+ * @brief Sets the memory budget in bytes, evicting collections if needed.
+ * A budget of 0 disables the cache.
+ */
+void PeachCache_set_budget(size_t budget_bytes);
+
+/**
+ * @brief Returns a caller-owned copy of a cached collection.
+ * @return The record set (free with Peach_free_record_set), or NULL on a miss.
+ */
+PeachRecordSet* PeachCache_lookup(const char* collection);
+
+/**
+ * @brief Returns the field count of a cached collection, or -1 if it is not cached.
+ */
+int PeachCache_field_count(const char* collection);
+
+// Receives one cached record; returns false to stop the scan.
+typedef bool (*PeachCacheVisitor)(char* const* fields, int num_fields, void* context);
+
+/**
+ * @brief Visits the live records of a cached collection in file order, without copying them.
+ * @return The collection's field count, or -1 if the collection is not cached.
+ */
+int PeachCache_scan(const char* collection, PeachCacheVisitor visit, void* context);
+
+/**
+ * @brief Caches a copy of a record set that was just read from disk.
+ * Does nothing if the collection is already cached or does not fit the budget.
+ */
+void PeachCache_store(const char* collection, const PeachRecordSet* record_set);
+
+/**
+ * @brief Checks whether a key exists in a cached collection.
+ * @return 1 if the key exists, 0 if it does not, -1 if the collection is not cached.
+ */
+int PeachCache_contains_key(const char* collection, const char* key);
+
+/**
+ * @brief Returns the highest numeric key of a cached collection.
+ * @param out_key Where the key is stored on a hit.
+ * @return true on a hit, false if the collection is not cached.
+ */
+bool PeachCache_highest_key(const char* collection, long* out_key);
+
+/**
+ * @brief Write-through hooks, called after the change reached the file.
+ */
+void PeachCache_on_append(const char* collection, const char* record_str);
+void PeachCache_on_update(const char* collection, const char* key, const char* new_record_str);
+void PeachCache_on_delete(const char* collection, const char* key);
+
+/**
+ * @brief Drops a collection from the cache (e.g., after its file was rewritten externally).
+ */
+void PeachCache_invalidate(const char* collection);
+
+#endif // PEACH_CACHE_H
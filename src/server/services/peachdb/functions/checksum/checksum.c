@@ -0,0 +1,61 @@
+#include "checksum.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+static uint32_t g_crc_table[256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+static void build_crc_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1u) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        g_crc_table[i] = crc;
+    }
+}
+
+uint32_t PeachChecksum_crc32(const char* data, size_t length) {
+    pthread_once(&g_crc_once, build_crc_table);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc = g_crc_table[(crc ^ (unsigned char)data[i]) & 0xFFu] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void PeachChecksum_suffix(const char* record, char out[PEACH_CHECKSUM_SUFFIX_LEN + 1]) {
+    snprintf(out, PEACH_CHECKSUM_SUFFIX_LEN + 1, "%c%08x", PEACH_CHECKSUM_MARK,
+             (unsigned)PeachChecksum_crc32(record, strlen(record)));
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+PeachLineCheck PeachChecksum_verify(const char* line, size_t length) {
+    if (length < PEACH_CHECKSUM_SUFFIX_LEN) return PEACH_LINE_UNCHECKED;
+    const char* suffix = line + length - PEACH_CHECKSUM_SUFFIX_LEN;
+    if (suffix[0] != PEACH_CHECKSUM_MARK) return PEACH_LINE_UNCHECKED;
+
+    uint32_t expected = 0;
+    for (int i = 1; i < PEACH_CHECKSUM_SUFFIX_LEN; i++) {
+        int digit = hex_value(suffix[i]);
+        if (digit < 0) return PEACH_LINE_CORRUPT;
+        expected = (expected << 4) | (uint32_t)digit;
+    }
+    if (PeachChecksum_crc32(line, length - PEACH_CHECKSUM_SUFFIX_LEN) != expected) {
+        return PEACH_LINE_CORRUPT;
+    }
+    return PEACH_LINE_VERIFIED;
+}
+
+PeachLineCheck PeachChecksum_strip(char* line) {
+    size_t length = strlen(line);
+    PeachLineCheck check = PeachChecksum_verify(line, length);
+    if (check == PEACH_LINE_VERIFIED) line[length - PEACH_CHECKSUM_SUFFIX_LEN] = '\0';
+    return check;
+}
@@ -0,0 +1,52 @@
+#ifndef PEACH_CHECKSUM_H
+#define PEACH_CHECKSUM_H
+#include <stddef.h>
+#include <stdint.h>
+
+/*==================[ PEACHDB RECORD CHECKSUMS ]==================
+ * Every record line written by PeachDB ends with a CRC-32 of the record:
+ *
+ *   <value1>^<value2>^...^<valueN><0x1F><8 hex digits>\n
+ *
+ * so a line torn by a crash, or damaged on disk, is detected instead of
+ * being parsed as a record. Readers strip the suffix before splitting the
+ * line into fields. Lines without the suffix (written before checksums
+ * existed, or bulk-loaded by tools) are accepted unverified.
+ ==========================================================*/
+
+#define PEACH_CHECKSUM_MARK '\x1f'
+#define PEACH_CHECKSUM_SUFFIX_LEN 9 // Mark + 8 hex digits
+
+typedef enum {
+    PEACH_LINE_VERIFIED,    // The checksum matched and was removed
+    PEACH_LINE_UNCHECKED,   // The line has no checksum
+    PEACH_LINE_CORRUPT      // The checksum does not match: skip the line
+} PeachLineCheck;
+
+/**
+ * @brief Computes the CRC-32 (IEEE) of a buffer.
+ */
+uint32_t PeachChecksum_crc32(const char* data, size_t length);
+
+/**
+ * @brief Formats the checksum suffix of a record.
+ * @param record The record, without suffix or newline.
+ * @param out Receives the suffix and a terminator.
+ */
+void PeachChecksum_suffix(const char* record, char out[PEACH_CHECKSUM_SUFFIX_LEN + 1]);
+
+/**
+ * @brief Verifies a record line without changing it.
+ * @param line The line, without its newline.
+ * @param length The length of the line.
+ */
+PeachLineCheck PeachChecksum_verify(const char* line, size_t length);
+
+/**
+ * @brief Verifies a record line and removes its checksum suffix in place.
+ * @param line The line, without its newline.
+ * @return The outcome; on PEACH_LINE_CORRUPT the line is left unchanged.
+ */
+PeachLineCheck PeachChecksum_strip(char* line);
+
+#endif // PEACH_CHECKSUM_H
@@ -0,0 +1,511 @@
+#define _GNU_SOURCE // fopencookie
+#include "compress.h"
+#include "../checksum/checksum.h"
+#include "../pool/pool.h"
+#include "../../../logService/logService.h"
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define COMPRESS_MAGIC "PEACHZ01"
+#define HASH_LOG 12
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+
+typedef struct {
+    char magic[8];
+    uint32_t block_count;
+    uint32_t header_length;     // The collection header line, stored as is after this struct
+    uint64_t index_offset;      // Where the block index starts
+    uint64_t raw_length;        // Bytes of the original file
+    uint32_t index_crc;         // CRC-32 of the block index
+    uint32_t reserved;
+} CompressedHeader;
+
+typedef struct {
+    uint64_t offset;            // Where the stored block starts
+    uint32_t stored_length;
+    uint32_t raw_length;
+    int64_t min_key;
+    int64_t max_key;
+    uint32_t raw_crc;           // CRC-32 of the original bytes
+    uint32_t stored_raw;        // 1: the block did not shrink and is stored as is
+} BlockEntry;
+
+// --- Codec ---
+// A block is a series of sequences: a token (literal count << 4 | match
+// length - 4), extra length bytes when a nibble is 15, the literals, a
+// 2-byte offset back into the output and extra match length bytes. The
+// last sequence has literals only.
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_LOG);
+}
+
+size_t PeachCompress_bound(size_t length) {
+    return length + length / 255 + 16;
+}
+
+// Writes the extra bytes of a length whose nibble was 15.
+static uint8_t* put_length(uint8_t* op, const uint8_t* oend, size_t length) {
+    while (length >= 255) {
+        if (op >= oend) return NULL;
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= oend) return NULL;
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t* put_sequence(uint8_t* op, const uint8_t* oend, const uint8_t* literals, size_t literal_length,
+                             size_t offset, size_t match_length) {
+    if (op >= oend) return NULL;
+    uint8_t* token = op++;
+    *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15 && (op = put_length(op, oend, literal_length - 15)) == NULL) return NULL;
+    if ((size_t)(oend - op) < literal_length) return NULL;
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (offset == 0) return op; // Last sequence
+
+    size_t extra = match_length - MIN_MATCH;
+    *token |= (uint8_t)(extra < 15 ? extra : 15);
+    if (oend - op < 2) return NULL;
+    *op++ = (uint8_t)(offset & 0xFF);
+    *op++ = (uint8_t)(offset >> 8);
+    if (extra >= 15 && (op = put_length(op, oend, extra - 15)) == NULL) return NULL;
+    return op;
+}
+
+size_t PeachCompress_block(const char* src, size_t length, char* dst, size_t capacity) {
+    const uint8_t* base = (const uint8_t*)src;
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    const uint8_t* end = base + length;
+    uint8_t* op = (uint8_t*)dst;
+    const uint8_t* oend = op + capacity;
+    uint32_t table[1 << HASH_LOG];
+    memset(table, 0, sizeof(table)); // Positions + 1; 0 is empty
+
+    // Matches stop a few bytes short of the end, so reads of 4 bytes stay inside
+    const uint8_t* match_limit = length > MIN_MATCH * 2 ? end - MIN_MATCH : base;
+    while (ip < match_limit) {
+        uint32_t sequence = read32(ip);
+        uint32_t h = hash4(sequence);
+        uint32_t candidate = table[h];
+        table[h] = (uint32_t)(ip - base) + 1;
+        const uint8_t* ref = base + candidate - 1;
+        if (candidate == 0 || ip - ref > MAX_OFFSET || read32(ref) != sequence) {
+            ip++;
+            continue;
+        }
+        const uint8_t* p = ip + MIN_MATCH;
+        const uint8_t* m = ref + MIN_MATCH;
+        while (p < end && *p == *m) {
+            p++;
+            m++;
+        }
+        op = put_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), (size_t)(p - ip));
+        if (op == NULL) return 0;
+        ip = p;
+        anchor = p;
+    }
+    op = put_sequence(op, oend, anchor, (size_t)(end - anchor), 0, 0);
+    return op != NULL ? (size_t)(op - (uint8_t*)dst) : 0;
+}
+
+// Reads the extra bytes of a length whose nibble was 15.
+static const uint8_t* get_length(const uint8_t* ip, const uint8_t* iend, size_t* length) {
+    uint8_t byte;
+    do {
+        if (ip >= iend) return NULL;
+        byte = *ip++;
+        *length += byte;
+    } while (byte == 255);
+    return ip;
+}
+
+int PeachCompress_unblock(const char* src, size_t length, char* dst, size_t raw_length) {
+    const uint8_t* ip = (const uint8_t*)src;
+    const uint8_t* iend = ip + length;
+    uint8_t* op = (uint8_t*)dst;
+    uint8_t* oend = op + raw_length;
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && (ip = get_length(ip, iend, &literal_length)) == NULL) return -1;
+        if ((size_t)(iend - ip) < literal_length || (size_t)(oend - op) < literal_length) return -1;
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == iend) break; // Last sequence
+
+        if (iend - ip < 2) return -1;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match_length = token & 15;
+        if (match_length == 15 && (ip = get_length(ip, iend, &match_length)) == NULL) return -1;
+        match_length += MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - (uint8_t*)dst) || (size_t)(oend - op) < match_length) return -1;
+        const uint8_t* match = op - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            op[i] = match[i]; // May overlap: repeats the last 'offset' bytes
+        }
+        op += match_length;
+    }
+    return op == oend ? 0 : -1;
+}
+
+bool PeachCompress_is_compressed(const char* path) {
+    size_t length = strlen(path);
+    size_t extension = strlen(PEACH_COMPRESS_EXTENSION);
+    return length >= extension && strcmp(path + length - extension, PEACH_COMPRESS_EXTENSION) == 0;
+}
+
+// --- Writing ---
+
+typedef struct {
+    FILE* file;
+    BlockEntry* blocks;
+    int count;
+    int capacity;
+    char* stored;               // Scratch for the compressed block
+    size_t stored_capacity;
+} SealWriter;
+
+static int write_block(SealWriter* writer, const char* raw, size_t raw_length, long long min_key, long long max_key) {
+    if (writer->count == writer->capacity) {
+        int capacity = writer->capacity > 0 ? writer->capacity * 2 : 64;
+        BlockEntry* grown = realloc(writer->blocks, (size_t)capacity * sizeof(BlockEntry));
+        if (grown == NULL) return -1;
+        writer->blocks = grown;
+        writer->capacity = capacity;
+    }
+    size_t bound = PeachCompress_bound(raw_length);
+    if (bound > writer->stored_capacity) {
+        char* grown = realloc(writer->stored, bound);
+        if (grown == NULL) return -1;
+        writer->stored = grown;
+        writer->stored_capacity = bound;
+    }
+
+    BlockEntry* entry = &writer->blocks[writer->count];
+    size_t stored_length = PeachCompress_block(raw, raw_length, writer->stored, writer->stored_capacity);
+    entry->stored_raw = stored_length == 0 || stored_length >= raw_length;
+    const char* stored = entry->stored_raw ? raw : writer->stored;
+    entry->stored_length = (uint32_t)(entry->stored_raw ? raw_length : stored_length);
+    entry->raw_length = (uint32_t)raw_length;
+    entry->offset = (uint64_t)ftell(writer->file);
+    entry->min_key = min_key;
+    entry->max_key = max_key;
+    entry->raw_crc = PeachChecksum_crc32(raw, raw_length);
+    if (fwrite(stored, 1, entry->stored_length, writer->file) != entry->stored_length) return -1;
+    writer->count++;
+    return 0;
+}
+
+static int seal_into(FILE* source, SealWriter* writer, CompressedHeader* header) {
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length = getline(&line, &line_capacity, source);
+    if (length <= 0) {
+        free(line);
+        return -1;
+    }
+    header->header_length = (uint32_t)length;
+    header->raw_length = (uint64_t)length;
+    if (fwrite(header, sizeof(*header), 1, writer->file) != 1 ||
+        fwrite(line, 1, (size_t)length, writer->file) != (size_t)length) {
+        free(line);
+        return -1;
+    }
+
+    // Blocks of whole lines
+    char* block = malloc(PEACH_COMPRESS_BLOCK_SIZE);
+    size_t block_capacity = PEACH_COMPRESS_BLOCK_SIZE;
+    size_t block_length = 0;
+    long long min_key = 0;
+    long long max_key = 0;
+    int status = block != NULL ? 0 : -1;
+    while (status == 0 && (length = getline(&line, &line_capacity, source)) > 0) {
+        if (block_length > 0 && block_length + (size_t)length > PEACH_COMPRESS_BLOCK_SIZE) {
+            status = write_block(writer, block, block_length, min_key, max_key);
+            block_length = 0;
+        }
+        if (block_length + (size_t)length > block_capacity) { // A line longer than a block
+            char* grown = realloc(block, block_length + (size_t)length);
+            if (grown == NULL) {
+                status = -1;
+                break;
+            }
+            block = grown;
+            block_capacity = block_length + (size_t)length;
+        }
+        long long key = strtoll(line, NULL, 10);
+        if (block_length == 0 || key < min_key) min_key = key;
+        if (block_length == 0 || key > max_key) max_key = key;
+        memcpy(block + block_length, line, (size_t)length);
+        block_length += (size_t)length;
+        header->raw_length += (uint64_t)length;
+    }
+    if (status == 0 && block_length > 0) status = write_block(writer, block, block_length, min_key, max_key);
+    free(block);
+    free(line);
+    if (status != 0 || ferror(source)) return -1;
+
+    // Block index, then the header again with its position
+    size_t index_length = (size_t)writer->count * sizeof(BlockEntry);
+    header->block_count = (uint32_t)writer->count;
+    header->index_offset = (uint64_t)ftell(writer->file);
+    header->index_crc = PeachChecksum_crc32((const char*)writer->blocks, index_length);
+    if ((index_length > 0 && fwrite(writer->blocks, index_length, 1, writer->file) != 1) ||
+        fseek(writer->file, 0, SEEK_SET) != 0 || fwrite(header, sizeof(*header), 1, writer->file) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+int PeachCompress_seal(const char* source_path, const char* target_path) {
+    FILE* source = fopen(source_path, "r");
+    if (source == NULL) return -1;
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", target_path);
+    SealWriter writer = { .file = fopen(temp_path, "w") };
+    if (writer.file == NULL) {
+        LOG_ERROR("peachdb", "Could not create '%s': %s", temp_path, strerror(errno));
+        fclose(source);
+        return -1;
+    }
+
+    CompressedHeader header = { 0 };
+    memcpy(header.magic, COMPRESS_MAGIC, sizeof(header.magic));
+    int status = seal_into(source, &writer, &header);
+    fclose(source);
+    if (status == 0 && (fflush(writer.file) != 0 || fsync(fileno(writer.file)) != 0)) status = -1;
+    if (fclose(writer.file) != 0) status = -1;
+    if (status == 0 && rename(temp_path, target_path) != 0) status = -1;
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not compress '%s'.", source_path);
+        remove(temp_path);
+    }
+    free(writer.blocks);
+    free(writer.stored);
+    return status;
+}
+
+// --- Reading ---
+
+typedef struct {
+    int fd;
+    char* header_line;
+    size_t header_length;
+    BlockEntry* blocks;         // The blocks in the stream, in file order
+    int block_count;
+    long* starts;               // Stream offset of each block; starts[block_count] is the length
+    long position;
+    // Decoded blocks [batch_first, batch_first + batch_count)
+    int batch_first;
+    int batch_count;
+    char* batch[PEACH_POOL_MAX_THREADS];
+    _Atomic int batch_failed;
+} CompressedStream;
+
+static void free_batch(CompressedStream* stream) {
+    for (int i = 0; i < stream->batch_count; i++) {
+        free(stream->batch[i]);
+        stream->batch[i] = NULL;
+    }
+    stream->batch_count = 0;
+}
+
+static void decode_task(int index, void* context) {
+    CompressedStream* stream = context;
+    const BlockEntry* entry = &stream->blocks[stream->batch_first + index];
+    char* raw = malloc(entry->raw_length > 0 ? entry->raw_length : 1);
+    char* stored = entry->stored_raw ? raw : malloc(entry->stored_length > 0 ? entry->stored_length : 1);
+    bool ok = raw != NULL && stored != NULL &&
+              pread(stream->fd, stored, entry->stored_length, (off_t)entry->offset) == (ssize_t)entry->stored_length &&
+              (entry->stored_raw || PeachCompress_unblock(stored, entry->stored_length, raw, entry->raw_length) == 0) &&
+              PeachChecksum_crc32(raw, entry->raw_length) == entry->raw_crc;
+    if (stored != raw) free(stored);
+    if (!ok) {
+        free(raw);
+        raw = NULL;
+        atomic_store_explicit(&stream->batch_failed, 1, memory_order_relaxed);
+    }
+    stream->batch[index] = raw;
+}
+
+// Makes block 'block' decoded. After the last block of a batch, the next
+// batch decodes several blocks on the pool's threads.
+static int load_block(CompressedStream* stream, int block) {
+    if (block >= stream->batch_first && block < stream->batch_first + stream->batch_count) return 0;
+    bool sequential = block == stream->batch_first + stream->batch_count;
+    free_batch(stream);
+    int threads = sequential ? PeachPool_threads() : 1;
+    int count = stream->block_count - block < threads ? stream->block_count - block : threads;
+    stream->batch_first = block;
+    atomic_store(&stream->batch_failed, 0);
+    PeachPool_run(count, count, decode_task, stream);
+    stream->batch_count = count;
+    if (atomic_load(&stream->batch_failed)) {
+        LOG_ERROR("peachdb", "A compressed block is damaged; the read stops there.");
+        free_batch(stream);
+        return -1;
+    }
+    return 0;
+}
+
+static ssize_t stream_read(void* cookie, char* buf, size_t size) {
+    CompressedStream* stream = cookie;
+    size_t copied = 0;
+    long length = stream->starts[stream->block_count];
+    while (copied < size && stream->position < length) {
+        if ((size_t)stream->position < stream->header_length) {
+            size_t count = stream->header_length - (size_t)stream->position;
+            if (count > size - copied) count = size - copied;
+            memcpy(buf + copied, stream->header_line + stream->position, count);
+            copied += count;
+            stream->position += (long)count;
+            continue;
+        }
+        // Binary search for the block holding the position
+        int lo = 0;
+        int hi = stream->block_count - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (stream->starts[mid] <= stream->position) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if (load_block(stream, lo) != 0) return copied > 0 ? (ssize_t)copied : -1;
+        const char* raw = stream->batch[lo - stream->batch_first];
+        size_t within = (size_t)(stream->position - stream->starts[lo]);
+        size_t count = stream->blocks[lo].raw_length - within;
+        if (count > size - copied) count = size - copied;
+        memcpy(buf + copied, raw + within, count);
+        copied += count;
+        stream->position += (long)count;
+    }
+    return (ssize_t)copied;
+}
+
+static int stream_seek(void* cookie, off64_t* offset, int whence) {
+    CompressedStream* stream = cookie;
+    long length = stream->starts[stream->block_count];
+    long target = (long)*offset;
+    if (whence == SEEK_CUR) target += stream->position;
+    if (whence == SEEK_END) target += length;
+    if (target < 0) return -1;
+    stream->position = target > length ? length : target;
+    *offset = stream->position;
+    return 0;
+}
+
+static int stream_close(void* cookie) {
+    CompressedStream* stream = cookie;
+    free_batch(stream);
+    close(stream->fd);
+    free(stream->header_line);
+    free(stream->blocks);
+    free(stream->starts);
+    free(stream);
+    return 0;
+}
+
+static FILE* open_compressed(const char* path, bool all_keys, long long lo, long long hi) {
+    CompressedStream* stream = calloc(1, sizeof(CompressedStream));
+    if (stream == NULL) return NULL;
+    stream->fd = open(path, O_RDONLY);
+    CompressedHeader header;
+    if (stream->fd < 0 || pread(stream->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, COMPRESS_MAGIC, sizeof(header.magic)) != 0) {
+        if (stream->fd >= 0) {
+            LOG_ERROR("peachdb", "'%s' is not a compressed segment.", path);
+            close(stream->fd);
+        }
+        free(stream);
+        return NULL;
+    }
+
+    // 1. The header line and the block index
+    size_t index_length = (size_t)header.block_count * sizeof(BlockEntry);
+    stream->header_line = malloc(header.header_length);
+    stream->blocks = malloc(index_length > 0 ? index_length : 1);
+    stream->starts = malloc(((size_t)header.block_count + 1) * sizeof(long));
+    bool ok = stream->header_line != NULL && stream->blocks != NULL && stream->starts != NULL &&
+              pread(stream->fd, stream->header_line, header.header_length, sizeof(header)) == (ssize_t)header.header_length &&
+              pread(stream->fd, stream->blocks, index_length, (off_t)header.index_offset) == (ssize_t)index_length &&
+              PeachChecksum_crc32((const char*)stream->blocks, index_length) == header.index_crc;
+    if (!ok) {
+        LOG_ERROR("peachdb", "The block index of '%s' is damaged.", path);
+        stream->block_count = 0;
+        stream_close(stream);
+        return NULL;
+    }
+    stream->header_length = header.header_length;
+
+    // 2. Keep the blocks the stream reads
+    int count = 0;
+    long start = (long)header.header_length;
+    for (uint32_t i = 0; i < header.block_count; i++) {
+        if (!all_keys && (stream->blocks[i].max_key < lo || stream->blocks[i].min_key > hi)) continue;
+        stream->blocks[count] = stream->blocks[i];
+        stream->starts[count++] = start;
+        start += (long)stream->blocks[i].raw_length;
+    }
+    stream->block_count = count;
+    stream->starts[count] = start;
+
+    cookie_io_functions_t functions = { .read = stream_read, .seek = stream_seek, .close = stream_close };
+    FILE* file = fopencookie(stream, "r", functions);
+    if (file == NULL) stream_close(stream);
+    return file;
+}
+
+FILE* PeachCompress_open(const char* path) {
+    return PeachCompress_is_compressed(path) ? open_compressed(path, true, 0, 0) : fopen(path, "r");
+}
+
+FILE* PeachCompress_open_keys(const char* path, long long lo, long long hi) {
+    return PeachCompress_is_compressed(path) ? open_compressed(path, false, lo, hi) : fopen(path, "r");
+}
+
+int PeachCompress_inflate(const char* source_path, const char* target_path) {
+    FILE* source = PeachCompress_open(source_path);
+    if (source == NULL) return -1;
+    FILE* target = fopen(target_path, "w");
+    if (target == NULL) {
+        fclose(source);
+        return -1;
+    }
+    char buffer[PEACH_COMPRESS_BLOCK_SIZE];
+    size_t length;
+    int status = 0;
+    while ((length = fread(buffer, 1, sizeof(buffer), source)) > 0) {
+        if (fwrite(buffer, 1, length, target) != length) {
+            status = -1;
+            break;
+        }
+    }
+    if (ferror(source)) status = -1;
+    fclose(source);
+    if (fclose(target) != 0) status = -1;
+    if (status != 0) remove(target_path);
+    return status;
+}
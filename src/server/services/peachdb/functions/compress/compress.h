@@ -0,0 +1,84 @@
+#ifndef PEACH_COMPRESS_H
+#define PEACH_COMPRESS_H
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*==================[ PEACHDB BLOCK COMPRESSION ]=================
+ * Sealed segments (see segments.h) never grow again, so a collection may
+ * keep them compressed: <collection>.NNNNNN.lpdz instead of .lpdb.
+ *
+ * - The records are cut into blocks of about PEACH_COMPRESS_BLOCK_SIZE
+ *   bytes of whole lines, each compressed on its own with an LZ4-style
+ *   codec (byte-aligned literals and back-references, no entropy coding:
+ *   cheap to decode). A block that does not shrink is stored as is.
+ * - A block index at the end of the file gives each block's position,
+ *   sizes, CRC-32 and key range, so a lookup by key decompresses only the
+ *   blocks whose range holds the key.
+ * - PeachCompress_open returns a FILE* that reads the original .lpdb
+ *   bytes (header line, then records with their checksums), so readers do
+ *   not care whether a file is compressed. Sequential reads decompress the
+ *   next blocks on several threads at once (see pool.h); seeks are
+ *   supported for the reverse scan.
+ *
+ * File layout:
+ *   [header][collection header line][block 0]...[block N-1][block index]
+ ==========================================================*/
+
+#define PEACH_COMPRESS_BLOCK_SIZE (64 * 1024)
+#define PEACH_COMPRESS_EXTENSION ".lpdz"
+
+/**
+ * @brief Returns the largest size PeachCompress_block can produce for 'length' bytes.
+ */
+size_t PeachCompress_bound(size_t length);
+
+/**
+ * @brief Compresses one block.
+ * @param src The bytes to compress.
+ * @param length Their number.
+ * @param dst Receives the compressed bytes.
+ * @param capacity Size of dst; PeachCompress_bound(length) always suffices.
+ * @return The compressed size, or 0 if it would not fit.
+ */
+size_t PeachCompress_block(const char* src, size_t length, char* dst, size_t capacity);
+
+/**
+ * @brief Decompresses one block.
+ * @param raw_length The exact size of the original bytes.
+ * @return 0 on success, -1 if the block is malformed.
+ */
+int PeachCompress_unblock(const char* src, size_t length, char* dst, size_t raw_length);
+
+/**
+ * @brief Returns true if a path names a compressed segment (by its extension).
+ */
+bool PeachCompress_is_compressed(const char* path);
+
+/**
+ * @brief Writes a compressed copy of a collection file, through a synced
+ *        '.tmp' file and an atomic rename.
+ * @return 0 on success, -1 on failure (target left untouched).
+ */
+int PeachCompress_seal(const char* source_path, const char* target_path);
+
+/**
+ * @brief Writes the original bytes of a compressed file to target_path (not synced).
+ * @return 0 on success, -1 on failure.
+ */
+int PeachCompress_inflate(const char* source_path, const char* target_path);
+
+/**
+ * @brief Opens a collection file for reading, compressed or not.
+ * @return A stream of the original bytes, or NULL. Close it with fclose().
+ */
+FILE* PeachCompress_open(const char* path);
+
+/**
+ * @brief Like PeachCompress_open, but a compressed file only yields the header
+ *        and the blocks whose key range meets [lo, hi] (keys compared as numbers).
+ *        Plain files are read whole.
+ */
+FILE* PeachCompress_open_keys(const char* path, long long lo, long long hi);
+
+#endif // PEACH_COMPRESS_H
@@ -0,0 +1,126 @@
+#include "indexfile.h"
+#include "../checksum/checksum.h"
+#include "../../../logService/logService.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_MAGIC "PEACHIX1"
+#define TAIL_CHECK_SIZE 4096
+
+typedef struct {
+    char magic[8];
+    uint32_t payload_crc;
+    uint32_t tail_crc;          // CRC-32 of the collection bytes just before 'covered'
+    uint64_t inode;
+    int64_t covered;
+    uint64_t payload_length;
+} SnapshotHeader;
+
+static void snapshot_path(char* out, size_t size, const char* collection, const char* kind) {
+    snprintf(out, size, "%s/%s.%s", PEACH_INDEX_SNAPSHOT_PATH, collection, kind);
+}
+
+// CRC-32 of the bytes [covered - TAIL_CHECK_SIZE, covered) of the collection file.
+static int tail_crc(int fd, long covered, uint32_t* out) {
+    char tail[TAIL_CHECK_SIZE];
+    size_t size = covered < TAIL_CHECK_SIZE ? (size_t)covered : TAIL_CHECK_SIZE;
+    if (pread(fd, tail, size, covered - (long)size) != (ssize_t)size) return -1;
+    *out = PeachChecksum_crc32(tail, size);
+    return 0;
+}
+
+int PeachIndexFile_save(const char* collection, const char* kind, const char* collection_path,
+                        long covered, const void* payload, size_t payload_length) {
+    // 1. Identify the collection file the payload describes
+    int source = open(collection_path, O_RDONLY);
+    if (source < 0) return -1;
+    struct stat st;
+    SnapshotHeader header = {0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    int status = (fstat(source, &st) == 0 && (long)st.st_size >= covered &&
+                  tail_crc(source, covered, &header.tail_crc) == 0) ? 0 : -1;
+    close(source);
+    if (status != 0) return -1;
+    header.inode = (uint64_t)st.st_ino;
+    header.covered = covered;
+    header.payload_length = payload_length;
+    header.payload_crc = PeachChecksum_crc32(payload, payload_length);
+
+    // 2. Write it; a snapshot lost in a crash only costs a rebuild, so no fsync
+    char path[512];
+    char temp_path[520];
+    snapshot_path(path, sizeof(path), collection, kind);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* file = fopen(temp_path, "w");
+    if (file == NULL) {
+        LOG_WARN("peachdb", "Could not write index snapshot %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        (payload_length > 0 && fwrite(payload, payload_length, 1, file) != 1)) {
+        status = -1;
+    }
+    if (fclose(file) != 0) status = -1;
+    if (status == 0 && rename(temp_path, path) != 0) status = -1;
+    if (status != 0) remove(temp_path);
+    return status;
+}
+
+int PeachIndexFile_open(PeachIndexFile* out, const char* collection, const char* kind, const char* collection_path) {
+    memset(out, 0, sizeof(*out));
+    char path[512];
+    snapshot_path(path, sizeof(path), collection, kind);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    // 1. The snapshot must be whole...
+    SnapshotHeader header;
+    memcpy(&header, map, sizeof(header));
+    const char* payload = (const char*)map + sizeof(header);
+    bool intact = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+                  header.payload_length == (uint64_t)st.st_size - sizeof(header) &&
+                  PeachChecksum_crc32(payload, header.payload_length) == header.payload_crc;
+
+    // 2. ...and the collection file only appended to since it was taken
+    bool current = false;
+    int source = intact ? open(collection_path, O_RDONLY) : -1;
+    if (source >= 0) {
+        struct stat source_st;
+        uint32_t crc = 0;
+        current = fstat(source, &source_st) == 0 && (uint64_t)source_st.st_ino == header.inode &&
+                  (int64_t)source_st.st_size >= header.covered &&
+                  tail_crc(source, (long)header.covered, &crc) == 0 && crc == header.tail_crc;
+        close(source);
+    }
+    if (!current) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    out->map = map;
+    out->map_length = (size_t)st.st_size;
+    out->payload = payload;
+    out->payload_length = header.payload_length;
+    out->covered = (long)header.covered;
+    return 0;
+}
+
+void PeachIndexFile_close(PeachIndexFile* file) {
+    if (file->map != NULL) munmap(file->map, file->map_length);
+    memset(file, 0, sizeof(*file));
+}
@@ -0,0 +1,52 @@
+#ifndef PEACH_INDEX_FILE_H
+#define PEACH_INDEX_FILE_H
+#include <stddef.h>
+
+/*==================[ PEACHDB INDEX SNAPSHOTS ]===================
+ * Persists in-memory indexes (Bloom filters, time indexes) in
+ * peachdata/indexes/<collection>.<kind>, so a warm restart maps them
+ * instead of scanning the whole collection again.
+ *
+ * A snapshot describes the first <covered> bytes of the collection file
+ * and remembers the file's inode and a CRC-32 of the bytes just before
+ * <covered>. It stays valid while the file is only appended to (updates
+ * and deletes rename a new file over the collection, which changes the
+ * inode); records past <covered> are then added as usual. A stale or
+ * damaged snapshot is ignored and the index is rebuilt from the file.
+ ==========================================================*/
+
+#define PEACH_INDEX_SNAPSHOT_PATH "peachdata/indexes"
+
+typedef struct {
+    void* map;              // The mapped snapshot file
+    size_t map_length;
+    const char* payload;    // Index data, as passed to PeachIndexFile_save
+    size_t payload_length;
+    long covered;           // Bytes of the collection file the payload describes
+} PeachIndexFile;
+
+/**
+ * @brief Writes the snapshot of an index (through a temporary file and a rename).
+ * The caller must hold the collection's lock so the file does not change meanwhile.
+ * @param collection The collection name.
+ * @param kind The index kind, used as file extension (e.g., "bloom").
+ * @param collection_path Path of the collection file.
+ * @param covered Bytes of the collection file the payload describes.
+ * @return 0 on success, -1 on failure.
+ */
+int PeachIndexFile_save(const char* collection, const char* kind, const char* collection_path,
+                        long covered, const void* payload, size_t payload_length);
+
+/**
+ * @brief Maps the snapshot of an index if it is still valid for the collection file.
+ * @param out Receives the mapping; release it with PeachIndexFile_close().
+ * @return 0 if a valid snapshot was mapped, -1 otherwise.
+ */
+int PeachIndexFile_open(PeachIndexFile* out, const char* collection, const char* kind, const char* collection_path);
+
+/**
+ * @brief Unmaps a snapshot.
+ */
+void PeachIndexFile_close(PeachIndexFile* file);
+
+#endif // PEACH_INDEX_FILE_H
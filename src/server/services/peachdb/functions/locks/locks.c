@@ -0,0 +1,43 @@
+#include "locks.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MAX_COLLECTION_LOCKS 128
+#define LOCK_NAME_LEN 64
+
+typedef struct {
+    char name[LOCK_NAME_LEN];
+    pthread_rwlock_t lock;
+} CollectionLock;
+
+static CollectionLock g_locks[MAX_COLLECTION_LOCKS];
+static _Atomic int g_lock_count = 0;
+static pthread_mutex_t g_locks_mutex = PTHREAD_MUTEX_INITIALIZER; // Serializes registration
+
+pthread_rwlock_t* PeachLock_get(const char* collection_name) {
+    // 1. Fast path: published slots never change, so no lock is needed
+    int count = atomic_load_explicit(&g_lock_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_locks[i].name, collection_name) == 0) return &g_locks[i].lock;
+    }
+
+    // 2. Register the collection
+    pthread_mutex_lock(&g_locks_mutex);
+    count = atomic_load_explicit(&g_lock_count, memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_locks[i].name, collection_name) == 0) {
+            pthread_mutex_unlock(&g_locks_mutex);
+            return &g_locks[i].lock;
+        }
+    }
+    if (count >= MAX_COLLECTION_LOCKS || strlen(collection_name) >= LOCK_NAME_LEN) {
+        pthread_mutex_unlock(&g_locks_mutex);
+        return NULL;
+    }
+    snprintf(g_locks[count].name, LOCK_NAME_LEN, "%s", collection_name);
+    pthread_rwlock_init(&g_locks[count].lock, NULL);
+    atomic_store_explicit(&g_lock_count, count + 1, memory_order_release);
+    pthread_mutex_unlock(&g_locks_mutex);
+    return &g_locks[count].lock;
+}
@@ -0,0 +1,21 @@
+#ifndef PEACH_LOCKS_H
+#define PEACH_LOCKS_H
+#include <pthread.h>
+
+/*==================[ PEACHDB COLLECTION LOCKS ]==================
+ * One reader/writer lock per collection. Reads (read_all, highest key)
+ * take it shared; appends, updates and deletes take it exclusively,
+ * which also keeps the record cache and the '.tmp' rewrite file of a
+ * collection consistent between threads.
+ *
+ * Locks are created on first use and live for the whole process.
+ ==========================================================*/
+
+/**
+ * @brief Returns the lock of a collection, creating it on first use.
+ * @param collection_name The name of the collection.
+ * @return The lock, or NULL if the lock table is full.
+ */
+pthread_rwlock_t* PeachLock_get(const char* collection_name);
+
+#endif // PEACH_LOCKS_H
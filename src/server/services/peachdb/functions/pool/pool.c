@@ -0,0 +1,75 @@
+#include "pool.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct {
+    PeachPoolTask task;
+    void* context;
+    int count;
+    _Atomic int next;
+} PoolRun;
+
+int PeachPool_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > PEACH_POOL_MAX_THREADS ? PEACH_POOL_MAX_THREADS : (int)cpus;
+}
+
+static void* pool_worker(void* arg) {
+    PoolRun* run = arg;
+    int index;
+    while ((index = atomic_fetch_add_explicit(&run->next, 1, memory_order_relaxed)) < run->count) {
+        run->task(index, run->context);
+    }
+    return NULL;
+}
+
+void PeachPool_run(int count, int threads, PeachPoolTask task, void* context) {
+    PoolRun run = { .task = task, .context = context, .count = count };
+    atomic_init(&run.next, 0);
+    if (threads > PEACH_POOL_MAX_THREADS) threads = PEACH_POOL_MAX_THREADS;
+    if (threads > count) threads = count;
+
+    // 1. Helpers; if one cannot be created, the others (and the caller) do its share
+    pthread_t helpers[PEACH_POOL_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&helpers[started], NULL, pool_worker, &run) == 0) started++;
+    }
+
+    // 2. The caller works too, then waits for the helpers
+    pool_worker(&run);
+    for (int i = 0; i < started; i++) {
+        pthread_join(helpers[i], NULL);
+    }
+}
+
+int PeachPool_split_lines(const char* path, long start, long end, int max_chunks, long* out_bounds) {
+    if (max_chunks > PEACH_POOL_MAX_CHUNKS) max_chunks = PEACH_POOL_MAX_CHUNKS;
+    if (max_chunks < 1) max_chunks = 1;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+
+    int count = 0;
+    out_bounds[0] = start;
+    for (int i = 1; i < max_chunks; i++) {
+        long target = start + (long)((double)(end - start) * i / max_chunks);
+        if (target <= out_bounds[count]) continue;
+
+        // Move forward to the start of the next line
+        fseek(file, target - 1, SEEK_SET);
+        int c;
+        long position = target - 1;
+        do {
+            c = fgetc(file);
+            position++;
+        } while (c != '\n' && c != EOF);
+        if (c == EOF || position >= end) break;
+        out_bounds[++count] = position;
+    }
+    out_bounds[++count] = end;
+    fclose(file);
+    return count;
+}
@@ -0,0 +1,43 @@
+#ifndef PEACH_POOL_H
+#define PEACH_POOL_H
+
+/*==================[ PEACHDB WORKER POOL ]=======================
+ * Fork-join helpers for scanning collection files on several threads,
+ * used to load collections and their indexes at startup:
+ *
+ * - PeachPool_run calls task(0) ... task(count - 1) on up to 'threads'
+ *   threads (the caller is one of them) and returns when all are done.
+ * - PeachPool_split_lines cuts a byte range of a file into chunks that
+ *   start at line boundaries, so every chunk holds whole records and can
+ *   be scanned on its own.
+ ==========================================================*/
+
+#define PEACH_POOL_MAX_THREADS 16
+#define PEACH_POOL_MAX_CHUNKS 64
+#define PEACH_POOL_CHUNK_MIN_BYTES (4L * 1024 * 1024) // Smaller files are scanned by one thread
+
+typedef void (*PeachPoolTask)(int index, void* context);
+
+/**
+ * @brief Returns the default number of threads (online CPUs, at most PEACH_POOL_MAX_THREADS).
+ */
+int PeachPool_threads(void);
+
+/**
+ * @brief Runs task(i, context) for every i in [0, count) and waits for all of them.
+ * @param threads The number of threads to use; 1 runs everything on the caller's thread.
+ */
+void PeachPool_run(int count, int threads, PeachPoolTask task, void* context);
+
+/**
+ * @brief Splits [start, end) of a file into up to max_chunks line-aligned chunks.
+ * @param path The file.
+ * @param start Offset of the first line (e.g., just after the header).
+ * @param end End of the range (e.g., the file size).
+ * @param max_chunks The maximum number of chunks (at most PEACH_POOL_MAX_CHUNKS).
+ * @param out_bounds Receives chunk i as [out_bounds[i], out_bounds[i + 1]); needs max_chunks + 1 slots.
+ * @return The number of chunks (at least 1), or -1 if the file cannot be read.
+ */
+int PeachPool_split_lines(const char* path, long start, long end, int max_chunks, long* out_bounds);
+
+#endif // PEACH_POOL_H
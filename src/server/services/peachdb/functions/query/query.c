@@ -0,0 +1,203 @@
+#include "query.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+int PeachQuery_split_line(char* line, char** fields, int num_fields) {
+    if (num_fields <= 0) return 0;
+    int count = 1;
+    fields[0] = line;
+    for (char* p = line; *p != '\0' && count < num_fields; p++) {
+        if (*p == '^') {
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+    return count;
+}
+
+static const char* field_at(char* const* fields, int num_fields, int index) {
+    if (index < 0 || index >= num_fields || fields[index] == NULL) return "";
+    return fields[index];
+}
+
+static bool compare(const PeachPredicate* predicate, const char* value) {
+    int cmp;
+    if (predicate->text != NULL) {
+        cmp = strcmp(value, predicate->text);
+    } else {
+        long long number = strtoll(value, NULL, 10);
+        cmp = (number > predicate->number) - (number < predicate->number);
+    }
+    switch (predicate->op) {
+        case PEACH_EQ: return cmp == 0;
+        case PEACH_NE: return cmp != 0;
+        case PEACH_LT: return cmp < 0;
+        case PEACH_LE: return cmp <= 0;
+        case PEACH_GT: return cmp > 0;
+        case PEACH_GE: return cmp >= 0;
+    }
+    return false;
+}
+
+// A record matches if all predicates of at least one or_group hold.
+static bool matches(const PeachQuery* query, char* const* fields, int num_fields) {
+    if (query->where_count == 0) return true;
+
+    uint32_t groups = 0;
+    for (int i = 0; i < query->where_count; i++) {
+        groups |= 1u << (query->where[i].or_group & 31);
+    }
+    uint32_t failed = 0;
+    for (int i = 0; i < query->where_count; i++) {
+        const PeachPredicate* predicate = &query->where[i];
+        uint32_t group = 1u << (predicate->or_group & 31);
+        if (failed & group) continue; // Group already ruled out
+        if (!compare(predicate, field_at(fields, num_fields, predicate->field))) {
+            failed |= group;
+            if (failed == groups) return false;
+        }
+    }
+    return failed != groups;
+}
+
+// Copies the projected fields into one block, so Peach_free_record_set can free it via fields[0].
+static PeachRecord* materialize(const PeachQueryRun* run, char* const* fields, int num_fields) {
+    const PeachQuery* query = run->query;
+    int out_fields = run->result->num_fields;
+    const char* values[PEACH_QUERY_MAX_FIELDS];
+    size_t total = 0;
+    for (int i = 0; i < out_fields; i++) {
+        int index = query->select != NULL ? query->select[i] : i;
+        values[i] = field_at(fields, num_fields, index);
+        total += strlen(values[i]) + 1;
+    }
+
+    PeachRecord* record = calloc(1, sizeof(PeachRecord));
+    char* block = malloc(total > 0 ? total : 1);
+    char** out = calloc(out_fields > 0 ? out_fields : 1, sizeof(char*));
+    if (record == NULL || block == NULL || out == NULL) {
+        free(record);
+        free(block);
+        free(out);
+        return NULL;
+    }
+    char* cursor = block;
+    for (int i = 0; i < out_fields; i++) {
+        size_t len = strlen(values[i]);
+        memcpy(cursor, values[i], len + 1);
+        out[i] = cursor;
+        cursor += len + 1;
+    }
+    if (out_fields == 0) {
+        block[0] = '\0';
+        out[0] = block; // Keeps the record freeable
+    }
+    record->fields = out;
+    record->num_fields = out_fields;
+    return record;
+}
+
+static void free_record(PeachRecord* record) {
+    if (record == NULL) return;
+    free(record->fields[0]);
+    free(record->fields);
+    free(record);
+}
+
+int PeachQuery_begin(PeachQueryRun* run, const PeachQuery* query, int num_fields, bool newest_first) {
+    memset(run, 0, sizeof(*run));
+    run->query = query;
+    run->newest_first = newest_first;
+    run->result = calloc(1, sizeof(PeachRecordSet));
+    if (run->result == NULL) return -1;
+
+    int out_fields = query->select != NULL ? query->select_count : num_fields;
+    if (out_fields > PEACH_QUERY_MAX_FIELDS) out_fields = PEACH_QUERY_MAX_FIELDS;
+    run->result->num_fields = out_fields;
+
+    if (query->order != PEACH_ORDER_ASC && query->limit > 0 && !newest_first) {
+        run->ring = calloc((size_t)query->limit, sizeof(PeachRecord*));
+        if (run->ring == NULL) {
+            free(run->result);
+            run->result = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+bool PeachQuery_offer(PeachQueryRun* run, char* const* fields, int num_fields) {
+    const PeachQuery* query = run->query;
+    if (run->failed) return false;
+    if (!matches(query, fields, num_fields)) return true;
+
+    PeachRecord* record = materialize(run, fields, num_fields);
+    if (record == NULL) {
+        run->failed = true;
+        return false;
+    }
+
+    if (run->newest_first) {
+        // Fed newest first: DESC appends, TAIL prepends to restore file order
+        if (query->order == PEACH_ORDER_TAIL) {
+            record->next = run->result->head;
+            run->result->head = record;
+        } else {
+            if (run->tail == NULL) run->result->head = record; else run->tail->next = record;
+            run->tail = record;
+        }
+        run->result->record_count++;
+        return query->limit == 0 || run->result->record_count < query->limit;
+    }
+
+    if (query->order == PEACH_ORDER_ASC || (query->order == PEACH_ORDER_TAIL && run->ring == NULL)) {
+        if (run->tail == NULL) run->result->head = record; else run->tail->next = record;
+        run->tail = record;
+        run->result->record_count++;
+        return query->limit == 0 || run->result->record_count < query->limit;
+    }
+
+    if (run->ring == NULL) {
+        // Descending without a limit: newest first means prepending
+        record->next = run->result->head;
+        run->result->head = record;
+        run->result->record_count++;
+        return true;
+    }
+
+    // Limited descending or tail: keep the newest 'limit' matches seen so far
+    if (run->ring_count < query->limit) {
+        run->ring[(run->ring_start + run->ring_count) % query->limit] = record;
+        run->ring_count++;
+    } else {
+        free_record(run->ring[run->ring_start]);
+        run->ring[run->ring_start] = record;
+        run->ring_start = (run->ring_start + 1) % query->limit;
+    }
+    return true;
+}
+
+PeachRecordSet* PeachQuery_finish(PeachQueryRun* run) {
+    if (run->ring != NULL) {
+        // Link the ring newest first (DESC) or oldest first (TAIL)
+        for (int i = 0; i < run->ring_count; i++) {
+            PeachRecord* record = run->ring[(run->ring_start + i) % run->query->limit];
+            if (run->query->order == PEACH_ORDER_TAIL) {
+                if (run->tail == NULL) run->result->head = record; else run->tail->next = record;
+                run->tail = record;
+            } else {
+                record->next = run->result->head;
+                run->result->head = record;
+            }
+            run->result->record_count++;
+        }
+        free(run->ring);
+        run->ring = NULL;
+    }
+    if (run->failed) {
+        Peach_free_record_set(run->result);
+        run->result = NULL;
+    }
+    return run->result;
+}
@@ -0,0 +1,61 @@
+#ifndef PEACH_QUERY_H
+#define PEACH_QUERY_H
+#include <stdbool.h>
+#include "../../peachdb.h"
+
+/*==================[ PEACHDB QUERY EXECUTION ]===================
+ * Evaluates a PeachQuery record by record. The caller feeds every
+ * candidate record as an array of field strings (a line tokenized in
+ * place, or a cached record); only matching records are copied, and
+ * only their projected fields.
+ *
+ * Records are fed either in file order (forward) or newest first (a
+ * backward scan, see reverse.h). Fed newest first, descending and tail
+ * queries can stop at the limit instead of keeping a ring of matches.
+ ==========================================================*/
+
+#define PEACH_QUERY_MAX_FIELDS 64
+
+// Execution state of one query. Lives on the caller's stack.
+typedef struct {
+    const PeachQuery* query;
+    PeachRecordSet* result;
+    PeachRecord* tail;      // Last record in ascending order
+    PeachRecord** ring;     // Newest 'limit' matches of a forward-fed, limited DESC/TAIL query
+    int ring_start;
+    int ring_count;
+    bool newest_first;      // Records are fed from the end of the collection
+    bool failed;            // Out of memory
+} PeachQueryRun;
+
+/**
+ * @brief Splits a record line in place ('^' becomes '\0'), like Peach_read_all_records.
+ * @param line The line, without its trailing newline.
+ * @param fields Receives pointers to the fields.
+ * @param num_fields The number of fields declared by the collection header.
+ * @return The number of fields found (at most num_fields).
+ */
+int PeachQuery_split_line(char* line, char** fields, int num_fields);
+
+/**
+ * @brief Prepares a run. The result set reports 'num_fields' when no projection is given.
+ * @param newest_first true if records will be offered newest first (ASC queries
+ *        must be fed in file order).
+ * @return 0 on success, -1 on allocation failure.
+ */
+int PeachQuery_begin(PeachQueryRun* run, const PeachQuery* query, int num_fields, bool newest_first);
+
+/**
+ * @brief Offers one record to the query.
+ * @param fields The record's fields; NULL entries and fields past num_fields read as "".
+ * @return false once no further record can change the result (limit reached).
+ */
+bool PeachQuery_offer(PeachQueryRun* run, char* const* fields, int num_fields);
+
+/**
+ * @brief Completes the run and hands over the result set.
+ * @return The result, or NULL if the run failed.
+ */
+PeachRecordSet* PeachQuery_finish(PeachQueryRun* run);
+
+#endif // PEACH_QUERY_H
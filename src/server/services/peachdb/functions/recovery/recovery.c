@@ -0,0 +1,296 @@
+#include "recovery.h"
+#include "../checksum/checksum.h"
+#include "../../../logService/logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define COPY_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    long scan_start;        // Offset of the first verified line
+    long good_end;          // End of the last intact line
+    int bad_lines;          // Complete lines whose checksum fails...
+    bool bad_inside;        // ...some of them followed by an intact line
+    long torn_offset;       // Start of the bytes after the last newline, -1 if none
+    bool torn_is_record;    // Those bytes are a whole checksummed record
+} ScanResult;
+
+static bool ends_with(const char* name, const char* suffix) {
+    size_t name_len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return name_len > suffix_len && strcmp(name + name_len - suffix_len, suffix) == 0;
+}
+
+static bool line_intact(const char* line, size_t length) {
+    return length == 0 || PeachChecksum_verify(line, length) != PEACH_LINE_CORRUPT;
+}
+
+// Keeps removed bytes next to the collection for inspection.
+static void save_rejected(const char* path, const char* data, size_t length) {
+    char rejected_path[600];
+    snprintf(rejected_path, sizeof(rejected_path), "%s.rejected", path);
+    FILE* file = fopen(rejected_path, "a");
+    if (file == NULL) return;
+    fwrite(data, 1, length, file);
+    if (length > 0 && data[length - 1] != '\n') fputc('\n', file);
+    fclose(file);
+}
+
+// Finds damaged lines. Returns -1 if the file has no complete header (left as is).
+static int scan_file(FILE* file, long size, bool full_check, ScanResult* out) {
+    char* line = NULL;
+    size_t capacity = 0;
+
+    // 1. Skip the header
+    ssize_t length = getline(&line, &capacity, file);
+    if (length <= 0 || line[length - 1] != '\n') {
+        free(line);
+        return -1;
+    }
+    long start = (long)length;
+
+    // 2. Unless every record is checked, start at the first line of the tail
+    if (!full_check && size - PEACH_RECOVERY_TAIL_BYTES > start) {
+        long tail = size - PEACH_RECOVERY_TAIL_BYTES;
+        fseek(file, tail - 1, SEEK_SET);
+        if (fgetc(file) == '\n') {
+            start = tail;
+        } else if ((length = getline(&line, &capacity, file)) > 0 && line[length - 1] == '\n') {
+            start = tail + (long)length;
+        } // else: one line fills the whole tail, so check everything
+    }
+
+    // 3. Verify every line from there
+    memset(out, 0, sizeof(*out));
+    out->scan_start = start;
+    out->good_end = start;
+    out->torn_offset = -1;
+    fseek(file, start, SEEK_SET);
+    long offset = start;
+    while ((length = getline(&line, &capacity, file)) > 0) {
+        if (line[length - 1] != '\n') {
+            out->torn_offset = offset;
+            out->torn_is_record = PeachChecksum_verify(line, (size_t)length) == PEACH_LINE_VERIFIED;
+            break;
+        }
+        if (line_intact(line, (size_t)length - 1)) {
+            if (out->bad_lines > 0) out->bad_inside = true;
+            out->good_end = offset + (long)length;
+        } else {
+            out->bad_lines++;
+        }
+        offset += (long)length;
+    }
+    free(line);
+    return 0;
+}
+
+// Cuts the file at 'end', keeping what is removed.
+static int truncate_file(FILE* file, const char* path, long end, long size) {
+    char* removed = malloc((size_t)(size - end));
+    if (removed != NULL) {
+        fseek(file, end, SEEK_SET);
+        size_t length = fread(removed, 1, (size_t)(size - end), file);
+        save_rejected(path, removed, length);
+        free(removed);
+    }
+    fflush(file);
+    return (ftruncate(fileno(file), end) == 0 && fsync(fileno(file)) == 0) ? 0 : -1;
+}
+
+// Rewrites the file without its damaged lines, through an atomic rename.
+static int rewrite_file(FILE* file, const char* path, const ScanResult* scan) {
+    char temp_path[600];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* temp_file = fopen(temp_path, "w");
+    if (temp_file == NULL) return -1;
+
+    // 1. Bytes before the scanned region were not verified: keep them
+    char* block = malloc(COPY_BLOCK_SIZE);
+    int status = block != NULL ? 0 : -1;
+    fseek(file, 0, SEEK_SET);
+    for (long left = scan->scan_start; status == 0 && left > 0;) {
+        size_t chunk = left < COPY_BLOCK_SIZE ? (size_t)left : COPY_BLOCK_SIZE;
+        if (fread(block, 1, chunk, file) != chunk || fwrite(block, 1, chunk, temp_file) != chunk) status = -1;
+        left -= (long)chunk;
+    }
+    free(block);
+
+    // 2. Copy the intact lines of the scanned region
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while (status == 0 && (length = getline(&line, &capacity, file)) > 0) {
+        bool complete = line[length - 1] == '\n';
+        size_t content = complete ? (size_t)length - 1 : (size_t)length;
+        bool keep = complete ? line_intact(line, content)
+                             : PeachChecksum_verify(line, content) == PEACH_LINE_VERIFIED;
+        if (keep) {
+            fwrite(line, 1, content, temp_file);
+            fputc('\n', temp_file);
+        } else {
+            save_rejected(path, line, (size_t)length);
+        }
+    }
+    free(line);
+
+    if (fflush(temp_file) != 0 || fsync(fileno(temp_file)) != 0) status = -1;
+    fclose(temp_file);
+    if (status == 0 && rename(temp_path, path) != 0) status = -1;
+    if (status != 0) remove(temp_path);
+    return status;
+}
+
+// Returns 1 if the file was repaired, 0 if it was intact, -1 on failure.
+static int check_collection(const char* path, bool full_check, PeachRecoveryReport* report) {
+    FILE* file = fopen(path, "r+");
+    if (file == NULL) return -1;
+    struct stat st;
+    ScanResult scan;
+    if (fstat(fileno(file), &st) != 0 || scan_file(file, (long)st.st_size, full_check, &scan) != 0) {
+        fclose(file);
+        LOG_WARN("peachdb", "Collection file '%s' has no complete header; left as is.", path);
+        return 0;
+    }
+    long size = (long)st.st_size;
+    if (scan.bad_lines == 0 && scan.torn_offset < 0) {
+        fclose(file);
+        return 0;
+    }
+
+    // 1. Choose the cheapest repair
+    int status;
+    long removed;
+    int dropped = scan.bad_lines;
+    if (scan.bad_lines == 0 && scan.torn_is_record) {
+        // The last record only lost its newline
+        fseek(file, 0, SEEK_END);
+        status = (fputc('\n', file) != EOF && fflush(file) == 0 && fsync(fileno(file)) == 0) ? 0 : -1;
+        removed = 0;
+    } else if (!scan.bad_inside && !scan.torn_is_record) {
+        // Only the end is damaged
+        status = truncate_file(file, path, scan.good_end, size);
+        removed = size - scan.good_end;
+        if (scan.torn_offset >= 0) dropped++;
+    } else {
+        status = rewrite_file(file, path, &scan);
+        struct stat rewritten;
+        removed = (status == 0 && stat(path, &rewritten) == 0) ? size - (long)rewritten.st_size : 0;
+        if (scan.torn_offset >= 0 && !scan.torn_is_record) dropped++;
+    }
+    fclose(file);
+
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not repair collection file '%s': %s", path, strerror(errno));
+        return -1;
+    }
+    LOG_WARN("peachdb", "Repaired collection file '%s': removed %d damaged record(s) (%ld bytes, kept in %s.rejected).",
+             path, dropped, removed, path);
+    report->records_dropped += dropped;
+    report->bytes_removed += removed;
+    return 1;
+}
+
+// Finishes or drops an interrupted rewrite.
+static void recover_temp_file(const char* collections_path, const char* name) {
+    char temp_path[600];
+    char original_path[600];
+    snprintf(temp_path, sizeof(temp_path), "%s/%s", collections_path, name);
+    snprintf(original_path, sizeof(original_path), "%s/%.*s", collections_path, (int)(strlen(name) - 4), name);
+
+    if (access(original_path, F_OK) == 0) {
+        LOG_WARN("peachdb", "Dropping interrupted rewrite '%s'.", temp_path);
+        remove(temp_path);
+    } else if (rename(temp_path, original_path) == 0) {
+        LOG_WARN("peachdb", "Restored '%s' from its rewrite file.", original_path);
+    }
+}
+
+static char** list_files(const char* path, const char* suffix, int* out_count) {
+    *out_count = 0;
+    DIR* dir = opendir(path);
+    if (dir == NULL) return NULL;
+    char** names = NULL;
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!ends_with(entry->d_name, suffix)) continue;
+        char** grown = realloc(names, (size_t)(count + 1) * sizeof(char*));
+        if (grown == NULL) break;
+        names = grown;
+        names[count] = strdup(entry->d_name);
+        if (names[count] != NULL) count++;
+    }
+    closedir(dir);
+    *out_count = count;
+    return names != NULL ? names : calloc(1, sizeof(char*));
+}
+
+static void free_list(char** names, int count) {
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+void PeachRecovery_sync_dir(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+int PeachRecovery_run(const char* collections_path, bool full_check,
+                      void (*on_repaired)(const char* collection_name), PeachRecoveryReport* report) {
+    memset(report, 0, sizeof(*report));
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // 1. Interrupted rewrites
+    int count = 0;
+    char** names = list_files(collections_path, ".lpdb.tmp", &count);
+    if (names == NULL) {
+        LOG_ERROR("peachdb", "Could not list %s for recovery.", collections_path);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        recover_temp_file(collections_path, names[i]);
+    }
+    free_list(names, count);
+    PeachRecovery_sync_dir(collections_path);
+
+    // 2. Torn or damaged records
+    names = list_files(collections_path, ".lpdb", &count);
+    if (names == NULL) return -1;
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        char path[600];
+        snprintf(path, sizeof(path), "%s/%s", collections_path, names[i]);
+        int result = check_collection(path, full_check, report);
+        report->collections++;
+        if (result < 0) {
+            status = -1;
+        } else if (result > 0) {
+            report->repaired++;
+            names[i][strlen(names[i]) - strlen(".lpdb")] = '\0';
+            if (on_repaired != NULL) on_repaired(names[i]);
+        }
+    }
+    free_list(names, count);
+    if (report->repaired > 0) PeachRecovery_sync_dir(collections_path);
+
+    struct timespec finished;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double elapsed_ms = (double)(finished.tv_sec - started.tv_sec) * 1000.0 +
+                        (double)(finished.tv_nsec - started.tv_nsec) / 1e6;
+    LOG_INFO("peachdb", "Recovery checked %d collections (%s) in %.1f ms; %d repaired.",
+             report->collections, full_check ? "every record" : "file tails", elapsed_ms, report->repaired);
+    return status;
+}
@@ -0,0 +1,53 @@
+#ifndef PEACH_RECOVERY_H
+#define PEACH_RECOVERY_H
+#include <stdbool.h>
+
+/*==================[ PEACHDB CRASH RECOVERY ]====================
+ * Runs once at startup, before any collection is read, and repairs what
+ * a crash may have left in the collections directory:
+ *
+ * - A '.tmp' rewrite file means an update or delete was interrupted
+ *   before its atomic rename: the original is still complete, so the
+ *   '.tmp' is dropped. If the original is missing (older versions removed
+ *   it before renaming), the '.tmp' becomes the collection.
+ * - A torn tail (bytes after the last newline, or trailing records whose
+ *   checksum fails) is cut off. A checksummed record that only lost its
+ *   newline gets it back.
+ * - Damaged records followed by good ones are removed by rewriting the
+ *   file.
+ *
+ * Removed bytes are appended to '<collection>.lpdb.rejected' so nothing is
+ * silently lost. Interrupted appends can only damage the end of a file, so
+ * by default only its last PEACH_RECOVERY_TAIL_BYTES are verified; a full
+ * check reads every record.
+ ==========================================================*/
+
+#define PEACH_RECOVERY_TAIL_BYTES (64 * 1024)
+
+typedef struct {
+    int collections;        // Collection files checked
+    int repaired;           // Collection files changed
+    int records_dropped;    // Damaged or torn records removed
+    long bytes_removed;
+} PeachRecoveryReport;
+
+/**
+ * @brief Checks and repairs every collection file of a directory.
+ * @param collections_path The collections directory.
+ * @param full_check Verify every record instead of the tail of each file.
+ * @param on_repaired Called with the name of every repaired collection, so
+ *                    its in-memory indexes are rebuilt from the new file.
+ * @param report Receives what was done.
+ * @return 0 on success, -1 if a file could not be repaired.
+ */
+int PeachRecovery_run(const char* collections_path, bool full_check,
+                      void (*on_repaired)(const char* collection_name), PeachRecoveryReport* report);
+
+/**
+ * @brief Flushes a directory's entries to disk, so files renamed into it
+ *        or removed from it stay that way after a crash. Best effort.
+ * @param path The directory.
+ */
+void PeachRecovery_sync_dir(const char* path);
+
+#endif // PEACH_RECOVERY_H
@@ -0,0 +1,111 @@
+#include "reverse.h"
+#include "../compress/compress.h"
+#include <stdlib.h>
+#include <string.h>
+
+int PeachReverse_open(PeachReverseReader* reader, const char* collection_path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = PeachCompress_open(collection_path); // Compressed segments read the same
+    if (reader->file == NULL) return -1;
+
+    // 1. Count the fields of the header line
+    char header[4096];
+    if (fgets(header, sizeof(header), reader->file) != NULL) {
+        reader->bytes_read += strlen(header);
+        header[strcspn(header, "\n")] = '\0';
+        if (header[0] != '\0') {
+            reader->num_fields = 1;
+            for (char* p = header; *p != '\0'; p++) {
+                if (*p == '^') reader->num_fields++;
+            }
+        }
+    }
+    reader->data_start = ftell(reader->file);
+
+    // 2. Start at the end of the file with an empty buffer
+    fseek(reader->file, 0, SEEK_END);
+    reader->position = ftell(reader->file);
+    if (reader->data_start < 0 || reader->position < reader->data_start) {
+        reader->position = reader->data_start;
+    }
+    reader->capacity = PEACH_REVERSE_BLOCK_SIZE + 1;
+    reader->buffer = malloc(reader->capacity);
+    if (reader->buffer == NULL) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Prepends the previous block of the file to the buffer.
+// Returns the number of bytes read, 0 at the header, -1 on error.
+static long read_previous_block(PeachReverseReader* reader) {
+    long available = reader->position - reader->data_start;
+    if (available <= 0) return 0;
+    size_t chunk = available < PEACH_REVERSE_BLOCK_SIZE ? (size_t)available : PEACH_REVERSE_BLOCK_SIZE;
+
+    // A line longer than the buffer makes it grow (+1 keeps room for a terminator)
+    if (reader->length + chunk + 1 > reader->capacity) {
+        size_t capacity = reader->capacity * 2;
+        while (capacity < reader->length + chunk + 1) capacity *= 2;
+        char* grown = realloc(reader->buffer, capacity);
+        if (grown == NULL) return -1;
+        reader->buffer = grown;
+        reader->capacity = capacity;
+    }
+
+    memmove(reader->buffer + chunk, reader->buffer, reader->length);
+    reader->position -= (long)chunk;
+    if (fseek(reader->file, reader->position, SEEK_SET) != 0 ||
+        fread(reader->buffer, 1, chunk, reader->file) != chunk) {
+        return -1;
+    }
+    reader->length += chunk;
+    reader->bytes_read += chunk;
+    return (long)chunk;
+}
+
+char* PeachReverse_next(PeachReverseReader* reader) {
+    if (reader->file == NULL) return NULL;
+
+    for (;;) {
+        // 1. Drop the newline that ends the current last line
+        while (reader->length > 0 && reader->buffer[reader->length - 1] == '\n') {
+            reader->length--;
+        }
+
+        // 2. The line starts after the previous newline in the buffer...
+        char* newline = NULL;
+        for (size_t i = reader->length; i > 0; i--) {
+            if (reader->buffer[i - 1] == '\n') {
+                newline = &reader->buffer[i - 1];
+                break;
+            }
+        }
+        if (newline != NULL) {
+            char* line = newline + 1;
+            reader->buffer[reader->length] = '\0';
+            reader->length = (size_t)(newline - reader->buffer) + 1;
+            return line;
+        }
+
+        // 3. ...or further back in the file
+        long loaded = read_previous_block(reader);
+        if (loaded > 0) continue;
+        if (loaded < 0 || reader->length == 0) return NULL;
+
+        // 4. At the header: what is left is the first record
+        reader->buffer[reader->length] = '\0';
+        reader->length = 0;
+        return reader->buffer;
+    }
+}
+
+void PeachReverse_close(PeachReverseReader* reader) {
+    if (reader->file != NULL) fclose(reader->file);
+    free(reader->buffer);
+    reader->file = NULL;
+    reader->buffer = NULL;
+    reader->length = 0;
+}
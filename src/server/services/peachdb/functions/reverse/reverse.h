@@ -0,0 +1,50 @@
+#ifndef PEACH_REVERSE_H
+#define PEACH_REVERSE_H
+#include <stdio.h>
+#include <stddef.h>
+
+/*==================[ PEACHDB REVERSE SCAN ]======================
+ * Reads the records of a collection file from the end towards the
+ * header, newest first. The file is read backwards in fixed-size
+ * blocks, so fetching the latest N records costs about N records of
+ * I/O instead of the whole file.
+ *
+ * The caller must hold the collection's lock (see locks.h) for as long
+ * as the reader is open.
+ ==========================================================*/
+
+#define PEACH_REVERSE_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    FILE* file;
+    long data_start;        // Offset of the first record (just after the header line)
+    long position;          // File offset of buffer[0]; bytes before it are not read yet
+    char* buffer;           // Unconsumed bytes [position, position + length)
+    size_t length;
+    size_t capacity;
+    int num_fields;         // From the header line
+    size_t bytes_read;      // For Metrics_add_db_io
+} PeachReverseReader;
+
+/**
+ * @brief Opens a collection file and reads its header.
+ * @param reader The reader to initialize.
+ * @param collection_path Path of the .lpdb (or compressed .lpdz) file.
+ * @return 0 on success, -1 if the file cannot be opened or memory is exhausted.
+ */
+int PeachReverse_open(PeachReverseReader* reader, const char* collection_path);
+
+/**
+ * @brief Returns the previous non-empty record line, without its newline.
+ * The line may be modified in place (e.g., with PeachQuery_split_line) and
+ * stays valid until the next call.
+ * @return The line, or NULL once the header is reached.
+ */
+char* PeachReverse_next(PeachReverseReader* reader);
+
+/**
+ * @brief Closes the file and frees the block buffer.
+ */
+void PeachReverse_close(PeachReverseReader* reader);
+
+#endif // PEACH_REVERSE_H
@@ -0,0 +1,467 @@
+#include "segments.h"
+#include "../checksum/checksum.h"
+#include "../compress/compress.h"
+#include "../../../logService/logService.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MAX_SEGMENTED_COLLECTIONS 16
+#define SEGMENT_NAME_LEN 64
+#define MANIFEST_FIELDS 10 // 9 before compression
+
+typedef struct {
+    char name[SEGMENT_NAME_LEN];
+    char time_field[SEGMENT_NAME_LEN];
+    long max_bytes;                     // 0: never rolls over
+    bool compress;                      // New segments are compressed
+    PeachSegment* segments;
+    int count;
+    int capacity;
+} SegmentedCollection;
+
+static SegmentedCollection g_collections[MAX_SEGMENTED_COLLECTIONS];
+static int g_collection_count = 0;
+static pthread_mutex_t g_segments_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// --- Registry (callers hold g_segments_mutex) ---
+
+static SegmentedCollection* find_collection(const char* name) {
+    for (int i = 0; i < g_collection_count; i++) {
+        if (strcmp(g_collections[i].name, name) == 0) return &g_collections[i];
+    }
+    return NULL;
+}
+
+static SegmentedCollection* find_or_add_collection(const char* name) {
+    SegmentedCollection* collection = find_collection(name);
+    if (collection != NULL) return collection;
+    if (g_collection_count >= MAX_SEGMENTED_COLLECTIONS || strlen(name) >= SEGMENT_NAME_LEN) return NULL;
+    collection = &g_collections[g_collection_count++];
+    memset(collection, 0, sizeof(*collection));
+    snprintf(collection->name, sizeof(collection->name), "%s", name);
+    return collection;
+}
+
+static int append_segment(SegmentedCollection* collection, const PeachSegment* segment) {
+    if (collection->count == collection->capacity) {
+        int capacity = collection->capacity > 0 ? collection->capacity * 2 : 8;
+        PeachSegment* grown = realloc(collection->segments, (size_t)capacity * sizeof(PeachSegment));
+        if (grown == NULL) return -1;
+        collection->segments = grown;
+        collection->capacity = capacity;
+    }
+    collection->segments[collection->count++] = *segment;
+    return 0;
+}
+
+static void remove_segment(SegmentedCollection* collection, int index) {
+    memmove(&collection->segments[index], &collection->segments[index + 1],
+            (size_t)(collection->count - index - 1) * sizeof(PeachSegment));
+    collection->count--;
+}
+
+// Widens the time range of a segment to include 'value'. A value too long
+// to be kept drops the range: the segment is then never skipped by time.
+static void widen_time(PeachSegment* segment, const char* value, bool* first) {
+    if (strlen(value) >= PEACH_SEGMENT_TIME_LEN) {
+        segment->min_time[0] = '\0';
+        segment->max_time[0] = '\0';
+        *first = false;
+        return;
+    }
+    if (*first || strcmp(value, segment->min_time) < 0) snprintf(segment->min_time, PEACH_SEGMENT_TIME_LEN, "%s", value);
+    if (*first || strcmp(value, segment->max_time) > 0) snprintf(segment->max_time, PEACH_SEGMENT_TIME_LEN, "%s", value);
+    *first = false;
+}
+
+// --- Configuration ---
+
+int PeachSegments_configure(const char* collection_name, const char* time_field, long max_bytes) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_or_add_collection(collection_name);
+    int status = -1;
+    if (collection != NULL && (time_field == NULL || strlen(time_field) < SEGMENT_NAME_LEN)) {
+        snprintf(collection->time_field, sizeof(collection->time_field), "%s", time_field != NULL ? time_field : "");
+        collection->max_bytes = max_bytes;
+        status = 0;
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+    return status;
+}
+
+int PeachSegments_set_compression(const char* collection_name, bool enabled) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_or_add_collection(collection_name);
+    if (collection != NULL) collection->compress = enabled;
+    pthread_mutex_unlock(&g_segments_mutex);
+    return collection != NULL ? 0 : -1;
+}
+
+bool PeachSegments_compression(const char* collection_name) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    bool enabled = collection != NULL && collection->compress;
+    pthread_mutex_unlock(&g_segments_mutex);
+    return enabled;
+}
+
+long PeachSegments_rollover_size(const char* collection_name) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    long max_bytes = collection != NULL ? collection->max_bytes : 0;
+    pthread_mutex_unlock(&g_segments_mutex);
+    return max_bytes;
+}
+
+void PeachSegments_time_field(const char* collection_name, char* out, size_t size) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    snprintf(out, size, "%s", collection != NULL ? collection->time_field : "");
+    pthread_mutex_unlock(&g_segments_mutex);
+}
+
+// --- Manifest ---
+
+bool PeachSegments_is_manifest_line(const char* line) {
+    return line[0] == PEACH_SEGMENT_MANIFEST_MARK;
+}
+
+// Splits on '^', keeping empty fields. Returns the number of fields.
+static int split_fields(char* line, char** fields, int max_fields) {
+    int count = 0;
+    fields[count++] = line;
+    for (char* p = line; *p != '\0' && count < max_fields; p++) {
+        if (*p == '^') {
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+    return count;
+}
+
+int PeachSegments_load_manifest(const char* index_path) {
+    FILE* file = fopen(index_path, "r");
+    if (file == NULL) return -1;
+
+    pthread_mutex_lock(&g_segments_mutex);
+    for (int i = 0; i < g_collection_count; i++) {
+        g_collections[i].count = 0; // Configuration stays, segments are read again
+    }
+    char line[1024];
+    int loaded = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (!PeachSegments_is_manifest_line(line)) continue;
+        line[strcspn(line, "\n")] = '\0';
+        char* fields[MANIFEST_FIELDS];
+        int field_count = split_fields(line + 1, fields, MANIFEST_FIELDS);
+        if (field_count < MANIFEST_FIELDS - 1) {
+            LOG_WARN("peachdb", "Ignoring a malformed segment line in %s.", index_path);
+            continue;
+        }
+        SegmentedCollection* collection = find_or_add_collection(fields[0]);
+        if (collection == NULL) continue;
+        PeachSegment segment = {
+            .number = atoi(fields[1]),
+            .bytes = atol(fields[3]),
+            .records = atol(fields[4]),
+            .min_key = strtoll(fields[5], NULL, 10),
+            .max_key = strtoll(fields[6], NULL, 10),
+            .compressed = field_count == MANIFEST_FIELDS && atoi(fields[9]) != 0
+        };
+        snprintf(segment.min_time, sizeof(segment.min_time), "%s", fields[7]);
+        snprintf(segment.max_time, sizeof(segment.max_time), "%s", fields[8]);
+        if (collection->time_field[0] == '\0') {
+            snprintf(collection->time_field, sizeof(collection->time_field), "%s", fields[2]);
+        }
+        if (append_segment(collection, &segment) == 0) loaded++;
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+    fclose(file);
+    return loaded;
+}
+
+void PeachSegments_write_manifest(FILE* file) {
+    pthread_mutex_lock(&g_segments_mutex);
+    for (int i = 0; i < g_collection_count; i++) {
+        const SegmentedCollection* collection = &g_collections[i];
+        for (int j = 0; j < collection->count; j++) {
+            const PeachSegment* segment = &collection->segments[j];
+            fprintf(file, "%c%s^%d^%s^%ld^%ld^%lld^%lld^%s^%s^%d\n", PEACH_SEGMENT_MANIFEST_MARK,
+                    collection->name, segment->number, collection->time_field, segment->bytes, segment->records,
+                    segment->min_key, segment->max_key, segment->min_time, segment->max_time, segment->compressed ? 1 : 0);
+        }
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+}
+
+// --- Recovery ---
+
+void PeachSegments_path(char* out, size_t size, const char* collections_path, const char* collection, int number) {
+    snprintf(out, size, "%s/%s.%06d.lpdb", collections_path, collection, number);
+}
+
+void PeachSegments_file(char* out, size_t size, const char* collections_path, const char* collection,
+                        const PeachSegment* segment) {
+    snprintf(out, size, "%s/%s.%06d%s", collections_path, collection, segment->number,
+             segment->compressed ? PEACH_COMPRESS_EXTENSION : ".lpdb");
+}
+
+static bool same_file(const char* a, const char* b) {
+    struct stat st_a;
+    struct stat st_b;
+    return stat(a, &st_a) == 0 && stat(b, &st_b) == 0 && st_a.st_dev == st_b.st_dev && st_a.st_ino == st_b.st_ino;
+}
+
+// Replaces the active file, still linked to its last segment, with a file holding only the header.
+static int reset_active(const char* active_path, const char* segment_path) {
+    FILE* segment = fopen(segment_path, "r");
+    if (segment == NULL) return -1;
+    char header[4096];
+    int status = fgets(header, sizeof(header), segment) != NULL ? 0 : -1;
+    fclose(segment);
+    if (status != 0) return -1;
+
+    char temp_path[600];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", active_path);
+    FILE* temp = fopen(temp_path, "w");
+    if (temp == NULL) return -1;
+    if (fputs(header, temp) == EOF || fflush(temp) != 0 || fsync(fileno(temp)) != 0) status = -1;
+    fclose(temp);
+    if (status == 0 && rename(temp_path, active_path) != 0) status = -1;
+    if (status != 0) remove(temp_path);
+    return status;
+}
+
+// Segment files the manifest does not know: a rollover stopped before the
+// manifest was written, so the active file still holds their records.
+static void remove_unlisted_segments(const char* collections_path) {
+    DIR* dir = opendir(collections_path);
+    if (dir == NULL) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // <collection>.<number>.lpdb
+        char name[256];
+        snprintf(name, sizeof(name), "%s", entry->d_name);
+        size_t length = strlen(name);
+        if (length > 9 && strcmp(name + length - 9, PEACH_COMPRESS_EXTENSION ".tmp") == 0) {
+            char temp_path[600];
+            snprintf(temp_path, sizeof(temp_path), "%s/%s", collections_path, entry->d_name);
+            unlink(temp_path); // An interrupted compression
+            continue;
+        }
+        if (length < 13 || strcmp(name + length - 5, ".lpdb") != 0) continue;
+        name[length - 5] = '\0';
+        char* dot = strrchr(name, '.');
+        if (dot == NULL || strlen(dot + 1) != 6 || strspn(dot + 1, "0123456789") != 6) continue;
+        *dot = '\0';
+        int number = atoi(dot + 1);
+
+        SegmentedCollection* collection = find_collection(name);
+        bool listed = false;
+        for (int i = 0; collection != NULL && i < collection->count; i++) {
+            if (collection->segments[i].number == number) listed = true;
+        }
+        if (listed) continue;
+
+        char segment_path[600];
+        char active_path[600];
+        snprintf(segment_path, sizeof(segment_path), "%s/%s", collections_path, entry->d_name);
+        snprintf(active_path, sizeof(active_path), "%s/%s.lpdb", collections_path, name);
+        if (same_file(segment_path, active_path)) {
+            LOG_WARN("peachdb", "Undoing the interrupted rollover of '%s' to segment %d.", name, number);
+            unlink(segment_path);
+        } else {
+            LOG_WARN("peachdb", "Segment file '%s' is not in the manifest; left as is.", segment_path);
+        }
+    }
+    closedir(dir);
+}
+
+int PeachSegments_recover(const char* collections_path) {
+    int changed = 0;
+    pthread_mutex_lock(&g_segments_mutex);
+    remove_unlisted_segments(collections_path);
+    for (int i = 0; i < g_collection_count; i++) {
+        SegmentedCollection* collection = &g_collections[i];
+        char active_path[600];
+        snprintf(active_path, sizeof(active_path), "%s/%s.lpdb", collections_path, collection->name);
+        for (int j = collection->count - 1; j >= 0; j--) {
+            // The file the manifest does not name is left over from a compression or a rewrite
+            PeachSegment other = collection->segments[j];
+            other.compressed = !other.compressed;
+            char segment_path[600];
+            char other_path[600];
+            PeachSegments_file(segment_path, sizeof(segment_path), collections_path, collection->name,
+                               &collection->segments[j]);
+            PeachSegments_file(other_path, sizeof(other_path), collections_path, collection->name, &other);
+            if (access(segment_path, F_OK) == 0 && access(other_path, F_OK) == 0) {
+                LOG_WARN("peachdb", "Removing '%s', superseded by '%s'.", other_path, segment_path);
+                unlink(other_path);
+            }
+            if (access(segment_path, F_OK) != 0) {
+                LOG_ERROR("peachdb", "Segment file '%s' is missing; dropping it from the manifest.", segment_path);
+                remove_segment(collection, j);
+                changed = 1;
+            } else if (same_file(segment_path, active_path)) {
+                // The manifest has the segment, but the active file was not replaced yet
+                LOG_WARN("peachdb", "Finishing the interrupted rollover of '%s'.", collection->name);
+                if (reset_active(active_path, segment_path) != 0) {
+                    LOG_ERROR("peachdb", "Could not finish the rollover of '%s': %s", collection->name, strerror(errno));
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+    return changed;
+}
+
+// --- Reading ---
+
+int PeachSegments_list(const char* collection_name, PeachSegment* out, int max) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    int count = collection != NULL ? collection->count : 0;
+    if (count > 0 && out != NULL) {
+        memcpy(out, collection->segments, (size_t)(count < max ? count : max) * sizeof(PeachSegment));
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+    return count;
+}
+
+int PeachSegments_count(const char* collection_name) {
+    return PeachSegments_list(collection_name, NULL, 0);
+}
+
+// Returns false if a predicate rules out every value in [min, max].
+static bool range_may_match(PeachOperator op, int below_min, int above_max, int at_min, int at_max) {
+    switch (op) {
+        case PEACH_EQ: return !below_min && !above_max;
+        case PEACH_GE: return !above_max;
+        case PEACH_GT: return !above_max && !at_max;
+        case PEACH_LE: return !below_min;
+        case PEACH_LT: return !below_min && !at_min;
+        case PEACH_NE: return true;
+    }
+    return true;
+}
+
+bool PeachSegments_may_match(const PeachSegment* segment, const PeachQuery* query, int time_field) {
+    if (query->where_count == 0) return true;
+    bool has_time = segment->max_time[0] != '\0';
+
+    uint32_t groups = 0;
+    uint32_t ruled_out = 0;
+    for (int i = 0; i < query->where_count; i++) {
+        const PeachPredicate* predicate = &query->where[i];
+        uint32_t group = 1u << (predicate->or_group & 31);
+        groups |= group;
+
+        bool may_match = true;
+        if (predicate->field == 0 && predicate->text == NULL) {
+            long long value = predicate->number;
+            may_match = range_may_match(predicate->op, value < segment->min_key, value > segment->max_key,
+                                        value <= segment->min_key, value >= segment->max_key);
+        } else if (has_time && predicate->field == time_field && predicate->text != NULL) {
+            int from_min = strcmp(predicate->text, segment->min_time);
+            int from_max = strcmp(predicate->text, segment->max_time);
+            may_match = range_may_match(predicate->op, from_min < 0, from_max > 0, from_min <= 0, from_max >= 0);
+        }
+        if (!may_match) ruled_out |= group;
+    }
+    return ruled_out != groups;
+}
+
+// --- Changes ---
+
+int PeachSegments_measure(const char* path, int time_field, PeachSegment* out) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    memset(out, 0, sizeof(*out));
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length = getline(&line, &capacity, file); // Header
+    long bytes = length > 0 ? (long)length : 0;
+    bool first_key = true;
+    bool first_time = time_field >= 0;
+    bool has_time = time_field >= 0;
+    while ((length = getline(&line, &capacity, file)) >= 0) {
+        bytes += (long)length;
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '\0' || PeachChecksum_strip(line) == PEACH_LINE_CORRUPT) continue;
+        out->records++;
+
+        long long key = strtoll(line, NULL, 10);
+        if (first_key || key < out->min_key) out->min_key = key;
+        if (first_key || key > out->max_key) out->max_key = key;
+        first_key = false;
+
+        if (has_time) {
+            const char* value = line;
+            for (int i = 0; i < time_field && value != NULL; i++) {
+                value = strchr(value, '^');
+                if (value != NULL) value++;
+            }
+            char time_value[PEACH_SEGMENT_TIME_LEN + 1];
+            size_t time_length = value != NULL ? strcspn(value, "^") : 0;
+            if (time_length > PEACH_SEGMENT_TIME_LEN) time_length = PEACH_SEGMENT_TIME_LEN; // Too long either way
+            memcpy(time_value, value != NULL ? value : "", time_length);
+            time_value[time_length] = '\0';
+            widen_time(out, time_value, &first_time);
+            if (out->max_time[0] == '\0' && !first_time) has_time = false; // Range dropped
+        }
+    }
+    free(line);
+    fclose(file);
+    out->bytes = bytes;
+    return 0;
+}
+
+int PeachSegments_add(const char* collection_name, const PeachSegment* segment) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_or_add_collection(collection_name);
+    int status = collection != NULL ? append_segment(collection, segment) : -1;
+    pthread_mutex_unlock(&g_segments_mutex);
+    return status;
+}
+
+void PeachSegments_remove_last(const char* collection_name) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    if (collection != NULL && collection->count > 0) collection->count--;
+    pthread_mutex_unlock(&g_segments_mutex);
+}
+
+void PeachSegments_set_compressed(const char* collection_name, int number, bool compressed, long bytes) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    for (int i = 0; collection != NULL && i < collection->count; i++) {
+        if (collection->segments[i].number != number) continue;
+        collection->segments[i].compressed = compressed;
+        collection->segments[i].bytes = bytes;
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+}
+
+void PeachSegments_on_rewrite(const char* collection_name, int number, bool deleted, const char* new_time, long bytes) {
+    pthread_mutex_lock(&g_segments_mutex);
+    SegmentedCollection* collection = find_collection(collection_name);
+    for (int i = 0; collection != NULL && i < collection->count; i++) {
+        PeachSegment* segment = &collection->segments[i];
+        if (segment->number != number) continue;
+        segment->bytes = bytes;
+        if (deleted && segment->records > 0) segment->records--;
+        if (new_time != NULL && segment->max_time[0] != '\0') {
+            bool first = false;
+            widen_time(segment, new_time, &first);
+        }
+    }
+    pthread_mutex_unlock(&g_segments_mutex);
+}
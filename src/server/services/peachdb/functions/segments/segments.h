@@ -0,0 +1,160 @@
+#ifndef PEACH_SEGMENTS_H
+#define PEACH_SEGMENTS_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "../../peachdb.h"
+
+/*==================[ PEACHDB COLLECTION SEGMENTS ]===============
+ * Large, append-mostly collections (messages) are split into sealed
+ * segments, so scans, rewrites and backups do not touch their whole
+ * history:
+ *
+ *   collections/messages.000001.lpdb   sealed, oldest records
+ *   collections/messages.000002.lpdb   sealed
+ *   collections/messages.lpdb          active: appends and indexes
+ *
+ * - When the active file grows past the configured size it rolls over:
+ *   it becomes the next segment (a hard link), the manifest records it,
+ *   and a new active file holding only the header replaces it.
+ * - Every segment file has the collection header, so it reads like a
+ *   collection file. Updates and deletes rewrite only the file that holds
+ *   the record.
+ * - The manifest lives at the end of index.mpdb, one line per segment:
+ *     @<collection>^<number>^<time_field>^<bytes>^<records>^<min_key>^<max_key>^<min_time>^<max_time>^<compressed>
+ *   Keys are compared as numbers, times as text. Queries skip segments
+ *   whose ranges cannot match; the ranges may be wider than the records
+ *   (deletes do not shrink them).
+ * - Indexes (Bloom filters, time index, B+trees) cover the active file.
+ * - A collection may keep its segments compressed (<c>.NNNNNN.lpdz, see
+ *   compress.h). A segment is sealed as .lpdb first and compressed after
+ *   the rollover; the manifest says which of the two files is current.
+ *
+ * Callers must hold the collection's lock (see locks.h); the registry
+ * itself is guarded by a mutex of this module.
+ ==========================================================*/
+
+#define PEACH_SEGMENT_TIME_LEN 32
+#define PEACH_SEGMENT_MANIFEST_MARK '@'
+
+typedef struct {
+    int number;                             // 1, 2, ... in file order
+    long bytes;
+    long records;
+    long long min_key;
+    long long max_key;
+    char min_time[PEACH_SEGMENT_TIME_LEN];  // "" if the collection has no time field
+    char max_time[PEACH_SEGMENT_TIME_LEN];
+    bool compressed;                        // Stored as .lpdz
+} PeachSegment;
+
+/**
+ * @brief Makes a collection roll over to a new segment once its active file reaches max_bytes.
+ * @param collection The collection name.
+ * @param time_field The field whose range every segment records (e.g., "time"), or NULL.
+ * @param max_bytes The rollover size.
+ * @return 0 on success, -1 if the segment table is full.
+ */
+int PeachSegments_configure(const char* collection, const char* time_field, long max_bytes);
+
+/**
+ * @brief Makes a collection compress the segments it seals (see compress.h).
+ * @return 0 on success, -1 if the segment table is full.
+ */
+int PeachSegments_set_compression(const char* collection, bool enabled);
+
+/**
+ * @brief Returns true if a collection compresses its segments.
+ */
+bool PeachSegments_compression(const char* collection);
+
+/**
+ * @brief Returns the rollover size of a collection, 0 if it never rolls over.
+ */
+long PeachSegments_rollover_size(const char* collection);
+
+/**
+ * @brief Copies the time field name of a collection into out ("" if none).
+ */
+void PeachSegments_time_field(const char* collection, char* out, size_t size);
+
+/**
+ * @brief Reads the segment lines of index.mpdb.
+ * @return The number of segments, or -1 if the file cannot be read.
+ */
+int PeachSegments_load_manifest(const char* index_path);
+
+/**
+ * @brief Writes every segment line, for a rewrite of index.mpdb.
+ */
+void PeachSegments_write_manifest(FILE* file);
+
+/**
+ * @brief Returns true for a segment line of index.mpdb.
+ */
+bool PeachSegments_is_manifest_line(const char* line);
+
+/**
+ * @brief Finishes or undoes a rollover a crash interrupted, and drops manifest
+ *        entries whose file is missing.
+ * @return 1 if the manifest changed (rewrite index.mpdb), 0 otherwise.
+ */
+int PeachSegments_recover(const char* collections_path);
+
+/**
+ * @brief Builds the path of a segment's .lpdb file.
+ */
+void PeachSegments_path(char* out, size_t size, const char* collections_path, const char* collection, int number);
+
+/**
+ * @brief Builds the path of a segment's current file (.lpdz if compressed).
+ */
+void PeachSegments_file(char* out, size_t size, const char* collections_path, const char* collection,
+                        const PeachSegment* segment);
+
+/**
+ * @brief Copies the segments of a collection, oldest first.
+ * @return The number of segments (all of them, even if more than max).
+ */
+int PeachSegments_list(const char* collection, PeachSegment* out, int max);
+
+/**
+ * @brief Returns the number of segments of a collection.
+ */
+int PeachSegments_count(const char* collection);
+
+/**
+ * @brief Returns false if no record of the segment can match the query.
+ * @param time_field Position of the collection's time field, -1 if none.
+ */
+bool PeachSegments_may_match(const PeachSegment* segment, const PeachQuery* query, int time_field);
+
+/**
+ * @brief Scans a file and records its size, record count and key and time ranges.
+ * @param time_field Position of the time field, -1 if none.
+ * @return 0 on success, -1 if the file cannot be read.
+ */
+int PeachSegments_measure(const char* path, int time_field, PeachSegment* out);
+
+/**
+ * @brief Adds a sealed segment to a collection; its number must follow the last one.
+ * @return 0 on success, -1 on failure.
+ */
+int PeachSegments_add(const char* collection, const PeachSegment* segment);
+
+/**
+ * @brief Removes the last segment of a collection (to undo a failed rollover).
+ */
+void PeachSegments_remove_last(const char* collection);
+
+/**
+ * @brief Marks a segment as compressed, now 'bytes' bytes on disk.
+ */
+void PeachSegments_set_compressed(const char* collection, int number, bool compressed, long bytes);
+
+/**
+ * @brief Follows a rewrite of a segment: one record was deleted (new_time NULL
+ *        and deleted true) or updated (its time field is now new_time).
+ */
+void PeachSegments_on_rewrite(const char* collection, int number, bool deleted, const char* new_time, long bytes);
+
+#endif // PEACH_SEGMENTS_H
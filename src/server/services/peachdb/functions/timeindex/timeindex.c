@@ -0,0 +1,432 @@
+#include "timeindex.h"
+#include "../checksum/checksum.h"
+#include "../pool/pool.h"
+#include "../indexfile/indexfile.h"
+#include "../../../metricsService/metricsService.h"
+#include "../../../logService/logService.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define MAX_TIME_INDEXES 16
+#define TIME_INDEX_NAME_LEN 64
+#define TIME_VALUE_LEN 32
+
+typedef struct {
+    long offset;                        // First record of the block
+    char max_value[TIME_VALUE_LEN];     // Largest value from the start of the file to the end of the block
+} TimeIndexEntry;
+
+typedef struct {
+    char name[TIME_INDEX_NAME_LEN];
+    char path[256];
+    char field_name[TIME_INDEX_NAME_LEN];
+    int field_index;                    // Resolved from the header at build time, -1 if unknown
+    TimeIndexEntry* entries;
+    int entry_count;
+    int entry_capacity;
+    long records;                       // Records covered by the index
+    long end_offset;                    // Where the next appended record starts
+    char max_value[TIME_VALUE_LEN];     // Largest value so far
+    bool sorted;                        // No value was ever smaller than a previous one
+    bool usable;                        // false if a value is too long to be indexed
+    _Atomic bool ready;
+    pthread_mutex_t build_mutex;        // Serializes lazy builds by concurrent readers
+} TimeIndex;
+
+static TimeIndex g_indexes[MAX_TIME_INDEXES];
+static _Atomic int g_index_count = 0;
+static pthread_mutex_t g_indexes_mutex = PTHREAD_MUTEX_INITIALIZER; // Serializes registration
+
+// Copies field 'field_index' of a '^'-separated line; a missing field reads as "".
+// Returns false if the value does not fit.
+static bool copy_field(const char* line, int field_index, char* out, size_t size) {
+    const char* start = line;
+    for (int i = 0; i < field_index; i++) {
+        start = strchr(start, '^');
+        if (start == NULL) {
+            out[0] = '\0';
+            return true;
+        }
+        start++;
+    }
+    size_t len = strcspn(start, "^\n");
+    if (len >= size) return false;
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return true;
+}
+
+static int add_record(TimeIndex* index, const char* line, long offset) {
+    char value[TIME_VALUE_LEN];
+    if (!copy_field(line, index->field_index, value, sizeof(value))) {
+        index->usable = false;
+        return 0;
+    }
+
+    // 1. Every PEACH_TIME_INDEX_STRIDE records start a new block
+    if (index->records % PEACH_TIME_INDEX_STRIDE == 0) {
+        if (index->entry_count == index->entry_capacity) {
+            int capacity = index->entry_capacity > 0 ? index->entry_capacity * 2 : 64;
+            TimeIndexEntry* grown = realloc(index->entries, (size_t)capacity * sizeof(TimeIndexEntry));
+            if (grown == NULL) return -1;
+            index->entries = grown;
+            index->entry_capacity = capacity;
+        }
+        TimeIndexEntry* entry = &index->entries[index->entry_count++];
+        entry->offset = offset;
+        memcpy(entry->max_value, index->max_value, TIME_VALUE_LEN);
+    }
+
+    // 2. Raise the running maximum of the current block
+    if (strcmp(value, index->max_value) < 0) {
+        index->sorted = false;
+    } else {
+        memcpy(index->max_value, value, TIME_VALUE_LEN);
+        memcpy(index->entries[index->entry_count - 1].max_value, value, TIME_VALUE_LEN);
+    }
+    index->records++;
+    return 0;
+}
+
+// --- Building ---
+
+static int resolve_field(TimeIndex* index, char* header) {
+    header[strcspn(header, "\n")] = '\0';
+    int field = 0;
+    const char* start = header;
+    for (const char* p = header;; p++) {
+        if (*p == '^' || *p == '\0') {
+            if ((size_t)(p - start) == strlen(index->field_name) &&
+                strncmp(start, index->field_name, (size_t)(p - start)) == 0) {
+                return field;
+            }
+            if (*p == '\0') break;
+            field++;
+            start = p + 1;
+        }
+    }
+    LOG_WARN("peachdb", "Time index field '%s' not found in collection '%s'.", index->field_name, index->name);
+    return -1;
+}
+
+// Adds the records of [start, end) of the file. 'first_value' (may be NULL)
+// receives the first indexed value. Returns the bytes read.
+static size_t scan_lines(TimeIndex* index, FILE* file, long start, long end, char* first_value) {
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    long offset = start;
+    fseek(file, start, SEEK_SET);
+    while (index->usable && offset < end && (length = getline(&line, &line_capacity, file)) >= 0) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] != '\0' && PeachChecksum_strip(line) != PEACH_LINE_CORRUPT) {
+            if (add_record(index, line, offset) != 0) index->usable = false;
+            if (first_value != NULL && index->records == 1) {
+                memcpy(first_value, index->max_value, TIME_VALUE_LEN);
+            }
+        }
+        offset += (long)length;
+    }
+    free(line);
+    return (size_t)(offset - start);
+}
+
+static void reset_index(TimeIndex* index) {
+    index->entry_count = 0;
+    index->records = 0;
+    index->max_value[0] = '\0';
+    index->sorted = true;
+    index->usable = index->field_index >= 0;
+}
+
+// --- Parallel build: every chunk is indexed on its own, then the chunks are joined ---
+
+typedef struct {
+    const TimeIndex* index;
+    long bounds[PEACH_POOL_MAX_CHUNKS + 1];
+    TimeIndex parts[PEACH_POOL_MAX_CHUNKS];
+    char first_values[PEACH_POOL_MAX_CHUNKS][TIME_VALUE_LEN];
+    size_t bytes_read[PEACH_POOL_MAX_CHUNKS];
+} TimeIndexBuild;
+
+static void build_chunk(int chunk, void* context) {
+    TimeIndexBuild* build = context;
+    TimeIndex* part = &build->parts[chunk];
+    part->field_index = build->index->field_index;
+    reset_index(part);
+    FILE* file = fopen(build->index->path, "r");
+    if (file == NULL) {
+        part->usable = false;
+        return;
+    }
+    build->bytes_read[chunk] = scan_lines(part, file, build->bounds[chunk], build->bounds[chunk + 1],
+                                          build->first_values[chunk]);
+    fclose(file);
+}
+
+// Joins the chunk indexes; block maxima become running maxima over the whole file.
+static int join_chunks(TimeIndex* index, TimeIndexBuild* build, int chunks) {
+    int entry_count = 0;
+    for (int c = 0; c < chunks; c++) {
+        if (!build->parts[c].usable) index->usable = false;
+        entry_count += build->parts[c].entry_count;
+    }
+    if (!index->usable) return 0;
+    if (entry_count > index->entry_capacity) {
+        TimeIndexEntry* grown = realloc(index->entries, (size_t)entry_count * sizeof(TimeIndexEntry));
+        if (grown == NULL) return -1;
+        index->entries = grown;
+        index->entry_capacity = entry_count;
+    }
+
+    for (int c = 0; c < chunks; c++) {
+        TimeIndex* part = &build->parts[c];
+        if (part->records > 0 && (!part->sorted || strcmp(build->first_values[c], index->max_value) < 0)) {
+            index->sorted = false;
+        }
+        for (int e = 0; e < part->entry_count; e++) {
+            TimeIndexEntry* entry = &index->entries[index->entry_count++];
+            *entry = part->entries[e];
+            if (strcmp(entry->max_value, index->max_value) < 0) {
+                memcpy(entry->max_value, index->max_value, TIME_VALUE_LEN);
+            } else {
+                memcpy(index->max_value, entry->max_value, TIME_VALUE_LEN);
+            }
+        }
+        index->records += part->records;
+    }
+    return 0;
+}
+
+// --- Snapshots (see indexfile.h) ---
+
+typedef struct {
+    int32_t field_index;
+    uint8_t sorted;
+    uint8_t usable;
+    uint8_t padding[2];
+    int64_t records;
+    char max_value[TIME_VALUE_LEN];
+    int64_t entry_count;
+} TimeIndexSnapshot;
+
+static void save_snapshot(TimeIndex* index) {
+    size_t entries_length = (size_t)index->entry_count * sizeof(TimeIndexEntry);
+    char* payload = malloc(sizeof(TimeIndexSnapshot) + entries_length);
+    if (payload == NULL) return;
+    TimeIndexSnapshot header = {
+        .field_index = index->field_index,
+        .sorted = index->sorted,
+        .usable = index->usable,
+        .records = index->records,
+        .entry_count = index->entry_count
+    };
+    memcpy(header.max_value, index->max_value, TIME_VALUE_LEN);
+    memcpy(payload, &header, sizeof(header));
+    if (entries_length > 0) memcpy(payload + sizeof(header), index->entries, entries_length);
+    PeachIndexFile_save(index->name, "tidx", index->path, index->end_offset, payload, sizeof(header) + entries_length);
+    free(payload);
+}
+
+// Restores the index from its snapshot. Returns the bytes of the file it covers, or -1.
+static long load_snapshot(TimeIndex* index) {
+    PeachIndexFile snapshot;
+    if (PeachIndexFile_open(&snapshot, index->name, "tidx", index->path) != 0) return -1;
+
+    TimeIndexSnapshot header;
+    long covered = -1;
+    if (snapshot.payload_length >= sizeof(header)) {
+        memcpy(&header, snapshot.payload, sizeof(header));
+        size_t entries_length = (size_t)header.entry_count * sizeof(TimeIndexEntry);
+        bool valid = header.field_index == index->field_index && header.entry_count >= 0 &&
+                     snapshot.payload_length == sizeof(header) + entries_length;
+        if (valid && header.entry_count > index->entry_capacity) {
+            TimeIndexEntry* grown = realloc(index->entries, entries_length);
+            if (grown != NULL) {
+                index->entries = grown;
+                index->entry_capacity = (int)header.entry_count;
+            } else {
+                valid = false;
+            }
+        }
+        if (valid) {
+            if (entries_length > 0) memcpy(index->entries, snapshot.payload + sizeof(header), entries_length);
+            index->entry_count = (int)header.entry_count;
+            index->records = header.records;
+            index->sorted = header.sorted != 0;
+            index->usable = header.usable != 0;
+            memcpy(index->max_value, header.max_value, TIME_VALUE_LEN);
+            index->max_value[TIME_VALUE_LEN - 1] = '\0';
+            covered = snapshot.covered;
+        }
+    }
+    PeachIndexFile_close(&snapshot);
+    return covered;
+}
+
+static int build_index(TimeIndex* index) {
+    FILE* file = fopen(index->path, "r");
+    if (file == NULL) return -1;
+
+    // 1. Resolve the field from the header and find where the records end
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length = getline(&line, &line_capacity, file);
+    if (length < 0) {
+        free(line);
+        fclose(file);
+        return -1;
+    }
+    long data_start = (long)length;
+    index->field_index = resolve_field(index, line);
+    free(line);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    reset_index(index);
+    size_t bytes_read = (size_t)data_start;
+
+    // 2. Warm restart: take the snapshot and add what was appended since
+    long covered = index->usable ? load_snapshot(index) : -1;
+    if (covered >= data_start) {
+        bytes_read += scan_lines(index, file, covered, size, NULL);
+    } else if (index->usable && size - data_start >= PEACH_POOL_CHUNK_MIN_BYTES) {
+        // 3. Big files are indexed in line-aligned chunks on several threads
+        reset_index(index);
+        TimeIndexBuild* build = calloc(1, sizeof(TimeIndexBuild));
+        int threads = PeachPool_threads();
+        int chunks = build != NULL ? PeachPool_split_lines(index->path, data_start, size, threads, build->bounds) : -1;
+        if (chunks > 0) {
+            build->index = index;
+            PeachPool_run(chunks, threads, build_chunk, build);
+            if (join_chunks(index, build, chunks) != 0) index->usable = false;
+            for (int c = 0; c < chunks; c++) {
+                bytes_read += build->bytes_read[c];
+                free(build->parts[c].entries);
+            }
+        } else {
+            index->usable = false;
+        }
+        free(build);
+    } else {
+        reset_index(index);
+        bytes_read += scan_lines(index, file, data_start, size, NULL);
+    }
+    index->end_offset = size;
+    fclose(file);
+    Metrics_add_db_io(index->name, bytes_read, 0);
+
+    if (index->usable && covered < size) save_snapshot(index);
+    return 0;
+}
+
+static bool ensure_ready(TimeIndex* index) {
+    if (atomic_load_explicit(&index->ready, memory_order_acquire)) return true;
+    pthread_mutex_lock(&index->build_mutex);
+    if (!atomic_load_explicit(&index->ready, memory_order_relaxed) && build_index(index) == 0) {
+        atomic_store_explicit(&index->ready, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&index->build_mutex);
+    return atomic_load_explicit(&index->ready, memory_order_acquire);
+}
+
+// --- Registry ---
+
+static TimeIndex* find_index(const char* collection) {
+    int count = atomic_load_explicit(&g_index_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_indexes[i].name, collection) == 0) return &g_indexes[i];
+    }
+    return NULL;
+}
+
+int PeachTimeIndex_declare(const char* collection, const char* collection_path, const char* field_name) {
+    TimeIndex* index = find_index(collection);
+    if (index != NULL) return strcmp(index->field_name, field_name) == 0 ? 0 : -1; // Fast path
+
+    pthread_mutex_lock(&g_indexes_mutex);
+    int status = 0;
+    index = find_index(collection);
+    if (index == NULL) {
+        int count = atomic_load_explicit(&g_index_count, memory_order_relaxed);
+        if (count >= MAX_TIME_INDEXES || strlen(collection) >= TIME_INDEX_NAME_LEN ||
+            strlen(field_name) >= TIME_INDEX_NAME_LEN) {
+            status = -1;
+        } else {
+            index = &g_indexes[count];
+            snprintf(index->name, sizeof(index->name), "%s", collection);
+            snprintf(index->path, sizeof(index->path), "%s", collection_path);
+            snprintf(index->field_name, sizeof(index->field_name), "%s", field_name);
+            index->field_index = -1;
+            pthread_mutex_init(&index->build_mutex, NULL);
+            atomic_store_explicit(&g_index_count, count + 1, memory_order_release);
+        }
+    } else if (strcmp(index->field_name, field_name) != 0) {
+        status = -1;
+    }
+    pthread_mutex_unlock(&g_indexes_mutex);
+    return status;
+}
+
+int PeachTimeIndex_field(const char* collection) {
+    TimeIndex* index = find_index(collection);
+    if (index == NULL || !ensure_ready(index) || !index->usable) return -1;
+    return index->field_index;
+}
+
+long PeachTimeIndex_seek(const char* collection, const char* lo, bool* out_sorted) {
+    TimeIndex* index = find_index(collection);
+    if (index == NULL || !ensure_ready(index) || !index->usable) return -1;
+    *out_sorted = index->sorted;
+
+    if (index->entry_count == 0) return index->end_offset;
+    if (lo == NULL) return index->entries[0].offset;
+
+    // First block whose running maximum reaches lo; every earlier record is < lo
+    int low = 0;
+    int high = index->entry_count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (strcmp(index->entries[middle].max_value, lo) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < index->entry_count ? index->entries[low].offset : index->end_offset;
+}
+
+void PeachTimeIndex_on_append(const char* collection, const char* record_str, size_t line_length) {
+    TimeIndex* index = find_index(collection);
+    if (index == NULL || !atomic_load_explicit(&index->ready, memory_order_acquire)) return; // Built from the file later
+    if (!index->usable) return;
+
+    if (add_record(index, record_str, index->end_offset) != 0) {
+        atomic_store_explicit(&index->ready, false, memory_order_release);
+        return;
+    }
+    index->end_offset += (long)line_length;
+}
+
+void PeachTimeIndex_invalidate(const char* collection) {
+    TimeIndex* index = find_index(collection);
+    if (index != NULL) {
+        atomic_store_explicit(&index->ready, false, memory_order_release);
+    }
+}
+
+void PeachTimeIndex_load(const char* collection) {
+    TimeIndex* index = find_index(collection);
+    if (index != NULL) ensure_ready(index);
+}
+
+int PeachTimeIndex_save(const char* collection) {
+    TimeIndex* index = find_index(collection);
+    if (index == NULL || !atomic_load_explicit(&index->ready, memory_order_acquire) || !index->usable) return -1;
+    save_snapshot(index);
+    return 0;
+}
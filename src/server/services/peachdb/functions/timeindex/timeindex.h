@@ -0,0 +1,77 @@
+#ifndef PEACH_TIME_INDEX_H
+#define PEACH_TIME_INDEX_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/*==================[ PEACHDB SPARSE TIME INDEX ]=================
+ * A sparse, in-memory index from a sortable text field (e.g. a
+ * "YYYY-MM-DD HH:MM:SS" timestamp) to file offsets, so "records since T"
+ * starts reading near T instead of at the header.
+ *
+ * - Records are grouped in blocks of PEACH_TIME_INDEX_STRIDE lines. Each
+ *   entry holds the offset of its block and the largest value seen in
+ *   the file up to the end of that block (a running maximum), so a seek
+ *   never skips a record >= T, even if a clock step wrote values out of
+ *   order.
+ * - While every appended value is >= the previous ones the collection is
+ *   "sorted" and a scan may also stop at the first value past its upper
+ *   bound.
+ * - Built lazily from the collection file on first use; appends extend it,
+ *   updates and deletes (which rewrite the file) drop it for a rebuild.
+ * - Every build saves a snapshot (see indexfile.h) that the next build
+ *   after a restart starts from. Large files are indexed in chunks on
+ *   several threads (see pool.h).
+ *
+ * Callers must hold the collection's lock (see locks.h): shared for
+ * lookups, exclusive for the on_* hooks.
+ ==========================================================*/
+
+#define PEACH_TIME_INDEX_STRIDE 128
+
+/**
+ * @brief Declares the time index of a collection (idempotent, one field per collection).
+ * @param collection The collection name.
+ * @param collection_path Path of the collection file, used to (re)build the index.
+ * @param field_name The indexed field.
+ * @return 0 on success, -1 if the index table is full or another field is already indexed.
+ */
+int PeachTimeIndex_declare(const char* collection, const char* collection_path, const char* field_name);
+
+/**
+ * @brief Returns the header position of the indexed field.
+ * @return The field index, or -1 if the collection has no usable index.
+ */
+int PeachTimeIndex_field(const char* collection);
+
+/**
+ * @brief Finds where to start reading for records whose field is >= lo.
+ * @param lo The lower bound, or NULL to start at the first record.
+ * @param out_sorted Set to true if values are stored in ascending order.
+ * @return The file offset to seek to, or -1 if the collection has no usable index.
+ */
+long PeachTimeIndex_seek(const char* collection, const char* lo, bool* out_sorted);
+
+/**
+ * @brief Extends the index with a record that was just appended to the file.
+ * @param record_str The record, without checksum.
+ * @param line_length Bytes appended to the file (checksum and newline included).
+ */
+void PeachTimeIndex_on_append(const char* collection, const char* record_str, size_t line_length);
+
+/**
+ * @brief Drops the index of a collection; it is rebuilt on next use.
+ */
+void PeachTimeIndex_invalidate(const char* collection);
+
+/**
+ * @brief Builds the index of a collection now instead of on first use.
+ */
+void PeachTimeIndex_load(const char* collection);
+
+/**
+ * @brief Saves a snapshot of the index of a collection, if it is built.
+ * @return 0 on success, -1 if there is nothing to save.
+ */
+int PeachTimeIndex_save(const char* collection);
+
+#endif // PEACH_TIME_INDEX_H
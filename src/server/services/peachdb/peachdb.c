@@ -7,29 +7,65 @@
  *   - peachdata/
  *     - collections/
  *         - {collection_name}.lpdb
+ *         - {collection_name}.NNNNNN.lpdb  (sealed segments, see segments.h)
  *     - index.mpdb
+ *     - .snapshot/    (hard links held by a running backup, see backup.h)
+ *     - indexes/      (index snapshots for warm restarts, see indexfile.h,
+ *                      and B+tree index files, see btree.h)
  *
  * index.mpdb format:
  *   Line 1: <number_of_collections>
  *   Line 2...N: <collection_name> <num_fields> <field1> ... <fieldN>
+ *   Then: one '@' line per sealed segment (the manifest, see segments.h)
  *
  * {collection_name}.lpdb format:
  *   Line 1: <field1>^<field2>^...^<fieldN>
- *   Line 2...M: <value1>^<value2>^...^<valueN>
+ *   Line 2...M: <value1>^<value2>^...^<valueN><checksum>
+ *   (<checksum> is a CRC-32 of the record, see checksum.h)
+ *
+ * Rewrites (update, delete, new collection) go through a synced '.tmp' file
+ * and an atomic rename; Peach_initPeachDb repairs what a crash left behind
+ * (see recovery.h).
  ==========================================================*/
 
 #include "peachdb.h"
+#include "../metricsService/metricsService.h"
+#include "../logService/logService.h"
+#include "functions/cache/cache.h"
+#include "functions/bloom/bloom.h"
+#include "functions/query/query.h"
+#include "functions/reverse/reverse.h"
+#include "functions/timeindex/timeindex.h"
+#include "functions/locks/locks.h"
+#include "functions/backup/backup.h"
+#include "functions/checksum/checksum.h"
+#include "functions/recovery/recovery.h"
+#include "functions/pool/pool.h"
+#include "functions/indexfile/indexfile.h"
+#include "functions/btree/btree.h"
+#include "functions/segments/segments.h"
+#include "functions/compress/compress.h"
 #include <stdio.h>
 #include <sys/stat.h> // For mkdir
 #include <unistd.h>   // For access()
 #include <errno.h>    // For errno
 #include <string.h>   // For strerror
 #include <stdlib.h>   // For malloc, free
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
 
 // Define constants for paths
 #define DB_ROOT_PATH "peachdata"
 #define COLLECTIONS_PATH "peachdata/collections"
 #define INDEX_PATH "peachdata/index.mpdb"
+#define INDEX_TEMP_PATH "peachdata/index.mpdb.tmp"
+#define MAX_SNAPSHOT_COLLECTIONS 128 // As many as there are collection locks
+
+// Serializes rewrites of index.mpdb; collection files have their own locks (see locks.h)
+static pthread_mutex_t g_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int rewrite_index_locked(void);
 
 // Helper function to check if a directory exists and create it if not.
 // Returns 0 on success, -1 on failure.
@@ -37,13 +73,22 @@ static int ensure_dir_exists(const char* path) {
     struct stat st = {0};
     if (stat(path, &st) == -1) {
         if (mkdir(path, 0700) != 0) {
-            fprintf(stderr, "Error creating directory %s: %s\n", path, strerror(errno));
+            LOG_ERROR("peachdb", "Error creating directory %s: %s", path, strerror(errno));
             return -1;
         }
     }
     return 0;
 }
 
+// Recovery names segment files <collection>.<number>; their collection is invalidated.
+static void on_collection_repaired(const char* file_name) {
+    char collection_name[256];
+    snprintf(collection_name, sizeof(collection_name), "%s", file_name);
+    char* dot = strrchr(collection_name, '.');
+    if (dot != NULL && strlen(dot + 1) == 6 && strspn(dot + 1, "0123456789") == 6) *dot = '\0';
+    Peach_cache_invalidate(collection_name);
+}
+
 /**
  * @brief Initialize the PeachDB service.
  * Checks for 'peachdata/' directory, 'peachdata/collections/' directory,
@@ -61,21 +106,102 @@ int Peach_initPeachDb() {
         return -1;
     }
 
-    // 3. Ensure 'index.mpdb' file exists
+    // 3. Ensure 'peachdata/indexes' directory exists
+    if (ensure_dir_exists(PEACH_INDEX_SNAPSHOT_PATH) != 0) {
+        return -1;
+    }
+
+    // 4. Ensure 'index.mpdb' file exists
     if (access(INDEX_PATH, F_OK) == -1) {
         // File does not exist, create it with initial content "0"
         FILE* index_file = fopen(INDEX_PATH, "w");
         if (index_file == NULL) {
-            fprintf(stderr, "Error creating file %s: %s\n", INDEX_PATH, strerror(errno));
+            LOG_ERROR("peachdb", "Error creating file %s: %s", INDEX_PATH, strerror(errno));
             return -1;
         }
         fprintf(index_file, "0\n"); // Initial number of collections
         fclose(index_file);
     }
 
+    // 5. Size the record cache (PEACHDB_CACHE_MB=0 disables it)
+    const char* cache_mb = getenv("PEACHDB_CACHE_MB");
+    if (cache_mb != NULL) {
+        Peach_set_cache_budget((size_t)atol(cache_mb) * 1024u * 1024u);
+    }
+
+    // 6. Repair what a crash may have left behind (PEACHDB_VERIFY=full checks every record)
+    const char* verify = getenv("PEACHDB_VERIFY");
+    PeachRecoveryReport report;
+    if (PeachRecovery_run(COLLECTIONS_PATH, verify != NULL && strcmp(verify, "full") == 0,
+                          on_collection_repaired, &report) != 0) {
+        return -1;
+    }
+
+    // 7. Read the segment manifest and finish a rollover a crash interrupted
+    PeachSegments_load_manifest(INDEX_PATH);
+    if (PeachSegments_recover(COLLECTIONS_PATH) > 0) {
+        pthread_mutex_lock(&g_index_mutex);
+        int status = rewrite_index_locked();
+        pthread_mutex_unlock(&g_index_mutex);
+        if (status != 0) return -1;
+    }
+
     return 0; // Success
 }
 
+void Peach_set_cache_budget(size_t budget_bytes) {
+    PeachCache_set_budget(budget_bytes);
+}
+
+void Peach_cache_invalidate(const char* collection_name) {
+    pthread_rwlock_t* lock = PeachLock_get(collection_name);
+    if (lock != NULL) pthread_rwlock_wrlock(lock);
+    PeachCache_invalidate(collection_name);
+    PeachBloom_invalidate(collection_name);
+    PeachTimeIndex_invalidate(collection_name);
+    PeachBTree_invalidate(collection_name);
+    if (lock != NULL) pthread_rwlock_unlock(lock);
+}
+
+// Takes the collection lock, shared or exclusive. Returns NULL if no lock is available.
+static pthread_rwlock_t* lock_collection(const char* collection_name, int exclusive) {
+    pthread_rwlock_t* lock = PeachLock_get(collection_name);
+    if (lock == NULL) {
+        LOG_ERROR("peachdb", "Too many collections to lock '%s'.", collection_name);
+        return NULL;
+    }
+    if (exclusive) {
+        pthread_rwlock_wrlock(lock);
+    } else {
+        pthread_rwlock_rdlock(lock);
+    }
+    return lock;
+}
+
+// Verifies a record line read from a collection file and strips its checksum.
+// Damaged records are skipped; recovery removes them at the next start.
+static bool accept_line(const char* collection_name, char* line) {
+    if (PeachChecksum_strip(line) != PEACH_LINE_CORRUPT) return true;
+    LOG_WARN("peachdb", "Skipping a damaged record in collection '%s'.", collection_name);
+    return false;
+}
+
+// Puts a rewritten file in place of the original. The rewrite is
+// synced first and rename() replaces the original atomically, so a crash
+// leaves either the old or the new file (see recovery.h).
+static int replace_with_rewrite(FILE* temp_file, const char* temp_path, const char* original_path, const char* dir_path) {
+    int status = (fflush(temp_file) == 0 && fsync(fileno(temp_file)) == 0) ? 0 : -1;
+    fclose(temp_file);
+    if (status == 0 && rename(temp_path, original_path) != 0) status = -1;
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not replace '%s' with its rewrite: %s", original_path, strerror(errno));
+        remove(temp_path);
+        return -1;
+    }
+    PeachRecovery_sync_dir(dir_path);
+    return 0;
+}
+
 // Helper function to count fields and replace '^' with space.
 // This function modifies the input string `fields_str`.
 static int count_and_prepare_fields(char* fields_str) {
@@ -94,23 +220,46 @@ static int count_and_prepare_fields(char* fields_str) {
     return count;
 }
 
+// Rewrites index.mpdb with the current segment manifest (see segments.h).
+// Callers hold g_index_mutex.
+static int rewrite_index_locked(void) {
+    FILE* index_file = fopen(INDEX_PATH, "r");
+    if (index_file == NULL) {
+        LOG_ERROR("peachdb", "Could not open index file %s for reading.", INDEX_PATH);
+        return -1;
+    }
+    FILE* index_file_write = fopen(INDEX_TEMP_PATH, "w");
+    if (index_file_write == NULL) {
+        LOG_ERROR("peachdb", "Could not open index file %s for writing.", INDEX_PATH);
+        fclose(index_file);
+        return -1;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), index_file) != NULL) {
+        if (!PeachSegments_is_manifest_line(line)) fputs(line, index_file_write); // Collection lines stay
+    }
+    fclose(index_file);
+    PeachSegments_write_manifest(index_file_write);
+    return replace_with_rewrite(index_file_write, INDEX_TEMP_PATH, INDEX_PATH, DB_ROOT_PATH);
+}
+
 /**
  * @brief Creates a new collection with specified fields.
  * @param collection_name The name for the new collection.
  * @param fields A string containing field names separated by '^' (e.g., "id^name^age").
  * @return 0 on success, -1 on failure (e.g., collection already exists).
  */
-int Peach_collection_create(const char* collection_name, const char* fields) {
+static int collection_create_locked(const char* collection_name, const char* fields) {
     // --- 1. Read index file and check for existing collection ---
     FILE* index_file_read = fopen(INDEX_PATH, "r");
     if (index_file_read == NULL) {
-        fprintf(stderr, "Error: Could not open index file %s for reading.\n", INDEX_PATH);
+        LOG_ERROR("peachdb", "Could not open index file %s for reading.", INDEX_PATH);
         return -1;
     }
 
     int num_collections;
     if (fscanf(index_file_read, "%d\n", &num_collections) != 1) {
-        fprintf(stderr, "Error: Could not read number of collections from index.\n");
+        LOG_ERROR("peachdb", "Could not read number of collections from index.");
         fclose(index_file_read);
         return -1;
     }
@@ -118,7 +267,7 @@ int Peach_collection_create(const char* collection_name, const char* fields) {
     // Store existing lines in memory to write them back later
     char** existing_lines = malloc(sizeof(char*) * num_collections);
     if(num_collections > 0 && existing_lines == NULL) {
-        fprintf(stderr, "Error: Memory allocation failed for existing lines.\n");
+        LOG_ERROR("peachdb", "Memory allocation failed for existing lines.");
         fclose(index_file_read);
         return -1;
     }
@@ -126,7 +275,7 @@ int Peach_collection_create(const char* collection_name, const char* fields) {
     char buffer[512];
     for (int i = 0; i < num_collections; i++) {
         if (fgets(buffer, sizeof(buffer), index_file_read) == NULL) {
-            fprintf(stderr, "Warning: Index file may be corrupted. Unexpected EOF.\n");
+            LOG_WARN("peachdb", "Index file may be corrupted. Unexpected EOF.");
             num_collections = i;
             break;
         }
@@ -136,7 +285,7 @@ int Peach_collection_create(const char* collection_name, const char* fields) {
         char* current_collection_name = strtok(temp_buffer, " ");
 
         if (current_collection_name != NULL && strcmp(current_collection_name, collection_name) == 0) {
-            fprintf(stderr, "Error: Collection '%s' already exists.\n", collection_name);
+            LOG_ERROR("peachdb", "Collection '%s' already exists.", collection_name);
             for (int j = 0; j < i; j++) {
                 free(existing_lines[j]);
             }
@@ -154,7 +303,7 @@ int Peach_collection_create(const char* collection_name, const char* fields) {
 
     FILE* collection_file = fopen(collection_path, "w");
     if (collection_file == NULL) {
-        fprintf(stderr, "Error: Failed to create collection file %s.\n", collection_path);
+        LOG_ERROR("peachdb", "Failed to create collection file %s.", collection_path);
         for (int i = 0; i < num_collections; i++) {
             free(existing_lines[i]);
         }
@@ -162,12 +311,14 @@ int Peach_collection_create(const char* collection_name, const char* fields) {
         return -1;
     }
     fprintf(collection_file, "%s\n", fields);
+    fflush(collection_file);
+    fsync(fileno(collection_file));
     fclose(collection_file);
 
-    // --- 3. Write the new, updated index file ---
-    FILE* index_file_write = fopen(INDEX_PATH, "w");
+    // --- 3. Write the new, updated index file (replaced atomically) ---
+    FILE* index_file_write = fopen(INDEX_TEMP_PATH, "w");
     if (index_file_write == NULL) {
-        fprintf(stderr, "Error: Could not open index file %s for writing.\n", INDEX_PATH);
+        LOG_ERROR("peachdb", "Could not open index file %s for writing.", INDEX_PATH);
         remove(collection_path);
         for (int i = 0; i < num_collections; i++) {
             free(existing_lines[i]);
@@ -188,12 +339,26 @@ int Peach_collection_create(const char* collection_name, const char* fields) {
     int num_fields = count_and_prepare_fields(fields_copy);
     fprintf(index_file_write, "%s %d %s\n", collection_name, num_fields, fields_copy);
     free(fields_copy);
+    PeachSegments_write_manifest(index_file_write);
 
-    fclose(index_file_write);
+    if (replace_with_rewrite(index_file_write, INDEX_TEMP_PATH, INDEX_PATH, DB_ROOT_PATH) != 0) {
+        remove(collection_path);
+        return -1;
+    }
 
     return 0; // Success
 }
 
+int Peach_collection_create(const char* collection_name, const char* fields) {
+    pthread_mutex_lock(&g_index_mutex);
+    int status = collection_create_locked(collection_name, fields);
+    pthread_mutex_unlock(&g_index_mutex);
+    if (status == 0) {
+        Peach_cache_invalidate(collection_name); // A new, empty file replaced whatever was cached
+    }
+    return status;
+}
+
 // Helper to get the key (the first field) from a record string.
 // The caller must free the returned string.
 static char* get_key_from_record(const char* record_str) {
@@ -221,6 +386,93 @@ static char* get_key_from_record(const char* record_str) {
     return key;
 }
 
+// Returns the position of a field in the collection header, or -1.
+static int field_index_locked(const char* collection_name, const char* field_name) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    FILE* file = fopen(collection_path, "r");
+    if (file == NULL) return -1;
+    char header[4096];
+    int found = -1;
+    if (fgets(header, sizeof(header), file) != NULL) {
+        header[strcspn(header, "\n")] = '\0';
+        char* saveptr = NULL;
+        int index = 0;
+        for (char* name = strtok_r(header, "^", &saveptr); name != NULL; name = strtok_r(NULL, "^", &saveptr)) {
+            if (strcmp(name, field_name) == 0) {
+                found = index;
+                break;
+            }
+            index++;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// --- Segments (see segments.h) ---
+
+// Copies the sealed segments of a collection, oldest first. Returns their
+// count; free *out. Segments change only under the exclusive collection lock.
+static int list_segments(const char* collection_name, PeachSegment** out) {
+    *out = NULL;
+    int count = PeachSegments_count(collection_name);
+    if (count == 0) return 0;
+    *out = malloc((size_t)count * sizeof(PeachSegment));
+    if (*out == NULL) return 0;
+    int listed = PeachSegments_list(collection_name, *out, count);
+    return listed < count ? listed : count;
+}
+
+// Returns the position of the collection's segment time field, or -1.
+static int segment_time_field_locked(const char* collection_name) {
+    char time_field[64];
+    PeachSegments_time_field(collection_name, time_field, sizeof(time_field));
+    return time_field[0] != '\0' ? field_index_locked(collection_name, time_field) : -1;
+}
+
+// Copies field 'field' of a record (without checksum) into out.
+static void copy_field(const char* record_str, int field, char* out, size_t size) {
+    const char* value = record_str;
+    for (int i = 0; i < field && value != NULL; i++) {
+        value = strchr(value, '^');
+        if (value != NULL) value++;
+    }
+    size_t length = value != NULL ? strcspn(value, "^") : 0;
+    if (length >= size) length = size - 1;
+    memcpy(out, value != NULL ? value : "", length);
+    out[length] = '\0';
+}
+
+// Looks for a key in the sealed segments whose key range covers it.
+static bool segment_holds_key_locked(const char* collection_name, const char* key) {
+    PeachSegment* segments;
+    int count = list_segments(collection_name, &segments);
+    long long value = strtoll(key, NULL, 10);
+    size_t key_length = strlen(key);
+    bool found = false;
+    for (int i = count - 1; i >= 0 && !found; i--) {
+        if (value < segments[i].min_key || value > segments[i].max_key) continue;
+        char segment_path[256];
+        PeachSegments_file(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, &segments[i]);
+        FILE* file = PeachCompress_open_keys(segment_path, value, value); // Only the blocks that may hold it
+        if (file == NULL) continue;
+        char buffer[1024];
+        size_t bytes_read = 0;
+        if (fgets(buffer, sizeof(buffer), file) != NULL) bytes_read += strlen(buffer); // Header
+        while (!found && fgets(buffer, sizeof(buffer), file) != NULL) {
+            bytes_read += strlen(buffer);
+            found = strncmp(buffer, key, key_length) == 0 &&
+                    (buffer[key_length] == '^' || buffer[key_length] == PEACH_CHECKSUM_MARK || buffer[key_length] == '\n');
+        }
+        fclose(file);
+        Metrics_add_db_io(collection_name, bytes_read, 0);
+    }
+    free(segments);
+    return found;
+}
+
 /**
  * @brief Appends a new record to a collection, ensuring the first field is a unique key.
  * @param collection_name The name of the collection.
@@ -228,34 +480,49 @@ static char* get_key_from_record(const char* record_str) {
  *                   separated by '^' (e.g., "1^John Doe^30").
  * @return 0 on success, -1 on failure (duplicate key or other error).
  */
-int Peach_write_record(const char* collection_name, const char* record_str) {
+static int write_record_locked(const char* collection_name, const char* record_str, long* out_offset) {
     char collection_path[256];
     snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
 
     // Extract key from the new record
     char* new_key = get_key_from_record(record_str);
     if (new_key == NULL) {
-        fprintf(stderr, "Error: Could not extract key from new record, or record is empty.\n");
+        LOG_ERROR("peachdb", "Could not extract key from new record, or record is empty.");
         return -1;
     }
 
-    FILE* collection_file = fopen(collection_path, "r");
-    if (collection_file == NULL) {
-        fprintf(stderr, "Error: Could not open collection '%s' for reading. It may not exist.\n", collection_name);
-        free(new_key);
-        return -1;
+    // The key's Bloom filter answers "not a duplicate", a cached collection
+    // answers both ways; only when neither knows is the file scanned.
+    PeachBloom_declare(collection_name, collection_path, NULL);
+    int is_duplicate = PeachBloom_may_contain(collection_name, NULL, new_key);
+    if (is_duplicate != 0) {
+        is_duplicate = PeachCache_contains_key(collection_name, new_key);
+    }
+    FILE* collection_file = NULL;
+    if (is_duplicate < 0) {
+        is_duplicate = 0;
+        collection_file = fopen(collection_path, "r");
+        if (collection_file == NULL) {
+            LOG_ERROR("peachdb", "Could not open collection '%s' for reading. It may not exist.", collection_name);
+            free(new_key);
+            return -1;
+        }
     }
 
     char buffer[1024];
-    int is_duplicate = 0;
+    size_t bytes_read = 0;
 
     // Skip header line
-    fgets(buffer, sizeof(buffer), collection_file);
+    if (collection_file != NULL && fgets(buffer, sizeof(buffer), collection_file) != NULL) {
+        bytes_read += strlen(buffer);
+    }
 
     // Check subsequent lines for duplicate keys
-    while (fgets(buffer, sizeof(buffer), collection_file) != NULL) {
+    while (collection_file != NULL && fgets(buffer, sizeof(buffer), collection_file) != NULL) {
+        bytes_read += strlen(buffer);
         // Remove newline character if it exists
         buffer[strcspn(buffer, "\n")] = 0;
+        PeachChecksum_strip(buffer);
 
         char* existing_key = get_key_from_record(buffer);
         if (existing_key != NULL) {
@@ -267,10 +534,17 @@ int Peach_write_record(const char* collection_name, const char* record_str) {
             free(existing_key);
         }
     }
-    fclose(collection_file);
+    if (collection_file != NULL) {
+        fclose(collection_file);
+        Metrics_add_db_io(collection_name, bytes_read, 0);
+    }
+
+    if (!is_duplicate && PeachSegments_count(collection_name) > 0) {
+        is_duplicate = segment_holds_key_locked(collection_name, new_key); // The filters cover the active file
+    }
 
     if (is_duplicate) {
-        fprintf(stderr, "Error: Duplicate key '%s' found in collection '%s'.\n", new_key, collection_name);
+        LOG_ERROR("peachdb", "Duplicate key '%s' found in collection '%s'.", new_key, collection_name);
         free(new_key);
         return -1;
     }
@@ -278,23 +552,148 @@ int Peach_write_record(const char* collection_name, const char* record_str) {
     // --- No duplicate found, proceed to append the record ---
     collection_file = fopen(collection_path, "a");
     if (collection_file == NULL) {
-        fprintf(stderr, "Error: Could not re-open collection '%s' for appending.\n", collection_name);
+        LOG_ERROR("peachdb", "Could not re-open collection '%s' for appending.", collection_name);
         free(new_key);
         return -1;
     }
+    fseek(collection_file, 0, SEEK_END);
+    *out_offset = ftell(collection_file);
 
-    if (fprintf(collection_file, "%s\n", record_str) < 0) {
-        fprintf(stderr, "Error: Failed to write record to collection '%s'.\n", collection_name);
+    char checksum[PEACH_CHECKSUM_SUFFIX_LEN + 1];
+    PeachChecksum_suffix(record_str, checksum);
+    if (fprintf(collection_file, "%s%s\n", record_str, checksum) < 0) {
+        LOG_ERROR("peachdb", "Failed to write record to collection '%s'.", collection_name);
         fclose(collection_file);
         free(new_key);
         return -1;
     }
 
     fclose(collection_file);
+    Metrics_add_db_io(collection_name, 0, strlen(record_str) + PEACH_CHECKSUM_SUFFIX_LEN + 1);
     free(new_key);
     return 0; // Success
 }
 
+// Replaces the .lpdb of a sealed segment with a compressed .lpdz (see compress.h).
+// The .lpdz is complete before the manifest names it; the .lpdb goes last.
+static int compress_segment_locked(const char* collection_name, int number) {
+    PeachSegment compressed = { .number = number, .compressed = true };
+    char segment_path[256];
+    char compressed_path[256];
+    PeachSegments_path(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, number);
+    PeachSegments_file(compressed_path, sizeof(compressed_path), COLLECTIONS_PATH, collection_name, &compressed);
+    struct stat st;
+    if (stat(segment_path, &st) != 0 || PeachCompress_seal(segment_path, compressed_path) != 0) return -1;
+    long raw_bytes = (long)st.st_size;
+    long bytes = stat(compressed_path, &st) == 0 ? (long)st.st_size : 0;
+    PeachRecovery_sync_dir(COLLECTIONS_PATH);
+
+    pthread_mutex_lock(&g_index_mutex);
+    PeachSegments_set_compressed(collection_name, number, true, bytes);
+    int status = rewrite_index_locked();
+    if (status != 0) PeachSegments_set_compressed(collection_name, number, false, raw_bytes);
+    pthread_mutex_unlock(&g_index_mutex);
+    if (status != 0) {
+        unlink(compressed_path);
+        return -1;
+    }
+    unlink(segment_path);
+    PeachRecovery_sync_dir(COLLECTIONS_PATH);
+    LOG_INFO("peachdb", "Compressed segment %d of '%s': %ld -> %ld bytes.", number, collection_name, raw_bytes, bytes);
+    return 0;
+}
+
+// Seals the active file as the next segment once it reaches the rollover size.
+// The link comes first and the manifest second, so a crash at any step leaves
+// something PeachSegments_recover can finish or undo.
+static void roll_over_locked(const char* collection_name, long size) {
+    long max_bytes = PeachSegments_rollover_size(collection_name);
+    if (max_bytes <= 0 || size < max_bytes) return;
+
+    char collection_path[256];
+    char segment_path[256];
+    char temp_path[256 + 4];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", collection_path);
+    PeachSegment* segments;
+    int count = list_segments(collection_name, &segments);
+    int number = count > 0 ? segments[count - 1].number + 1 : 1;
+    free(segments);
+
+    // 1. Describe the file and link it under its segment name
+    PeachSegment segment;
+    if (PeachSegments_measure(collection_path, segment_time_field_locked(collection_name), &segment) != 0) return;
+    segment.number = number;
+    PeachSegments_path(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, number);
+    if (link(collection_path, segment_path) != 0) {
+        LOG_ERROR("peachdb", "Could not seal segment %d of '%s': %s", number, collection_name, strerror(errno));
+        return;
+    }
+    PeachRecovery_sync_dir(COLLECTIONS_PATH);
+
+    // 2. Record it in the manifest
+    pthread_mutex_lock(&g_index_mutex);
+    int status = PeachSegments_add(collection_name, &segment);
+    if (status == 0 && (status = rewrite_index_locked()) != 0) PeachSegments_remove_last(collection_name);
+    pthread_mutex_unlock(&g_index_mutex);
+    if (status != 0) {
+        unlink(segment_path);
+        return;
+    }
+
+    // 3. Start a new active file holding only the header
+    char header[4096] = "";
+    FILE* segment_file = fopen(segment_path, "r");
+    if (segment_file != NULL) {
+        if (fgets(header, sizeof(header), segment_file) == NULL) header[0] = '\0';
+        fclose(segment_file);
+    }
+    FILE* temp_file = header[0] != '\0' ? fopen(temp_path, "w") : NULL;
+    status = (temp_file != NULL && fputs(header, temp_file) != EOF) ? 0 : -1;
+    if (status != 0 && temp_file != NULL) {
+        fclose(temp_file);
+        remove(temp_path);
+    }
+    if (status != 0 || replace_with_rewrite(temp_file, temp_path, collection_path, COLLECTIONS_PATH) != 0) {
+        // The records would be read twice: take the segment back
+        LOG_ERROR("peachdb", "Could not start a new active file for '%s'.", collection_name);
+        pthread_mutex_lock(&g_index_mutex);
+        PeachSegments_remove_last(collection_name);
+        rewrite_index_locked();
+        pthread_mutex_unlock(&g_index_mutex);
+        unlink(segment_path);
+        return;
+    }
+
+    // 4. The indexes describe the active file; the cache still holds every record
+    PeachBloom_invalidate(collection_name);
+    PeachTimeIndex_invalidate(collection_name);
+    PeachBTree_invalidate(collection_name);
+    LOG_INFO("peachdb", "Collection '%s' rolled over to segment %d (%ld records, %ld bytes).",
+             collection_name, number, segment.records, segment.bytes);
+
+    // 5. Compress it if the collection asks for it; it stays readable as .lpdb otherwise
+    if (PeachSegments_compression(collection_name)) compress_segment_locked(collection_name, number);
+}
+
+int Peach_write_record(const char* collection_name, const char* record_str) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    PeachBTree_load(collection_name); // Open before the file changes, so the tree can follow
+    long offset = 0;
+    int status = write_record_locked(collection_name, record_str, &offset);
+    if (status == 0) {
+        size_t line_length = strlen(record_str) + PEACH_CHECKSUM_SUFFIX_LEN + 1;
+        PeachCache_on_append(collection_name, record_str);
+        PeachBloom_on_insert(collection_name, record_str);
+        PeachTimeIndex_on_append(collection_name, record_str, line_length);
+        PeachBTree_on_append(collection_name, record_str, offset, line_length);
+        roll_over_locked(collection_name, offset + (long)line_length);
+    }
+    pthread_rwlock_unlock(lock);
+    return status;
+}
+
 void Peach_free_record_set(PeachRecordSet* record_set) {
     if (record_set == NULL) return;
 
@@ -316,28 +715,21 @@ void Peach_free_record_set(PeachRecordSet* record_set) {
     free(record_set);
 }
 
-PeachRecordSet* Peach_read_all_records(const char* collection_name) {
-    char collection_path[256];
-    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
-
-    FILE* file = fopen(collection_path, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: Could not open collection file '%s' for reading.\n", collection_name);
-        return NULL;
-    }
-
-    PeachRecordSet* record_set = calloc(1, sizeof(PeachRecordSet));
-    if (record_set == NULL) {
-        fclose(file);
-        return NULL;
-    }
+// Appends the records of one collection or segment file to a record set.
+// Returns 0 on success, -1 if the file cannot be read or memory runs out.
+static int read_records_file(const char* collection_name, const char* path,
+                             PeachRecordSet* record_set, PeachRecord** tail) {
+    FILE* file = PeachCompress_open(path);
+    if (file == NULL) return -1;
 
     char buffer[1024];
+    size_t bytes_read = 0;
     // Read header line to count fields
     if (fgets(buffer, sizeof(buffer), file) == NULL) {
         fclose(file);
-        return record_set; // Return empty set for an empty file
+        return 0; // An empty file has no records
     }
+    bytes_read += strlen(buffer);
     buffer[strcspn(buffer, "\n")] = 0;
 
     int num_fields = 0;
@@ -349,12 +741,12 @@ PeachRecordSet* Peach_read_all_records(const char* collection_name) {
     }
     record_set->num_fields = num_fields;
 
-    PeachRecord* tail = NULL; // To append new records efficiently
-
     // Read data lines
     while (fgets(buffer, sizeof(buffer), file) != NULL) {
+        bytes_read += strlen(buffer);
         buffer[strcspn(buffer, "\n")] = 0;
         if (strlen(buffer) == 0) continue; // Skip empty lines
+        if (!accept_line(collection_name, buffer)) continue;
 
         PeachRecord* new_record = calloc(1, sizeof(PeachRecord));
         char* line_copy = strdup(buffer);
@@ -364,9 +756,8 @@ PeachRecordSet* Peach_read_all_records(const char* collection_name) {
             free(new_record);
             free(line_copy);
             free(fields_array);
-            Peach_free_record_set(record_set);
             fclose(file);
-            return NULL; // Memory allocation error
+            return -1; // Memory allocation error
         }
 
         new_record->num_fields = num_fields;
@@ -386,186 +777,358 @@ PeachRecordSet* Peach_read_all_records(const char* collection_name) {
         if (record_set->head == NULL) {
             record_set->head = new_record;
         } else {
-            tail->next = new_record;
+            (*tail)->next = new_record;
         }
-        tail = new_record;
+        *tail = new_record;
         record_set->record_count++;
     }
 
     fclose(file);
+    Metrics_add_db_io(collection_name, bytes_read, 0);
+    return 0;
+}
+
+static PeachRecordSet* read_all_records_locked(const char* collection_name) {
+    PeachRecordSet* record_set = calloc(1, sizeof(PeachRecordSet));
+    if (record_set == NULL) return NULL;
+    PeachRecord* tail = NULL; // To append new records efficiently
+
+    // 1. Sealed segments hold the oldest records
+    PeachSegment* segments;
+    int count = list_segments(collection_name, &segments);
+    for (int i = 0; i < count; i++) {
+        char segment_path[256];
+        PeachSegments_file(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, &segments[i]);
+        if (read_records_file(collection_name, segment_path, record_set, &tail) != 0) {
+            LOG_ERROR("peachdb", "Could not read segment %d of collection '%s'.", segments[i].number, collection_name);
+            free(segments);
+            Peach_free_record_set(record_set);
+            return NULL;
+        }
+    }
+    free(segments);
+
+    // 2. Then the active file
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+    if (access(collection_path, F_OK) != 0) {
+        LOG_ERROR("peachdb", "Could not open collection file '%s' for reading.", collection_name);
+        Peach_free_record_set(record_set);
+        return NULL;
+    }
+    if (read_records_file(collection_name, collection_path, record_set, &tail) != 0) {
+        Peach_free_record_set(record_set);
+        return NULL;
+    }
     return record_set;
 }
 
-int Peach_delete_record(const char* collection_name, const char* key) {
-    char original_path[256];
-    char temp_path[256 + 4]; // for ".tmp"
+PeachRecordSet* Peach_read_all_records(const char* collection_name) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 0);
+    if (lock == NULL) return NULL;
+
+    // 1. Serve hot collections from memory
+    PeachRecordSet* record_set = PeachCache_lookup(collection_name);
+    if (record_set == NULL) {
+        // 2. Miss: parse the file and keep a copy for the next reader
+        record_set = read_all_records_locked(collection_name);
+        PeachCache_store(collection_name, record_set);
+    }
+    pthread_rwlock_unlock(lock);
+    return record_set;
+}
 
-    snprintf(original_path, sizeof(original_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+// The record a rewrite replaced or removed, for the B+trees (see btree.h).
+typedef struct {
+    long offset;                // Where its line started
+    size_t length;              // Bytes of its line
+    char record[1024];          // Its content, without checksum
+} RecordChange;
+
+// Deletes a record from one collection or segment file.
+// Returns 0 on success, 1 if the key is not in the file, -1 on error.
+static int delete_record_locked(const char* collection_name, const char* original_path, const char* key,
+                                RecordChange* out_change) {
+    char temp_path[256 + 4]; // for ".tmp"
     snprintf(temp_path, sizeof(temp_path), "%s.tmp", original_path);
 
     FILE* original_file = fopen(original_path, "r");
     if (original_file == NULL) {
-        fprintf(stderr, "Error: Cannot open collection '%s' to delete record.\n", collection_name);
+        LOG_ERROR("peachdb", "Cannot open collection '%s' to delete record.", collection_name);
         return -1;
     }
 
     FILE* temp_file = fopen(temp_path, "w");
     if (temp_file == NULL) {
-        fprintf(stderr, "Error: Cannot create temporary file for deletion.\n");
+        LOG_ERROR("peachdb", "Cannot create temporary file for deletion.");
         fclose(original_file);
         return -1;
     }
 
     char buffer[1024];
     int record_found = 0;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
 
     // Copy header
     if (fgets(buffer, sizeof(buffer), original_file) != NULL) {
+        bytes_read += strlen(buffer);
+        bytes_written += strlen(buffer);
         fputs(buffer, temp_file);
     }
 
     // Copy records, skipping the one to delete
     while (fgets(buffer, sizeof(buffer), original_file) != NULL) {
+        long offset = (long)bytes_read;
+        bytes_read += strlen(buffer);
         char clean_buffer[1024];
         strcpy(clean_buffer, buffer);
         clean_buffer[strcspn(clean_buffer, "\n")] = 0;
+        PeachChecksum_strip(clean_buffer); // Lines are copied as they are, damaged or not
 
         char* record_key = get_key_from_record(clean_buffer);
         if (record_key != NULL) {
-            if (strcmp(key, record_key) == 0) {
+            if (strcmp(key, record_key) == 0 && !record_found) {
                 record_found = 1; // Found it, so we skip writing this line
+                out_change->offset = offset;
+                out_change->length = strlen(buffer);
+                snprintf(out_change->record, sizeof(out_change->record), "%s", clean_buffer);
             } else {
+                bytes_written += strlen(buffer);
                 fputs(buffer, temp_file); // Not the key, so write it to temp file
             }
             free(record_key);
         } else {
+             bytes_written += strlen(buffer);
              fputs(buffer, temp_file); // Write lines that don't have a parseable key (e.g., empty lines)
         }
     }
 
     fclose(original_file);
-    fclose(temp_file);
+    Metrics_add_db_io(collection_name, bytes_read, bytes_written);
 
     if (!record_found) {
+        fclose(temp_file);
         remove(temp_path); // Delete the useless temp file
-        return -1; // Return -1 to indicate "not found"
+        return 1; // Not found
     }
 
     // Replace the original file with the temp file
-    if (remove(original_path) != 0) {
-        fprintf(stderr, "Error: Could not delete original file '%s'.\n", original_path);
-        remove(temp_path);
-        return -1;
-    }
-    if (rename(temp_path, original_path) != 0) {
-        fprintf(stderr, "Error: Could not rename temp file to '%s'.\n", original_path);
-        return -1;
-    }
-
-    return 0; // Success
+    return replace_with_rewrite(temp_file, temp_path, original_path, COLLECTIONS_PATH);
 }
 
-int Peach_update_record(const char* collection_name, const char* key, const char* new_record_str) {
+// Replaces a record of one collection or segment file.
+// Returns 0 on success, 1 if the key is not in the file, -1 on error.
+static int update_record_locked(const char* collection_name, const char* original_path, const char* key,
+                                const char* new_record_str, RecordChange* out_change) {
     // Safety check: key in new record must match the key parameter
     char* new_key = get_key_from_record(new_record_str);
     if (new_key == NULL || strcmp(key, new_key) != 0) {
-        fprintf(stderr, "Error: Key in new record data ('%s') does not match the target key ('%s').\n", new_key ? new_key : "NULL", key);
+        LOG_ERROR("peachdb", "Key in new record data ('%s') does not match the target key ('%s').", new_key ? new_key : "NULL", key);
         free(new_key);
         return -1;
     }
     free(new_key);
 
-    char original_path[256];
     char temp_path[256 + 4];
-
-    snprintf(original_path, sizeof(original_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
     snprintf(temp_path, sizeof(temp_path), "%s.tmp", original_path);
 
     FILE* original_file = fopen(original_path, "r");
     if (original_file == NULL) {
-        fprintf(stderr, "Error: Cannot open collection '%s' to update record.\n", collection_name);
+        LOG_ERROR("peachdb", "Cannot open collection '%s' to update record.", collection_name);
         return -1;
     }
 
     FILE* temp_file = fopen(temp_path, "w");
     if (temp_file == NULL) {
-        fprintf(stderr, "Error: Cannot create temporary file for update.\n");
+        LOG_ERROR("peachdb", "Cannot create temporary file for update.");
         fclose(original_file);
         return -1;
     }
 
     char buffer[1024];
     int record_found = 0;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
 
     // Copy header
     if (fgets(buffer, sizeof(buffer), original_file) != NULL) {
+        bytes_read += strlen(buffer);
+        bytes_written += strlen(buffer);
         fputs(buffer, temp_file);
     }
 
     // Read records, update the target record, and copy the rest
     while (fgets(buffer, sizeof(buffer), original_file) != NULL) {
+        long offset = (long)bytes_read;
+        bytes_read += strlen(buffer);
         char clean_buffer[1024];
         strcpy(clean_buffer, buffer);
         clean_buffer[strcspn(clean_buffer, "\n")] = 0;
+        PeachChecksum_strip(clean_buffer); // Lines are copied as they are, damaged or not
 
         char* record_key = get_key_from_record(clean_buffer);
         if (record_key != NULL) {
-            if (strcmp(key, record_key) == 0) {
+            if (strcmp(key, record_key) == 0 && !record_found) {
                 record_found = 1;
+                out_change->offset = offset;
+                out_change->length = strlen(buffer);
+                snprintf(out_change->record, sizeof(out_change->record), "%s", clean_buffer);
                 // Write the new record string instead of the old one
-                fprintf(temp_file, "%s\n", new_record_str);
+                char checksum[PEACH_CHECKSUM_SUFFIX_LEN + 1];
+                PeachChecksum_suffix(new_record_str, checksum);
+                bytes_written += strlen(new_record_str) + PEACH_CHECKSUM_SUFFIX_LEN + 1;
+                fprintf(temp_file, "%s%s\n", new_record_str, checksum);
             } else {
                 // Not the key, so write the original line
+                bytes_written += strlen(buffer);
                 fputs(buffer, temp_file);
             }
             free(record_key);
         } else {
+             bytes_written += strlen(buffer);
              fputs(buffer, temp_file);
         }
     }
 
     fclose(original_file);
-    fclose(temp_file);
+    Metrics_add_db_io(collection_name, bytes_read, bytes_written);
 
     if (!record_found) {
+        fclose(temp_file);
         remove(temp_path);
-        return -1; // Record to update was not found
+        return 1; // Record to update was not found
     }
 
-    if (remove(original_path) != 0) {
-        fprintf(stderr, "Error: Could not delete original file '%s' for update.\n", original_path);
-        remove(temp_path);
-        return -1;
+    return replace_with_rewrite(temp_file, temp_path, original_path, COLLECTIONS_PATH);
+}
+
+// Deletes (new_record_str NULL) or updates a record kept in a sealed segment,
+// looking only at segments whose key range covers the key.
+// Returns 0 on success, 1 if no segment holds the key, -1 on error.
+static int rewrite_segment_locked(const char* collection_name, const char* key, const char* new_record_str) {
+    PeachSegment* segments;
+    int count = list_segments(collection_name, &segments);
+    long long value = strtoll(key, NULL, 10);
+    int status = 1;
+    for (int i = count - 1; i >= 0 && status > 0; i--) {
+        if (value < segments[i].min_key || value > segments[i].max_key) continue;
+        // A compressed segment is inflated to its .lpdb, rewritten there and compressed again
+        char segment_path[256];
+        char file_path[256];
+        PeachSegments_path(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, segments[i].number);
+        PeachSegments_file(file_path, sizeof(file_path), COLLECTIONS_PATH, collection_name, &segments[i]);
+        if (segments[i].compressed && PeachCompress_inflate(file_path, segment_path) != 0) {
+            status = -1;
+            continue;
+        }
+        RecordChange change;
+        if (new_record_str == NULL) {
+            status = delete_record_locked(collection_name, segment_path, key, &change);
+        } else {
+            status = update_record_locked(collection_name, segment_path, key, new_record_str, &change);
+        }
+        if (segments[i].compressed) {
+            if (status == 0 && PeachCompress_seal(segment_path, file_path) != 0) status = -1;
+            unlink(segment_path);
+        }
+        if (status != 0) continue;
+
+        // The manifest follows: its ranges must still cover every record
+        char new_time[PEACH_SEGMENT_TIME_LEN + 1] = "";
+        int time_field = segment_time_field_locked(collection_name);
+        if (new_record_str != NULL && time_field >= 0) copy_field(new_record_str, time_field, new_time, sizeof(new_time));
+        struct stat st;
+        long bytes = stat(file_path, &st) == 0 ? (long)st.st_size : segments[i].bytes;
+        PeachSegments_on_rewrite(collection_name, segments[i].number, new_record_str == NULL,
+                                 time_field >= 0 && new_record_str != NULL ? new_time : NULL, bytes);
+        pthread_mutex_lock(&g_index_mutex);
+        if (rewrite_index_locked() != 0) {
+            LOG_ERROR("peachdb", "The manifest of '%s' is out of date until the next change.", collection_name);
+        }
+        pthread_mutex_unlock(&g_index_mutex);
     }
-    if (rename(temp_path, original_path) != 0) {
-        fprintf(stderr, "Error: Could not rename temp file to '%s' for update.\n", original_path);
-        return -1;
+    free(segments);
+    return status;
+}
+
+int Peach_delete_record(const char* collection_name, const char* key) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    PeachBTree_load(collection_name);
+    RecordChange change;
+    int status = delete_record_locked(collection_name, collection_path, key, &change);
+    if (status == 0) {
+        PeachBloom_on_delete(collection_name);
+        PeachTimeIndex_invalidate(collection_name); // Offsets moved
+        PeachBTree_on_rewrite(collection_name, change.offset, change.record, change.length, NULL, 0);
+    } else if (status > 0) {
+        status = rewrite_segment_locked(collection_name, key, NULL); // Indexes cover the active file only
     }
+    if (status == 0) {
+        PeachCache_on_delete(collection_name, key);
+    }
+    pthread_rwlock_unlock(lock);
+    return status == 0 ? 0 : -1;
+}
 
-    return 0; // Success
+int Peach_update_record(const char* collection_name, const char* key, const char* new_record_str) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    PeachBTree_load(collection_name);
+    RecordChange change;
+    int status = update_record_locked(collection_name, collection_path, key, new_record_str, &change);
+    if (status == 0) {
+        PeachBloom_on_insert(collection_name, new_record_str);
+        PeachTimeIndex_invalidate(collection_name); // Offsets moved
+        PeachBTree_on_rewrite(collection_name, change.offset, change.record, change.length,
+                              new_record_str, strlen(new_record_str) + PEACH_CHECKSUM_SUFFIX_LEN + 1);
+    } else if (status > 0) {
+        status = rewrite_segment_locked(collection_name, key, new_record_str);
+    }
+    if (status == 0) {
+        PeachCache_on_update(collection_name, key, new_record_str);
+    }
+    pthread_rwlock_unlock(lock);
+    return status == 0 ? 0 : -1;
 }
 
-long Peach_get_highest_key(const char* collection_name) {
+static long get_highest_key_locked(const char* collection_name) {
     char collection_path[256];
     snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
 
     FILE* file = fopen(collection_path, "r");
     if (file == NULL) {
-        fprintf(stderr, "Error: Could not open collection '%s' to get highest key.\n", collection_name);
+        LOG_ERROR("peachdb", "Could not open collection '%s' to get highest key.", collection_name);
         return -1; // Indicate error
     }
 
     char buffer[1024];
     long highest_key = 0;
+    size_t bytes_read = 0;
+
+    // Sealed segments know their highest key
+    PeachSegment* segments;
+    int count = list_segments(collection_name, &segments);
+    for (int i = 0; i < count; i++) {
+        if (segments[i].max_key > highest_key) highest_key = (long)segments[i].max_key;
+    }
+    free(segments);
 
     // Skip header line
-    if (fgets(buffer, sizeof(buffer), file) == NULL) {
-        fclose(file);
-        return 0; // Collection is empty or just has a header
+    if (fgets(buffer, sizeof(buffer), file) != NULL) {
+        bytes_read += strlen(buffer);
     }
 
     // Read data lines
     while (fgets(buffer, sizeof(buffer), file) != NULL) {
+        bytes_read += strlen(buffer);
         char* key_str = get_key_from_record(buffer);
         if (key_str != NULL) {
             long current_key = atol(key_str); // Convert string to long
@@ -577,5 +1140,722 @@ long Peach_get_highest_key(const char* collection_name) {
     }
 
     fclose(file);
+    Metrics_add_db_io(collection_name, bytes_read, 0);
+    return highest_key;
+}
+
+long Peach_get_highest_key(const char* collection_name) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 0);
+    if (lock == NULL) return -1;
+    long highest_key;
+    if (!PeachCache_highest_key(collection_name, &highest_key)) {
+        highest_key = get_highest_key_locked(collection_name);
+    }
+    pthread_rwlock_unlock(lock);
     return highest_key;
-}
\ No newline at end of file
+}
+
+int Peach_index_field(const char* collection_name, const char* field_name) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    int status = PeachBloom_declare(collection_name, collection_path, field_name);
+    pthread_rwlock_unlock(lock);
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not index field '%s' of collection '%s'.", field_name, collection_name);
+    }
+    return status;
+}
+
+int Peach_index_range(const char* collection_name, const char* field_name) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    int status = PeachTimeIndex_declare(collection_name, collection_path, field_name);
+    pthread_rwlock_unlock(lock);
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not index range field '%s' of collection '%s'.", field_name, collection_name);
+    }
+    return status;
+}
+
+int Peach_index_ordered(const char* collection_name, const char* field_name) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    int status = PeachBTree_declare(collection_name, collection_path, field_name);
+    pthread_rwlock_unlock(lock);
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not create a B+tree on field '%s' of collection '%s'.", field_name, collection_name);
+    }
+    return status;
+}
+
+int Peach_collection_segment(const char* collection_name, const char* time_field, long max_bytes) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    int status = -1;
+    if (time_field == NULL || field_index_locked(collection_name, time_field) >= 0) {
+        status = PeachSegments_configure(collection_name, time_field, max_bytes);
+    }
+    pthread_rwlock_unlock(lock);
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not split collection '%s' into segments.", collection_name);
+    }
+    return status;
+}
+
+int Peach_collection_compress(const char* collection_name, int enabled) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 1);
+    if (lock == NULL) return -1;
+    int status = PeachSegments_set_compression(collection_name, enabled != 0);
+
+    // Segments sealed while compression was off are compressed now
+    PeachSegment* segments;
+    int count = status == 0 && enabled ? list_segments(collection_name, &segments) : 0;
+    for (int i = 0; i < count; i++) {
+        if (!segments[i].compressed && compress_segment_locked(collection_name, segments[i].number) != 0) status = -1;
+    }
+    if (count > 0) free(segments);
+    pthread_rwlock_unlock(lock);
+    if (status != 0) {
+        LOG_ERROR("peachdb", "Could not compress the segments of collection '%s'.", collection_name);
+    }
+    return status;
+}
+
+// Reads the collection names from index.mpdb. Returns the count, or -1; free each name.
+static int list_collections(char** names, int max_names) {
+    pthread_mutex_lock(&g_index_mutex);
+    FILE* index_file = fopen(INDEX_PATH, "r");
+    if (index_file == NULL) {
+        pthread_mutex_unlock(&g_index_mutex);
+        LOG_ERROR("peachdb", "Could not open index file %s.", INDEX_PATH);
+        return -1;
+    }
+    char line[1024];
+    int count = 0;
+    if (fgets(line, sizeof(line), index_file) != NULL) { // Line 1: count
+        while (count < max_names && fgets(line, sizeof(line), index_file) != NULL) {
+            if (PeachSegments_is_manifest_line(line)) continue;
+            line[strcspn(line, " \n")] = '\0';
+            if (line[0] != '\0' && (names[count] = strdup(line)) != NULL) count++;
+        }
+    }
+    fclose(index_file);
+    pthread_mutex_unlock(&g_index_mutex);
+    return count;
+}
+
+typedef struct {
+    char** names;
+    int* order;         // Indexes into names of the collections to load
+} IndexLoad;
+
+static void load_collection_indexes(int task, void* context) {
+    IndexLoad* load = context;
+    const char* name = load->names[load->order[task]];
+    pthread_rwlock_t* lock = lock_collection(name, 0);
+    if (lock == NULL) return;
+    PeachBloom_load(name);
+    PeachTimeIndex_load(name);
+    PeachBTree_load(name);
+    pthread_rwlock_unlock(lock);
+}
+
+int Peach_load_indexes(int threads) {
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    if (threads <= 0) threads = PeachPool_threads();
+
+    char* names[MAX_SNAPSHOT_COLLECTIONS];
+    int count = list_collections(names, MAX_SNAPSHOT_COLLECTIONS);
+    if (count < 0) return -1;
+
+    // 1. Every collection has a key filter; small collections load side by side,
+    //    large ones afterwards, one at a time, each split over all threads
+    int small[MAX_SNAPSHOT_COLLECTIONS];
+    int large[MAX_SNAPSHOT_COLLECTIONS];
+    int small_count = 0;
+    int large_count = 0;
+    for (int i = 0; i < count; i++) {
+        char collection_path[256];
+        snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, names[i]);
+        pthread_rwlock_t* lock = lock_collection(names[i], 1);
+        if (lock == NULL) continue;
+        PeachBloom_declare(names[i], collection_path, NULL);
+        pthread_rwlock_unlock(lock);
+
+        struct stat st;
+        if (stat(collection_path, &st) == 0 && st.st_size >= PEACH_POOL_CHUNK_MIN_BYTES) {
+            large[large_count++] = i;
+        } else {
+            small[small_count++] = i;
+        }
+    }
+
+    // 2. Build (or map) the indexes
+    IndexLoad load = { .names = names, .order = small };
+    PeachPool_run(small_count, threads, load_collection_indexes, &load);
+    load.order = large;
+    PeachPool_run(large_count, 1, load_collection_indexes, &load);
+
+    for (int i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    struct timespec finished;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double elapsed_ms = (double)(finished.tv_sec - started.tv_sec) * 1000.0 +
+                        (double)(finished.tv_nsec - started.tv_nsec) / 1e6;
+    LOG_INFO("peachdb", "Loaded the indexes of %d collections (%d large) on %d threads in %.1f ms.",
+             count, large_count, threads, elapsed_ms);
+    return 0;
+}
+
+int Peach_save_indexes(void) {
+    char* names[MAX_SNAPSHOT_COLLECTIONS];
+    int count = list_collections(names, MAX_SNAPSHOT_COLLECTIONS);
+    if (count < 0) return -1;
+    int saved = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_rwlock_t* lock = lock_collection(names[i], 0);
+        if (lock != NULL) {
+            if (PeachBloom_save(names[i]) == 0) saved++;
+            if (PeachTimeIndex_save(names[i]) == 0) saved++;
+            pthread_rwlock_unlock(lock);
+        }
+        free(names[i]);
+    }
+    return saved;
+}
+
+int Peach_field_may_contain(const char* collection_name, const char* field_name, const char* value) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 0);
+    if (lock == NULL) return -1;
+    // The filters do not cover sealed segments
+    int result = PeachSegments_count(collection_name) > 0 ? -1 : PeachBloom_may_contain(collection_name, field_name, value);
+    pthread_rwlock_unlock(lock);
+    return result;
+}
+
+static bool offer_cached_record(char* const* fields, int num_fields, void* context) {
+    return PeachQuery_offer((PeachQueryRun*)context, fields, num_fields);
+}
+
+// Where a forward scan may start and stop, derived from the time index (see timeindex.h).
+typedef struct {
+    long start_offset;      // First byte to read after the header
+    int field;              // Indexed field
+    const char* hi;         // Stop at the first value past this bound (NULL: read to the end)
+} RangePlan;
+
+// Collects the bounds a query puts on the indexed field. Every or_group must
+// bound it from below for the index to help; the scan may stop early only if
+// every group also bounds it from above and the values are stored in order.
+static bool plan_range(const char* collection_name, const PeachQuery* query, RangePlan* plan) {
+    if (query->where_count == 0) return false;
+    int field = PeachTimeIndex_field(collection_name);
+    if (field < 0) return false;
+
+    const char* group_lo[32] = { 0 };
+    const char* group_hi[32] = { 0 };
+    uint32_t groups = 0;
+    for (int i = 0; i < query->where_count; i++) {
+        const PeachPredicate* predicate = &query->where[i];
+        int group = predicate->or_group & 31;
+        groups |= 1u << group;
+        if (predicate->field != field || predicate->text == NULL) continue;
+        const char* value = predicate->text;
+        if (predicate->op == PEACH_EQ || predicate->op == PEACH_GE || predicate->op == PEACH_GT) {
+            if (group_lo[group] == NULL || strcmp(value, group_lo[group]) > 0) group_lo[group] = value;
+        }
+        if (predicate->op == PEACH_EQ || predicate->op == PEACH_LE || predicate->op == PEACH_LT) {
+            if (group_hi[group] == NULL || strcmp(value, group_hi[group]) < 0) group_hi[group] = value;
+        }
+    }
+
+    const char* lo = NULL;
+    const char* hi = NULL;
+    bool bounded_above = true;
+    for (int group = 0; group < 32; group++) {
+        if ((groups & (1u << group)) == 0) continue;
+        if (group_lo[group] == NULL) return false; // This group may match anywhere in the file
+        if (lo == NULL || strcmp(group_lo[group], lo) < 0) lo = group_lo[group];
+        if (group_hi[group] == NULL) {
+            bounded_above = false;
+        } else if (hi == NULL || strcmp(group_hi[group], hi) > 0) {
+            hi = group_hi[group];
+        }
+    }
+
+    bool sorted = false;
+    long offset = PeachTimeIndex_seek(collection_name, lo, &sorted);
+    if (offset < 0) return false;
+    plan->start_offset = offset;
+    plan->field = field;
+    plan->hi = (bounded_above && sorted) ? hi : NULL;
+    return true;
+}
+
+// Streams the lines of an open collection or segment file through a running
+// query, tokenizing each line in place. With a range plan, reading may stop
+// where the plan says. Returns false once the query's limit is reached.
+static bool stream_lines(const char* collection_name, FILE* file, PeachQueryRun* run, int num_fields,
+                         const RangePlan* plan, size_t* bytes_read) {
+    char buffer[4096];
+    char* fields[PEACH_QUERY_MAX_FIELDS];
+    while (fgets(buffer, sizeof(buffer), file) != NULL) {
+        *bytes_read += strlen(buffer);
+        buffer[strcspn(buffer, "\n")] = 0;
+        if (buffer[0] == '\0') continue; // Skip empty lines
+        if (!accept_line(collection_name, buffer)) continue;
+
+        int found = PeachQuery_split_line(buffer, fields, num_fields);
+        if (plan != NULL && plan->hi != NULL && plan->field < found &&
+            strcmp(fields[plan->field], plan->hi) > 0) {
+            return true; // Sorted: every later record is past the upper bound too
+        }
+        if (!PeachQuery_offer(run, fields, found)) return false; // Limit reached
+    }
+    return true;
+}
+
+// Streams the collection through the query: the sealed segments it may match,
+// oldest first, then the active file. A range plan applies to the active file.
+static PeachRecordSet* query_file_locked(const char* collection_name, const PeachQuery* query, const RangePlan* plan) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    FILE* file = fopen(collection_path, "r");
+    if (file == NULL) {
+        LOG_ERROR("peachdb", "Could not open collection file '%s' for reading.", collection_name);
+        return NULL;
+    }
+
+    char buffer[4096];
+    size_t bytes_read = 0;
+    int num_fields = 0;
+    if (fgets(buffer, sizeof(buffer), file) != NULL) {
+        bytes_read += strlen(buffer);
+        buffer[strcspn(buffer, "\n")] = 0;
+        if (strlen(buffer) > 0) {
+            num_fields = 1;
+            for (char* p = buffer; *p != '\0'; p++) {
+                if (*p == '^') num_fields++;
+            }
+        }
+    }
+    if (num_fields > PEACH_QUERY_MAX_FIELDS) num_fields = PEACH_QUERY_MAX_FIELDS;
+
+    PeachQueryRun run;
+    if (PeachQuery_begin(&run, query, num_fields, false) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    // 1. Sealed segments, skipping those whose ranges rule the query out
+    PeachSegment* segments;
+    int count = list_segments(collection_name, &segments);
+    int time_field = count > 0 ? segment_time_field_locked(collection_name) : -1;
+    bool more = true;
+    for (int i = 0; i < count && more; i++) {
+        if (!PeachSegments_may_match(&segments[i], query, time_field)) continue;
+        char segment_path[256];
+        PeachSegments_file(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, &segments[i]);
+        FILE* segment_file = PeachCompress_open(segment_path);
+        if (segment_file == NULL) {
+            LOG_ERROR("peachdb", "Could not open segment %d of collection '%s'.", segments[i].number, collection_name);
+            continue;
+        }
+        if (fgets(buffer, sizeof(buffer), segment_file) != NULL) bytes_read += strlen(buffer); // Header
+        more = stream_lines(collection_name, segment_file, &run, num_fields, NULL, &bytes_read);
+        fclose(segment_file);
+    }
+    free(segments);
+
+    // 2. The active file
+    if (more) {
+        if (plan != NULL) fseek(file, plan->start_offset, SEEK_SET);
+        stream_lines(collection_name, file, &run, num_fields, plan, &bytes_read);
+    }
+
+    fclose(file);
+    Metrics_add_db_io(collection_name, bytes_read, 0);
+    return PeachQuery_finish(&run);
+}
+
+// Streams one file through a running query from its end. Returns false once the limit is reached.
+static bool stream_reverse(const char* collection_name, PeachReverseReader* reader, PeachQueryRun* run, int num_fields) {
+    char* fields[PEACH_QUERY_MAX_FIELDS];
+    char* line;
+    while ((line = PeachReverse_next(reader)) != NULL) {
+        if (!accept_line(collection_name, line)) continue;
+        int found = PeachQuery_split_line(line, fields, num_fields);
+        if (!PeachQuery_offer(run, fields, found)) return false; // Limit reached
+    }
+    return true;
+}
+
+// Streams the collection through the query from its end, newest record first:
+// the active file, then the sealed segments it may match, newest first.
+static PeachRecordSet* query_file_reverse_locked(const char* collection_name, const PeachQuery* query) {
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+
+    PeachReverseReader reader;
+    if (PeachReverse_open(&reader, collection_path) != 0) {
+        LOG_ERROR("peachdb", "Could not open collection file '%s' for reading.", collection_name);
+        return NULL;
+    }
+    int num_fields = reader.num_fields;
+    if (num_fields > PEACH_QUERY_MAX_FIELDS) num_fields = PEACH_QUERY_MAX_FIELDS;
+
+    PeachQueryRun run;
+    if (PeachQuery_begin(&run, query, num_fields, true) != 0) {
+        PeachReverse_close(&reader);
+        return NULL;
+    }
+
+    bool more = stream_reverse(collection_name, &reader, &run, num_fields);
+    Metrics_add_db_io(collection_name, reader.bytes_read, 0);
+    PeachReverse_close(&reader);
+
+    PeachSegment* segments = NULL;
+    int count = more ? list_segments(collection_name, &segments) : 0;
+    int time_field = count > 0 ? segment_time_field_locked(collection_name) : -1;
+    for (int i = count - 1; i >= 0 && more; i--) {
+        if (!PeachSegments_may_match(&segments[i], query, time_field)) continue;
+        char segment_path[256];
+        PeachSegments_file(segment_path, sizeof(segment_path), COLLECTIONS_PATH, collection_name, &segments[i]);
+        if (PeachReverse_open(&reader, segment_path) != 0) {
+            LOG_ERROR("peachdb", "Could not open segment %d of collection '%s'.", segments[i].number, collection_name);
+            continue;
+        }
+        more = stream_reverse(collection_name, &reader, &run, num_fields);
+        Metrics_add_db_io(collection_name, reader.bytes_read, 0);
+        PeachReverse_close(&reader);
+    }
+    free(segments);
+    return PeachQuery_finish(&run);
+}
+
+PeachRecordSet* Peach_query(const char* collection_name, const PeachQuery* query) {
+    if (query == NULL || (query->where_count > 0 && query->where == NULL) ||
+        (query->select != NULL && query->select_count <= 0) || query->limit < 0) {
+        LOG_ERROR("peachdb", "Invalid query on collection '%s'.", collection_name);
+        return NULL;
+    }
+
+    pthread_rwlock_t* lock = lock_collection(collection_name, 0);
+    if (lock == NULL) return NULL;
+
+    // 1. The newest 'limit' records are nearest to the end of the file: a backward
+    //    scan reads about one page, where the cache would visit every record
+    PeachRecordSet* result = NULL;
+    if (query->order != PEACH_ORDER_ASC && query->limit > 0) {
+        result = query_file_reverse_locked(collection_name, query);
+        pthread_rwlock_unlock(lock);
+        return result;
+    }
+
+    // 2. A time-indexed bound seeks close to the first candidate
+    RangePlan plan;
+    if (plan_range(collection_name, query, &plan)) {
+        result = query_file_locked(collection_name, query, &plan);
+        pthread_rwlock_unlock(lock);
+        return result;
+    }
+
+    // 3. Filter a cached collection in memory
+    PeachQueryRun run;
+    int cached_fields = PeachCache_field_count(collection_name);
+    if (cached_fields >= 0 && PeachQuery_begin(&run, query, cached_fields, false) == 0) {
+        if (PeachCache_scan(collection_name, offer_cached_record, &run) >= 0) {
+            result = PeachQuery_finish(&run);
+            pthread_rwlock_unlock(lock);
+            return result;
+        }
+        Peach_free_record_set(PeachQuery_finish(&run));
+    }
+
+    // 4. Otherwise stream the file, from the end when the newest records are wanted
+    if (query->order == PEACH_ORDER_ASC) {
+        result = query_file_locked(collection_name, query, NULL);
+    } else {
+        result = query_file_reverse_locked(collection_name, query);
+    }
+    pthread_rwlock_unlock(lock);
+    return result;
+}
+
+PeachRecordSet* Peach_read_last_n(const char* collection_name, int n) {
+    if (n <= 0) return calloc(1, sizeof(PeachRecordSet));
+    PeachQuery query = { .limit = n, .order = PEACH_ORDER_DESC };
+    return Peach_query(collection_name, &query);
+}
+
+PeachRecordSet* Peach_range(const char* collection_name, const char* field_name, const char* lo, const char* hi) {
+    pthread_rwlock_t* lock = lock_collection(collection_name, 0);
+    if (lock == NULL) return NULL;
+    int field = field_index_locked(collection_name, field_name);
+    pthread_rwlock_unlock(lock);
+    if (field < 0) {
+        LOG_ERROR("peachdb", "Unknown field '%s' in collection '%s'.", field_name, collection_name);
+        return NULL;
+    }
+
+    PeachPredicate bounds[2];
+    int bound_count = 0;
+    if (lo != NULL) bounds[bound_count++] = (PeachPredicate){ .field = field, .op = PEACH_GE, .text = lo };
+    if (hi != NULL) bounds[bound_count++] = (PeachPredicate){ .field = field, .op = PEACH_LE, .text = hi };
+    PeachQuery query = { .where = bounds, .where_count = bound_count, .order = PEACH_ORDER_ASC };
+    return Peach_query(collection_name, &query);
+}
+
+// Walks the field's B+tree from lo and reads each record at its offset.
+static PeachRecordSet* index_scan_locked(const char* collection_name, const char* field_name,
+                                         const char* lo, const char* hi, int limit) {
+    int field = PeachBTree_field(collection_name, field_name);
+    PeachBTreeCursor cursor;
+    if (field < 0 || PeachBTree_seek(collection_name, field_name, lo, &cursor) != 0) return NULL;
+
+    char collection_path[256];
+    snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, collection_name);
+    FILE* file = fopen(collection_path, "r");
+    if (file == NULL) {
+        LOG_ERROR("peachdb", "Could not open collection file '%s' for reading.", collection_name);
+        return NULL;
+    }
+
+    char buffer[4096];
+    size_t bytes_read = 0;
+    int num_fields = 0;
+    if (fgets(buffer, sizeof(buffer), file) != NULL) {
+        bytes_read += strlen(buffer);
+        buffer[strcspn(buffer, "\n")] = 0;
+        if (strlen(buffer) > 0) {
+            num_fields = 1;
+            for (char* p = buffer; *p != '\0'; p++) {
+                if (*p == '^') num_fields++;
+            }
+        }
+    }
+    if (num_fields > PEACH_QUERY_MAX_FIELDS) num_fields = PEACH_QUERY_MAX_FIELDS;
+
+    // The bounds are checked again on the records themselves
+    PeachPredicate bounds[2];
+    int bound_count = 0;
+    if (lo != NULL) bounds[bound_count++] = (PeachPredicate){ .field = field, .op = PEACH_GE, .text = lo };
+    if (hi != NULL) bounds[bound_count++] = (PeachPredicate){ .field = field, .op = PEACH_LE, .text = hi };
+    PeachQuery query = { .where = bounds, .where_count = bound_count, .limit = limit, .order = PEACH_ORDER_ASC };
+    PeachQueryRun run;
+    if (PeachQuery_begin(&run, &query, num_fields, false) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    char* fields[PEACH_QUERY_MAX_FIELDS];
+    const char* value;
+    long offset;
+    while (PeachBTree_next(&cursor, &value, &offset)) {
+        if (hi != NULL && strcmp(value, hi) > 0) break;
+        if (fseek(file, offset, SEEK_SET) != 0 || fgets(buffer, sizeof(buffer), file) == NULL) continue;
+        bytes_read += strlen(buffer);
+        buffer[strcspn(buffer, "\n")] = 0;
+        if (!accept_line(collection_name, buffer)) continue;
+        int found = PeachQuery_split_line(buffer, fields, num_fields);
+        if (!PeachQuery_offer(&run, fields, found)) break; // Limit reached
+    }
+
+    fclose(file);
+    Metrics_add_db_io(collection_name, bytes_read, 0);
+    return PeachQuery_finish(&run);
+}
+
+PeachRecordSet* Peach_index_scan(const char* collection_name, const char* field_name,
+                                 const char* lo, const char* hi, int limit) {
+    if (limit < 0) return NULL;
+    pthread_rwlock_t* lock = lock_collection(collection_name, 0);
+    if (lock == NULL) return NULL;
+    PeachRecordSet* result = NULL;
+    if (PeachSegments_count(collection_name) == 0) { // The trees do not cover sealed segments
+        result = index_scan_locked(collection_name, field_name, lo, hi, limit);
+    }
+    pthread_rwlock_unlock(lock);
+    return result;
+}
+
+// --- Online backup ---
+
+// Copies index.mpdb into the snapshot. Callers hold g_index_mutex.
+static int read_index_text_locked(PeachSnapshot* snapshot) {
+    free(snapshot->index_text);
+    snapshot->index_text = NULL;
+    FILE* index_file = fopen(INDEX_PATH, "r");
+    if (index_file == NULL) {
+        LOG_ERROR("peachdb", "Could not open index file %s for backup.", INDEX_PATH);
+        return -1;
+    }
+    fseek(index_file, 0, SEEK_END);
+    long index_length = ftell(index_file);
+    rewind(index_file);
+    snapshot->index_text = malloc(index_length > 0 ? (size_t)index_length + 1 : 1);
+    if (snapshot->index_text == NULL || index_length < 0 ||
+        fread(snapshot->index_text, 1, (size_t)index_length, index_file) != (size_t)index_length) {
+        fclose(index_file);
+        return -1;
+    }
+    fclose(index_file);
+    snapshot->index_text[index_length] = '\0';
+    snapshot->index_length = (size_t)index_length;
+    return 0;
+}
+
+// Counts the collection lines (lines 2...N, segment lines aside) of an index text,
+// keeping the first max_names names. Cuts names_text into pieces.
+static int index_names(char* names_text, char** names, int max_names) {
+    int count = 0;
+    char* saveptr = NULL;
+    char* line = strtok_r(names_text, "\n", &saveptr); // Line 1: count
+    while (line != NULL && (line = strtok_r(NULL, "\n", &saveptr)) != NULL) {
+        if (PeachSegments_is_manifest_line(line)) continue;
+        line[strcspn(line, " ")] = '\0';
+        if (line[0] == '\0') continue;
+        if (count < max_names) names[count] = line;
+        count++;
+    }
+    return count < max_names ? count : max_names;
+}
+
+// Freezes every collection listed in index.mpdb, with its sealed segments, into a snapshot (see backup.h).
+static int snapshot_collections(PeachSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (PeachBackup_prepare_staging() != 0) return -1;
+
+    for (int attempt = 0; attempt < 3; attempt++) {
+        // 1. Collect the collection names
+        pthread_mutex_lock(&g_index_mutex);
+        int status = read_index_text_locked(snapshot);
+        pthread_mutex_unlock(&g_index_mutex);
+        if (status != 0) return -1;
+        char* names_text = strdup(snapshot->index_text);
+        if (names_text == NULL) return -1;
+        char* names[MAX_SNAPSHOT_COLLECTIONS];
+        int name_count = index_names(names_text, names, MAX_SNAPSHOT_COLLECTIONS);
+
+        // 2. Hold every collection lock at once, so the snapshot is consistent across collections.
+        //    They are taken before the index mutex: a rollover writes the manifest under its lock
+        pthread_rwlock_t* locks[MAX_SNAPSHOT_COLLECTIONS];
+        int locked = 0;
+        while (status == 0 && locked < name_count) {
+            locks[locked] = lock_collection(names[locked], 0);
+            if (locks[locked] == NULL) {
+                status = -1;
+            } else {
+                locked++;
+            }
+        }
+
+        // 3. The index cannot change while its collections are linked; a collection
+        //    created since step 1 means starting over
+        pthread_mutex_lock(&g_index_mutex);
+        bool changed = false;
+        if (status == 0 && (status = read_index_text_locked(snapshot)) == 0) {
+            char* check_text = strdup(snapshot->index_text);
+            char* check_names[MAX_SNAPSHOT_COLLECTIONS];
+            changed = check_text == NULL || index_names(check_text, check_names, MAX_SNAPSHOT_COLLECTIONS) != name_count;
+            free(check_text);
+        }
+        for (int i = 0; i < name_count && status == 0 && !changed; i++) {
+            char collection_path[256];
+            snprintf(collection_path, sizeof(collection_path), "%s/%s.lpdb", COLLECTIONS_PATH, names[i]);
+            if (PeachBackup_add_file(snapshot, names[i], collection_path) < 0) status = -1;
+
+            PeachSegment* segments;
+            int count = list_segments(names[i], &segments);
+            for (int j = 0; j < count && status == 0; j++) {
+                char segment_name[256];
+                char segment_path[256];
+                snprintf(segment_name, sizeof(segment_name), "%s.%06d", names[i], segments[j].number);
+                PeachSegments_file(segment_path, sizeof(segment_path), COLLECTIONS_PATH, names[i], &segments[j]);
+                if (PeachBackup_add_file(snapshot, segment_name, segment_path) < 0) status = -1;
+            }
+            free(segments);
+        }
+        pthread_mutex_unlock(&g_index_mutex);
+        for (int i = 0; i < locked; i++) {
+            pthread_rwlock_unlock(locks[i]);
+        }
+        free(names_text);
+        if (!changed) return status;
+    }
+    LOG_WARN("peachdb", "Collections kept being created during the backup snapshot.");
+    return -1;
+}
+
+int Peach_backup(const char* dest_dir, int incremental) {
+    if (!PeachBackup_begin(dest_dir)) {
+        LOG_WARN("peachdb", "A backup is already running.");
+        return -1;
+    }
+    PeachSnapshot snapshot;
+    int status = snapshot_collections(&snapshot);
+    if (status == 0) {
+        status = PeachBackup_copy(&snapshot, dest_dir, incremental != 0);
+    }
+    PeachBackup_release(&snapshot);
+    PeachBackup_end(status);
+    return status;
+}
+
+typedef struct {
+    PeachSnapshot snapshot;
+    char dest_dir[256];
+    int incremental;
+} BackupJob;
+
+static void* backup_thread(void* arg) {
+    BackupJob* job = arg;
+    int status = PeachBackup_copy(&job->snapshot, job->dest_dir, job->incremental != 0);
+    PeachBackup_release(&job->snapshot);
+    PeachBackup_end(status);
+    free(job);
+    return NULL;
+}
+
+int Peach_backup_start(const char* dest_dir, int incremental) {
+    BackupJob* job = calloc(1, sizeof(BackupJob));
+    if (job == NULL || strlen(dest_dir) >= sizeof(job->dest_dir)) {
+        free(job);
+        return -1;
+    }
+    if (!PeachBackup_begin(dest_dir)) {
+        LOG_WARN("peachdb", "A backup is already running.");
+        free(job);
+        return -1;
+    }
+    snprintf(job->dest_dir, sizeof(job->dest_dir), "%s", dest_dir);
+    job->incremental = incremental;
+
+    // 1. Freeze the snapshot now; only the copy runs in the background
+    pthread_t thread;
+    if (snapshot_collections(&job->snapshot) != 0 ||
+        pthread_create(&thread, NULL, backup_thread, job) != 0) {
+        PeachBackup_release(&job->snapshot);
+        PeachBackup_end(-1);
+        free(job);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+void Peach_backup_status(PeachBackupStatus* out) {
+    PeachBackup_get_status(out);
+}
@@ -1,5 +1,6 @@
 #ifndef PEACHDB_H
 #define PEACHDB_H
+#include <stddef.h>
 
 /*==================[ PEACH DATABASE SPECIFICATION (v2) ]=========
  * Design decision: To optimize for write performance, record counts are not
@@ -11,6 +12,9 @@
  *     - collections/
  *         - {collection_name}.lpdb
  *     - index.mpdb
+ *     - .snapshot/    (hard links held by a running backup, see backup.h)
+ *     - indexes/      (index snapshots for warm restarts, see indexfile.h,
+ *                      and B+tree index files, see btree.h)
  *
  * index.mpdb format:
  *   Line 1: <number_of_collections>
@@ -18,7 +22,15 @@
  *
  * {collection_name}.lpdb format:
  *   Line 1: <field1>^<field2>^...^<fieldN>
- *   Line 2...M: <value1>^<value2>^...^<valueN>
+ *   Line 2...M: <value1>^<value2>^...^<valueN><checksum>
+ *   (<checksum> is a CRC-32 of the record, see checksum.h)
+ *
+ * Rewrites (update, delete, new collection) go through a synced '.tmp' file
+ * and an atomic rename; Peach_initPeachDb repairs what a crash left behind
+ * (see recovery.h).
+ *
+ * Concurrency: every collection has its own reader/writer lock, so the
+ * Peach_* functions may be called from several threads at once.
  ==========================================================*/
 
 // Represents a single record (row) in a collection.
@@ -35,6 +47,44 @@ typedef struct {
     int num_fields;         // The number of fields per record.
 } PeachRecordSet;
 
+// Comparison operators for query predicates.
+typedef enum {
+    PEACH_EQ,
+    PEACH_NE,
+    PEACH_LT,
+    PEACH_LE,
+    PEACH_GT,
+    PEACH_GE
+} PeachOperator;
+
+// A condition on one field of a record. Predicates with the same or_group
+// are AND-ed together; a record matches if every predicate of at least one
+// group holds (e.g., "(a=1 AND b=2) OR (a=2 AND b=1)" uses groups 0 and 1).
+typedef struct {
+    int field;              // Field index, as in the collection header.
+    PeachOperator op;
+    const char* text;       // Compared as a string when not NULL...
+    long long number;       // ...otherwise the field is compared as an integer.
+    int or_group;           // 0..31
+} PeachPredicate;
+
+// Order in which matching records are returned.
+typedef enum {
+    PEACH_ORDER_ASC,        // File (insertion) order.
+    PEACH_ORDER_DESC,       // Newest first.
+    PEACH_ORDER_TAIL        // The newest 'limit' matches, in file order (e.g., the last page of a chat).
+} PeachOrder;
+
+// A query over one collection. The projection and limit can be prepared
+// once (e.g., as static const data) and reused with fresh predicates.
+typedef struct {
+    const PeachPredicate* where;
+    int where_count;        // 0 matches every record.
+    const int* select;      // Field indices to return, in this order; NULL returns all fields.
+    int select_count;
+    int limit;              // Maximum number of records; 0 means no limit.
+    PeachOrder order;
+} PeachQuery;
 
 /**
  * @brief Initialize the PeachDB service.
@@ -44,6 +94,23 @@ typedef struct {
  */
 int Peach_initPeachDb();
 
+/**
+ * @brief Sets the memory budget of the shared record cache.
+ * Recently read collections are kept parsed in memory and evicted with the
+ * CLOCK algorithm once the budget is exceeded. Writes through the Peach_*
+ * API keep the cache in sync. The default is 8 MiB, or PEACHDB_CACHE_MB
+ * when set at Peach_initPeachDb().
+ * @param budget_bytes The budget in bytes; 0 disables the cache.
+ */
+void Peach_set_cache_budget(size_t budget_bytes);
+
+/**
+ * @brief Drops a collection's in-memory state (record cache, Bloom filters).
+ * Only needed when a collection file was modified outside the Peach_* API.
+ * @param collection_name The name of the collection.
+ */
+void Peach_cache_invalidate(const char* collection_name);
+
 /**
  * @brief Creates a new collection with specified fields.
  * @param collection_name The name for the new collection.
@@ -77,6 +144,35 @@ int Peach_write_record(const char* collection_name, const char* record_str);
  */
 PeachRecordSet* Peach_read_all_records(const char* collection_name);
 
+/**
+ * @brief Runs a query against a collection.
+ * Predicates are evaluated on each line in place, before anything is
+ * allocated; only the projected fields of matching records are copied.
+ * Ascending queries read the file forwards, descending and tail queries read
+ * it backwards from the end; either way reading stops once the limit is
+ * reached. A text lower bound on a field indexed with Peach_index_range
+ * makes the scan start near the first match. Records of a cached collection
+ * are filtered in memory, except for limited descending and tail queries,
+ * which only need the end of the file, and time-indexed ranges.
+ * @param collection_name The name of the collection to query.
+ * @param query The predicates, projection, limit and order.
+ * @return A record set whose records hold the projected fields (missing fields
+ *         are empty strings), or NULL on failure. Free it with Peach_free_record_set().
+ */
+PeachRecordSet* Peach_query(const char* collection_name, const PeachQuery* query);
+
+/**
+ * @brief Reads the newest records of a collection, newest first.
+ * The file is scanned backwards from its end, so the cost grows with n,
+ * not with the size of the collection. Queries ordered PEACH_ORDER_DESC
+ * or PEACH_ORDER_TAIL use the same backward scan.
+ * @param collection_name The name of the collection.
+ * @param n The maximum number of records to return.
+ * @return A pointer to a PeachRecordSet, or NULL on failure. Free it with
+ *         Peach_free_record_set().
+ */
+PeachRecordSet* Peach_read_last_n(const char* collection_name, int n);
+
 /**
  * @brief Frees the memory allocated for a PeachRecordSet, including all its records and fields.
  * @param record_set The record set to free.
@@ -111,4 +207,152 @@ int Peach_update_record(const char* collection_name, const char* key, const char
  */
 long Peach_get_highest_key(const char* collection_name);
 
+/**
+ * @brief Maintains a Bloom filter on a field so lookups of absent values
+ * can be answered without reading the file (the key field always has one).
+ * The filter is built from the file on first use and updated on writes.
+ * @param collection_name The name of the collection.
+ * @param field_name The field to index, as named in the collection header.
+ * @return 0 on success, -1 on failure.
+ */
+int Peach_index_field(const char* collection_name, const char* field_name);
+
+/**
+ * @brief Maintains a sparse time index on a field so range queries on it
+ * (Peach_range, or Peach_query predicates with a text lower bound on the
+ * field) seek near their first match instead of reading the whole file.
+ * The field must sort correctly as text, e.g. "YYYY-MM-DD HH:MM:SS".
+ * A collection has at most one such index.
+ * @param collection_name The name of the collection.
+ * @param field_name The field to index.
+ * @return 0 on success, -1 on failure.
+ */
+int Peach_index_range(const char* collection_name, const char* field_name);
+
+/**
+ * @brief Splits a collection into sealed segments of about max_bytes each
+ * ({collection}.NNNNNN.lpdb, see segments.h): once the collection file reaches
+ * max_bytes, it is sealed and a new, empty one takes its place. Queries skip
+ * segments whose key and time ranges cannot match. Indexes (Bloom filters,
+ * time index, B+trees) cover only the records written since the last rollover.
+ * @param collection_name The name of the collection.
+ * @param time_field A field whose range each segment records (e.g., "time"), or NULL.
+ * @param max_bytes The rollover size; 0 stops rollovers.
+ * @return 0 on success, -1 on failure.
+ */
+int Peach_collection_segment(const char* collection_name, const char* time_field, long max_bytes);
+
+/**
+ * @brief Keeps the sealed segments of a collection compressed ({collection}.NNNNNN.lpdz,
+ * see compress.h). Reads decompress them transparently; a lookup by key decompresses
+ * only the blocks whose key range holds the key. Enabling it compresses the segments
+ * already sealed; disabling it leaves them compressed and seals new ones as they are.
+ * @param collection_name The name of the collection.
+ * @param enabled Nonzero to compress.
+ * @return 0 on success, -1 on failure.
+ */
+int Peach_collection_compress(const char* collection_name, int enabled);
+
+/**
+ * @brief Keeps a persistent B+tree on a field (peachdata/indexes/{collection}.{field}.idx).
+ * The tree is maintained by every write, update and delete and is usable right
+ * after a restart; see Peach_index_scan.
+ * @param collection_name The name of the collection.
+ * @param field_name The field to index (values up to 47 bytes).
+ * @return 0 on success, -1 on failure.
+ */
+int Peach_index_ordered(const char* collection_name, const char* field_name);
+
+/**
+ * @brief Reads the records whose field lies between lo and hi (inclusive, compared
+ *        as text) in field order, through the field's B+tree. lo == hi is a point lookup.
+ * @param collection_name The name of the collection.
+ * @param field_name A field declared with Peach_index_ordered.
+ * @param lo The lower bound, or NULL for none.
+ * @param hi The upper bound, or NULL for none.
+ * @param limit The maximum number of records; 0 means no limit.
+ * @return A record set ordered by the field (equal values in file order), or NULL
+ *         if the field has no usable B+tree or the collection has sealed segments
+ *         (scan instead), or on failure. Free it with Peach_free_record_set().
+ */
+PeachRecordSet* Peach_index_scan(const char* collection_name, const char* field_name,
+                                 const char* lo, const char* hi, int limit);
+
+/**
+ * @brief Reads the records whose field lies between lo and hi (inclusive, compared as text).
+ * Uses the field's time index when one was declared with Peach_index_range.
+ * @param collection_name The name of the collection.
+ * @param field_name The field to compare.
+ * @param lo The lower bound, or NULL for none.
+ * @param hi The upper bound, or NULL for none.
+ * @return A record set in file order, or NULL on failure. Free it with
+ *         Peach_free_record_set().
+ */
+PeachRecordSet* Peach_range(const char* collection_name, const char* field_name, const char* lo, const char* hi);
+
+// Progress of an online backup (see Peach_backup).
+typedef struct {
+    int running;                // 1 while a backup is copying
+    int last_status;            // Last finished backup: 0 success, -1 failure, 1 none yet
+    char dest_dir[256];
+    long long bytes_total;      // Collection bytes in the snapshot
+    long long bytes_copied;     // Bytes written; smaller than bytes_total when incremental
+    int collections_appended;   // Collections extended with their new records only
+    int collections_copied;     // Collections copied in full
+} PeachBackupStatus;
+
+/**
+ * @brief Backs up peachdata/ while the server keeps running.
+ * A consistent snapshot of every collection is frozen first (a brief pause
+ * for writers, see backup.h), then copied into dest_dir, which gets the
+ * layout of peachdata/ and can be restored by copying it back.
+ * @param dest_dir The backup directory, created if missing.
+ * @param incremental If dest_dir holds a previous backup, copy only the
+ *                    records appended since (collections rewritten by an
+ *                    update or delete are still copied in full).
+ * @return 0 on success, -1 on failure or if another backup is running.
+ */
+int Peach_backup(const char* dest_dir, int incremental);
+
+/**
+ * @brief Like Peach_backup, but copies on a background thread.
+ * The snapshot is frozen before this function returns.
+ * @return 0 if the backup started, -1 on failure or if another backup is running.
+ */
+int Peach_backup_start(const char* dest_dir, int incremental);
+
+/**
+ * @brief Reports the running or last backup.
+ * @param out Receives the status.
+ */
+void Peach_backup_status(PeachBackupStatus* out);
+
+/**
+ * @brief Tests a value against a field's Bloom filter.
+ * @param collection_name The name of the collection.
+ * @param field_name A field declared with Peach_index_field, or NULL for the key.
+ * @param value The value to look for.
+ * @return 0 if no record has this value, 1 if one may have it (~1% false
+ *         positives), -1 if the field has no filter or the collection has sealed
+ *         segments (scan instead).
+ */
+int Peach_field_may_contain(const char* collection_name, const char* field_name, const char* value);
+
+/**
+ * @brief Builds the declared indexes of every collection now instead of on first use.
+ * Call it at startup, after the Peach_index_field / Peach_index_range declarations.
+ * Collections are loaded side by side; a large collection is split into
+ * line-aligned chunks scanned on several threads. Indexes whose snapshot in
+ * peachdata/indexes is still valid are mapped and only catch up on appended records.
+ * @param threads The number of threads, 0 for one per CPU.
+ * @return 0 on success, -1 if the collections cannot be listed.
+ */
+int Peach_load_indexes(int threads);
+
+/**
+ * @brief Saves a snapshot of every built index (builds save one already).
+ * @return The number of snapshots written, or -1 on failure.
+ */
+int Peach_save_indexes(void);
+
 #endif // PEACHDB_H
\ No newline at end of file
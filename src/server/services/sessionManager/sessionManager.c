@@ -1,4 +1,6 @@
 #include "sessionManager.h"
+#include "../metricsService/metricsService.h"
+#include "../logService/logService.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -12,19 +14,19 @@ static int g_session_count = 0;
 void SessionManager_init() {
     memset(g_sessions, 0, sizeof(g_sessions));
     g_session_count = 0;
-    printf("Session Manager initialized.\n");
+    LOG_INFO("session", "Session Manager initialized.");
 }
 
 int SessionManager_add(long userId, const char* username, int socket_fd) {
     if (g_session_count >= MAX_SESSIONS) {
-        fprintf(stderr, "SessionManager Error: Maximum number of sessions reached.\n");
+        LOG_ERROR("session", "Maximum number of sessions reached.");
         return -1;
     }
 
     // Check if user or socket is already in a session
     for (int i = 0; i < g_session_count; i++) {
         if (g_sessions[i].userId == userId || g_sessions[i].socket_fd == socket_fd) {
-            fprintf(stderr, "SessionManager Warning: User %ld (socket %d) is already in a session. Updating socket.\n", userId, socket_fd);
+            LOG_WARN("session", "User %ld (socket %d) is already in a session. Updating socket.", userId, socket_fd);
             // Update socket in case of re-login before disconnect
             g_sessions[i].socket_fd = socket_fd;
             strncpy(g_sessions[i].username, username, sizeof(g_sessions[i].username) - 1);
@@ -39,8 +41,9 @@ int SessionManager_add(long userId, const char* username, int socket_fd) {
     g_sessions[g_session_count].username[sizeof(g_sessions[g_session_count].username) - 1] = '\0';
     
     g_session_count++;
+    Metrics_gauge_add(METRICS_GAUGE_ACTIVE_SESSIONS, 1);
     
-    printf("Session added: UserID %ld, Username %s, Socket %d. Total sessions: %d\n", userId, username, socket_fd, g_session_count);
+    LOG_INFO("session", "Session added: UserID %ld, Username %s, Socket %d. Total sessions: %d", userId, username, socket_fd, g_session_count);
     return 0;
 }
 
@@ -54,14 +57,15 @@ void SessionManager_remove_by_socket(int socket_fd) {
     }
 
     if (found_index != -1) {
-        printf("Session removed: UserID %ld, Username %s, Socket %d. \n", g_sessions[found_index].userId, g_sessions[found_index].username, socket_fd);
+        LOG_INFO("session", "Session removed: UserID %ld, Username %s, Socket %d.", g_sessions[found_index].userId, g_sessions[found_index].username, socket_fd);
         // To remove, we swap the found element with the last element
         // and decrement the count. This is faster than shifting all elements.
         g_sessions[found_index] = g_sessions[g_session_count - 1];
         // Clear the now-unused last element
         memset(&g_sessions[g_session_count - 1], 0, sizeof(UserSession));
         g_session_count--;
-        printf("Total sessions: %d\n", g_session_count);
+        Metrics_gauge_add(METRICS_GAUGE_ACTIVE_SESSIONS, -1);
+        LOG_INFO("session", "Total sessions: %d", g_session_count);
     }
 }
 
@@ -3,13 +3,251 @@
 #include "../sessionManager/sessionManager.h"
 #include "../messageService/messageService.h"
 #include "../groupService/groupService.h"
+#include "../deliveryService/deliveryService.h"
+#include "../metricsService/metricsService.h"
+#include "../logService/logService.h"
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/uio.h>   // For writev
 #include <arpa/inet.h> // For inet_ntoa
 
+#define WRITE_LOCK_STRIPES 64
+
+// Frames written to one socket must not interleave (replies and forwards
+// from other client threads), so writes take a lock picked by socket number
+static pthread_mutex_t g_write_locks[WRITE_LOCK_STRIPES];
+
+#define RECENT_SEND_SLOTS 1024
+
+// Recent sends that carried a client message ID (SEND_DM^to^text^clientId),
+// so a send retried after a lost acknowledgement is answered with the
+// message it already saved instead of being saved again. A direct-mapped
+// table: a colliding send simply takes the slot over.
+typedef struct {
+    long user_id;
+    long client_id;   // 0 if the slot is free
+    bool is_group;
+    long message_id;
+    char time[20];    // When the message was saved
+} RecentSend;
+
+static RecentSend g_recent_sends[RECENT_SEND_SLOTS];
+static pthread_mutex_t g_recent_sends_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static RecentSend* recent_send_slot(long userId, long clientId) {
+    unsigned long hash = ((unsigned long)userId * 31 + (unsigned long)clientId) * 2654435761UL;
+    return &g_recent_sends[hash % RECENT_SEND_SLOTS];
+}
+
+// The message saved for a client message ID, or 0 if it was not seen.
+// out_time (20 bytes) receives the time it was saved at.
+static long find_recent_send(long userId, bool isGroup, long clientId, char* out_time) {
+    if (clientId <= 0) return 0;
+    pthread_mutex_lock(&g_recent_sends_mutex);
+    const RecentSend* slot = recent_send_slot(userId, clientId);
+    long message_id = 0;
+    if (slot->user_id == userId && slot->client_id == clientId && slot->is_group == isGroup) {
+        message_id = slot->message_id;
+        strcpy(out_time, slot->time);
+    }
+    pthread_mutex_unlock(&g_recent_sends_mutex);
+    return message_id;
+}
+
+static void remember_send(long userId, bool isGroup, long clientId, long messageId, const char* time) {
+    if (clientId <= 0) return;
+    pthread_mutex_lock(&g_recent_sends_mutex);
+    RecentSend* slot = recent_send_slot(userId, clientId);
+    *slot = (RecentSend){ userId, clientId, isGroup, messageId, "" };
+    strcpy(slot->time, time);
+    pthread_mutex_unlock(&g_recent_sends_mutex);
+}
+
+/*==================[ FRAMING ]====================================
+ * Every frame in both directions ends with '\n' (message text never
+ * contains one). The reader below splits the byte stream of a client
+ * into requests; a client that has never sent a '\n' is treated as
+ * unframed and each recv() is taken as one request, as before.
+ ==========================================================*/
+
+// Sends one frame: the payload followed by '\n'.
+static void send_frame(int sock, const char* data, size_t length) {
+    struct iovec parts[2] = {
+        { .iov_base = (void*)data, .iov_len = length },
+        { .iov_base = "\n", .iov_len = 1 },
+    };
+    pthread_mutex_t* lock = &g_write_locks[(unsigned int)sock % WRITE_LOCK_STRIPES];
+    pthread_mutex_lock(lock);
+    size_t remaining = length + 1;
+    int index = 0;
+    while (remaining > 0) {
+        ssize_t written = writev(sock, &parts[index], 2 - index);
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) continue;
+            break; // The reader thread of this socket notices the disconnect
+        }
+        remaining -= (size_t)written;
+        // Skip what was written
+        while (index < 2 && (size_t)written >= parts[index].iov_len) {
+            written -= (ssize_t)parts[index].iov_len;
+            index++;
+        }
+        if (index < 2) {
+            parts[index].iov_base = (char*)parts[index].iov_base + written;
+            parts[index].iov_len -= (size_t)written;
+        }
+    }
+    pthread_mutex_unlock(lock);
+}
+
+typedef struct {
+    int sock;
+    char buffer[4096];
+    size_t length;
+    bool framed;        // The client terminates its requests with '\n'
+} RequestReader;
+
+// Copies the next request into 'out' (truncated to its size).
+// Returns its length, 0 once the client disconnected, -1 on a recv error.
+static int next_request(RequestReader* reader, char* out, size_t size) {
+    for (;;) {
+        // 1. A complete line is buffered
+        char* newline = memchr(reader->buffer, '\n', reader->length);
+        if (newline != NULL) {
+            size_t line_length = (size_t)(newline - reader->buffer);
+            size_t copied = line_length < size - 1 ? line_length : size - 1;
+            memcpy(out, reader->buffer, copied);
+            out[copied] = '\0';
+            reader->length -= line_length + 1;
+            memmove(reader->buffer, newline + 1, reader->length);
+            reader->framed = true;
+            if (copied > 0) return (int)copied;
+            continue; // Skip empty lines
+        }
+
+        // 2. Unframed clients send one request per recv()
+        if (reader->length > 0 && !reader->framed) {
+            size_t copied = reader->length < size - 1 ? reader->length : size - 1;
+            memcpy(out, reader->buffer, copied);
+            out[copied] = '\0';
+            reader->length = 0;
+            return (int)copied;
+        }
+
+        // 3. A line longer than the buffer cannot be a valid request
+        if (reader->length == sizeof(reader->buffer)) {
+            LOG_WARN("socket", "Dropping an oversized request from client %d.", reader->sock);
+            reader->length = 0;
+        }
+
+        ssize_t received = recv(reader->sock, reader->buffer + reader->length, sizeof(reader->buffer) - reader->length, 0);
+        if (received <= 0) return (int)received;
+        reader->length += (size_t)received;
+    }
+}
+
+// Appends a field value with its row delimiters escaped ("\,", "\;" and
+// "\\"), so message texts and names may contain them. Returns false if it did not fit.
+static bool append_field(char* reply, size_t buffer_size, size_t* length, const char* value) {
+    size_t at = *length;
+    for (const char* c = value; *c != '\0'; c++) {
+        if (*c == ',' || *c == ';' || *c == '\\') {
+            if (at + 1 >= buffer_size) return false;
+            reply[at++] = '\\';
+        }
+        if (at + 1 >= buffer_size) return false;
+        reply[at++] = *c;
+    }
+    reply[at] = '\0';
+    *length = at;
+    return true;
+}
+
+// Appends a ',' or ';' after a field. Returns false if it did not fit.
+static bool append_delimiter(char* reply, size_t buffer_size, size_t* length, char delimiter) {
+    if (*length + 1 >= buffer_size) return false;
+    reply[(*length)++] = delimiter;
+    reply[*length] = '\0';
+    return true;
+}
+
+// Appends "tag,field,field,...;" for every record (no tag when NULL).
+// Returns false if a row did not fit; the partial row is dropped.
+static bool append_rows(char* reply, size_t buffer_size, size_t* current_len, const char* tag, const PeachRecordSet* records) {
+    for (PeachRecord* rec = records != NULL ? records->head : NULL; rec != NULL; rec = rec->next) {
+        size_t row_len = *current_len;
+        bool fits = tag == NULL || (append_field(reply, buffer_size, &row_len, tag) &&
+                                    append_delimiter(reply, buffer_size, &row_len, ','));
+        for (int i = 0; fits && i < rec->num_fields; i++) {
+            fits = append_field(reply, buffer_size, &row_len, rec->fields[i]) &&
+                   append_delimiter(reply, buffer_size, &row_len, i + 1 < rec->num_fields ? ',' : ';');
+        }
+        if (!fits) {
+            reply[*current_len] = '\0';
+            return false;
+        }
+        *current_len = row_len;
+    }
+    return true;
+}
+
+// Upper bound of what append_rows writes for a record set: every character
+// escaped, plus a delimiter per field
+static size_t rows_size(const PeachRecordSet* records) {
+    size_t size = 0;
+    for (PeachRecord* rec = records != NULL ? records->head : NULL; rec != NULL; rec = rec->next) {
+        for (int i = 0; i < rec->num_fields; i++) {
+            size += strlen(rec->fields[i]) * 2 + 1;
+        }
+    }
+    return size;
+}
+
+// Writes a message list as "<prefix>field,field,...;field,field,...;" in one frame
+// (values escaped by append_field). The reply is sized to hold the whole page;
+// clients decode it as it streams in (see the client's rowDecoder).
+static void send_message_rows(int sock, const char* prefix, PeachRecordSet* messages) {
+    size_t buffer_size = strlen(prefix) + rows_size(messages) + 1;
+    char* reply = malloc(buffer_size);
+    if (reply == NULL) return;
+    snprintf(reply, buffer_size, "%s", prefix);
+    size_t current_len = strlen(reply);
+    append_rows(reply, buffer_size, &current_len, NULL, messages);
+    send_frame(sock, reply, current_len);
+    free(reply);
+}
+
+// Sends the undelivered messages of a user as one frame:
+// MISSED_DATA^<more>^D,senderId,id,time,message;...;G,groupId,senderId,id,time,message;...
+// <more> is 1 when the client should ask again (GET_MISSED) after acknowledging this batch.
+static void send_missed_batch(int sock, long userId) {
+    PeachRecordSet* dms = DeliveryService_get_missed_dms(userId);
+    PeachRecordSet* group_messages = DeliveryService_get_missed_group_messages(userId);
+
+    size_t buffer_size = 16384;
+    char* reply = malloc(buffer_size);
+    if (reply != NULL) {
+        // The flag is patched once it is known whether everything fit
+        snprintf(reply, buffer_size, "MISSED_DATA^0^");
+        size_t current_len = strlen(reply);
+        bool complete = append_rows(reply, buffer_size, &current_len, "D", dms) &&
+                        append_rows(reply, buffer_size, &current_len, "G", group_messages);
+        bool more = !complete ||
+                    (dms != NULL && dms->record_count >= DELIVERY_BATCH_SIZE) ||
+                    (group_messages != NULL && group_messages->record_count >= DELIVERY_BATCH_SIZE);
+        reply[strlen("MISSED_DATA^")] = more ? '1' : '0';
+        send_frame(sock, reply, current_len);
+        free(reply);
+    }
+    Peach_free_record_set(dms);
+    Peach_free_record_set(group_messages);
+}
+
 // This is the new, command-aware client handler
 static void* client_handler(void* socket_desc) {
     int sock = *(int*)socket_desc;
@@ -18,17 +256,22 @@ static void* client_handler(void* socket_desc) {
     char client_message[2048];
     char response[2048];
     int read_size;
+    RequestReader reader = { .sock = sock };
 
     // Define the separator for parsing commands
     const char* separator = "^";
 
-    while ((read_size = recv(sock, client_message, sizeof(client_message) - 1, 0)) > 0) {
-        client_message[read_size] = '\0';
-        printf("Received from client %d: %s\n", sock, client_message);
+    Metrics_gauge_add(METRICS_GAUGE_CONNECTIONS, 1);
+
+    while ((read_size = next_request(&reader, client_message, sizeof(client_message))) > 0) {
+        uint64_t started_us = Metrics_now_us();
+        Metrics_gauge_add(METRICS_GAUGE_INFLIGHT_REQUESTS, 1);
+        LOG_DEBUG("socket", "Received from client %d: %s", sock, client_message);
 
         // Make a copy for strtok, as it modifies the string
         char* msg_copy = strdup(client_message);
         char* command = strtok(msg_copy, separator);
+        MetricsCommand metric_command = Metrics_command_from_name(command);
 
         if (command == NULL) {
             snprintf(response, sizeof(response), "ERROR^INVALID_COMMAND_FORMAT");
@@ -39,6 +282,7 @@ static void* client_handler(void* socket_desc) {
             if (username && password) {
                 long new_id = UserService_register(username, password);
                 if (new_id > 0) {
+                    DeliveryService_open_user(new_id);
                     snprintf(response, sizeof(response), "REGISTER_SUCCESS^%ld", new_id);
                 } else {
                     snprintf(response, sizeof(response), "REGISTER_FAIL^USERNAME_TAKEN_OR_INVALID");
@@ -54,7 +298,13 @@ static void* client_handler(void* socket_desc) {
                 User* user = UserService_login(username, password);
                 if (user != NULL) {
                     SessionManager_add(user->id, user->username, sock);
+                    DeliveryService_open_user(user->id);
+
+                    // Reply first, then stream what arrived while the user was away
                     snprintf(response, sizeof(response), "LOGIN_SUCCESS^%ld", user->id);
+                    send_frame(sock, response, strlen(response));
+                    send_missed_batch(sock, user->id);
+                    snprintf(response, sizeof(response), "");
                     User_free(user); // Free the user struct after use
                 } else {
                     snprintf(response, sizeof(response), "LOGIN_FAIL^INVALID_CREDENTIALS");
@@ -69,20 +319,27 @@ static void* client_handler(void* socket_desc) {
             } else {
                 char* receiverId_str = strtok(NULL, separator);
                 char* message = strtok(NULL, separator);
-
-                if (receiverId_str && message) {
+                char* clientId_str = strtok(NULL, separator); // Optional, see RecentSend
+                long client_id = clientId_str ? atol(clientId_str) : 0;
+                char saved_time[20];
+                long repeated_id = find_recent_send(sender_session->userId, false, client_id, saved_time);
+
+                if (receiverId_str && message && repeated_id > 0) {
+                    snprintf(response, sizeof(response), "SEND_DM_SUCCESS^%ld^%s", repeated_id, saved_time);
+                } else if (receiverId_str && message) {
                     long receiverId = atol(receiverId_str);
-                    long message_id = MessageService_save_dm(sender_session->userId, receiverId, message);
+                    long message_id = MessageService_save_dm(sender_session->userId, receiverId, message, saved_time);
 
                     if (message_id > 0) {
-                        snprintf(response, sizeof(response), "SEND_DM_SUCCESS^%ld", message_id);
+                        remember_send(sender_session->userId, false, client_id, message_id, saved_time);
+                        snprintf(response, sizeof(response), "SEND_DM_SUCCESS^%ld^%s", message_id, saved_time);
                         
                         int receiver_socket = SessionManager_get_socket(receiverId);
                         if (receiver_socket != -1) {
                             char forward_msg[2048];
-                            snprintf(forward_msg, sizeof(forward_msg), "RECEIVE_DM^%ld^%s", sender_session->userId, message);
-                            printf("Forwarding DM from %ld to %ld (socket %d): %s\n", sender_session->userId, receiverId, receiver_socket, forward_msg);
-                            write(receiver_socket, forward_msg, strlen(forward_msg));
+                            snprintf(forward_msg, sizeof(forward_msg), "RECEIVE_DM^%ld^%s^%ld^%s", sender_session->userId, message, message_id, saved_time);
+                            LOG_DEBUG("socket", "Forwarding DM from %ld to %ld (socket %d): %s", sender_session->userId, receiverId, receiver_socket, forward_msg);
+                            send_frame(receiver_socket, forward_msg, strlen(forward_msg));
                         }
                     } else {
                         snprintf(response, sizeof(response), "SEND_DM_FAIL^COULD_NOT_SAVE");
@@ -148,19 +405,25 @@ static void* client_handler(void* socket_desc) {
                         for (int i = 0; i < count; i++) {
                             char group_name[256];
                             if (GroupService_get_group_name(groups[i], group_name, sizeof(group_name)) == 0) {
-                                int written = snprintf(groups_response + current_len, buffer_size - current_len,
-                                                       "%ld,%s;", groups[i], group_name);
-                                if (written > 0 && current_len + written < buffer_size) {
-                                    current_len += written;
+                                char group_id[32];
+                                snprintf(group_id, sizeof(group_id), "%ld", groups[i]);
+                                size_t row_len = current_len;
+                                if (append_field(groups_response, buffer_size, &row_len, group_id) &&
+                                    append_delimiter(groups_response, buffer_size, &row_len, ',') &&
+                                    append_field(groups_response, buffer_size, &row_len, group_name) &&
+                                    append_delimiter(groups_response, buffer_size, &row_len, ';')) {
+                                    current_len = row_len;
+                                } else {
+                                    groups_response[current_len] = '\0';
                                 }
                             }
                         }
-                        write(sock, groups_response, current_len);
+                        send_frame(sock, groups_response, current_len);
                         free(groups_response);
                     }
                     free(groups);
                 } else {
-                    write(sock, "MY_GROUPS_DATA^", strlen("MY_GROUPS_DATA^"));
+                    send_frame(sock, "MY_GROUPS_DATA^", strlen("MY_GROUPS_DATA^"));
                 }
                 snprintf(response, sizeof(response), "");
             }
@@ -173,35 +436,8 @@ static void* client_handler(void* socket_desc) {
                 if (groupId_str) {
                     long groupId = atol(groupId_str);
                     PeachRecordSet* history = GroupService_get_group_history(groupId);
-                    
-                    if (history != NULL && history->record_count > 0) {
-                        size_t buffer_size = 16384;
-                        char* history_response = malloc(buffer_size);
-                        if (history_response) {
-                            strcpy(history_response, "GROUP_HISTORY_DATA^");
-                            size_t current_len = strlen(history_response);
-                            
-                            for (PeachRecord* rec = history->head; rec != NULL; rec = rec->next) {
-                                // fields: id^groupId^senderId^message^time
-                                char* msg_senderId = rec->fields[2];
-                                char* msg_content = rec->fields[3];
-                                char* msg_time = rec->fields[4];
-                                
-                                int written = snprintf(history_response + current_len, buffer_size - current_len,
-                                                       "%s,%s,%s;", msg_senderId, msg_content, msg_time);
-                                if (written > 0 && current_len + written < buffer_size) {
-                                    current_len += written;
-                                } else {
-                                    break;
-                                }
-                            }
-                            write(sock, history_response, current_len);
-                            free(history_response);
-                        }
-                        Peach_free_record_set(history);
-                    } else {
-                        write(sock, "GROUP_HISTORY_DATA^", strlen("GROUP_HISTORY_DATA^"));
-                    }
+                    send_message_rows(sock, "GROUP_HISTORY_DATA^", history); // rows: senderId,message,time
+                    Peach_free_record_set(history);
                     snprintf(response, sizeof(response), "");
                 } else {
                     snprintf(response, sizeof(response), "ERROR^GET_GROUP_HISTORY_FAIL^INSUFFICIENT_ARGS");
@@ -214,13 +450,20 @@ static void* client_handler(void* socket_desc) {
             } else {
                 char* groupId_str = strtok(NULL, separator);
                 char* message = strtok(NULL, separator);
-
-                if (groupId_str && message) {
+                char* clientId_str = strtok(NULL, separator); // Optional, see RecentSend
+                long client_id = clientId_str ? atol(clientId_str) : 0;
+                char saved_time[20];
+                long repeated_id = find_recent_send(sender_session->userId, true, client_id, saved_time);
+
+                if (groupId_str && message && repeated_id > 0) {
+                    snprintf(response, sizeof(response), "SEND_GROUP_MSG_SUCCESS^%ld^%s", repeated_id, saved_time);
+                } else if (groupId_str && message) {
                     long groupId = atol(groupId_str);
-                    long message_id = GroupService_save_group_message(groupId, sender_session->userId, message);
+                    long message_id = GroupService_save_group_message(groupId, sender_session->userId, message, saved_time);
 
                     if (message_id > 0) {
-                        snprintf(response, sizeof(response), "SEND_GROUP_MSG_SUCCESS^%ld", message_id);
+                        remember_send(sender_session->userId, true, client_id, message_id, saved_time);
+                        snprintf(response, sizeof(response), "SEND_GROUP_MSG_SUCCESS^%ld^%s", message_id, saved_time);
                         
                         PeachRecordSet* members = GroupService_get_group_members(groupId);
                         if (members != NULL) {
@@ -232,9 +475,9 @@ static void* client_handler(void* socket_desc) {
                                 int member_socket = SessionManager_get_socket(member_userId);
                                 if (member_socket != -1) {
                                     char forward_msg[2048];
-                                    snprintf(forward_msg, sizeof(forward_msg), "RECEIVE_GROUP_MSG^%ld^%ld^%s", groupId, sender_session->userId, message);
-                                    printf("Forwarding Group Msg to %ld (socket %d)\n", member_userId, member_socket);
-                                    write(member_socket, forward_msg, strlen(forward_msg));
+                                    snprintf(forward_msg, sizeof(forward_msg), "RECEIVE_GROUP_MSG^%ld^%ld^%s^%ld^%s", groupId, sender_session->userId, message, message_id, saved_time);
+                                    LOG_DEBUG("socket", "Forwarding Group Msg to %ld (socket %d)", member_userId, member_socket);
+                                    send_frame(member_socket, forward_msg, strlen(forward_msg));
                                 }
                             }
                             Peach_free_record_set(members);
@@ -255,43 +498,98 @@ static void* client_handler(void* socket_desc) {
                 if (contactId_str) {
                     long contactId = atol(contactId_str);
                     PeachRecordSet* history = MessageService_get_history(sender_session->userId, contactId);
-                    
-                    // Manually send history response, then clear the standard response buffer
-                    if (history != NULL && history->record_count > 0) {
-                        size_t buffer_size = 16384; // 16KB buffer
-                        char* history_response = malloc(buffer_size);
-                        if (history_response) {
-                            strcpy(history_response, "HISTORY_DATA^");
-                            size_t current_len = strlen(history_response);
-
-                            for (PeachRecord* rec = history->head; rec != NULL; rec = rec->next) {
-                                // fields: id^senderId^receiverId^message^time
-                                char* msg_senderId = rec->fields[1];
-                                char* msg_content = rec->fields[3];
-                                char* msg_time = rec->fields[4];
-                                
-                                int written = snprintf(history_response + current_len, buffer_size - current_len,
-                                                       "%s,%s,%s;", msg_senderId, msg_content, msg_time);
-                                
-                                if (written > 0 && current_len + written < buffer_size) {
-                                    current_len += written;
-                                } else {
-                                    break;
-                                }
-                            }
-                            write(sock, history_response, current_len);
-                            free(history_response);
-                        }
-                        Peach_free_record_set(history);
-                    } else {
-                        // No history or error, send empty data
-                        write(sock, "HISTORY_DATA^", strlen("HISTORY_DATA^"));
-                    }
+                    send_message_rows(sock, "HISTORY_DATA^", history); // rows: senderId,message,time
+                    Peach_free_record_set(history);
                     snprintf(response, sizeof(response), ""); // Clear response buffer
                 } else {
                     snprintf(response, sizeof(response), "ERROR^GET_DM_HISTORY_FAIL^INSUFFICIENT_ARGS");
                 }
             }
+        } else if (strcmp(command, "GET_DM_SINCE") == 0) {
+            const UserSession* sender_session = SessionManager_get_session_by_socket(sock);
+            if (sender_session == NULL) {
+                snprintf(response, sizeof(response), "ERROR^NOT_LOGGED_IN");
+            } else {
+                char* contactId_str = strtok(NULL, separator);
+                char* since = strtok(NULL, separator);
+                if (contactId_str && since) {
+                    long contactId = atol(contactId_str);
+                    PeachRecordSet* messages = MessageService_get_history_since(sender_session->userId, contactId, since);
+                    send_message_rows(sock, "DM_SINCE_DATA^", messages); // rows: senderId,message,time,id
+                    Peach_free_record_set(messages);
+                    snprintf(response, sizeof(response), "");
+                } else {
+                    snprintf(response, sizeof(response), "ERROR^GET_DM_SINCE_FAIL^INSUFFICIENT_ARGS");
+                }
+            }
+        } else if (strcmp(command, "GET_GROUP_SINCE") == 0) {
+            const UserSession* sender_session = SessionManager_get_session_by_socket(sock);
+            if (sender_session == NULL) {
+                snprintf(response, sizeof(response), "ERROR^NOT_LOGGED_IN");
+            } else {
+                char* groupId_str = strtok(NULL, separator);
+                char* since = strtok(NULL, separator);
+                if (groupId_str && since && !GroupService_is_member(atol(groupId_str), sender_session->userId)) {
+                    snprintf(response, sizeof(response), "ERROR^GET_GROUP_SINCE_FAIL^NOT_A_MEMBER");
+                } else if (groupId_str && since) {
+                    long groupId = atol(groupId_str);
+                    PeachRecordSet* messages = GroupService_get_group_history_since(groupId, since);
+                    send_message_rows(sock, "GROUP_SINCE_DATA^", messages); // rows: senderId,message,time,id
+                    Peach_free_record_set(messages);
+                    snprintf(response, sizeof(response), "");
+                } else {
+                    snprintf(response, sizeof(response), "ERROR^GET_GROUP_SINCE_FAIL^INSUFFICIENT_ARGS");
+                }
+            }
+        } else if (strcmp(command, "GET_DM_BEFORE") == 0 || strcmp(command, "GET_GROUP_BEFORE") == 0) {
+            // Older pages, for clients scrolling back: GET_*_BEFORE^<contact or group id>^<message id>
+            const UserSession* sender_session = SessionManager_get_session_by_socket(sock);
+            bool is_group = strcmp(command, "GET_GROUP_BEFORE") == 0;
+            if (sender_session == NULL) {
+                snprintf(response, sizeof(response), "ERROR^NOT_LOGGED_IN");
+            } else {
+                char* chatId_str = strtok(NULL, separator);
+                char* beforeId_str = strtok(NULL, separator);
+                if (chatId_str && beforeId_str && is_group && !GroupService_is_member(atol(chatId_str), sender_session->userId)) {
+                    snprintf(response, sizeof(response), "ERROR^GET_GROUP_BEFORE_FAIL^NOT_A_MEMBER");
+                } else if (chatId_str && beforeId_str) {
+                    long chatId = atol(chatId_str);
+                    long beforeId = atol(beforeId_str);
+                    PeachRecordSet* messages = is_group
+                        ? GroupService_get_group_history_before(chatId, beforeId)
+                        : MessageService_get_history_before(sender_session->userId, chatId, beforeId);
+                    send_message_rows(sock, is_group ? "GROUP_BEFORE_DATA^" : "DM_BEFORE_DATA^", messages); // rows: senderId,message,time,id
+                    Peach_free_record_set(messages);
+                    snprintf(response, sizeof(response), "");
+                } else {
+                    snprintf(response, sizeof(response), "ERROR^%s_FAIL^INSUFFICIENT_ARGS", command);
+                }
+            }
+        } else if (strcmp(command, "ACK_DM") == 0 || strcmp(command, "ACK_GROUP_MSG") == 0) {
+            // Acknowledgements are not answered; the client does not wait for them
+            const UserSession* sender_session = SessionManager_get_session_by_socket(sock);
+            char* messageId_str = strtok(NULL, separator);
+            if (sender_session == NULL) {
+                snprintf(response, sizeof(response), "ERROR^NOT_LOGGED_IN");
+            } else if (messageId_str == NULL) {
+                snprintf(response, sizeof(response), "ERROR^%s_FAIL^INSUFFICIENT_ARGS", command);
+            } else {
+                long messageId = atol(messageId_str);
+                if (strcmp(command, "ACK_DM") == 0) {
+                    DeliveryService_ack_dm(sender_session->userId, messageId);
+                } else {
+                    DeliveryService_ack_group_message(sender_session->userId, messageId);
+                }
+                snprintf(response, sizeof(response), "");
+            }
+        } else if (strcmp(command, "GET_MISSED") == 0) {
+            const UserSession* sender_session = SessionManager_get_session_by_socket(sock);
+            if (sender_session == NULL) {
+                snprintf(response, sizeof(response), "ERROR^NOT_LOGGED_IN");
+            } else {
+                send_missed_batch(sock, sender_session->userId);
+                snprintf(response, sizeof(response), "");
+            }
         } else if (strcmp(command, "GET_CONTACTS") == 0) {
             snprintf(response, sizeof(response), ""); // Clear standard response
             const UserSession* sender_session = SessionManager_get_session_by_socket(sock);
@@ -308,29 +606,26 @@ static void* client_handler(void* socket_desc) {
                         strcpy(contacts_response, "CONTACTS_DATA^");
                         size_t current_len = strlen(contacts_response);
 
+                        // One row per contact: "id;id;..."
                         for (int i = 0; i < count; i++) {
                             int written = snprintf(contacts_response + current_len, buffer_size - current_len,
-                                                   "%ld,", contacts[i]);
+                                                   "%ld;", contacts[i]);
                             
                             if (written > 0 && current_len + written < buffer_size) {
                                 current_len += written;
                             } else {
+                                contacts_response[current_len] = '\0';
                                 break; // Buffer full or error
                             }
                         }
-                        // Remove trailing comma if any
-                        if (current_len > 0 && contacts_response[current_len - 1] == ',') {
-                            contacts_response[current_len - 1] = '\0';
-                            current_len--;
-                        }
 
-                        write(sock, contacts_response, current_len);
+                        send_frame(sock, contacts_response, current_len);
                         free(contacts_response);
                     }
                     free(contacts);
                 } else {
                     // No contacts or error
-                    write(sock, "CONTACTS_DATA^", strlen("CONTACTS_DATA^"));
+                    send_frame(sock, "CONTACTS_DATA^", strlen("CONTACTS_DATA^"));
                 }
             }
         } else if (strcmp(command, "GET_USER_INFO") == 0) {
@@ -368,25 +663,29 @@ static void* client_handler(void* socket_desc) {
 
         // Send the response back to the client, if one was prepared
         if (strlen(response) > 0) {
-            printf("Sending response to client %d: %s\n", sock, response);
-            write(sock, response, strlen(response));
+            LOG_DEBUG("socket", "Sending response to client %d: %s", sock, response);
+            send_frame(sock, response, strlen(response));
         }
+
+        Metrics_record_command(metric_command, Metrics_now_us() - started_us);
+        Metrics_gauge_add(METRICS_GAUGE_INFLIGHT_REQUESTS, -1);
         
         memset(client_message, 0, sizeof(client_message));
         memset(response, 0, sizeof(response));
     }
 
     if (read_size == 0) {
-        printf("Client %d disconnected.\n", sock);
+        LOG_INFO("socket", "Client %d disconnected.", sock);
         fflush(stdout);
     } else if (read_size == -1) {
-        perror("recv failed");
+        LOG_ERROR("socket", "recv failed: %s", strerror(errno));
     }
 
     // Clean up the session before closing the socket
     SessionManager_remove_by_socket(sock);
 
     close(sock);
+    Metrics_gauge_add(METRICS_GAUGE_CONNECTIONS, -1);
     return 0;
 }
 
@@ -396,15 +695,19 @@ int Socket_init(int port, int max_connections) {
     struct sockaddr_in address;
     int opt = 1;
 
+    for (int i = 0; i < WRITE_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&g_write_locks[i], NULL);
+    }
+
     // 1. Create socket file descriptor
     if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("socket failed");
+        LOG_ERROR("socket", "socket failed: %s", strerror(errno));
         return -1;
     }
 
     // 2. Set socket options to allow reusing the address and port
     if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
-        perror("setsockopt(SO_REUSEADDR) failed");
+        LOG_ERROR("socket", "setsockopt(SO_REUSEADDR) failed: %s", strerror(errno));
         close(server_fd);
         return -1;
     }
@@ -417,24 +720,24 @@ int Socket_init(int port, int max_connections) {
 
     // 3. Bind the socket to the network address and port
     if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        perror("bind failed");
+        LOG_ERROR("socket", "bind failed: %s", strerror(errno));
         close(server_fd);
         return -1;
     }
 
     // 4. Put the server socket in a passive mode to wait for clients
     if (listen(server_fd, max_connections) < 0) {
-        perror("listen failed");
+        LOG_ERROR("socket", "listen failed: %s", strerror(errno));
         close(server_fd);
         return -1;
     }
 
-    printf("Server socket initialized. Listening on port %d\n", port);
+    LOG_INFO("socket", "Server socket initialized. Listening on port %d", port);
     return server_fd;
 }
 
 void Socket_run(int server_fd) {
-    printf("Server is running. Waiting for incoming connections...\n");
+    LOG_INFO("socket", "Server is running. Waiting for incoming connections...");
 
     struct sockaddr_in client_addr;
     int c = sizeof(struct sockaddr_in);
@@ -442,29 +745,29 @@ void Socket_run(int server_fd) {
 
     while ((client_sock = accept(server_fd, (struct sockaddr*)&client_addr, (socklen_t*)&c))) {
         if (client_sock < 0) {
-            perror("accept failed");
+            LOG_ERROR("socket", "accept failed: %s", strerror(errno));
             continue;
         }
         
-        printf("Connection accepted from %s:%d\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        LOG_INFO("socket", "Connection accepted from %s:%d", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 
         pthread_t client_thread;
         int* new_sock = malloc(sizeof(int));
         *new_sock = client_sock;
 
         if (pthread_create(&client_thread, NULL, client_handler, (void*)new_sock) < 0) {
-            perror("could not create thread");
+            LOG_ERROR("socket", "could not create thread: %s", strerror(errno));
             free(new_sock);
             close(client_sock);
         } else {
             pthread_detach(client_thread);
-            printf("Handler thread assigned for client %d.\n", client_sock);
+            LOG_DEBUG("socket", "Handler thread assigned for client %d.", client_sock);
         }
     }
     
     // If the loop exits, it's a critical failure.
     if (client_sock < 0) {
-        perror("accept failed, shutting down server");
+        LOG_ERROR("socket", "accept failed, shutting down server: %s", strerror(errno));
         close(server_fd);
     }
 }
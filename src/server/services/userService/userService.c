@@ -1,13 +1,15 @@
 #include "userService.h"
 #include "../../models/usermodel/userModel.h"
 #include "../peachdb/peachdb.h"
+#include "../logService/logService.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 int UserService_createDocument() {
     // First, ensure the database service itself is initialized
     if (Peach_initPeachDb() != 0) {
-        fprintf(stderr, "UserService Error: Failed to initialize PeachDB.\n");
+        LOG_ERROR("user", "Failed to initialize PeachDB.");
         return -1;
     }
 
@@ -20,6 +22,30 @@ int UserService_createDocument() {
     Peach_collection_create("groups", "groupId^groupName^ownerId");
     Peach_collection_create("groupusers", "id^groupId^userId");
     Peach_collection_create("groupmessages", "id^groupId^senderId^message^time");
+    Peach_collection_create("deliverycursors", "userId^lastDmId^lastGroupMsgId");
+
+    // Registration and login look users up by name
+    Peach_index_field("user", "username");
+    Peach_index_ordered("user", "username");
+
+    // Reconnecting clients fetch the messages sent since a point in time
+    Peach_index_range("messages", "time");
+    Peach_index_range("groupmessages", "time");
+
+    // Message history grows without bound: seal it in segments (PEACHDB_SEGMENT_MB, 0 = never)
+    const char* segment_mb = getenv("PEACHDB_SEGMENT_MB");
+    long segment_bytes = (segment_mb != NULL ? atol(segment_mb) : 64) * 1024L * 1024L;
+    Peach_collection_segment("messages", "time", segment_bytes);
+    Peach_collection_segment("groupmessages", "time", segment_bytes);
+
+    // Sealed history is read rarely and compresses well (PEACHDB_COMPRESS=0 keeps it plain)
+    const char* compress = getenv("PEACHDB_COMPRESS");
+    int compress_segments = compress == NULL || strcmp(compress, "0") != 0;
+    Peach_collection_compress("messages", compress_segments);
+    Peach_collection_compress("groupmessages", compress_segments);
+
+    // Warm the indexes now rather than on the first request that needs them
+    Peach_load_indexes(0);
 
     // It will, however, return -1 on other critical errors, which we pass up.
     return 0;
@@ -34,7 +60,7 @@ long UserService_register(const char* username, const char* password) {
     User* existing_user = User_read_by_username(username);
     if (existing_user != NULL) {
         User_free(existing_user);
-        fprintf(stderr, "UserService Error: Username '%s' already exists.\n", username);
+        LOG_ERROR("user", "Username '%s' already exists.", username);
         return -1; // Username is taken
     }
 
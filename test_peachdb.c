@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "src/server/services/peachdb/peachdb.h"
 
 // Helper function to print the contents of a record set
@@ -107,6 +109,202 @@ int main() {
     Peach_free_record_set(users);
     printf("\n");
 
+    printf("[10] Testing record cache consistency...\n");
+    PeachRecordSet* cached = Peach_read_all_records("users"); // Served from the cache
+    Peach_cache_invalidate("users");
+    PeachRecordSet* on_disk = Peach_read_all_records("users"); // Re-read from the file
+    int consistent = cached != NULL && on_disk != NULL && cached->record_count == on_disk->record_count;
+    for (PeachRecord *a = cached ? cached->head : NULL, *b = on_disk ? on_disk->head : NULL;
+         consistent && a != NULL && b != NULL; a = a->next, b = b->next) {
+        for (int i = 0; i < a->num_fields; i++) {
+            if (strcmp(a->fields[i], b->fields[i]) != 0) consistent = 0;
+        }
+    }
+    Peach_free_record_set(cached);
+    Peach_free_record_set(on_disk);
+    if (!consistent || Peach_get_highest_key("users") != 2) {
+        fprintf(stderr, "  FAILURE: Cached records differ from the collection file.\n");
+    } else {
+        printf("  SUCCESS: Cached records match the collection file.\n");
+    }
+    printf("\n");
+
+    printf("[11] Testing Bloom filter lookups...\n");
+    Peach_index_field("users", "name");
+    if (Peach_field_may_contain("users", "name", "Alice") != 1 || Peach_field_may_contain("users", NULL, "1") != 1) {
+        fprintf(stderr, "  FAILURE: Bloom filter rejected a stored value.\n");
+    } else if (Peach_field_may_contain("users", "name", "Zed") != 0) {
+        printf("  NOTE: 'Zed' is a Bloom filter false positive.\n");
+    } else {
+        printf("  SUCCESS: Stored values pass, an absent name is rejected.\n");
+    }
+    printf("\n");
+
+    printf("[12] Testing Peach_query (id >= 2, projected to email)...\n");
+    const int email_only[] = { 2 };
+    PeachPredicate from_two = { .field = 0, .op = PEACH_GE, .number = 2 };
+    PeachQuery query = { .where = &from_two, .where_count = 1, .select = email_only, .select_count = 1 };
+    PeachRecordSet* emails = Peach_query("users", &query);
+    if (emails == NULL || emails->record_count != 1 || strcmp(emails->head->fields[0], "bob.s@work.com") != 0) {
+        fprintf(stderr, "  FAILURE: Unexpected query result.\n");
+    } else {
+        printf("  SUCCESS: Query returned only the projected field of the matching record.\n");
+    }
+    Peach_free_record_set(emails);
+    printf("\n");
+
+    printf("[13] Testing backward scans (Peach_read_last_n, PEACH_ORDER_TAIL)...\n");
+    Peach_set_cache_budget(0); // Force the on-disk path
+    PeachRecordSet* newest = Peach_read_last_n("users", 1);
+    PeachQuery tail_query = { .limit = 2, .order = PEACH_ORDER_TAIL };
+    PeachRecordSet* tail = Peach_query("users", &tail_query);
+    if (newest == NULL || newest->record_count != 1 || strcmp(newest->head->fields[0], "2") != 0) {
+        fprintf(stderr, "  FAILURE: Peach_read_last_n did not return the newest record.\n");
+    } else if (tail == NULL || tail->record_count != 2 || strcmp(tail->head->fields[0], "1") != 0 ||
+               strcmp(tail->head->next->fields[0], "2") != 0) {
+        fprintf(stderr, "  FAILURE: Tail query did not return the last records in file order.\n");
+    } else {
+        printf("  SUCCESS: Newest record first; tail page in file order.\n");
+    }
+    Peach_free_record_set(newest);
+    Peach_free_record_set(tail);
+    Peach_set_cache_budget(8u * 1024u * 1024u); // Back to the default budget
+    printf("\n");
+
+    printf("[14] Testing time-indexed ranges (Peach_range)...\n");
+    Peach_collection_create("events", "id^time");
+    Peach_index_range("events", "time");
+    for (int i = 0; i < 300; i++) {
+        char record[64];
+        snprintf(record, sizeof(record), "%d^2024-01-01 00:%02d:%02d", i + 1, i / 60, i % 60);
+        Peach_write_record("events", record);
+    }
+    PeachRecordSet* window = Peach_range("events", "time", "2024-01-01 00:02:00", "2024-01-01 00:02:09");
+    if (window == NULL || window->record_count != 10 || strcmp(window->head->fields[0], "121") != 0) {
+        fprintf(stderr, "  FAILURE: Range returned the wrong records.\n");
+    } else {
+        printf("  SUCCESS: Range returned exactly the 10 records of the window.\n");
+    }
+    Peach_free_record_set(window);
+    printf("\n");
+
+    printf("[15] Testing online backups (Peach_backup, full then incremental)...\n");
+    PeachBackupStatus backup_status;
+    int full_status = Peach_backup("backup_test", 0);
+    Peach_write_record("events", "301^2024-01-01 00:05:00");
+    int incremental_status = Peach_backup("backup_test", 1);
+    Peach_backup_status(&backup_status);
+    if (full_status != 0 || incremental_status != 0) {
+        fprintf(stderr, "  FAILURE: Backup failed.\n");
+    } else if (backup_status.collections_copied != 0 ||
+               backup_status.bytes_copied != (long long)strlen("301^2024-01-01 00:05:00") + 9 + 1) { // + checksum + newline
+        fprintf(stderr, "  FAILURE: Incremental backup copied %lld bytes.\n", backup_status.bytes_copied);
+    } else {
+        printf("  SUCCESS: The incremental backup copied only the appended record.\n");
+    }
+    printf("\n");
+
+    printf("[16] Testing crash recovery (torn append, Peach_initPeachDb)...\n");
+    FILE* torn = fopen("peachdata/collections/events.lpdb", "a");
+    fputs("302^2024-01-01 00:0", torn); // A crash in the middle of an append
+    fclose(torn);
+    Peach_initPeachDb();
+    PeachRecordSet* recovered = Peach_read_last_n("events", 1);
+    int rewritten = Peach_write_record("events", "302^2024-01-01 00:05:01");
+    PeachRecordSet* after = Peach_read_last_n("events", 1);
+    if (recovered == NULL || strcmp(recovered->head->fields[0], "301") != 0) {
+        fprintf(stderr, "  FAILURE: The torn record was not removed.\n");
+    } else if (rewritten != 0 || after == NULL || strcmp(after->head->fields[1], "2024-01-01 00:05:01") != 0) {
+        fprintf(stderr, "  FAILURE: Could not append after recovery.\n");
+    } else {
+        printf("  SUCCESS: The torn tail was cut off and appends continue cleanly.\n");
+    }
+    Peach_free_record_set(recovered);
+    Peach_free_record_set(after);
+    printf("\n");
+
+    printf("[17] Testing index snapshots (Peach_load_indexes, warm rebuild)...\n");
+    Peach_load_indexes(0);
+    int saved = Peach_save_indexes();
+    Peach_write_record("events", "303^2024-01-01 00:06:00");
+    Peach_cache_invalidate("events"); // The next range rebuilds the index from its snapshot
+    PeachRecordSet* warm = Peach_range("events", "time", "2024-01-01 00:05:30", NULL);
+    if (saved <= 0 || access("peachdata/indexes/events.tidx", F_OK) != 0) {
+        fprintf(stderr, "  FAILURE: No index snapshot was written.\n");
+    } else if (warm == NULL || warm->record_count != 1 || strcmp(warm->head->fields[0], "303") != 0) {
+        fprintf(stderr, "  FAILURE: The index rebuilt from its snapshot missed the appended record.\n");
+    } else {
+        printf("  SUCCESS: The snapshot was reused and caught up with the appended record.\n");
+    }
+    Peach_free_record_set(warm);
+    printf("\n");
+
+    printf("[18] Testing B+tree indexes (Peach_index_ordered, Peach_index_scan)...\n");
+    Peach_index_ordered("events", "time");
+    Peach_delete_record("events", "125");
+    Peach_update_record("events", "126", "126^2024-01-01 00:07:00"); // Moves out of the window
+    PeachRecordSet* ordered = Peach_index_scan("events", "time", "2024-01-01 00:02:00", "2024-01-01 00:02:09", 0);
+    PeachRecordSet* point = Peach_index_scan("events", "time", "2024-01-01 00:07:00", "2024-01-01 00:07:00", 0);
+    if (ordered == NULL || ordered->record_count != 8 || strcmp(ordered->head->fields[0], "121") != 0) {
+        fprintf(stderr, "  FAILURE: The B+tree range missed a delete or an update.\n");
+    } else if (point == NULL || point->record_count != 1 || strcmp(point->head->fields[0], "126") != 0) {
+        fprintf(stderr, "  FAILURE: The B+tree lookup did not find the updated record.\n");
+    } else {
+        printf("  SUCCESS: The B+tree follows writes, updates and deletes.\n");
+    }
+    Peach_free_record_set(ordered);
+    Peach_free_record_set(point);
+    printf("\n");
+
+    printf("[19] Testing segmented collections (Peach_collection_segment)...\n");
+    Peach_collection_create("logs", "id^time");
+    Peach_collection_segment("logs", "time", 256);
+    for (int i = 1; i <= 30; i++) {
+        char log_record[64];
+        snprintf(log_record, sizeof(log_record), "%d^2024-02-01 00:%02d:00", i, i);
+        Peach_write_record("logs", log_record);
+    }
+    int duplicate = Peach_write_record("logs", "3^2024-02-01 00:03:00"); // Sealed by now
+    Peach_update_record("logs", "2", "2^2024-02-01 00:02:30");
+    Peach_delete_record("logs", "4");
+    Peach_initPeachDb(); // Reads the manifest back
+    PeachRecordSet* sealed = Peach_read_last_n("logs", 40);
+    PeachRecordSet* sealed_window = Peach_range("logs", "time", "2024-02-01 00:02:00", "2024-02-01 00:05:00");
+    if (access("peachdata/collections/logs.000001.lpdb", F_OK) != 0 || duplicate == 0) {
+        fprintf(stderr, "  FAILURE: The collection did not roll over, or took a sealed key twice.\n");
+    } else if (sealed == NULL || sealed->record_count != 29 || Peach_get_highest_key("logs") != 30) {
+        fprintf(stderr, "  FAILURE: Reading across segments lost records.\n");
+    } else if (sealed_window == NULL || sealed_window->record_count != 3 || strcmp(sealed_window->head->fields[1], "2024-02-01 00:02:30") != 0) {
+        fprintf(stderr, "  FAILURE: A range over sealed segments missed an update or a delete.\n");
+    } else {
+        printf("  SUCCESS: Sealed segments are read, updated and skipped correctly.\n");
+    }
+    Peach_free_record_set(sealed);
+    Peach_free_record_set(sealed_window);
+    printf("\n");
+
+    printf("[20] Testing compressed segments (Peach_collection_compress)...\n");
+    Peach_collection_compress("logs", 1);
+    int compressed_duplicate = Peach_write_record("logs", "5^2024-02-01 00:05:00");
+    Peach_update_record("logs", "6", "6^2024-02-01 00:06:30");
+    Peach_initPeachDb();
+    PeachRecordSet* inflated = Peach_read_last_n("logs", 40);
+    PeachRecordSet* compressed_window = Peach_range("logs", "time", "2024-02-01 00:06:00", "2024-02-01 00:07:00");
+    if (access("peachdata/collections/logs.000001.lpdz", F_OK) != 0 ||
+        access("peachdata/collections/logs.000001.lpdb", F_OK) == 0 || compressed_duplicate == 0) {
+        fprintf(stderr, "  FAILURE: The segments were not compressed, or a compressed key was taken twice.\n");
+    } else if (inflated == NULL || inflated->record_count != 29) {
+        fprintf(stderr, "  FAILURE: Reading compressed segments lost records.\n");
+    } else if (compressed_window == NULL || compressed_window->record_count != 2 ||
+               strcmp(compressed_window->head->fields[1], "2024-02-01 00:06:30") != 0) {
+        fprintf(stderr, "  FAILURE: An update of a compressed segment was lost.\n");
+    } else {
+        printf("  SUCCESS: Compressed segments read, update and restart like plain ones.\n");
+    }
+    Peach_free_record_set(inflated);
+    Peach_free_record_set(compressed_window);
+    printf("\n");
+
     printf("-----[ Test Finished ]-----\n");
 
     return 0;